@@ -0,0 +1,274 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <malloc.h>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+#include "AST/AST.h"
+#include "SemanticAnalyzer.h"
+#include "Symbol/Region.h"
+#include "Symbol/SymbolTable.h"
+
+using namespace std;
+
+/*******************************************************************************
+ Measures how the time and the peak heap of SemanticAnalyzer::check grow with
+ the size of generated stress programs of each shape, for n = 2^k:
+
+    let       val v = let val x0 = 0 in let val x1 = x0 in ... xn end ... end;
+    tuple     val (a0, a1, ...) = (0, 1.0, 2, 3.0, ...);
+    fn        val v = fn x0 => fn x1 => ... => fn xn => x0;
+    compose   val v = let val c0 = fn x => x in
+                      let val c1 = fn x => c0 (c0 x) in ... cn 0 end ... end;
+    share     val v = let val y0 = 0 in
+                      let val y1 = (y0, y0) in ... yn end ... end;
+
+ The asts are created the way the parser creates them. Each program is
+ checked by a fresh semantic analyzer with a symbol table of its own, in a
+ region whose allocations of symbols are reported, and the growth of the time
+ against the previous size shows whether the check is linear, e.g. about 2 for
+ twice the size. The type of yi in share has i nodes
+ but is 2^i large if the nodes shared are not walked once, thus its check is
+ quadratic rather than exponential. Records are left out, as the
+ type check has no record expressions. The programs are checked by TypeCheck,
+ or by the constraint solver if the third argument is solver.
+*******************************************************************************/
+
+namespace {
+    size_t heapUsed;
+    size_t heapPeak;
+
+    void *allocate(size_t sz) noexcept {
+        auto p = malloc(sz ? sz : 1);
+        if (p) {
+            heapUsed += malloc_usable_size(p);
+            if (heapUsed > heapPeak) {
+                heapPeak = heapUsed;
+            }
+        }
+        return p;
+    }
+
+    void release(void *p) noexcept {
+        if (p) {
+            heapUsed -= malloc_usable_size(p);
+            free(p);
+        }
+    }
+}
+
+void *operator new(size_t sz) {
+    if (auto p = allocate(sz)) {
+        return p;
+    }
+    throw bad_alloc();
+}
+
+void *operator new(size_t sz, const nothrow_t &) noexcept {
+    return allocate(sz);
+}
+
+void operator delete(void *p) noexcept {
+    release(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    release(p);
+}
+
+namespace {
+    shared_ptr<IdAST> id(const string &name) {
+        return AST::create<AlphanumericIdAST>(name);
+    }
+
+    shared_ptr<ExpAST> var(const string &name) {
+        return AST::create<ValueOrConstructorIdentifierExpAST>(
+                AST::create<LongIdAST>(vector<shared_ptr<IdAST>>{id(name)}));
+    }
+
+    shared_ptr<PatAST> pat(const string &name) {
+        return AST::create<VariablePatAST>(id(name));
+    }
+
+    shared_ptr<ExpAST> integer(int v) {
+        return AST::create<ConstantExpAST>(AST::create<IntConAST>(v));
+    }
+
+    shared_ptr<ExpAST> real(double v) {
+        return AST::create<ConstantExpAST>(AST::create<FloatConAST>(v));
+    }
+
+    shared_ptr<ValueDecAST> val(shared_ptr<PatAST> p, shared_ptr<ExpAST> e) {
+        return AST::create<ValueDecAST>(
+                AST::create<DestructuringValBindAST>(std::move(p),
+                                                     std::move(e)));
+    }
+
+    shared_ptr<ExpAST> let(shared_ptr<DecAST> dec, shared_ptr<ExpAST> e) {
+        return AST::create<LocalDeclarationExpAST>(
+                std::move(dec), vector<shared_ptr<ExpAST>>{std::move(e)});
+    }
+
+    shared_ptr<ExpAST> fn(const string &param, shared_ptr<ExpAST> e) {
+        return AST::create<FunctionExpAST>(
+                AST::create<MatchAST>(pat(param), std::move(e)));
+    }
+
+    shared_ptr<ExpAST> call(const string &f, shared_ptr<ExpAST> e) {
+        return AST::create<ApplicationExpAST>(var(f), std::move(e));
+    }
+
+    string numbered(const char *prefix, size_t i) {
+        return prefix + to_string(i);
+    }
+
+    /**
+     * let val x0 = 0 in let val x1 = x0 in ... xn end ... end
+     */
+    shared_ptr<AST> createLet(size_t n) {
+        shared_ptr<ExpAST> exp = var(numbered("x", n - 1));
+        for (size_t i = n; i-- > 0;) {
+            auto init = i ? var(numbered("x", i - 1)) : integer(0);
+            exp = let(val(pat(numbered("x", i)), init), exp);
+        }
+        return val(pat("v"), exp);
+    }
+
+    /**
+     * val (a0, a1, ...) = (0, 1.0, 2, 3.0, ...)
+     */
+    shared_ptr<AST> createTuple(size_t n) {
+        vector<shared_ptr<PatAST>> pats;
+        vector<shared_ptr<ExpAST>> exps;
+        for (size_t i = 0; i < n; ++i) {
+            pats.push_back(pat(numbered("a", i)));
+            exps.push_back(i % 2 ? real(double(i)) : integer(int(i)));
+        }
+        return val(AST::create<TuplePatAST>(std::move(pats)),
+                   AST::create<TupleExpAST>(std::move(exps)));
+    }
+
+    /**
+     * fn x0 => fn x1 => ... => fn xn => x0
+     */
+    shared_ptr<AST> createFn(size_t n) {
+        auto exp = var("x0");
+        for (size_t i = n; i-- > 0;) {
+            exp = fn(numbered("x", i), exp);
+        }
+        return val(pat("v"), exp);
+    }
+
+    /**
+     * let val c0 = fn x => x in
+     * let val c1 = fn x => c0 (c0 x) in ... cn 0 end ... end
+     */
+    shared_ptr<AST> createCompose(size_t n) {
+        auto exp = call(numbered("c", n - 1), integer(0));
+        for (size_t i = n; i-- > 0;) {
+            auto body = var("x");
+            if (i) {
+                auto previous = numbered("c", i - 1);
+                body = call(previous, call(previous, body));
+            }
+            exp = let(val(pat(numbered("c", i)), fn("x", body)), exp);
+        }
+        return val(pat("v"), exp);
+    }
+
+    /**
+     * let val y0 = 0 in let val y1 = (y0, y0) in ... yn end ... end
+     */
+    shared_ptr<AST> createShare(size_t n) {
+        shared_ptr<ExpAST> exp = var(numbered("y", n - 1));
+        for (size_t i = n; i-- > 0;) {
+            shared_ptr<ExpAST> init = integer(0);
+            if (i) {
+                auto previous = numbered("y", i - 1);
+                init = AST::create<TupleExpAST>(
+                        vector<shared_ptr<ExpAST>>{var(previous),
+                                                   var(previous)});
+            }
+            exp = let(val(pat(numbered("y", i)), init), exp);
+        }
+        return val(pat("v"), exp);
+    }
+
+    struct Shape {
+        const char *name;
+
+        shared_ptr<AST> (*create)(size_t n);
+    };
+
+    const Shape shapes[] = {
+            {"let",     createLet},
+            {"tuple",   createTuple},
+            {"fn",      createFn},
+            {"compose", createCompose},
+            {"share",   createShare},
+    };
+
+    struct Result {
+        double checkMs{};
+        size_t peakBytes{};
+        Region::Statistics symbols{};
+        bool ok{};
+    };
+
+    auto engine = SemanticAnalyzer::InferenceEngine::TYPE_CHECK;
+
+    Result run(const Shape &shape, size_t n) {
+        using clock = chrono::steady_clock;
+        Region region;
+        Region::Scope _1{region};
+        auto ast = shape.create(n);
+        Result result;
+        {
+            SymbolTable symbolTable;
+            SemanticAnalyzer semanticAnalyzer(&symbolTable);
+            semanticAnalyzer.setInferenceEngine(engine);
+            auto base = heapUsed;
+            heapPeak = heapUsed;
+            auto start = clock::now();
+            result.ok = bool(semanticAnalyzer.check(ast));
+            auto end = clock::now();
+            result.checkMs = chrono::duration<double, milli>(end - start).count();
+            result.peakBytes = heapPeak - base;
+            result.symbols = region.getStatistics();
+        }
+        Type::clearInterned(region);
+        return result;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t maxN = argc > 1 ? size_t(atol(argv[1])) : 4096u;
+    size_t minN = argc > 2 ? size_t(atol(argv[2])) : 64u;
+    if (argc > 3 && string(argv[3]) == "solver") {
+        engine = SemanticAnalyzer::InferenceEngine::CONSTRAINT_SOLVER;
+    }
+    bool failed = false;
+    printf("%-8s %8s %12s %8s %14s %8s %10s %12s\n",
+           "shape", "n", "check ms", "growth", "peak bytes", "growth",
+           "symbols", "bytes");
+    for (auto &&shape : shapes) {
+        Result previous;
+        for (size_t n = minN; n <= maxN; n *= 2) {
+            auto result = run(shape, n);
+            failed |= !result.ok;
+            auto timeGrowth = previous.checkMs > 0
+                              ? result.checkMs / previous.checkMs : 0;
+            auto peakGrowth = previous.peakBytes
+                              ? double(result.peakBytes) / previous.peakBytes
+                              : 0;
+            printf("%-8s %8zu %12.3f %8.2f %14zu %8.2f %10zu %12zu%s\n",
+                   shape.name, n, result.checkMs, timeGrowth,
+                   result.peakBytes, peakGrowth, result.symbols.allocations,
+                   result.symbols.bytes, result.ok ? "" : " failed");
+            previous = result;
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,110 @@
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "AST/AST.h"
+#include "SemanticAnalyzer.h"
+#include "Symbol/SymbolTable.h"
+
+using namespace std;
+
+/*******************************************************************************
+ Measures what hash consing in AST::create saves on a generated program which
+ repeats the same constants and type annotations, like
+
+    val v0 : real -> real = fn x : real => 2.0 : real;
+    val v1 : real -> real = fn x : real => 2.0 : real;
+    ...
+
+ The asts are created the way the parser creates them, then checked by the
+ semantic analyzer.
+*******************************************************************************/
+
+namespace {
+    shared_ptr<TypAST> createRealTyp() {
+        return AST::create<ConstructorTypAST>(
+                AST::create<LongIdAST>(vector<shared_ptr<IdAST>>{
+                        AST::create<AlphanumericIdAST>("real")}));
+    }
+
+    shared_ptr<PatAST> createRealPat(const string &name) {
+        return AST::create<TypeAnnotationPatAST>(
+                AST::create<VariablePatAST>(
+                        AST::create<AlphanumericIdAST>(name)),
+                createRealTyp());
+    }
+
+    shared_ptr<AST> createDec(size_t i) {
+        auto typ = AST::create<FunctionTypAST>(createRealTyp(),
+                                               createRealTyp());
+        auto exp = AST::create<FunctionExpAST>(
+                AST::create<MatchAST>(
+                        createRealPat("x"),
+                        AST::create<TypeAnnotationExpAST>(
+                                AST::create<ConstantExpAST>(
+                                        AST::create<FloatConAST>(2.0)),
+                                createRealTyp())));
+        auto pat = AST::create<TypeAnnotationPatAST>(
+                AST::create<VariablePatAST>(
+                        AST::create<AlphanumericIdAST>("v" + to_string(i))),
+                typ);
+        return AST::create<ValueDecAST>(
+                AST::create<DestructuringValBindAST>(pat, exp));
+    }
+
+    struct Result {
+        double createMs{};
+        double checkMs{};
+        size_t failures{};
+        AST::HashConsStatistics statistics;
+    };
+
+    Result run(size_t n, bool hashConsing) {
+        using clock = chrono::steady_clock;
+        Result result;
+        SymbolTable::reset();
+        AST::clearHashConsing();
+        AST::setHashConsing(hashConsing);
+
+        auto start = clock::now();
+        vector<shared_ptr<AST>> decs;
+        decs.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            decs.push_back(createDec(i));
+        }
+        auto created = clock::now();
+        SemanticAnalyzer semanticAnalyzer;
+        for (auto &&dec : decs) {
+            if (!semanticAnalyzer.check(dec)) {
+                ++result.failures;
+            }
+        }
+        auto checked = clock::now();
+
+        result.createMs = chrono::duration<double, milli>(created - start).count();
+        result.checkMs = chrono::duration<double, milli>(checked - created).count();
+        result.statistics = AST::getHashConsStatistics();
+        AST::setHashConsing(false);
+        return result;
+    }
+
+    void print(const char *name, const Result &result) {
+        printf("%-8s create %8.2f ms, check %8.2f ms, failures %zu, "
+               "shared %zu of %zu asts, saved %zu bytes\n",
+               name, result.createMs, result.checkMs, result.failures,
+               result.statistics.hits,
+               result.statistics.hits + result.statistics.misses,
+               result.statistics.savedBytes);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = argc > 1 ? size_t(atol(argv[1])) : 10000u;
+    auto plain = run(n, false);
+    auto shared = run(n, true);
+    printf("declarations: %zu\n", n);
+    print("plain", plain);
+    print("shared", shared);
+    return plain.failures == shared.failures ? 0 : 1;
+}
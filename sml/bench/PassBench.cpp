@@ -0,0 +1,143 @@
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AST/AST.h"
+#include "AST/ASTAnalyses.h"
+#include "AST/ASTPass.h"
+
+using namespace std;
+
+/*******************************************************************************
+ Measures the node counting, constant detection, name resolution and free
+ variable passes run over a generated program
+
+    fun f0 x = (x + y0) * (1 + 2);
+    val z0 = f0 (1 + 2);
+    ...
+
+ once per pass, fused in a single traversal, and fused over the declarations
+ in parallel.
+*******************************************************************************/
+
+namespace {
+    shared_ptr<IdAST> createId(const string &name) {
+        return AST::create<AlphanumericIdAST>(name);
+    }
+
+    shared_ptr<ExpAST> createVar(const string &name) {
+        return AST::create<ValueOrConstructorIdentifierExpAST>(
+                AST::create<LongIdAST>(vector<shared_ptr<IdAST>>{
+                        createId(name)}));
+    }
+
+    shared_ptr<ExpAST> createSum() {
+        return AST::create<ParenthesesExpAST>(
+                AST::create<InfixApplicationExpAST>(
+                        AST::create<ConstantExpAST>(AST::create<IntConAST>(1)),
+                        createId("+"),
+                        AST::create<ConstantExpAST>(AST::create<IntConAST>(2))));
+    }
+
+    vector<shared_ptr<AST>> createProgram(size_t n) {
+        vector<shared_ptr<AST>> decs;
+        for (size_t i = 0; i < n; ++i) {
+            auto f = "f" + to_string(i);
+            auto body = AST::create<InfixApplicationExpAST>(
+                    AST::create<ParenthesesExpAST>(
+                            AST::create<InfixApplicationExpAST>(
+                                    createVar("x"),
+                                    createId("+"),
+                                    createVar("y" + to_string(i)))),
+                    createId("*"),
+                    createSum());
+            decs.push_back(AST::create<FunctionDecAST>(
+                    AST::create<FunBindAST>(
+                            AST::create<NonFixFunMatchAST>(
+                                    createId(f),
+                                    vector<shared_ptr<PatAST>>{
+                                            AST::create<VariablePatAST>(
+                                                    createId("x"))},
+                                    body))));
+            decs.push_back(AST::create<ValueDecAST>(
+                    AST::create<DestructuringValBindAST>(
+                            AST::create<VariablePatAST>(
+                                    createId("z" + to_string(i))),
+                            AST::create<ApplicationExpAST>(
+                                    createVar(f), createSum()))));
+        }
+        return decs;
+    }
+
+    struct Passes {
+        NodeCountPass nodeCount;
+        ConstantPass constant;
+        NameResolutionPass nameResolution;
+        FreeVariablePass freeVariable;
+
+        [[nodiscard]] vector<ASTPass *> all() {
+            return {&nodeCount, &constant, &nameResolution, &freeVariable};
+        }
+
+        [[nodiscard]] size_t checksum() const {
+            return nodeCount.getTotal()
+                   + constant.getConstants().size()
+                   + nameResolution.getUseCount();
+        }
+    };
+
+    template<typename TFunc>
+    double measure(TFunc &&func) {
+        auto start = chrono::steady_clock::now();
+        func();
+        auto end = chrono::steady_clock::now();
+        return chrono::duration<double, milli>(end - start).count();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = argc > 1 ? size_t(atol(argv[1])) : 50000u;
+    unsigned threads = argc > 2 ? unsigned(atoi(argv[2]))
+                                : max(thread::hardware_concurrency(), 1u);
+    auto decs = createProgram(n);
+
+    Passes separate;
+    auto separateMs = measure([&] {
+        for (auto pass : separate.all()) {
+            ASTPassManager manager;
+            manager.addPass(*pass);
+            manager.run(decs);
+        }
+    });
+
+    Passes fused;
+    auto fusedMs = measure([&] {
+        ASTPassManager manager;
+        for (auto pass : fused.all()) {
+            manager.addPass(*pass);
+        }
+        manager.run(decs);
+    });
+
+    Passes parallel;
+    auto parallelMs = measure([&] {
+        ASTPassManager manager;
+        for (auto pass : parallel.all()) {
+            manager.addPass(*pass);
+        }
+        manager.run(decs, threads);
+    });
+
+    printf("declarations: %zu, asts: %zu\n", decs.size(),
+           fused.nodeCount.getTotal());
+    printf("separate:          %8.2f ms (checksum %zu)\n",
+           separateMs, separate.checksum());
+    printf("fused:             %8.2f ms (checksum %zu)\n",
+           fusedMs, fused.checksum());
+    printf("fused, %2u threads: %8.2f ms (checksum %zu)\n",
+           threads, parallelMs, parallel.checksum());
+    return separate.checksum() == fused.checksum()
+           && fused.checksum() == parallel.checksum() ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include "Symbol/Region.h"
+#include "Symbol/SymbolTable.h"
+
+using namespace std;
+
+/*******************************************************************************
+ Measures the startup of a session, i.e. creating the symbol table of the
+ builtin symbols in the region of the session, like an interpreter does.
+
+ The first table creates the builtin symbols for the process, and the others
+ only share them, so a table after the first is to allocate no symbol in the
+ region of its session.
+*******************************************************************************/
+
+namespace {
+    struct Result {
+        double ms{};
+        size_t symbols{};
+    };
+
+    Result run(size_t n) {
+        using clock = chrono::steady_clock;
+        Result result;
+        auto start = clock::now();
+        for (size_t i = 0; i < n; ++i) {
+            Region region;
+            Region::Scope _1{region};
+            auto symbolTable = make_unique<SymbolTable>();
+            symbolTable.reset();
+            result.symbols += region.getStatistics().allocations;
+        }
+        result.ms = chrono::duration<double, milli>(clock::now() - start)
+                .count();
+        return result;
+    }
+
+    void print(const char *name, size_t n, const Result &result) {
+        printf("%-6s tables %8zu, total %10.3f ms, per table %8.3f us, "
+               "symbols %zu\n",
+               name, n, result.ms, result.ms * 1000 / double(n),
+               result.symbols);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = argc > 1 ? size_t(atol(argv[1])) : 10000u;
+    auto first = run(1);
+    auto others = run(n);
+    print("first", 1, first);
+    print("others", n, others);
+    return others.symbols == 0 ? 0 : 1;
+}
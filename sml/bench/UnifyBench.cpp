@@ -0,0 +1,110 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Symbol/SymbolTable.h"
+#include "../src/SemanticAnalyzer/TypeCheck.h"
+
+using namespace std;
+
+/*******************************************************************************
+ Measures unifying long chains of type variables
+
+    'a0 = 'a1, 'a1 = 'a2, ..., 'an-1 = int     (chain)
+    'a0 = 'a1, 'a0 = 'a2, ..., 'a0 = int       (star)
+
+ by the union-find kept in the variables by TypeCheck, against the previous
+ one kept in a map from a type to its parent. Without union by rank, the
+ latter finds the first variable of the chain as deep as the chain is, thus
+ it may run out of stack for millions of variables.
+*******************************************************************************/
+
+namespace {
+    /**
+     * The union-find of types in a map, as TypeCheck did before.
+     */
+    class MapUnionFind {
+    public:
+        Type *find(Type *t) {
+            if (dsu[t] == nullptr) {
+                return dsu[t] = t;
+            }
+            return t == dsu[t] ? t : dsu[t] = find(dsu[t]);
+        }
+
+        Type *unify(Type *s, Type *t) {
+            s = find(s);
+            t = find(t);
+            if (s == t) {
+                return t;
+            }
+            if (s->getTypeId() == Type::VARIABLE_TYPE_NAME) {
+                return dsu[s] = t;
+            }
+            if (t->getTypeId() == Type::VARIABLE_TYPE_NAME) {
+                return dsu[t] = s;
+            }
+            return nullptr;
+        }
+
+    private:
+        unordered_map<Type *, Type *> dsu;
+    };
+
+    vector<Type *> createVariables(size_t n) {
+        vector<Type *> vars;
+        vars.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            vars.push_back(VariableTypeNameType::create("'a" + to_string(i)));
+        }
+        return vars;
+    }
+
+    /**
+     * Unify the variables in a chain or a star, then the last one with int.
+     * @return The time in milliseconds, or a negative number if the first
+     * variable is not unified with int.
+     */
+    template<typename TUnionFind>
+    double run(const vector<Type *> &vars, bool chain) {
+        using clock = chrono::steady_clock;
+        auto intType = IntType::create();
+        auto start = clock::now();
+        TUnionFind unionFind;
+        for (size_t i = 1; i < vars.size(); ++i) {
+            unionFind.unify(vars[chain ? i - 1 : 0], vars[i]);
+        }
+        unionFind.unify(vars.back(), intType);
+        auto ok = unionFind.find(vars.front()) == intType;
+        auto end = clock::now();
+        return ok ? chrono::duration<double, milli>(end - start).count() : -1;
+    }
+
+    /**
+     * TypeCheck exposing its union-find.
+     */
+    class InlineUnionFind : public TypeCheck {
+    public:
+        Type *find(Type *t) {
+            return verify(t);
+        }
+    };
+
+    void print(const char *name, double mapMs, double inlineMs) {
+        printf("%-6s map %9.2f ms, inline %9.2f ms\n", name, mapMs, inlineMs);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = argc > 1 ? size_t(atol(argv[1])) : 100000u;
+    auto vars = createVariables(n);
+    auto chainMap = run<MapUnionFind>(vars, true);
+    auto chainInline = run<InlineUnionFind>(vars, true);
+    auto starMap = run<MapUnionFind>(vars, false);
+    auto starInline = run<InlineUnionFind>(vars, false);
+    printf("variables: %zu\n", n);
+    print("chain", chainMap, chainInline);
+    print("star", starMap, starInline);
+    return chainMap < 0 || chainInline < 0 || starMap < 0 || starInline < 0;
+}
@@ -0,0 +1,110 @@
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include "AST/AST.h"
+#include "AST/ASTTypedVisitor.h"
+#include "AST/ASTVisitor.h"
+
+using namespace std;
+
+/*******************************************************************************
+ Measures the per node overhead of visiting asts with the virtual ASTVisitor,
+ whose unhandled asts are forwarded up the class hierarchy, and with the
+ statically dispatched ASTTypedVisitor.
+*******************************************************************************/
+
+namespace {
+    class VirtualCounter : public ASTVisitor {
+    public:
+        void *visit(AST *ast) override {
+            ++count;
+            return ast;
+        }
+
+        void *visit(ExpAST *ast) override {
+            count += 2;
+            return ast;
+        }
+
+        size_t count{};
+    };
+
+    class TypedCounter : public ASTTypedVisitor<TypedCounter, size_t> {
+    public:
+        using ASTTypedVisitor::visit;
+
+        size_t visit(AST *) {
+            return 1;
+        }
+
+        size_t visit(ExpAST *) {
+            return 2;
+        }
+    };
+
+    vector<shared_ptr<AST>> makeNodes(size_t n) {
+        vector<shared_ptr<AST>> nodes;
+        nodes.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            switch (i % 4) {
+                case 0:
+                    nodes.push_back(AST::create<IntConAST>(int(i)));
+                    break;
+                case 1:
+                    nodes.push_back(AST::create<ConstantExpAST>(
+                            AST::create<IntConAST>(int(i))));
+                    break;
+                case 2:
+                    nodes.push_back(AST::create<NonFixFunMatchAST>(
+                            AST::create<AlphanumericIdAST>("f"),
+                            vector<shared_ptr<PatAST>>{},
+                            nullptr));
+                    break;
+                default:
+                    nodes.push_back(AST::create<VariablePatAST>(
+                            AST::create<AlphanumericIdAST>("x")));
+                    break;
+            }
+        }
+        return nodes;
+    }
+
+    template<typename TFunc>
+    double measure(const vector<shared_ptr<AST>> &nodes, int rounds,
+                   TFunc &&func) {
+        auto start = chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (auto &&node : nodes) {
+                func(node.get());
+            }
+        }
+        auto end = chrono::steady_clock::now();
+        auto ns = chrono::duration<double, nano>(end - start).count();
+        return ns / (double(nodes.size()) * rounds);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = argc > 1 ? size_t(atol(argv[1])) : 1u << 16u;
+    int rounds = argc > 2 ? atoi(argv[2]) : 50;
+    auto nodes = makeNodes(n);
+
+    VirtualCounter virtualCounter;
+    auto virtualNs = measure(nodes, rounds, [&](AST *ast) {
+        ast->accept(&virtualCounter);
+    });
+
+    TypedCounter typedCounter;
+    size_t typedCount{};
+    auto typedNs = measure(nodes, rounds, [&](AST *ast) {
+        typedCount += typedCounter.dispatch(ast);
+    });
+
+    printf("nodes: %zu, rounds: %d\n", n, rounds);
+    printf("ASTVisitor:      %6.2f ns/visit (checksum %zu)\n",
+           virtualNs, virtualCounter.count);
+    printf("ASTTypedVisitor: %6.2f ns/visit (checksum %zu)\n",
+           typedNs, typedCount);
+    return virtualCounter.count == typedCount ? 0 : 1;
+}
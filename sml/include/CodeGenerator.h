@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include "AST/ASTVisitor.h"
 
 namespace llvm {
@@ -10,14 +11,37 @@ namespace llvm {
 
 class AST;
 
+class ConstantExpAST;
+
+class SymbolTable;
+
+struct JITModule;
+
 class CodeGenerator : public ASTVisitor {
 public:
-    CodeGenerator();
+    /**
+     * @param symbolTable The symbol table the names are looked up in, or null
+     * for the default one.
+     * @param jitModule The state of the code generated, shared with the JIT
+     * running it, or null for the default one.
+     */
+    explicit CodeGenerator(SymbolTable *symbolTable = nullptr,
+                           JITModule *jitModule = nullptr);
 
     ~CodeGenerator();
 
     llvm::Function *generate(const std::shared_ptr<AST>& ast);
 
+    /**
+     * Bind a name to a constant, e.g. of a value declaration folded by the
+     * semantic analyzer, for the code generated after to refer to, without
+     * generating a function.
+     * @param name The name.
+     * @param constant The constant.
+     */
+    void bind(const std::string &name,
+              const std::shared_ptr<ConstantExpAST> &constant);
+
     void *visit(ExpAST *ast) override;
 
 //    void *visit(LocalDeclarationExpAST *ast) override ;
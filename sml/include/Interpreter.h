@@ -17,14 +17,43 @@ class CodeGenerator;
 
 class JIT;
 
+class Region;
+
+class SymbolTable;
+
 class Interpreter {
 public:
     explicit Interpreter(std::istream &in);
 
+    /**
+     * Create a session starting with the symbols of another, e.g. of a
+     * library loaded once, forked in constant time, and with the functions
+     * it compiled, compiled again by the new session once called. The code
+     * of the new session can only refer to the values of the other bound to
+     * constants, e.g. val x = 1, not to those computed, e.g. val y = f x,
+     * which it is to bind again. The other session is to outlive it, and is
+     * not to interpret in parallel with it.
+     * @param in The input.
+     * @param base The session forked.
+     */
+    Interpreter(std::istream &in, const Interpreter &base);
+
     ~Interpreter();
 
     void interpret();
 
+    /**
+     * Get the region the symbols of the session are allocated in, e.g. for
+     * its statistics.
+     */
+    [[nodiscard]] Region &getRegion() const;
+
+    /**
+     * Get the symbol table of the session, independent of those of the other
+     * interpreters.
+     */
+    [[nodiscard]] SymbolTable *getSymbolTable() const;
+
     friend class ParserInterface;
 
     class ParserInterface {
@@ -1,10 +1,39 @@
 #pragma once
 
+#include <memory>
+
 namespace llvm {
     class Value;
 }
 
+class ConstantExpAST;
+
+class SymbolTable;
+
+struct JITModule;
+
 class JIT {
 public:
+    /**
+     * @param symbolTable The symbol table of the types printed, or null for
+     * the default one.
+     * @param jitModule The state of the code run, shared with the code
+     * generator, or null for the default one.
+     */
+    explicit JIT(SymbolTable *symbolTable = nullptr,
+                 JITModule *jitModule = nullptr);
+
     void run(llvm::Function* theFun);
+
+    /**
+     * Print the value of a top-level expression folded into a constant by the
+     * semantic analyzer, which needs not to be compiled.
+     * @param exp The constant expression.
+     */
+    void run(const std::shared_ptr<ConstantExpAST> &exp);
+
+private:
+    SymbolTable *_symbolTable;
+
+    JITModule *_jitModule;
 };
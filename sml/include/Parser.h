@@ -27,14 +27,20 @@ class Interpreter;
 
 class Parser {
 public:
-    explicit Parser(Interpreter *interpreter);
+    /**
+     * @param symbolTable The symbol table of the operators declared, or null
+     * for the default one.
+     */
+    explicit Parser(Interpreter *interpreter,
+                    SymbolTable *symbolTable = nullptr);
 
-    explicit Parser(Scanner &scanner);
+    explicit Parser(Scanner &scanner, SymbolTable *symbolTable = nullptr);
 
     std::shared_ptr<AST> parse();
 
 private:
     Interpreter *interpreter{};
+    SymbolTable *symbolTable;
     std::shared_ptr<Token> curTok; //Store the current token
     std::string tokVal;
     Token::Type tokType;
@@ -1,22 +1,120 @@
 #pragma once
 
+#include <cstddef>
+#include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
 class AST;
 
+class SymbolTable;
+
 class SemanticAnalyzer {
 public:
-    SemanticAnalyzer();
+    /**
+     * @param symbolTable The symbol table the names are bound in, or null for
+     * the default one.
+     */
+    explicit SemanticAnalyzer(SymbolTable *symbolTable = nullptr);
 
     ~SemanticAnalyzer();
 
     /**
-     * Do a context check for built ast.
+     * Do a context check for built ast, inline the calls of small functions
+     * declared before, and fold its constant expressions.
      * @param ast The ast built by parser.
-     * @return The original AST if no semantic error, otherwise a nullptr.
+     * @return The AST with calls inlined and constants folded if no semantic
+     * error, otherwise a nullptr. It is the original AST if nothing changes.
      */
     std::shared_ptr<AST> check(const std::shared_ptr<AST> &ast);
 
+    /**
+     * Check top-level asts as if they were checked one by one, with the asts
+     * not depending on each other type checked in parallel. An ast depends
+     * on the last ast before it which may bind any name it uses, and it is
+     * checked once that ast is checked. The names bound, the errors reported
+     * and the results are the same as check of each ast in order.
+     * @param asts The top-level asts built by parser, in order.
+     * @param threads The number of threads to check in parallel.
+     * @return The result of check of each ast.
+     */
+    std::vector<std::shared_ptr<AST>>
+    checkAll(const std::vector<std::shared_ptr<AST>> &asts, unsigned threads);
+
+    /**
+     * Get the calls of small functions inlined by the last successful check.
+     * @return The number of inlined calls of each function.
+     */
+    [[nodiscard]] const std::map<std::string, size_t> &getInlinedCalls() const;
+
+    /**
+     * Set the maximum number of asts in the body of a function to inline.
+     * @param threshold The threshold, 0 to disable inlining.
+     */
+    void setInlineThreshold(size_t threshold);
+
+    /**
+     * Statistics of the type checks of top-level asts. The types inferred
+     * for a top-level ast are reused by a later check of an identical one,
+     * e.g. when a script is run again, if the free names it uses have the
+     * same types as before.
+     */
+    struct TypeCacheStatistics {
+        /**
+         * The number of checks reusing the cached types.
+         */
+        size_t hits{};
+
+        /**
+         * The number of checks inferring the types.
+         */
+        size_t misses{};
+    };
+
+    [[nodiscard]] TypeCacheStatistics getTypeCacheStatistics() const;
+
+    /**
+     * The engines inferring the types of a top-level ast.
+     */
+    enum class InferenceEngine {
+        TYPE_CHECK, ///< unify the types while visiting the ast
+        CONSTRAINT_SOLVER, ///< emit the constraints of the ast, then solve them
+        DIFFERENTIAL, ///< both, keeping the result of the type check
+    };
+
+    /**
+     * Select the engine of the next checks. An ast with a type the
+     * constraint solver does not model, e.g. a record, is type checked
+     * instead. checkAll type checks the asts in parallel regardless.
+     * @param engine The engine.
+     */
+    void setInferenceEngine(InferenceEngine engine);
+
+    /**
+     * Statistics of the differential checks, which infer the types of each
+     * ast by both engines and compare them.
+     */
+    struct DifferentialStatistics {
+        /**
+         * The number of asts inferred by both engines.
+         */
+        size_t checks{};
+
+        /**
+         * The number of asts the engines disagree on, i.e. whether it is
+         * well typed, the types bound up to the names of the variables, or
+         * the resolved primitives.
+         */
+        size_t mismatches{};
+
+        double typeCheckSeconds{};
+
+        double solverSeconds{};
+    };
+
+    [[nodiscard]] DifferentialStatistics getDifferentialStatistics() const;
+
 private:
     struct Impl;
 
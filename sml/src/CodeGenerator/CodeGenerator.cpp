@@ -25,99 +25,91 @@
 
 using namespace std;
 
-CodeGenerator::CodeGenerator() : _impl(make_unique<Impl>()) {
-    using namespace llvm;
-    InitializeNativeTarget();
-    InitializeNativeTargetAsmPrinter();
-    InitializeNativeTargetAsmParser();
-    TheJIT = llvm::make_unique<llvm::orc::KaleidoscopeJIT>();
+CodeGenerator::CodeGenerator(SymbolTable *symbolTable, JITModule *jitModule)
+        : _impl(make_unique<Impl>(
+                symbolTable ? symbolTable : SymbolTable::getInstance(),
+                jitModule ? jitModule : JITModule::getInstance())) {
+
 }
 
 CodeGenerator::~CodeGenerator() = default;
 
 
-llvm::Function *CodeGenerator::generate(const std::shared_ptr<AST> &ast) {
-    _ast = ast;
-    return (llvm::Function*) ast->accept(this);
-
-    ///ast为函数体
-    if (auto exp = dynamic_pointer_cast<ExpAST>(ast)) {
-        if (auto temInfixApplicationAST = dynamic_pointer_cast<InfixApplicationExpAST>(exp)) {
-//            std::shared_ptr<IdAST> id( new AlphanumericIdAST(temInfixApplicationAST->getId()->get()));
-            std::shared_ptr<IdAST> id(new AlphanumericIdAST("__anon_expr"));
-            auto Proto = llvm::make_unique<FunMatchAST>(std::move(id),
-                                                        std::vector<std::shared_ptr<PatAST>>(), temInfixApplicationAST);
-            auto FnBind = llvm::make_unique<FunBindAST>(std::move(Proto));
-            auto FnAST = llvm::make_unique<FunctionDecAST>(std::move(FnBind));
-            return static_cast<llvm::Function *>(FnAST->accept(&_impl->codeGen));
-        } else if (auto appExp = dynamic_pointer_cast<ApplicationExpAST>(exp)) {
-            std::shared_ptr<IdAST> id(new AlphanumericIdAST("__anon_expr"));
-            auto Proto = llvm::make_unique<FunMatchAST>(std::move(id),
-                                                        std::vector<std::shared_ptr<PatAST>>(), appExp);
-            auto FnBind = llvm::make_unique<FunBindAST>(std::move(Proto));
-            auto FnAST = llvm::make_unique<FunctionDecAST>(std::move(FnBind));
-            return static_cast<llvm::Function *>(FnAST->accept(&_impl->codeGen));
-        } else if (auto temLet = dynamic_pointer_cast<LocalDeclarationExpAST>(exp)) {
-            std::shared_ptr<IdAST> id(new AlphanumericIdAST("__anon_expr"));
-            auto temSequence = dynamic_pointer_cast<SequenceDecAST>(temLet->getDec());
-            std::vector<std::shared_ptr<PatAST>> temPats;
-            for (int i = 0; i < temSequence->getDecs().size(); i++) {
-                auto tem = dynamic_pointer_cast<ValueDecAST>(temSequence->getDecs()[i]);
-                auto tem2 = dynamic_pointer_cast<DestructuringValBindAST>(tem->getValBind());
-                temPats.push_back(tem2->getPat());
-            }
-            std::shared_ptr<TupleExpAST> temTuple(new TupleExpAST(temLet->getExps()));
-            auto Proto = llvm::make_unique<FunMatchAST>(std::move(id), temPats, temTuple);
+/**
+ * Generate a function of the name, parameters and body.
+ * @param codeGen The code generator of asts.
+ * @param name The name of the function.
+ * @param pats The parameters of the function.
+ * @param exp The body of the function.
+ * @return The generated function, or null if any error occurred.
+ */
+static llvm::Function *generateFunction(CodeGen &codeGen,
+                                        const std::string &name,
+                                        std::vector<std::shared_ptr<PatAST>> pats,
+                                        std::shared_ptr<ExpAST> exp) {
+    auto Proto = AST::create<FunMatchAST>(AST::create<AlphanumericIdAST>(name),
+                                          std::move(pats), std::move(exp));
+    auto FnBind = AST::create<FunBindAST>(std::move(Proto));
+    auto FnAST = AST::create<FunctionDecAST>(std::move(FnBind));
+    return static_cast<llvm::Function *>(codeGen.dispatch(FnAST));
+}
 
-            auto FnBind = llvm::make_unique<FunBindAST>(std::move(Proto));
-            auto FnAST = llvm::make_unique<FunctionDecAST>(std::move(FnBind));
-            return static_cast<llvm::Function *>(FnAST->accept(&_impl->codeGen));
-        } else {
-            //创建匿名函数
-            std::shared_ptr<IdAST> id(new AlphanumericIdAST("__anon_expr"));
-            auto Proto = llvm::make_unique<FunMatchAST>(std::move(id), std::vector<std::shared_ptr<PatAST>>(), exp);
-            auto FnBind = llvm::make_unique<FunBindAST>(std::move(Proto));
-            auto FnAST = llvm::make_unique<FunctionDecAST>(std::move(FnBind));
-            return static_cast<llvm::Function *>(FnAST->accept(&_impl->codeGen));
+/**
+ * Get the name bound by a value pattern, either `x' or `x : t'.
+ * @param pat The pattern of a value binding.
+ * @return The long identifier of the name, or null if it is not a name.
+ */
+static std::shared_ptr<LongIdAST> getBoundName(const std::shared_ptr<PatAST> &pat) {
+    switch (pat->getKind()) {
+        case ASTKind::ConstructionPatAST:
+            return AST::cast<ConstructionPatAST>(pat)->getLongId();
+        case ASTKind::TypeAnnotationPatAST: {
+            auto temPat = AST::cast<TypeAnnotationPatAST>(pat)->getPat();
+            return AST::cast<ConstructionPatAST>(temPat)->getLongId();
         }
+        default:
+            return nullptr;
+    }
+}
 
-//        auto FnValue = (llvm::Value*)FnAST->accept(&_impl->codeGen);
-    } else if (auto dec = dynamic_pointer_cast<FunctionDecAST>(ast)) {
-        fprintf(stderr, "Read function definition:");
-        std::shared_ptr<IdAST> id(new AlphanumericIdAST(dec->getFunBind()->getFunMatch()->getId()->get()));
-        auto temTuplePat = dynamic_pointer_cast<TuplePatAST>(dec->getFunBind()->getFunMatch()->getPats()[0]);
-        auto Proto = llvm::make_unique<FunMatchAST>(std::move(id), temTuplePat->getPats(),
-                                                    dec->getFunBind()->getFunMatch()->getExp());
-        auto FnBind = llvm::make_unique<FunBindAST>(std::move(Proto));
-        auto FnAST = llvm::make_unique<FunctionDecAST>(std::move(FnBind));
-        return static_cast<llvm::Function *>(FnAST->accept(&_impl->codeGen));
-    } else if (auto fnDec = dynamic_pointer_cast<ValueDecAST>(ast)) {
-        if (auto val = dynamic_pointer_cast<DestructuringValBindAST>(fnDec->getValBind())) {
-            if (auto fn = dynamic_pointer_cast<FunctionExpAST>(val->getExp()))
-                if (auto longid = dynamic_pointer_cast<ConstructionPatAST>(val->getPat())) {
-                    std::shared_ptr<IdAST> id(new AlphanumericIdAST(longid->getLongId()->getIds()[0]->get()));
-                    auto Proto = llvm::make_unique<FunMatchAST>(std::move(id),
-                                                                std::vector<std::shared_ptr<PatAST>>{val->getPat()},
-                                                                val->getExp());
-                    auto FnBind = llvm::make_unique<FunBindAST>(std::move(Proto));
-                    auto FnAST = llvm::make_unique<FunctionDecAST>(std::move(FnBind));
-                    return static_cast<llvm::Function *>(FnAST->accept(&_impl->codeGen));
-                }
+/**
+ * Compile the functions forked from another session that the code generated
+ * calls, each in a module of its own added to the JIT, keeping the module of
+ * the code generated current for the JIT to run.
+ * @param codeGen The code generator of asts.
+ * @param jitModule The state of the code generated.
+ */
+static void compileCalled(CodeGen &codeGen, JITModule &jitModule) {
+    if (jitModule.called.empty()) {
+        return;
+    }
+    auto module = std::move(jitModule.module);
+    // a function compiled may call other functions forked.
+    while (!jitModule.called.empty()) {
+        auto name = std::move(jitModule.called.back());
+        jitModule.called.pop_back();
+        auto funMatch = AST::cast<FunMatchAST>(
+                *jitModule.functionProtos.find(name));
+        auto FnAST = AST::create<FunctionDecAST>(
+                AST::create<FunBindAST>(std::move(funMatch)));
+        if (codeGen.dispatch(FnAST)) {
+            jitModule.jit->addModule(std::move(jitModule.module));
         }
-    } else {
-        return static_cast<llvm::Function *>(ast->accept(&_impl->codeGen));
     }
+    jitModule.module = std::move(module);
+}
+
+llvm::Function *CodeGenerator::generate(const std::shared_ptr<AST> &ast) {
+    _ast = ast;
+    auto function = (llvm::Function*) ast->accept(this);
+    compileCalled(_impl->codeGen, *_impl->jitModule);
+    return function;
 }
 
 void *CodeGenerator::visit(ExpAST *ast) {
-    std::shared_ptr<IdAST> id(new AlphanumericIdAST("__anon_expr"));
-    auto Proto = shared_ptr<FunMatchAST>(
-            new FunMatchAST(std::move(id),
+    return generateFunction(_impl->codeGen, "__anon_expr",
                             std::vector<std::shared_ptr<PatAST>>(),
-                            dynamic_pointer_cast<ExpAST>(_ast)));
-    auto FnBind = shared_ptr<FunBindAST>(new FunBindAST(std::move(Proto)));
-    auto FnAST = shared_ptr<FunctionDecAST>(new FunctionDecAST(std::move(FnBind)));
-    return static_cast<llvm::Function *>(FnAST->accept(&_impl->codeGen));
+                            AST::dynCast<ExpAST>(_ast));
 }
 
 //void *CodeGenerator::visit(LocalDeclarationExpAST *ast) {
@@ -137,141 +129,95 @@ void *CodeGenerator::visit(ExpAST *ast) {
 //    return static_cast<llvm::Function *>(FnAST->accept(&_impl->codeGen));
 //}
 
+void CodeGenerator::bind(const std::string &name,
+                         const std::shared_ptr<ConstantExpAST> &constant) {
+    _impl->jitModule->temNamedValues.insert(
+            name, _impl->codeGen.dispatch(constant));
+}
+
 void *CodeGenerator::visit(FunctionDecAST *ast) {
     fprintf(stderr, "Read function definition:");
-    std::shared_ptr<IdAST> id(new AlphanumericIdAST(ast->getFunBind()->getFunMatch()->getId()->get()));
-    if(auto temTuplePat = dynamic_pointer_cast<TuplePatAST>(ast->getFunBind()->getFunMatch()->getPats()[0])){
-        auto Proto = llvm::make_unique<FunMatchAST>(std::move(id), temTuplePat->getPats(),
-                                                    ast->getFunBind()->getFunMatch()->getExp());
-        auto FnBind = llvm::make_unique<FunBindAST>(std::move(Proto));
-        auto FnAST = llvm::make_unique<FunctionDecAST>(std::move(FnBind));
-        return static_cast<llvm::Function *>(FnAST->accept(&_impl->codeGen));
-    }else if(auto temLongIdPat = dynamic_pointer_cast<ConstructionPatAST>(ast->getFunBind()->getFunMatch()->getPats()[0])){
-        std::vector<std::shared_ptr<PatAST>> temV;
-        temV.push_back(static_cast<const shared_ptr<PatAST>>(new ConstructionPatAST(temLongIdPat->getLongId())));
-
-        auto Proto = llvm::make_unique<FunMatchAST>(std::move(id),temV,
-                                                    ast->getFunBind()->getFunMatch()->getExp());
-        auto FnBind = llvm::make_unique<FunBindAST>(std::move(Proto));
-        auto FnAST = llvm::make_unique<FunctionDecAST>(std::move(FnBind));
-        return static_cast<llvm::Function *>(FnAST->accept(&_impl->codeGen));
+    auto funMatch = ast->getFunBind()->getFunMatch();
+    auto &name = funMatch->getId()->get();
+    auto &pat = funMatch->getPats()[0];
+    switch (pat->getKind()) {
+        case ASTKind::TuplePatAST:
+            return generateFunction(_impl->codeGen, name,
+                                    AST::cast<TuplePatAST>(pat)->getPats(),
+                                    funMatch->getExp());
+        case ASTKind::ConstructionPatAST: {
+            auto temLongId = AST::cast<ConstructionPatAST>(pat)->getLongId();
+            std::vector<std::shared_ptr<PatAST>> temV{
+                    AST::create<ConstructionPatAST>(temLongId)};
+            return generateFunction(_impl->codeGen, name, std::move(temV),
+                                    funMatch->getExp());
+        }
+        default:
+            return nullptr;
     }
 }
 
 void *CodeGenerator::visit(ValueDecAST *ast) {
-    if (auto val = dynamic_pointer_cast<DestructuringValBindAST>(ast->getValBind())) {
-        if (auto fn = dynamic_pointer_cast<FunctionExpAST>(val->getExp())){
-            if (auto longid = dynamic_pointer_cast<ConstructionPatAST>(val->getPat())) {
-
-                auto temName = dynamic_pointer_cast<ConstructionPatAST>(val->getPat());
-                std::shared_ptr<IdAST> id(new AlphanumericIdAST(temName->getLongId()->getIds()[0]->get()));
-
-                auto temPats = dynamic_pointer_cast<TuplePatAST>(fn->getMatch()->getPat());
-//                std::vector<std::shared_ptr<ValueOrConstructorIdentifierExpAST>>temLongId;
-//                for(int i =0;i<temPats->getExps().size();i++){
-//                    auto tem = dynamic_pointer_cast<ValueOrConstructorIdentifierExpAST>(temPats->getExps()[i]);
-//                    temLongId.push_back(tem);
-//                }
-                auto Proto = llvm::make_unique<FunMatchAST>(std::move(id),temPats->getPats(),
-//                                                            std::vector<std::shared_ptr<PatAST>>{val->getPat()},
-                                                            fn->getMatch()->getExp());
-                auto FnBind = llvm::make_unique<FunBindAST>(std::move(Proto));
-                auto FnAST = llvm::make_unique<FunctionDecAST>(std::move(FnBind));
-                return static_cast<llvm::Function *>(FnAST->accept(&_impl->codeGen));
-            }else if(auto longid = dynamic_pointer_cast<TypeAnnotationPatAST>(val->getPat())){
-
+    auto val = AST::dynCast<DestructuringValBindAST>(ast->getValBind());
+    if (!val) {
+        return nullptr;
+    }
+    auto &pat = val->getPat();
+    auto &exp = val->getExp();
+    switch (exp->getKind()) {
+        case ASTKind::FunctionExpAST: {
+            if (!AST::isa<ConstructionPatAST>(pat)) {
+                return nullptr;
             }
-        }else{
-            // Codegen the RHS.
-            if(auto temFunctionExpAST = dynamic_pointer_cast<FunctionExpAST>(val->getExp())){
-
-            }else if(dynamic_pointer_cast<ConstantExpAST>(val->getExp())){
-                if(auto tem = dynamic_pointer_cast<ConstructionPatAST>(val->getPat())){
-                    std::shared_ptr<IdAST> id(new AlphanumericIdAST(tem->getLongId()->getIds()[0]->get()));
-
-                    auto Proto = llvm::make_unique<FunMatchAST>(std::move(id),
-                                                                std::vector<std::shared_ptr<PatAST>>(),
-                                                                val->getExp());
-
-                    temNamedValues[tem->getLongId()->getIds()[0]->get()] = (llvm::Value*)val->getExp()->accept(&_impl->codeGen);
-                    auto FnBind = llvm::make_unique<FunBindAST>(std::move(Proto));
-                    auto FnAST = llvm::make_unique<FunctionDecAST>(std::move(FnBind));
-                    return static_cast<llvm::Function *>(FnAST->accept(&_impl->codeGen));
-                }else if(auto tem = dynamic_pointer_cast<TypeAnnotationPatAST>(val->getPat())){
-                    auto temPat = dynamic_pointer_cast<ConstructionPatAST>(tem->getPat());
-                    std::shared_ptr<IdAST> id(new AlphanumericIdAST(temPat->getLongId()->getIds()[0]->get()));
-
-                    auto Proto = llvm::make_unique<FunMatchAST>(std::move(id),
-                                                                std::vector<std::shared_ptr<PatAST>>(),
-                                                                val->getExp());
-
-                    temNamedValues[temPat->getLongId()->getIds()[0]->get()] = (llvm::Value*)val->getExp()->accept(&_impl->codeGen);
-                    auto FnBind = llvm::make_unique<FunBindAST>(std::move(Proto));
-                    auto FnAST = llvm::make_unique<FunctionDecAST>(std::move(FnBind));
-                    return static_cast<llvm::Function *>(FnAST->accept(&_impl->codeGen));
-                }
-            } if(auto temVariable = dynamic_pointer_cast<ValueOrConstructorIdentifierExpAST>(val->getExp())){
-                if(auto tem = dynamic_pointer_cast<ConstructionPatAST>(val->getPat())){
-                    if(llvm::Value* temV = temNamedValues[temVariable->getLongId()->getIds()[0]->get()])
-                        temNamedValues[tem->getLongId()->getIds()[0]->get()] = temV;
-                    std::shared_ptr<IdAST> id(new AlphanumericIdAST(tem->getLongId()->getIds()[0]->get()));
-
-                    auto Proto = llvm::make_unique<FunMatchAST>(std::move(id),
-                                                                std::vector<std::shared_ptr<PatAST>>(),
-                                                                val->getExp());
-
-                    temNamedValues[tem->getLongId()->getIds()[0]->get()] = (llvm::Value*)val->getExp()->accept(&_impl->codeGen);
-                    auto FnBind = llvm::make_unique<FunBindAST>(std::move(Proto));
-                    auto FnAST = llvm::make_unique<FunctionDecAST>(std::move(FnBind));
-                    return static_cast<llvm::Function *>(FnAST->accept(&_impl->codeGen));
-                }
-            } if(auto temVariable = dynamic_pointer_cast<InfixApplicationExpAST>(val->getExp())){
-                if(auto tem = dynamic_pointer_cast<ConstructionPatAST>(val->getPat())){
-//                    if(llvm::Value* temV = temNamedValues[temVariable->getLongId()->getIds()[0]->get()])
-//                        temNamedValues[tem->getLongId()->getIds()[0]->get()] = temV;
-                    std::shared_ptr<IdAST> id(new AlphanumericIdAST(tem->getLongId()->getIds()[0]->get()));
-
-                    auto Proto = llvm::make_unique<FunMatchAST>(std::move(id),
-                                                                std::vector<std::shared_ptr<PatAST>>(),
-                                                                val->getExp());
-
-                    temNamedValues[tem->getLongId()->getIds()[0]->get()] = (llvm::Value*)val->getExp()->accept(&_impl->codeGen);
-                    auto FnBind = llvm::make_unique<FunBindAST>(std::move(Proto));
-                    auto FnAST = llvm::make_unique<FunctionDecAST>(std::move(FnBind));
-                    return static_cast<llvm::Function *>(FnAST->accept(&_impl->codeGen));
-                }
-                if(auto tem = dynamic_pointer_cast<TypeAnnotationPatAST>(val->getPat())){
-                    auto temPat = dynamic_pointer_cast<ConstructionPatAST>(tem->getPat());
-                    std::shared_ptr<IdAST> id(new AlphanumericIdAST(temPat->getLongId()->getIds()[0]->get()));
-
-                    auto Proto = llvm::make_unique<FunMatchAST>(std::move(id),
-                                                                std::vector<std::shared_ptr<PatAST>>(),
-                                                                val->getExp());
+            auto fn = AST::cast<FunctionExpAST>(exp);
+            auto temPats = AST::cast<TuplePatAST>(fn->getMatch()->getPat());
+            return generateFunction(_impl->codeGen,
+                                    getBoundName(pat)->getIds()[0]->get(),
+                                    temPats->getPats(),
+                                    fn->getMatch()->getExp());
+        }
+        case ASTKind::ValueOrConstructorIdentifierExpAST:
+            if (AST::isa<ConstructionPatAST>(pat)) {
+                auto temVariable = AST::cast<ValueOrConstructorIdentifierExpAST>(exp);
+                auto &name = getBoundName(pat)->getIds()[0]->get();
+                if (llvm::Value *temV = _impl->jitModule->temNamedValues.lookup(temVariable->getLongId()->getIds()[0]->get()))
+                    _impl->jitModule->temNamedValues.insert(name, temV);
+                _impl->jitModule->temNamedValues.insert(name, _impl->codeGen.dispatch(exp));
+                return generateFunction(_impl->codeGen, name,
+                                        std::vector<std::shared_ptr<PatAST>>(),
+                                        exp);
+            }
+            break;
+        case ASTKind::ConstantExpAST:
+        case ASTKind::InfixApplicationExpAST:
+            if (auto longId = getBoundName(pat)) {
+                auto &name = longId->getIds()[0]->get();
+                _impl->jitModule->temNamedValues.insert(name, _impl->codeGen.dispatch(exp));
+                return generateFunction(_impl->codeGen, name,
+                                        std::vector<std::shared_ptr<PatAST>>(),
+                                        exp);
+            }
+            if (exp->getKind() == ASTKind::InfixApplicationExpAST) {
+                return nullptr;
+            }
+            break;
+        default:
+            break;
+    }
 
-                    temNamedValues[temPat->getLongId()->getIds()[0]->get()] = (llvm::Value*)val->getExp()->accept(&_impl->codeGen);
-                    auto FnBind = llvm::make_unique<FunBindAST>(std::move(Proto));
-                    auto FnAST = llvm::make_unique<FunctionDecAST>(std::move(FnBind));
-                    return static_cast<llvm::Function *>(FnAST->accept(&_impl->codeGen));
-                }
-            }else{
-                auto pat = val->getPat();
-                auto *LHSE = dynamic_cast<ConstructionPatAST *>(pat.get());
-                if (!LHSE)
-                    return nullptr;
-                auto temValue = (llvm::Value*)val->getExp()->accept(this);
-                if (!temValue)
-                    return nullptr;
+    auto *LHSE = AST::dynCast<ConstructionPatAST>(pat.get());
+    if (!LHSE)
+        return nullptr;
+    auto temValue = (llvm::Value*)exp->accept(this);
+    if (!temValue)
+        return nullptr;
 
-                // Look up the name.
+    // Look up the name.
 //        NamedValues[LHSE->getLongId()->getIds()[0]->get()] = temValue;
-                llvm::Value *Variable = NamedValues[LHSE->getLongId()->getIds()[0]->get()];
-                if (!Variable)
-                    return nullptr;
+    llvm::Value *Variable = _impl->jitModule->namedValues.lookup(LHSE->getLongId()->getIds()[0]->get());
+    if (!Variable)
+        return nullptr;
 
-                Builder.CreateStore(temValue, Variable);
-                return temValue;
-            }
-        }
-
-    }
-}
\ No newline at end of file
+    _impl->jitModule->builder.CreateStore(temValue, Variable);
+    return temValue;
+}
@@ -4,7 +4,12 @@
 #include "JIT.h"
 #include "JITModule/JITModule.h"
 
-void *CodeGen::visit(InfixConstructionPatAST *ast) {
+CodeGen::CodeGen(SymbolTable *symbolTable, JITModule *jitModule)
+        : _symbolTable(symbolTable), _jitModule(jitModule) {
+
+}
+
+llvm::Value *CodeGen::visit(InfixConstructionPatAST *ast) {
     auto pat1 = ast->getPat1();
     auto id = ast->getId();
     auto pat2 = ast->getPat2();
@@ -13,111 +18,107 @@ void *CodeGen::visit(InfixConstructionPatAST *ast) {
     std::string op = id->get();
     if (op[0] == '=') {
         // Assignment requires the LHS to be an identifier.
-        // This assume we're building without RTTI because LLVM builds that way by
-        // default.  If you build LLVM with RTTI this can be changed to a
-        // dynamic_cast for automatic error checking.
-        auto *LHSE = dynamic_cast<VariablePatAST *>(pat1.get());
+        auto *LHSE = AST::dynCast<VariablePatAST>(pat1.get());
         if (!LHSE)
             return nullptr;
         // Codegen the RHS.
-        auto Val = (llvm::Value*)pat2->accept(this);
+        auto Val = dispatch(pat2);
         if (!Val)
             return nullptr;
 
         // Look up the name.
-        llvm::Value *Variable = NamedValues[LHSE->getId()->get()];
+        llvm::Value *Variable = _jitModule->namedValues.lookup(LHSE->getId()->get());
         if (!Variable)
             return nullptr;
 
-        Builder.CreateStore(Val, Variable);
+        _jitModule->builder.CreateStore(Val, Variable);
         return Val;
     }
 
-    auto L = (llvm::Value*)pat1->accept(this);
-    auto R = (llvm::Value*)pat2->accept(this);
+    auto L = dispatch(pat1);
+    auto R = dispatch(pat2);
 //    auto Op = (llvm::Value*)id->accept(this);
     if(!L || !R)
         return nullptr;
 
     switch(op[0]){
         case '+':
-            return Builder.CreateFAdd(L, R, "addtmp");
+            return _jitModule->builder.CreateFAdd(L, R, "addtmp");
         case '-':
-            return Builder.CreateFSub(L, R, "subtmp");
+            return _jitModule->builder.CreateFSub(L, R, "subtmp");
         case '*':
-            return Builder.CreateFMul(L, R, "multmp");
+            return _jitModule->builder.CreateFMul(L, R, "multmp");
         case '/':
-            return Builder.CreateFDiv(L, R, "divtem");
+            return _jitModule->builder.CreateFDiv(L, R, "divtem");
         default:
             Error("invalid binary operator");
             return nullptr;
     }
 }
 
-void *CodeGen::visit(FunctionTypAST *ast) {
+llvm::Value *CodeGen::visit(FunctionTypAST *ast) {
     auto typ1 = ast->getTyp1();
     auto typ2 = ast->getTyp2();
     if(!(typ1 and typ2)){
         return nullptr;
     }
-    auto tem1 = typ1->accept(this);
-    auto tem2 = typ2->accept(this);
+    auto tem1 = dispatch(typ1);
+    auto tem2 = dispatch(typ2);
 }
 
-void *CodeGen::visit(FunctionExpAST *ast) {
+llvm::Value *CodeGen::visit(FunctionExpAST *ast) {
     auto tem = ast->getMatch();
     if(!tem)
         return nullptr;
-    return tem->accept(this);
+    return dispatch(tem);
 }
 
-void *CodeGen::visit(MatchAST *ast) {
+llvm::Value *CodeGen::visit(MatchAST *ast) {
     ///返回llvm::Value*
     auto temPat = ast->getPat();
     auto temExp = ast->getExp();
     auto temMatch = ast->getMatch();
     if(!(temPat and temExp))
         return nullptr;
-    auto tem1 = (llvm::Value*)temPat->accept(this);
-    auto tem2 = (llvm::Value*)temExp->accept(this);
+    auto tem1 = dispatch(temPat);
+    auto tem2 = dispatch(temExp);
     if(temMatch)//如果只有一个函数体就返回tem2
         return tem2;
-    auto temMatchValue = (llvm::Value*)temMatch->accept(this);
+    auto temMatchValue = dispatch(temMatch);
     ///如何根据具体的值来返回相应的Value*
 
 }
 
-void *CodeGen::visit(ValBindAST *ast) {
+llvm::Value *CodeGen::visit(ValBindAST *ast) {
     return nullptr;
 }
 
-void *CodeGen::visit(NumberLabAST *ast) {
-    return llvm::ConstantInt::get(TheContext, llvm::APInt(32, ast->getN()));
+llvm::Value *CodeGen::visit(NumberLabAST *ast) {
+    return llvm::ConstantInt::get(_jitModule->context, llvm::APInt(32, ast->getN()));
 }
 
-void *CodeGen::visit(IdentifierLabAST *ast) {
+llvm::Value *CodeGen::visit(IdentifierLabAST *ast) {
     auto tem = ast->getId();
-    tem->accept(this);
+    dispatch(tem);
 }
 
-void *CodeGen::visit(LongIdAST *ast) {
+llvm::Value *CodeGen::visit(LongIdAST *ast) {
     auto tem = ast->getIds();
     for(int i=0;i<tem.size();i++){
-        tem[i]->accept(this);
+        dispatch(tem[i]);
     }
 }
 
-void *CodeGen::visit(VarAST *ast) {
+llvm::Value *CodeGen::visit(VarAST *ast) {
     auto tem = ast->getVar();
     if(!tem.empty()){
         Error("Unknown var");
-        return nullptr;
     }
-    return &tem;
+    return nullptr;
 }
 
-void *CodeGen::visit(IdAST *ast) {
-    auto tem = SymbolTable::getInstance()->getValue(ast->get());
+llvm::Value *CodeGen::visit(IdAST *ast) {
+    auto tem = _symbolTable->getValue(ast->get());
     if(!tem){
         Error("Unknown Id name!");
         return nullptr;
@@ -125,20 +126,20 @@ void *CodeGen::visit(IdAST *ast) {
     return tem->getLLVMValue();
 }
 
-void *CodeGen::visit(IntConAST *ast) {
-    return llvm::ConstantInt::get(TheContext, llvm::APInt(32, ast->get()));
+llvm::Value *CodeGen::visit(IntConAST *ast) {
+    return llvm::ConstantInt::get(_jitModule->context, llvm::APInt(32, ast->get()));
 }
 
-void *CodeGen::visit(FloatConAST *ast) {
-    return llvm::ConstantFP::get(TheContext, llvm::APFloat(ast->get()));
+llvm::Value *CodeGen::visit(FloatConAST *ast) {
+    return llvm::ConstantFP::get(_jitModule->context, llvm::APFloat(ast->get()));
 }
 
-void *CodeGen::visit(CharConAST *ast) {
+llvm::Value *CodeGen::visit(CharConAST *ast) {
     // Maybe something is wrong here,
-    return llvm::ConstantInt::get(TheContext, llvm::APInt(8, ast->get(), false));
+    return llvm::ConstantInt::get(_jitModule->context, llvm::APInt(8, ast->get(), false));
 }
 
-void *CodeGen::visit(StringConAST *ast) {
+llvm::Value *CodeGen::visit(StringConAST *ast) {
 //    //I guess here is sonething wrong, but I am not sure.
 //    llvm::Function *TheFunction = Builder.GetInsertBlock()->getParent();
 //
@@ -155,87 +156,91 @@ void *CodeGen::visit(StringConAST *ast) {
 //    return Builder.CreateGlobalString(ast->get());
     std::vector<llvm::Constant*> StringLocal;
     for(unsigned long long i = 0; i < ast->get().length();i++){
-        llvm::ConstantInt* temInt = llvm::ConstantInt::get(TheContext,
+        llvm::ConstantInt* temInt = llvm::ConstantInt::get(_jitModule->context,
                 llvm::APInt(8,ast->get().c_str()[i],false));
         StringLocal.push_back(temInt);
     }
     llvm::Constant*  charArray = llvm::ConstantArray::get(llvm::ArrayType::get(
-            llvm::Type::getInt64Ty(TheContext),ast->get().length()),llvm::ArrayRef(StringLocal));
+            llvm::Type::getInt64Ty(_jitModule->context),ast->get().length()),llvm::ArrayRef(StringLocal));
     return charArray;
 }
 
-void *CodeGen::visit(BoolConAST *ast) {
-    return llvm::ConstantInt::get(TheContext,llvm::APInt(1,int(ast->get())));
+llvm::Value *CodeGen::visit(BoolConAST *ast) {
+    return llvm::ConstantInt::get(_jitModule->context,llvm::APInt(1,int(ast->get())));
 }
 
-void *CodeGen::visit(DisjunctionExpAST *ast) {
+llvm::Value *CodeGen::visit(DisjunctionExpAST *ast) {
     auto lhs = visitAsValue(ast->getExp1());
     auto rhs = visitAsValue(ast->getExp2());
     return llvm::BinaryOperator::CreateOr(lhs, rhs, "tmpor");
 }
 
-void *CodeGen::visit(ConjunctionExpAST *ast) {
+llvm::Value *CodeGen::visit(ConjunctionExpAST *ast) {
     auto lhs = visitAsValue(ast->getExp1());
     auto rhs = visitAsValue(ast->getExp2());
     return llvm::BinaryOperator::CreateAnd(lhs, rhs, "andpor");
 }
 
 llvm::Value *CodeGen::visitAsValue(const std::shared_ptr<ExpAST>& exp) {
-    return static_cast<llvm::Value *>(exp->accept(this));
+    return dispatch(exp);
 }
 
 ///check this!!!
-llvm::Function *getFunction(std::string Name,ASTVisitor* ASTVisitor) {
+llvm::Function *CodeGen::getFunction(const std::string &Name) {
     ///返回llvm::Function*
     // First, see if the function has already been added to the current module.
-    if (auto *F = TheModule->getFunction(Name))
+    if (auto *F = _jitModule->module->getFunction(Name))
         return F;
 
     // If not, check whether we can codegen the declaration from some existing
     // prototype.
-    auto FI = FunctionProtos.find(Name);
-    if (FI != FunctionProtos.end())
-        return (llvm::Function *)FI->second->accept(ASTVisitor);
+    if (auto FI = _jitModule->functionProtos.find(Name)) {
+        // a function forked is compiled by the JIT of the session once called.
+        if (_jitModule->uncompiled.erase(Name))
+            _jitModule->called.push_back(Name);
+        return static_cast<llvm::Function *>(dispatch(*FI));
+    }
 
     // If no existing prototype exists, return null.
     return nullptr;
 }
 
-void *CodeGen::visit(FunctionDecAST *ast) {
-    InitializeModuleAndPassManager();
+llvm::Value *CodeGen::visit(FunctionDecAST *ast) {
+    _jitModule->initializeModuleAndPassManager();
     auto temAST = ast->getFunBind()->getFunMatch()->getId()->get();
-    FunctionProtos[temAST] = ast->getFunBind()->getFunMatch();
-    llvm::Function *TheFunction = getFunction(temAST,this);
+    _jitModule->functionProtos.insert(temAST, ast->getFunBind()->getFunMatch());
+    _jitModule->uncompiled.erase(temAST);
+    llvm::Function *TheFunction = getFunction(temAST);
     if(!TheFunction)
         return nullptr;
 
-    llvm::BasicBlock *BB = llvm::BasicBlock::Create(TheContext,"entry",TheFunction);
-    Builder.SetInsertPoint(BB);
+    llvm::BasicBlock *BB = llvm::BasicBlock::Create(_jitModule->context,"entry",TheFunction);
+    _jitModule->builder.SetInsertPoint(BB);
 
-    NamedValues.clear();
+    _jitModule->namedValues.clear();
     for (auto &Arg : TheFunction->args())
-        NamedValues[Arg.getName()] = &Arg;
-    if(auto RetVal = (llvm::Value*)ast->getFunBind()->getFunMatch()->getExp()->accept(this)){
+        _jitModule->namedValues.insert(Arg.getName().str(), &Arg);
+    if(auto RetVal = dispatch(ast->getFunBind()->getFunMatch()->getExp())){
         // Finish off the function.
-        Builder.CreateRet(RetVal);
+        _jitModule->builder.CreateRet(RetVal);
 
         // Validate the generated code, checking for consistency.
         verifyFunction(*TheFunction);
 
         // Run the optimizer on the function.
-        TheFPM->run(*TheFunction);
+        _jitModule->passManager->run(*TheFunction);
 
         return TheFunction;
-    }else if(auto RetAST = dynamic_pointer_cast<ValueOrConstructorIdentifierExpAST>(ast->getFunBind()->getFunMatch()->getExp())){
+    }else if(auto RetAST = AST::dynCast<ValueOrConstructorIdentifierExpAST>(ast->getFunBind()->getFunMatch()->getExp())){
         // Finish off the function.
-        auto RetVal = temNamedValues[RetAST->getLongId()->getIds()[0]->get()];
-        Builder.CreateRet(RetVal);
+        auto RetVal = _jitModule->temNamedValues.lookup(RetAST->getLongId()->getIds()[0]->get());
+        _jitModule->builder.CreateRet(RetVal);
 
         // Validate the generated code, checking for consistency.
         verifyFunction(*TheFunction);
 
         // Run the optimizer on the function.
-        TheFPM->run(*TheFunction);
+        _jitModule->passManager->run(*TheFunction);
 
         return TheFunction;
     }
@@ -244,26 +249,26 @@ void *CodeGen::visit(FunctionDecAST *ast) {
     return nullptr;
 }
 
-void *CodeGen::visit(FunBindAST *ast) {
+llvm::Value *CodeGen::visit(FunBindAST *ast) {
 //    if(ast->getAndFunBind())
 //        auto tem = ast->getAndFunBind()->accept(this);
-    return ast->getFunMatch()->accept(this);///返回llvm::Function*
+    return dispatch(ast->getFunMatch());///返回llvm::Function*
 }
 
-void *CodeGen::visit(FunMatchAST *ast) {
+llvm::Value *CodeGen::visit(FunMatchAST *ast) {
     auto iii = ast->getPats().size();
-    std::vector<llvm::Type *>Ints(ast->getPats().size(),llvm::Type::getInt32Ty(TheContext));
+    std::vector<llvm::Type *>Ints(ast->getPats().size(),llvm::Type::getInt32Ty(_jitModule->context));
     llvm::FunctionType *FT=
-            llvm::FunctionType::get(llvm::Type::getInt32Ty(TheContext),Ints,false);
+            llvm::FunctionType::get(llvm::Type::getInt32Ty(_jitModule->context),Ints,false);
 
-    llvm::Function *F = llvm::Function::Create(FT,llvm::Function::ExternalLinkage,ast->getId()->get(),TheModule.get());
+    llvm::Function *F = llvm::Function::Create(FT,llvm::Function::ExternalLinkage,ast->getId()->get(),_jitModule->module.get());
 
     unsigned Idx =0;
     auto temPats = ast->getPats();
     vector<shared_ptr<ConstructionPatAST>> temLongId;
     auto ii = temPats.size();
     for(int i =0;i<temPats.size();i++){
-        temLongId.push_back(dynamic_pointer_cast<ConstructionPatAST>(temPats[i]));
+        temLongId.push_back(AST::dynCast<ConstructionPatAST>(temPats[i]));
     }
 //    std::vector<std::shared_ptr<ConstructionPatAST>> tem = (const vector<shared_ptr<ConstructionPatAST>> &) ast->getPats();
     for(auto &Arg:F->args())
@@ -283,33 +288,29 @@ void *CodeGen::visit(FunMatchAST *ast) {
     return F;
 }
 
-void *CodeGen::visit(TuplePatAST *ast) {
+llvm::Value *CodeGen::visit(TuplePatAST *ast) {
     return nullptr;
 }
 
-void *CodeGen::visit(VariablePatAST *ast) {
+llvm::Value *CodeGen::visit(VariablePatAST *ast) {
 //    auto tem = (llvm::Value*) ast->getId()->accept(this);
 //    NamedValues[ast->getId()->get()] = tem;
 //    return tem;
     return nullptr;
 }
 
-void *CodeGen::visit(InfixApplicationExpAST *ast) {
-    char flag = 'I';
+llvm::Value *CodeGen::visit(InfixApplicationExpAST *ast) {
     shared_ptr<ExpAST>exp11;
     shared_ptr<ValueOrConstructorIdentifierExpAST>exp12;
-    if(auto tem = dynamic_pointer_cast<ValueOrConstructorIdentifierExpAST>(ast->getExp1())){
+    if(auto tem = AST::dynCast<ValueOrConstructorIdentifierExpAST>(ast->getExp1())){
         exp12 = tem;
     }else{
         exp11 = ast->getExp1();
     }
 
-    if(ASTProperty::getType(exp11)->getTypeId()==Type::REAL)
-        flag = 'F';
-
     shared_ptr<ExpAST>exp21;
     shared_ptr<ValueOrConstructorIdentifierExpAST>exp22;
-    if(auto tem = dynamic_pointer_cast<ValueOrConstructorIdentifierExpAST>(ast->getExp2())){
+    if(auto tem = AST::dynCast<ValueOrConstructorIdentifierExpAST>(ast->getExp2())){
         exp22 = tem;
     }else{
         exp21 = ast->getExp2();
@@ -321,93 +322,90 @@ void *CodeGen::visit(InfixApplicationExpAST *ast) {
     std::string op = id->get();
     if (op[0] == '=') {
         // Assignment requires the LHS to be an identifier.
-        // This assume we're building without RTTI because LLVM builds that way by
-        // default.  If you build LLVM with RTTI this can be changed to a
-        // dynamic_cast for automatic error checking.
         ///I guess something is wrong here
-        auto LHSE = dynamic_cast<VariablePatAST *>(exp12.get());
+        auto LHSE = AST::dynCast<VariablePatAST>(exp12.get());
         if (!LHSE)
             return nullptr;
         // Codegen the RHS.
-        auto Val = (llvm::Value*)exp21->accept(this);
+        auto Val = dispatch(exp21);
         if (!Val)
             return nullptr;
 
         // Look up the name.
-        llvm::Value *Variable = NamedValues[LHSE->getId()->get()];
+        llvm::Value *Variable = _jitModule->namedValues.lookup(LHSE->getId()->get());
         if (!Variable)
             return nullptr;
 
-        Builder.CreateStore(Val, Variable);
+        _jitModule->builder.CreateStore(Val, Variable);
         return Val;
     }
     llvm::Value* L;
     llvm::Value* R;
     if(exp11 == nullptr){
 //        L = (llvm::Value*)exp12->accept(this);
-        if(llvm::Value* v1 = NamedValues[exp12->getLongId()->getIds()[0]->get()])
+        if(llvm::Value* v1 = _jitModule->namedValues.lookup(exp12->getLongId()->getIds()[0]->get()))
             L = v1;
-        else if(llvm::Value* v11 = temNamedValues[exp12->getLongId()->getIds()[0]->get()])
+        else if(llvm::Value* v11 = _jitModule->temNamedValues.lookup(exp12->getLongId()->getIds()[0]->get()))
             L = v11;
         else
             Error("unknown variable name");
     }else{
-        L = (llvm::Value*)exp11->accept(this);
+        L = dispatch(exp11);
     }
     if(exp21 == nullptr){
 //        R = (llvm::Value*)exp22->accept(this);
-        if(llvm::Value* v2 = NamedValues[exp22->getLongId()->getIds()[0]->get()])
+        if(llvm::Value* v2 = _jitModule->namedValues.lookup(exp22->getLongId()->getIds()[0]->get()))
             R = v2;
-        else if(llvm::Value* v22 = temNamedValues[exp22->getLongId()->getIds()[0]->get()])
+        else if(llvm::Value* v22 = _jitModule->temNamedValues.lookup(exp22->getLongId()->getIds()[0]->get()))
             R = v22;
         else
             Error("unknown variable name");
     }else{
-        R = (llvm::Value*)exp21->accept(this);
+        R = dispatch(exp21);
     }
 //    auto Op = (llvm::Value*)id->accept(this);
     if(!L || !R)
         return nullptr;
 
+    // the builtin arithmetic is resolved by the type check.
+    switch(ASTProperty::getPrimitive(ast)){
+        case Primitive::INT_ADD:
+            return _jitModule->builder.CreateAdd(L, R, "addtmp");
+        case Primitive::INT_SUB:
+            return _jitModule->builder.CreateSub(L, R, "subtmp");
+        case Primitive::INT_MUL:
+            return _jitModule->builder.CreateMul(L, R, "multmp");
+        case Primitive::REAL_ADD:
+            return _jitModule->builder.CreateFAdd(L, R, "addtmp");
+        case Primitive::REAL_SUB:
+            return _jitModule->builder.CreateFSub(L, R, "subtmp");
+        case Primitive::REAL_MUL:
+            return _jitModule->builder.CreateFMul(L, R, "multmp");
+        default:
+            break;
+    }
+
     switch(op[0]){
-        case '+':
-            if(flag == 'I')
-                return Builder.CreateAdd(L, R, "addtmp");
-            else if(flag == 'F')
-                return Builder.CreateFAdd(L,R,"addtmp");
-        case '-':
-            if(flag == 'I')
-                return Builder.CreateSub(L, R, "subtmp");
-            else if(flag == 'F')
-                return Builder.CreateFSub(L, R, "subtmp");
-        case '*':
-            if(flag == 'I')
-                return Builder.CreateMul(L, R, "multmp");
-            else if(flag == 'F')
-                return Builder.CreateFMul(L, R, "multmp");
         case '/':
-            return Builder.CreateFDiv(L, R, "divtem");
+            return _jitModule->builder.CreateFDiv(L, R, "divtem");
         case '>':{
-            return Builder.CreateICmpSGT(L,R,"IcmpSGTtem");
+            return _jitModule->builder.CreateICmpSGT(L,R,"IcmpSGTtem");
 //            return Builder.CreateUIToFP(temBool,llvm::Type::getDoubleTy(TheContext),"boolFTem");
         }
         case '<':{
 //            llvm::Value* temBool = Builder.CreateICmpSLT(L,R,"IcmpSLTtem");
 //            return Builder.CreateUIToFP(temBool,llvm::Type::getDoubleTy(TheContext),"boolFTem");
-            return Builder.CreateICmpSLT(L,R,"IcmpSLTtem");
+            return _jitModule->builder.CreateICmpSLT(L,R,"IcmpSLTtem");
         }
         case '^':
-            if(auto temStr1 = dynamic_pointer_cast<ConstantExpAST>(exp11))
-            {
-                if(auto temStr2 = dynamic_pointer_cast<ConstantExpAST>(exp21)){
-                    if(auto temStr11 = dynamic_pointer_cast<StringConAST>(temStr1->getCon()))
-                        if(auto temStr22 = dynamic_pointer_cast<StringConAST>(temStr2->getCon())){
-                            string tem  =temStr11->get()+temStr22->get();
-                            auto temAST = new StringConAST(tem);
-                            return temAST->accept(this);
-                        }
-                }else{
-                    Error("both of the operator must be a string");
+            if(AST::isa<ConstantExpAST>(exp11) && AST::isa<ConstantExpAST>(exp21)){
+                auto temStr1 = AST::cast<ConstantExpAST>(exp11)->getCon();
+                auto temStr2 = AST::cast<ConstantExpAST>(exp21)->getCon();
+                if(temStr1->getKind() == ASTKind::StringConAST &&
+                   temStr2->getKind() == ASTKind::StringConAST){
+                    string tem = AST::cast<StringConAST>(temStr1)->get() +
+                                 AST::cast<StringConAST>(temStr2)->get();
+                    return dispatch(AST::create<StringConAST>(tem));
                 }
             }else{
                 Error("both of the operator must be a string");
@@ -418,142 +416,166 @@ void *CodeGen::visit(InfixApplicationExpAST *ast) {
     }
 }
 
-void *CodeGen::visit(ConditionalExpAST *ast) {
-    auto CondV = (llvm::Value *)ast->getExp1()->accept(this);
+llvm::Value *CodeGen::visit(ConditionalExpAST *ast) {
+    auto CondV = dispatch(ast->getExp1());
     if (!CondV)
         return nullptr;
 
     // Convert condition to a bool by comparing equal to 0.0.
-    CondV = Builder.CreateFCmpONE(
-            CondV, llvm::ConstantFP::get(TheContext, llvm::APFloat(0.0)), "ifcond");
+    CondV = _jitModule->builder.CreateFCmpONE(
+            CondV, llvm::ConstantFP::get(_jitModule->context, llvm::APFloat(0.0)), "ifcond");
 
-    llvm::Function *TheFunction = Builder.GetInsertBlock()->getParent();
+    llvm::Function *TheFunction = _jitModule->builder.GetInsertBlock()->getParent();
 
     // Create blocks for the then and else cases.  Insert the 'then' block at the
     // end of the function.
-    llvm::BasicBlock *ThenBB = llvm::BasicBlock::Create(TheContext, "then", TheFunction);
-    llvm::BasicBlock *ElseBB = llvm::BasicBlock::Create(TheContext, "else");
-    llvm::BasicBlock *MergeBB = llvm::BasicBlock::Create(TheContext, "ifcont");
+    llvm::BasicBlock *ThenBB = llvm::BasicBlock::Create(_jitModule->context, "then", TheFunction);
+    llvm::BasicBlock *ElseBB = llvm::BasicBlock::Create(_jitModule->context, "else");
+    llvm::BasicBlock *MergeBB = llvm::BasicBlock::Create(_jitModule->context, "ifcont");
 
-    Builder.CreateCondBr(CondV, ThenBB, ElseBB);
+    _jitModule->builder.CreateCondBr(CondV, ThenBB, ElseBB);
 
     // Emit then value.
-    Builder.SetInsertPoint(ThenBB);
+    _jitModule->builder.SetInsertPoint(ThenBB);
 
-    auto ThenV = (llvm::Value*)ast->getExp2()->accept(this);
+    auto ThenV = dispatch(ast->getExp2());
     if (!ThenV)
         return nullptr;
 
-    Builder.CreateBr(MergeBB);
+    _jitModule->builder.CreateBr(MergeBB);
     // Codegen of 'Then' can change the current block, update ThenBB for the PHI.
-    ThenBB = Builder.GetInsertBlock();
+    ThenBB = _jitModule->builder.GetInsertBlock();
 
     // Emit else block.
     TheFunction->getBasicBlockList().push_back(ElseBB);
-    Builder.SetInsertPoint(ElseBB);
+    _jitModule->builder.SetInsertPoint(ElseBB);
 
-    auto ElseV = (llvm::Value*)ast->getExp3()->accept(this);
+    auto ElseV = dispatch(ast->getExp3());
     if (!ElseV)
         return nullptr;
 
-    Builder.CreateBr(MergeBB);
+    _jitModule->builder.CreateBr(MergeBB);
     // Codegen of 'Else' can change the current block, update ElseBB for the PHI.
-    ElseBB = Builder.GetInsertBlock();
+    ElseBB = _jitModule->builder.GetInsertBlock();
 
     // Emit merge block.
     TheFunction->getBasicBlockList().push_back(MergeBB);
-    Builder.SetInsertPoint(MergeBB);
-    llvm::PHINode *PN = Builder.CreatePHI(llvm::Type::getDoubleTy(TheContext), 2, "iftmp");
+    _jitModule->builder.SetInsertPoint(MergeBB);
+    llvm::PHINode *PN = _jitModule->builder.CreatePHI(llvm::Type::getDoubleTy(_jitModule->context), 2, "iftmp");
 
     PN->addIncoming(ThenV, ThenBB);
     PN->addIncoming(ElseV, ElseBB);
     return PN;
 }
 
-void *CodeGen::visit(ValueDecAST *ast) {///返回llvm::Value*
-    return ast->getValBind()->accept(this);
+llvm::Value *CodeGen::visit(ValueDecAST *ast) {///返回llvm::Value*
+    return dispatch(ast->getValBind());
 }
 
-void *CodeGen::visit(DestructuringValBindAST *ast) {
+llvm::Value *CodeGen::visit(DestructuringValBindAST *ast) {
     auto pat = ast->getPat();
-    auto *LHSE = dynamic_cast<ConstructionPatAST *>(pat.get());
+    auto *LHSE = AST::dynCast<ConstructionPatAST>(pat.get());
     if (!LHSE)
         return nullptr;
     // Codegen the RHS.
-    if(auto temFunctionExpAST = dynamic_pointer_cast<FunctionExpAST>(ast->getExp())){
-
-    }else if(auto con = dynamic_pointer_cast<ConstantExpAST>(ast->getExp())){
-        if(auto tem = dynamic_pointer_cast<ConstructionPatAST>(ast->getPat())){
-            auto temV = (llvm::Value*)con->getCon()->accept(this);
-            temNamedValues[tem->getLongId()->getIds()[0]->get()] = temV;
+    switch (ast->getExp()->getKind()) {
+        case ASTKind::FunctionExpAST:
+            return nullptr;
+        case ASTKind::ConstantExpAST: {
+            auto con = AST::cast<ConstantExpAST>(ast->getExp());
+            auto temV = dispatch(con->getCon());
+            _jitModule->temNamedValues.insert(LHSE->getLongId()->getIds()[0]->get(), temV);
             return temV;
         }
-    }else{
-        auto temValue = (llvm::Value*)ast->getExp()->accept(this);
-        if (!temValue)
-            return nullptr;
-
-        // Look up the name.
-//        NamedValues[LHSE->getLongId()->getIds()[0]->get()] = temValue;
-        llvm::Value *Variable = NamedValues[LHSE->getLongId()->getIds()[0]->get()];
-        if (!Variable)
-            return nullptr;
-
-        Builder.CreateStore(temValue, Variable);
-        return temValue;
+        default: {
+            auto temValue = dispatch(ast->getExp());
+            if (!temValue)
+                return nullptr;
+
+            // Look up the name.
+//            NamedValues[LHSE->getLongId()->getIds()[0]->get()] = temValue;
+            llvm::Value *Variable = _jitModule->namedValues.lookup(LHSE->getLongId()->getIds()[0]->get());
+            if (!Variable)
+                return nullptr;
+
+            _jitModule->builder.CreateStore(temValue, Variable);
+            return temValue;
+        }
     }
 }
 
-void *CodeGen::visit(ConstantExpAST *ast) {
-    return ast->getCon()->accept(this);
-}
-
-void *CodeGen::visit(ConAST *ast) {
-    return ASTVisitor::visit(ast);
+llvm::Value *CodeGen::visit(ConstantExpAST *ast) {
+    return dispatch(ast->getCon());
 }
 
-void *CodeGen::visit(ExpAST *ast) {
-    return ASTVisitor::visit(ast);
-}
-
-void *CodeGen::visit(ApplicationExpAST *ast) {
-    if(auto con = dynamic_pointer_cast<ValueOrConstructorIdentifierExpAST>(ast->getExp1())){
+llvm::Value *CodeGen::visit(ApplicationExpAST *ast) {
+    // the builtin negation is resolved by the type check.
+    auto primitive = ASTProperty::getPrimitive(ast);
+    if(primitive == Primitive::INT_NEG || primitive == Primitive::REAL_NEG){
+        auto V = dispatch(ast->getExp2());
+        if(!V)
+            return nullptr;
+        if(primitive == Primitive::INT_NEG)
+            return _jitModule->builder.CreateNeg(V, "negtmp");
+        return _jitModule->builder.CreateFNeg(V, "negtmp");
+    }
+    // the field a selector is resolved to by the type check.
+    if(auto selector = AST::dynCast<RecordSelectorExpAST>(ast->getExp1())){
+        auto offset = ASTProperty::getFieldOffset(selector);
+        auto record = dispatch(ast->getExp2());
+        if(offset < 0 || !record)
+            return nullptr;
+        if(!record->getType()->isStructTy()){
+            Error("invalid record selected");
+            return nullptr;
+        }
+        return _jitModule->builder.CreateExtractValue(record, unsigned(offset), "selecttmp");
+    }
+    if(auto con = AST::dynCast<ValueOrConstructorIdentifierExpAST>(ast->getExp1())){
         string str = con->getLongId()->getIds()[0]->get();
 
-        llvm::Function* callF = getFunction(str,this);
+        llvm::Function* callF = getFunction(str);
         if(!callF)
             Error("invalid Function name");
 
-        // If argument mismatch error.
-        if(auto arg = dynamic_pointer_cast<TupleExpAST>(ast->getExp2())){
-            if (callF->arg_size() != arg->getExps().size())
-                ////FIX THIS
-                Error("Incorrect # arguments passed");
-
-            std::vector<llvm::Value *> ArgsV;
-            for (unsigned i = 0, e = arg->getExps().size(); i != e; ++i) {
-                auto tem = (llvm::Value*)arg->getExps()[i]->accept(this);
-                ArgsV.push_back(tem);
-                if (!ArgsV.back())
-                    return nullptr;
-            }
+        auto &exp2 = ast->getExp2();
+        switch (exp2->getKind()) {
+            case ASTKind::TupleExpAST: {
+                auto arg = AST::cast<TupleExpAST>(exp2);
+                // If argument mismatch error.
+                if (callF->arg_size() != arg->getExps().size())
+                    ////FIX THIS
+                    Error("Incorrect # arguments passed");
+
+                std::vector<llvm::Value *> ArgsV;
+                for (unsigned i = 0, e = arg->getExps().size(); i != e; ++i) {
+                    auto tem = dispatch(arg->getExps()[i]);
+                    ArgsV.push_back(tem);
+                    if (!ArgsV.back())
+                        return nullptr;
+                }
 
-            return Builder.CreateCall(callF, ArgsV, "calltmp");
-        }else if(auto arg = dynamic_pointer_cast<ConstantExpAST>(ast->getExp2())){
-            std::vector<llvm::Value *> ArgsV;
-            for (unsigned i = 0, e = 1; i != e; ++i) {
-                auto tem = (llvm::Value*)arg->accept(this);
-                ArgsV.push_back(tem);
-                if (!ArgsV.back())
-                    return nullptr;
+                return _jitModule->builder.CreateCall(callF, ArgsV, "calltmp");
             }
-            return Builder.CreateCall(callF, ArgsV, "calltmp");
+            case ASTKind::ConstantExpAST: {
+                std::vector<llvm::Value *> ArgsV;
+                for (unsigned i = 0, e = 1; i != e; ++i) {
+                    auto tem = dispatch(exp2);
+                    ArgsV.push_back(tem);
+                    if (!ArgsV.back())
+                        return nullptr;
+                }
+                return _jitModule->builder.CreateCall(callF, ArgsV, "calltmp");
+            }
+            default:
+                break;
         }
     }
+    return nullptr;
 }
 
-void *CodeGen::visit(ValueOrConstructorIdentifierExpAST *ast) {
-    llvm::Value* V = NamedValues[ast->getLongId()->getIds()[0]->get()];
+llvm::Value *CodeGen::visit(ValueOrConstructorIdentifierExpAST *ast) {
+    llvm::Value* V = _jitModule->namedValues.lookup(ast->getLongId()->getIds()[0]->get());
     if(!V)
         Error("unknown variable name");
     return V;
@@ -562,25 +584,30 @@ void *CodeGen::visit(ValueOrConstructorIdentifierExpAST *ast) {
 //    return tem;
 }
 
-void *CodeGen::visit(LocalDeclarationExpAST *ast) {///返回llvm::Function*
+llvm::Value *CodeGen::visit(LocalDeclarationExpAST *ast) {///返回llvm::Function*
     std::vector<llvm::Value*> tem;
     auto exps = ast->getExps();
     auto dec = ast->getDec();
-    dec->accept(this);
+    dispatch(dec);
     for(int i =0;i<ast->getExps().size();i++){
-        tem.push_back((llvm::Value*)ast->getExps()[i]->accept(this));
+        tem.push_back(dispatch(ast->getExps()[i]));
     }
     return tem[tem.size()-1];
 }
 
-void *CodeGen::visit(SequenceDecAST *ast) {
+llvm::Value *CodeGen::visit(SequenceDecAST *ast) {
 
     for(int i =0;i<ast->getDecs().size();i++){
-        auto temValue = (llvm::Value*)ast->getDecs()[i]->accept(this);
-
-        auto temDec = dynamic_pointer_cast<ValueDecAST>(ast->getDecs()[i]);
-        auto temDesDec = dynamic_pointer_cast<DestructuringValBindAST>(temDec->getValBind());
-        auto temConDec = dynamic_pointer_cast<ConstructionPatAST>(temDesDec->getPat());
-        NamedValues[temConDec->getLongId()->getIds()[0]->get()] = temValue;
+        auto temValue = dispatch(ast->getDecs()[i]);
+
+        if (ast->getDecs()[i]->getKind() != ASTKind::ValueDecAST)
+            continue;
+        auto temDec = AST::cast<ValueDecAST>(ast->getDecs()[i]);
+        auto temDesDec = AST::dynCast<DestructuringValBindAST>(temDec->getValBind());
+        if (!temDesDec)
+            continue;
+        if (auto temConDec = AST::dynCast<ConstructionPatAST>(temDesDec->getPat()))
+            _jitModule->namedValues.insert(temConDec->getLongId()->getIds()[0]->get(), temValue);
     }
+    return nullptr;
 }
@@ -11,7 +11,7 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "AST/AST.h"
-#include "AST/ASTVisitor.h"
+#include "AST/ASTTypedVisitor.h"
 #include "CodeGenerator.h"
 #include "Error.h"
 #include "Symbol/SymbolTable.h"
@@ -22,80 +22,104 @@
 using namespace std;
 //using llvm::Value;
 
-class CodeGen : public ASTVisitor {
+struct JITModule;
+
+class CodeGen : public ASTTypedVisitor<CodeGen, llvm::Value *> {
 public:
-    void *visit(ValBindAST *ast) override;
+    /**
+     * @param symbolTable The symbol table the names are looked up in.
+     * @param jitModule The state of the code generated.
+     */
+    CodeGen(SymbolTable *symbolTable, JITModule *jitModule);
+
+    using ASTTypedVisitor::visit;
 
-    void *visit(IntConAST *ast) override;
+    llvm::Value *visit(ValBindAST *ast);
 
-    void *visit(FloatConAST *ast) override;
+    llvm::Value *visit(IntConAST *ast);
 
-    void *visit(CharConAST *ast) override;
+    llvm::Value *visit(FloatConAST *ast);
 
-    void *visit(StringConAST *ast) override;
+    llvm::Value *visit(CharConAST *ast);
 
-    void *visit(BoolConAST *ast) override;
+    llvm::Value *visit(StringConAST *ast);
 
-    void *visit(DisjunctionExpAST *ast) override;
+    llvm::Value *visit(BoolConAST *ast);
 
-    void *visit(ConjunctionExpAST *ast) override;
+    llvm::Value *visit(DisjunctionExpAST *ast);
 
-    void *visit(IdAST *ast) override;
+    llvm::Value *visit(ConjunctionExpAST *ast);
 
-    void *visit(VarAST *ast) override;
+    llvm::Value *visit(IdAST *ast);
 
-    void *visit(LongIdAST *ast) override;
+    llvm::Value *visit(VarAST *ast);
 
-    void *visit(IdentifierLabAST *ast) override;
+    llvm::Value *visit(LongIdAST *ast);
 
-    void *visit(NumberLabAST *ast) override;
+    llvm::Value *visit(IdentifierLabAST *ast);
 
-    void *visit(MatchAST *ast) override;
+    llvm::Value *visit(NumberLabAST *ast);
 
-    void *visit(FunctionExpAST *ast) override;
+    llvm::Value *visit(MatchAST *ast);
 
-    void *visit(FunctionTypAST *ast) override;
+    llvm::Value *visit(FunctionExpAST *ast);
 
-    void *visit(InfixConstructionPatAST *ast) override;
+    llvm::Value *visit(FunctionTypAST *ast);
 
-    void *visit(FunctionDecAST *ast) override;
+    llvm::Value *visit(InfixConstructionPatAST *ast);
 
-    void *visit(FunBindAST *ast) override;
+    llvm::Value *visit(FunctionDecAST *ast);
 
-    void *visit(FunMatchAST *ast) override;
+    llvm::Value *visit(FunBindAST *ast);
 
-    void *visit(TuplePatAST *ast) override;
+    llvm::Value *visit(FunMatchAST *ast);
 
-    void *visit(VariablePatAST *ast) override;
+    llvm::Value *visit(TuplePatAST *ast);
 
-    void *visit(InfixApplicationExpAST *ast) override;
+    llvm::Value *visit(VariablePatAST *ast);
 
-    void *visit(ConditionalExpAST *ast) override;
+    llvm::Value *visit(InfixApplicationExpAST *ast);
 
-    void *visit(ValueDecAST *ast) override;
+    llvm::Value *visit(ConditionalExpAST *ast);
 
-    void *visit(DestructuringValBindAST *ast) override;
+    llvm::Value *visit(ValueDecAST *ast);
 
-    void *visit(ConstantExpAST *ast) override;
+    llvm::Value *visit(DestructuringValBindAST *ast);
 
-    void *visit(ConAST *ast) override;
+    llvm::Value *visit(ConstantExpAST *ast);
 
-    void *visit(ExpAST *ast) override;
+    llvm::Value *visit(ApplicationExpAST *ast);
 
-    void *visit(ApplicationExpAST *ast) override;
+    llvm::Value *visit(ValueOrConstructorIdentifierExpAST *ast);
 
-    void *visit(ValueOrConstructorIdentifierExpAST *ast) override;
+    llvm::Value *visit(LocalDeclarationExpAST *ast);
 
-    void *visit(LocalDeclarationExpAST *ast) override;
+    llvm::Value *visit(SequenceDecAST *ast);
 
-    void *visit(SequenceDecAST *ast) override;
+    /**
+     * Get the function of a name in the current module, declared from its
+     * definition if not yet.
+     * @return The function, or null if no function is defined of the name.
+     */
+    llvm::Function *getFunction(const std::string &Name);
 
 private:
     llvm::Value *visitAsValue(const std::shared_ptr<ExpAST>& exp);
 
+    SymbolTable *_symbolTable;
+
+    JITModule *_jitModule;
+
     llvm::Value *_value{};
 };
 
 struct CodeGenerator::Impl {
+    Impl(SymbolTable *symbolTable, JITModule *jitModule)
+            : jitModule(jitModule), codeGen(symbolTable, jitModule) {
+
+    }
+
+    JITModule *jitModule;
+
     CodeGen codeGen;
 };
@@ -14,9 +14,38 @@ inline void *__VA_ARGS__::accept(ASTVisitor *____v) {return ____v->visit(this);}
 
 APPLY_ALL
 
+ExpRowAST::ExpRowAST() : AST(ASTKind::ExpRowAST) {
+
+}
+
+RecordTupleExpAST::RecordTupleExpAST() : ExpAST(ASTKind::RecordTupleExpAST) {
+
+}
+
+CaseAnalysisExpAST::CaseAnalysisExpAST() : ExpAST(ASTKind::CaseAnalysisExpAST) {
+
+}
+
+WildCardPatAST::WildCardPatAST() : PatAST(ASTKind::WildCardPatAST) {
+
+}
+
+LayeredPatAST::LayeredPatAST() : PatAST(ASTKind::LayeredPatAST) {
+
+}
+
+WildCardPatRowAST::WildCardPatRowAST() : PatRowAST(ASTKind::WildCardPatRowAST) {
+
+}
+
+DataTypeDecAST::DataTypeDecAST() : DecAST(ASTKind::DataTypeDecAST) {
+
+}
+
 LeftAssociativeInfixDecAST::LeftAssociativeInfixDecAST(
         std::vector<std::shared_ptr<IdAST>> ids, int priority)
-        : ids(std::move(ids)), priority(priority) {
+        : DecAST(ASTKind::LeftAssociativeInfixDecAST),
+          ids(std::move(ids)), priority(priority) {
 
 }
 
@@ -31,7 +60,8 @@ int LeftAssociativeInfixDecAST::getPriority() const {
 
 RightAssociativeInfixDecAST::RightAssociativeInfixDecAST(
         std::vector<std::shared_ptr<IdAST>> ids, int priority)
-        : ids(std::move(ids)), priority(priority) {
+        : DecAST(ASTKind::RightAssociativeInfixDecAST),
+          ids(std::move(ids)), priority(priority) {
 
 }
 
@@ -49,12 +79,12 @@ const std::shared_ptr<ExpAST> &ParenthesesExpAST::getExp() const {
 }
 
 ParenthesesExpAST::ParenthesesExpAST(std::shared_ptr<ExpAST> exp)
-        : exp(std::move(exp)) {
+        : ExpAST(ASTKind::ParenthesesExpAST), exp(std::move(exp)) {
 
 }
 
 ParenthesesPatAST::ParenthesesPatAST(std::shared_ptr<PatAST> pat)
-        : pat(std::move(pat)) {
+        : PatAST(ASTKind::ParenthesesPatAST), pat(std::move(pat)) {
 
 }
 
@@ -66,7 +96,8 @@ const std::shared_ptr<PatAST> &ParenthesesPatAST::getPat() const {
 LocalDeclarationExpAST::LocalDeclarationExpAST(
         std::shared_ptr<DecAST> dec,
         std::vector<std::shared_ptr<ExpAST>> exps)
-        : _dec(std::move(dec)), _exps(std::move(exps)) {
+        : ExpAST(ASTKind::LocalDeclarationExpAST),
+          _dec(std::move(dec)), _exps(std::move(exps)) {
 
 }
 
@@ -79,23 +110,42 @@ LocalDeclarationExpAST::getExps() const {
     return _exps;
 }
 
-NonfixDecAST::NonfixDecAST(std::vector<std::shared_ptr<IdAST>> ids) : ids(
-        std::move(ids)) {}
+NonfixDecAST::NonfixDecAST(std::vector<std::shared_ptr<IdAST>> ids)
+        : DecAST(ASTKind::NonfixDecAST),
+          ids(std::move(ids)) {}
+
+const std::vector<std::shared_ptr<IdAST>> &NonfixDecAST::getIds() const {
+    return ids;
+}
 
 LocalDecAST::LocalDecAST(std::shared_ptr<DecAST> dec1,
-                         std::shared_ptr<DecAST> dec2) : dec1(std::move(dec1)),
-                                                         dec2(std::move(
-                                                                 dec2)) {}
+                         std::shared_ptr<DecAST> dec2)
+        : DecAST(ASTKind::LocalDecAST),
+          dec1(std::move(dec1)),
+          dec2(std::move(dec2)) {}
+
+const std::shared_ptr<DecAST> &LocalDecAST::getDec1() const {
+    return dec1;
+}
+
+const std::shared_ptr<DecAST> &LocalDecAST::getDec2() const {
+    return dec2;
+}
 
 SequenceDecAST::SequenceDecAST(std::vector<std::shared_ptr<DecAST>> decs)
-        : _decs(std::move(decs)) {}
+        : DecAST(ASTKind::SequenceDecAST), _decs(std::move(decs)) {}
 
 const std::vector<std::shared_ptr<DecAST>> &SequenceDecAST::getDecs() const {
     return _decs;
 }
 
-VariableTypAST::VariableTypAST(std::shared_ptr<VarAST> var) : _var(
-        std::move(var)) {}
+VariableTypAST::VariableTypAST(std::shared_ptr<VarAST> var)
+        : TypAST(ASTKind::VariableTypAST),
+          _var(std::move(var)) {}
+
+const std::shared_ptr<VarAST> &VariableTypAST::getVar() const {
+    return _var;
+}
 
 
 InfixFunMatchAST::InfixFunMatchAST(std::shared_ptr<IdAST> id,
@@ -103,13 +153,17 @@ InfixFunMatchAST::InfixFunMatchAST(std::shared_ptr<IdAST> id,
                                    std::shared_ptr<ExpAST> exp,
                                    std::shared_ptr<TypAST> typ,
                                    std::shared_ptr<FunMatchAST> orFunMatch)
-        : FunMatchAST(std::move(id),
+        : FunMatchAST(ASTKind::InfixFunMatchAST,
+                      std::move(id),
                       std::move(pats),
                       std::move(exp),
                       std::move(typ),
                       std::move(orFunMatch)) {
-    this->_pat1 = std::move(pats[0]);
-    this->_pat2 = std::move(pats[1]);
+    // pats is moved to the base already.
+    if (_pats.size() == 2) {
+        this->_pat1 = _pats[0];
+        this->_pat2 = _pats[1];
+    }
 }
 
 const std::shared_ptr<PatAST> &InfixFunMatchAST::getPat1() const {
@@ -125,7 +179,8 @@ NonFixFunMatchAST::NonFixFunMatchAST(std::shared_ptr<IdAST> id,
                                      std::shared_ptr<ExpAST> exp,
                                      std::shared_ptr<TypAST> typ,
                                      std::shared_ptr<FunMatchAST> orFunMatch)
-        : FunMatchAST(std::move(id),
+        : FunMatchAST(ASTKind::NonFixFunMatchAST,
+                      std::move(id),
                       std::move(pats),
                       std::move(exp),
                       std::move(typ),
@@ -133,11 +188,17 @@ NonFixFunMatchAST::NonFixFunMatchAST(std::shared_ptr<IdAST> id,
 
 }
 
-RecordSelectorExpAST::RecordSelectorExpAST(std::shared_ptr<LabAST> lab) : _lab(
-        std::move(lab)) {}
+RecordSelectorExpAST::RecordSelectorExpAST(std::shared_ptr<LabAST> lab)
+        : ExpAST(ASTKind::RecordSelectorExpAST),
+          _lab(std::move(lab)) {}
+
+const std::shared_ptr<LabAST> &RecordSelectorExpAST::getLab() const {
+    return _lab;
+}
 
-TupleExpAST::TupleExpAST(std::vector<std::shared_ptr<ExpAST>> exps) : _exps(
-        std::move(exps)) {}
+TupleExpAST::TupleExpAST(std::vector<std::shared_ptr<ExpAST>> exps)
+        : ExpAST(ASTKind::TupleExpAST),
+          _exps(std::move(exps)) {}
 
 const std::vector<std::shared_ptr<ExpAST>> &TupleExpAST::getExps() const {
     return _exps;
@@ -164,15 +225,30 @@ FunMatchAST::FunMatchAST(std::shared_ptr<IdAST> id,
                          std::vector<std::shared_ptr<PatAST>> pats,
                          std::shared_ptr<ExpAST> exp,
                          std::shared_ptr<TypAST> typ,
-                         std::shared_ptr<FunMatchAST> orFunMatch) : _id(
-        std::move(id)), _pats(std::move(pats)),
-                                                                    _exp(std::move(
-                                                                            exp)),
-                                                                    _typ(std::move(
-                                                                            typ)),
-                                                                    _orFunMatch(
-                                                                            std::move(
-                                                                                    orFunMatch)) {}
+                         std::shared_ptr<FunMatchAST> orFunMatch)
+        : FunMatchAST(ASTKind::FunMatchAST,
+                      std::move(id),
+                      std::move(pats),
+                      std::move(exp),
+                      std::move(typ),
+                      std::move(orFunMatch)) {
+
+}
+
+FunMatchAST::FunMatchAST(ASTKind kind,
+                         std::shared_ptr<IdAST> id,
+                         std::vector<std::shared_ptr<PatAST>> pats,
+                         std::shared_ptr<ExpAST> exp,
+                         std::shared_ptr<TypAST> typ,
+                         std::shared_ptr<FunMatchAST> orFunMatch)
+        : AST(kind),
+          _id(std::move(id)),
+          _pats(std::move(pats)),
+          _exp(std::move(exp)),
+          _typ(std::move(typ)),
+          _orFunMatch(std::move(orFunMatch)) {
+
+}
 
 const std::shared_ptr<TypAST> &FunMatchAST::getTyp() const {
     return _typ;
@@ -186,8 +262,17 @@ FunMatchAST::setOrFunMatch(const std::shared_ptr<FunMatchAST> &orFunMatch) {
 
 IterationExpAST::IterationExpAST(std::shared_ptr<ExpAST> exp1,
                                  std::shared_ptr<ExpAST> exp2)
-        : exp1(std::move(exp1)), exp2(std::move(exp2)) {
+        : ExpAST(ASTKind::IterationExpAST),
+          exp1(std::move(exp1)), exp2(std::move(exp2)) {
+
+}
+
+const std::shared_ptr<ExpAST> &IterationExpAST::getExp1() const {
+    return exp1;
+}
 
+const std::shared_ptr<ExpAST> &IterationExpAST::getExp2() const {
+    return exp2;
 }
 
 const std::vector<std::shared_ptr<PatAST>> &TuplePatAST::getPats() const {
@@ -195,13 +280,14 @@ const std::vector<std::shared_ptr<PatAST>> &TuplePatAST::getPats() const {
 }
 
 TuplePatAST::TuplePatAST(std::vector<std::shared_ptr<PatAST>> pats)
-        : pats(std::move(pats)) {
+        : PatAST(ASTKind::TuplePatAST), pats(std::move(pats)) {
 
 }
 
 ConstructionPatAST::ConstructionPatAST(
         std::shared_ptr<LongIdAST> longId, std::shared_ptr<PatAST> pat)
-        : longId(std::move(longId)), pat(std::move(pat)) {
+        : PatAST(ASTKind::ConstructionPatAST),
+          longId(std::move(longId)), pat(std::move(pat)) {
 
 }
 
@@ -217,13 +303,15 @@ InfixConstructionPatAST::InfixConstructionPatAST(
         std::shared_ptr<PatAST> pat1,
         std::shared_ptr<IdAST> id,
         std::shared_ptr<PatAST> pat2)
-        : pat1(std::move(pat1)), id(std::move(id)), pat2(std::move(pat2)) {
+        : PatAST(ASTKind::InfixConstructionPatAST),
+          pat1(std::move(pat1)), id(std::move(id)), pat2(std::move(pat2)) {
 
 }
 
 ValueOrConstructorIdentifierExpAST::ValueOrConstructorIdentifierExpAST(
         std::shared_ptr<LongIdAST> longId)
-        : longId(std::move(longId)) {
+        : ExpAST(ASTKind::ValueOrConstructorIdentifierExpAST),
+          longId(std::move(longId)) {
 
 }
 
@@ -234,7 +322,8 @@ ValueOrConstructorIdentifierExpAST::getLongId() const {
 
 ApplicationExpAST::ApplicationExpAST(
         std::shared_ptr<ExpAST> exp1, std::shared_ptr<ExpAST> exp2)
-        : exp1(std::move(exp1)), exp2(std::move(exp2)) {
+        : ExpAST(ASTKind::ApplicationExpAST),
+          exp1(std::move(exp1)), exp2(std::move(exp2)) {
 
 }
 
@@ -247,7 +336,7 @@ const std::shared_ptr<ExpAST> &ApplicationExpAST::getExp2() const {
 }
 
 ListExpAST::ListExpAST(std::vector<std::shared_ptr<ExpAST>> exps)
-        : exps(std::move(exps)) {
+        : ExpAST(ASTKind::ListExpAST), exps(std::move(exps)) {
 
 }
 
@@ -255,16 +344,23 @@ const std::vector<std::shared_ptr<ExpAST>> &ListExpAST::getExps() const {
     return exps;
 }
 
-EqualityVarAST::EqualityVarAST(std::string var) : VarAST(std::move(var)) {
+EqualityVarAST::EqualityVarAST(std::string var)
+        : VarAST(ASTKind::EqualityVarAST, std::move(var)) {
 
 }
 
 UnconstrainedVarAST::UnconstrainedVarAST(std::string var)
-        : VarAST(std::move(var)) {
+        : VarAST(ASTKind::UnconstrainedVarAST, std::move(var)) {
 
 }
 
-VarAST::VarAST(std::string var) : _var(std::move(var)) {
+VarAST::VarAST(std::string var)
+        : VarAST(ASTKind::VarAST, std::move(var)) {
+
+}
+
+VarAST::VarAST(ASTKind kind, std::string var)
+        : AST(kind), _var(std::move(var)) {
 
 }
 
@@ -288,14 +384,16 @@ InfixApplicationExpAST::InfixApplicationExpAST(
         std::shared_ptr<ExpAST> exp1,
         std::shared_ptr<IdAST> id,
         std::shared_ptr<ExpAST> exp2)
-        : exp1(std::move(exp1)), id(std::move(id)), exp2(std::move(exp2)) {
+        : ExpAST(ASTKind::InfixApplicationExpAST),
+          exp1(std::move(exp1)), id(std::move(id)), exp2(std::move(exp2)) {
 
 }
 
 MatchAST::MatchAST(std::shared_ptr<PatAST> pat,
                    std::shared_ptr<ExpAST> exp,
                    std::shared_ptr<MatchAST> match)
-        : pat(std::move(pat)), exp(std::move(exp)), match(std::move(match)) {
+        : AST(ASTKind::MatchAST),
+          pat(std::move(pat)), exp(std::move(exp)), match(std::move(match)) {
 
 }
 
@@ -316,7 +414,7 @@ void MatchAST::setMatch(const std::shared_ptr<MatchAST> &orMatch) {
 }
 
 LongIdAST::LongIdAST(std::vector<std::shared_ptr<IdAST>> ids)
-        : ids(std::move(ids)) {
+        : AST(ASTKind::LongIdAST), ids(std::move(ids)) {
 
 }
 
@@ -325,7 +423,7 @@ const std::vector<std::shared_ptr<IdAST>> &LongIdAST::getIds() const {
 }
 
 ConstructorTypAST::ConstructorTypAST(std::shared_ptr<LongIdAST> longId)
-        : longId(std::move(longId)) {
+        : TypAST(ASTKind::ConstructorTypAST), longId(std::move(longId)) {
 
 }
 
@@ -335,7 +433,8 @@ const std::shared_ptr<LongIdAST> &ConstructorTypAST::getLongId() const {
 
 TypeAnnotationExpAST::TypeAnnotationExpAST(
         std::shared_ptr<ExpAST> exp, std::shared_ptr<TypAST> typ)
-        : exp(std::move(exp)), typ(std::move(typ)) {
+        : ExpAST(ASTKind::TypeAnnotationExpAST),
+          exp(std::move(exp)), typ(std::move(typ)) {
 
 }
 
@@ -348,7 +447,7 @@ const std::shared_ptr<TypAST> &TypeAnnotationExpAST::getTyp() const {
 }
 
 TupleTypAST::TupleTypAST(std::vector<std::shared_ptr<TypAST>> tuple)
-        : tuple(std::move(tuple)) {
+        : TypAST(ASTKind::TupleTypAST), tuple(std::move(tuple)) {
 
 }
 
@@ -356,7 +455,7 @@ const std::vector<std::shared_ptr<TypAST>> &TupleTypAST::getTuple() const {
     return tuple;
 }
 
-NumberLabAST::NumberLabAST(int n) : n(n) {
+NumberLabAST::NumberLabAST(int n) : LabAST(ASTKind::NumberLabAST), n(n) {
 
 }
 
@@ -365,7 +464,7 @@ int NumberLabAST::getN() const {
 }
 
 IdentifierLabAST::IdentifierLabAST(std::shared_ptr<IdAST> id)
-        : id(std::move(id)) {
+        : LabAST(ASTKind::IdentifierLabAST), id(std::move(id)) {
 
 }
 
@@ -373,21 +472,25 @@ const std::shared_ptr<IdAST> &IdentifierLabAST::getId() const {
     return id;
 }
 
-AlphanumericIdAST::AlphanumericIdAST(std::string id) : IdAST(std::move(id)) {
+AlphanumericIdAST::AlphanumericIdAST(std::string id)
+        : IdAST(ASTKind::AlphanumericIdAST, std::move(id)) {
 
 }
 
-SymbolicIdAST::SymbolicIdAST(std::string id) : IdAST(std::move(id)) {
+SymbolicIdAST::SymbolicIdAST(std::string id)
+        : IdAST(ASTKind::SymbolicIdAST, std::move(id)) {
 
 }
 
-BoolConAST::BoolConAST(bool b) : b(b) {}
+BoolConAST::BoolConAST(bool b) : ConAST(ASTKind::BoolConAST), b(b) {}
 
 bool BoolConAST::get() const {
     return b;
 }
 
-VariablePatAST::VariablePatAST(std::shared_ptr<IdAST> id) : id(std::move(id)) {
+VariablePatAST::VariablePatAST(std::shared_ptr<IdAST> id)
+        : PatAST(ASTKind::VariablePatAST),
+          id(std::move(id)) {
 
 }
 
@@ -409,7 +512,8 @@ const std::shared_ptr<PatAST> &InfixConstructionPatAST::getPat2() const {
 
 TypeAnnotationPatAST::TypeAnnotationPatAST(
         std::shared_ptr<PatAST> pat, std::shared_ptr<TypAST> typ)
-        : pat(std::move(pat)), typ(std::move(typ)) {
+        : PatAST(ASTKind::TypeAnnotationPatAST),
+          pat(std::move(pat)), typ(std::move(typ)) {
 
 }
 
@@ -422,7 +526,7 @@ const std::shared_ptr<TypAST> &TypeAnnotationPatAST::getTyp() const {
 }
 
 ConstantExpAST::ConstantExpAST(std::shared_ptr<ConAST> con)
-        : con(std::move(con)) {
+        : ExpAST(ASTKind::ConstantExpAST), con(std::move(con)) {
 
 }
 
@@ -430,7 +534,7 @@ const std::shared_ptr<ConAST> &ConstantExpAST::getCon() const {
     return con;
 }
 
-IdAST::IdAST(std::string id) : id(std::move(id)) {
+IdAST::IdAST(ASTKind kind, std::string id) : AST(kind), id(std::move(id)) {
 
 }
 
@@ -438,7 +542,9 @@ const std::string &IdAST::get() const {
     return id;
 }
 
-StringConAST::StringConAST(std::string str) : str(std::move(str)) {
+StringConAST::StringConAST(std::string str)
+        : ConAST(ASTKind::StringConAST),
+          str(std::move(str)) {
 
 }
 
@@ -446,7 +552,7 @@ const std::string &StringConAST::get() const {
     return str;
 }
 
-FloatConAST::FloatConAST(double v) : v(v) {
+FloatConAST::FloatConAST(double v) : ConAST(ASTKind::FloatConAST), v(v) {
 
 }
 
@@ -454,7 +560,7 @@ double FloatConAST::get() const {
     return v;
 }
 
-CharConAST::CharConAST(char c) : c(c) {
+CharConAST::CharConAST(char c) : ConAST(ASTKind::CharConAST), c(c) {
 
 }
 
@@ -462,7 +568,7 @@ char CharConAST::get() const {
     return c;
 }
 
-IntConAST::IntConAST(int v) : v(v) {
+IntConAST::IntConAST(int v) : ConAST(ASTKind::IntConAST), v(v) {
 
 }
 
@@ -474,7 +580,8 @@ ConditionalExpAST::ConditionalExpAST(
         std::shared_ptr<ExpAST> exp1,
         std::shared_ptr<ExpAST> exp2,
         std::shared_ptr<ExpAST> exp3)
-        : exp1(std::move(exp1)), exp2(std::move(exp2)), exp3(std::move(exp3)) {
+        : ExpAST(ASTKind::ConditionalExpAST),
+          exp1(std::move(exp1)), exp2(std::move(exp2)), exp3(std::move(exp3)) {
 
 }
 
@@ -491,7 +598,7 @@ const std::shared_ptr<ExpAST> &ConditionalExpAST::getExp3() const {
 }
 
 FunctionExpAST::FunctionExpAST(std::shared_ptr<MatchAST> match)
-        : match(std::move(match)) {
+        : ExpAST(ASTKind::FunctionExpAST), match(std::move(match)) {
 }
 
 const std::shared_ptr<MatchAST> &FunctionExpAST::getMatch() const {
@@ -500,7 +607,8 @@ const std::shared_ptr<MatchAST> &FunctionExpAST::getMatch() const {
 
 DisjunctionExpAST::DisjunctionExpAST(
         std::shared_ptr<ExpAST> exp1, std::shared_ptr<ExpAST> exp2)
-        : exp1(std::move(exp1)), exp2(std::move(exp2)) {
+        : ExpAST(ASTKind::DisjunctionExpAST),
+          exp1(std::move(exp1)), exp2(std::move(exp2)) {
 
 }
 
@@ -515,7 +623,8 @@ const std::shared_ptr<ExpAST> &DisjunctionExpAST::getExp2() const {
 ConjunctionExpAST::ConjunctionExpAST(
         std::shared_ptr<ExpAST> exp1,
         std::shared_ptr<ExpAST> exp2)
-        : exp1(std::move(exp1)), exp2(std::move(exp2)) {
+        : ExpAST(ASTKind::ConjunctionExpAST),
+          exp1(std::move(exp1)), exp2(std::move(exp2)) {
 
 }
 
@@ -528,7 +637,7 @@ const std::shared_ptr<ExpAST> &ConjunctionExpAST::getExp2() const {
 }
 
 ConstantPatAST::ConstantPatAST(std::shared_ptr<ConAST> con)
-        : con(std::move(con)) {
+        : PatAST(ASTKind::ConstantPatAST), con(std::move(con)) {
 
 }
 
@@ -540,7 +649,8 @@ TypRowAST::TypRowAST(
         std::shared_ptr<LabAST> lab,
         std::shared_ptr<TypAST> typ,
         std::shared_ptr<TypRowAST> typRow)
-        : lab(std::move(lab)), typ(std::move(typ)), typRow(std::move(typRow)) {
+        : AST(ASTKind::TypRowAST),
+          lab(std::move(lab)), typ(std::move(typ)), typRow(std::move(typRow)) {
 
 }
 
@@ -557,7 +667,7 @@ const std::shared_ptr<TypRowAST> &TypRowAST::getTypRow() const {
 }
 
 RecordTypAST::RecordTypAST(std::shared_ptr<TypRowAST> typRow)
-        : typRow(std::move(typRow)) {
+        : TypAST(ASTKind::RecordTypAST), typRow(std::move(typRow)) {
 
 }
 
@@ -567,7 +677,8 @@ const std::shared_ptr<TypRowAST> &RecordTypAST::getTypRow() const {
 
 FunctionTypAST::FunctionTypAST(
         std::shared_ptr<TypAST> typ1, std::shared_ptr<TypAST> typ2)
-        : typ1(std::move(typ1)), typ2(std::move(typ2)) {
+        : TypAST(ASTKind::FunctionTypAST),
+          typ1(std::move(typ1)), typ2(std::move(typ2)) {
 
 }
 
@@ -580,7 +691,7 @@ const std::shared_ptr<TypAST> &FunctionTypAST::getTyp2() const {
 }
 
 ParenthesesTypAST::ParenthesesTypAST(std::shared_ptr<TypAST> typ)
-        : typ(std::move(typ)) {
+        : TypAST(ASTKind::ParenthesesTypAST), typ(std::move(typ)) {
 
 }
 
@@ -589,7 +700,7 @@ const std::shared_ptr<TypAST> &ParenthesesTypAST::getTyp() const {
 }
 
 FunctionDecAST::FunctionDecAST(std::shared_ptr<FunBindAST> funBind)
-        : funBind(std::move(funBind)) {
+        : DecAST(ASTKind::FunctionDecAST), funBind(std::move(funBind)) {
 
 }
 
@@ -598,7 +709,8 @@ const std::shared_ptr<FunBindAST> &FunctionDecAST::getFunBind() const {
 }
 
 RecursiveValBindAST::RecursiveValBindAST(std::shared_ptr<ValBindAST> valBind)
-        : valBind(std::move(valBind)) {
+        : ValBindAST(ASTKind::RecursiveValBindAST),
+          valBind(std::move(valBind)) {
 
 }
 
@@ -607,7 +719,7 @@ const std::shared_ptr<ValBindAST> &RecursiveValBindAST::getValBind() const {
 }
 
 TypeDecAST::TypeDecAST(std::shared_ptr<TypBindAST> typBind)
-        : _typBind(std::move(typBind)) {
+        : DecAST(ASTKind::TypeDecAST), _typBind(std::move(typBind)) {
 
 }
 
@@ -616,7 +728,7 @@ const std::shared_ptr<TypBindAST> &TypeDecAST::getTypBind() const {
 }
 
 ValueDecAST::ValueDecAST(std::shared_ptr<ValBindAST> valBind)
-        : _valBind(std::move(valBind)) {
+        : DecAST(ASTKind::ValueDecAST), _valBind(std::move(valBind)) {
 
 }
 
@@ -628,7 +740,7 @@ DestructuringValBindAST::DestructuringValBindAST(
         std::shared_ptr<PatAST> pat,
         std::shared_ptr<ExpAST> exp,
         std::shared_ptr<ValBindAST> andValBind)
-        : _pat(std::move(pat)),
+        : ValBindAST(ASTKind::DestructuringValBindAST), _pat(std::move(pat)),
           _exp(std::move(exp)),
           _andValBind(std::move(andValBind)) {
 
@@ -655,7 +767,7 @@ void DestructuringValBindAST::setAndValBind(
 FunBindAST::FunBindAST(
         std::shared_ptr<FunMatchAST> funMatch,
         std::shared_ptr<FunBindAST> andFunBind)
-        : _funMatch(std::move(funMatch)),
+        : AST(ASTKind::FunBindAST), _funMatch(std::move(funMatch)),
           _andFunBind(std::move(andFunBind)) {
 
 }
@@ -676,7 +788,7 @@ TypBindAST::TypBindAST(
         std::shared_ptr<IdAST> id,
         std::shared_ptr<TypAST> typ,
         std::shared_ptr<TypBindAST> andTypBind)
-        : id(std::move(id)),
+        : AST(ASTKind::TypBindAST), id(std::move(id)),
           typ(std::move(typ)),
           typBind(std::move(andTypBind)) {
 
@@ -697,3 +809,217 @@ const std::shared_ptr<TypBindAST> &TypBindAST::getTypBind() const {
 void TypBindAST::setTypBind(const std::shared_ptr<TypBindAST> &typBind) {
     TypBindAST::typBind = typBind;
 }
+
+namespace {
+    template<typename TAST>
+    void addChild(std::vector<AST *> &children,
+                  const std::shared_ptr<TAST> &child) {
+        if (child) {
+            children.push_back(child.get());
+        }
+    }
+
+    template<typename TAST>
+    void addChild(std::vector<AST *> &children,
+                  const std::vector<std::shared_ptr<TAST>> &childList) {
+        for (auto &&child : childList) {
+            addChild(children, child);
+        }
+    }
+
+    template<typename ...TChildren>
+    void addChildren(std::vector<AST *> &children,
+                     const TChildren &...childList) {
+        (addChild(children, childList), ...);
+    }
+}
+
+void AST::getChildren(std::vector<AST *> &children) const {
+    auto ast = const_cast<AST *>(this);
+    switch (_kind) {
+        case ASTKind::LongIdAST:
+            addChildren(children, cast<LongIdAST *>(ast)->getIds());
+            break;
+        case ASTKind::IdentifierLabAST:
+            addChildren(children, cast<IdentifierLabAST *>(ast)->getId());
+            break;
+        case ASTKind::ConstantExpAST:
+            addChildren(children, cast<ConstantExpAST *>(ast)->getCon());
+            break;
+        case ASTKind::ValueOrConstructorIdentifierExpAST:
+            addChildren(children,
+                        cast<ValueOrConstructorIdentifierExpAST *>(ast)->getLongId());
+            break;
+        case ASTKind::ApplicationExpAST: {
+            auto exp = cast<ApplicationExpAST *>(ast);
+            addChildren(children, exp->getExp1(), exp->getExp2());
+            break;
+        }
+        case ASTKind::InfixApplicationExpAST: {
+            auto exp = cast<InfixApplicationExpAST *>(ast);
+            addChildren(children, exp->getExp1(), exp->getId(), exp->getExp2());
+            break;
+        }
+        case ASTKind::ParenthesesExpAST:
+            addChildren(children, cast<ParenthesesExpAST *>(ast)->getExp());
+            break;
+        case ASTKind::TupleExpAST:
+            addChildren(children, cast<TupleExpAST *>(ast)->getExps());
+            break;
+        case ASTKind::RecordSelectorExpAST:
+            addChildren(children, cast<RecordSelectorExpAST *>(ast)->getLab());
+            break;
+        case ASTKind::ListExpAST:
+            addChildren(children, cast<ListExpAST *>(ast)->getExps());
+            break;
+        case ASTKind::LocalDeclarationExpAST: {
+            auto exp = cast<LocalDeclarationExpAST *>(ast);
+            addChildren(children, exp->getDec(), exp->getExps());
+            break;
+        }
+        case ASTKind::TypeAnnotationExpAST: {
+            auto exp = cast<TypeAnnotationExpAST *>(ast);
+            addChildren(children, exp->getExp(), exp->getTyp());
+            break;
+        }
+        case ASTKind::ConjunctionExpAST: {
+            auto exp = cast<ConjunctionExpAST *>(ast);
+            addChildren(children, exp->getExp1(), exp->getExp2());
+            break;
+        }
+        case ASTKind::DisjunctionExpAST: {
+            auto exp = cast<DisjunctionExpAST *>(ast);
+            addChildren(children, exp->getExp1(), exp->getExp2());
+            break;
+        }
+        case ASTKind::ConditionalExpAST: {
+            auto exp = cast<ConditionalExpAST *>(ast);
+            addChildren(children, exp->getExp1(), exp->getExp2(), exp->getExp3());
+            break;
+        }
+        case ASTKind::IterationExpAST: {
+            auto exp = cast<IterationExpAST *>(ast);
+            addChildren(children, exp->getExp1(), exp->getExp2());
+            break;
+        }
+        case ASTKind::FunctionExpAST:
+            addChildren(children, cast<FunctionExpAST *>(ast)->getMatch());
+            break;
+        case ASTKind::MatchAST: {
+            auto match = cast<MatchAST *>(ast);
+            addChildren(children, match->getPat(), match->getExp(), match->getMatch());
+            break;
+        }
+        case ASTKind::ConstantPatAST:
+            addChildren(children, cast<ConstantPatAST *>(ast)->getCon());
+            break;
+        case ASTKind::VariablePatAST:
+            addChildren(children, cast<VariablePatAST *>(ast)->getId());
+            break;
+        case ASTKind::ConstructionPatAST: {
+            auto pat = cast<ConstructionPatAST *>(ast);
+            addChildren(children, pat->getLongId(), pat->getPat());
+            break;
+        }
+        case ASTKind::InfixConstructionPatAST: {
+            auto pat = cast<InfixConstructionPatAST *>(ast);
+            addChildren(children, pat->getPat1(), pat->getId(), pat->getPat2());
+            break;
+        }
+        case ASTKind::ParenthesesPatAST:
+            addChildren(children, cast<ParenthesesPatAST *>(ast)->getPat());
+            break;
+        case ASTKind::TuplePatAST:
+            addChildren(children, cast<TuplePatAST *>(ast)->getPats());
+            break;
+        case ASTKind::TypeAnnotationPatAST: {
+            auto pat = cast<TypeAnnotationPatAST *>(ast);
+            addChildren(children, pat->getPat(), pat->getTyp());
+            break;
+        }
+        case ASTKind::VariableTypAST:
+            addChildren(children, cast<VariableTypAST *>(ast)->getVar());
+            break;
+        case ASTKind::ConstructorTypAST:
+            addChildren(children, cast<ConstructorTypAST *>(ast)->getLongId());
+            break;
+        case ASTKind::ParenthesesTypAST:
+            addChildren(children, cast<ParenthesesTypAST *>(ast)->getTyp());
+            break;
+        case ASTKind::FunctionTypAST: {
+            auto typ = cast<FunctionTypAST *>(ast);
+            addChildren(children, typ->getTyp1(), typ->getTyp2());
+            break;
+        }
+        case ASTKind::TupleTypAST:
+            addChildren(children, cast<TupleTypAST *>(ast)->getTuple());
+            break;
+        case ASTKind::RecordTypAST:
+            addChildren(children, cast<RecordTypAST *>(ast)->getTypRow());
+            break;
+        case ASTKind::TypRowAST: {
+            auto typRow = cast<TypRowAST *>(ast);
+            addChildren(children,
+                        typRow->getLab(), typRow->getTyp(), typRow->getTypRow());
+            break;
+        }
+        case ASTKind::ValueDecAST:
+            addChildren(children, cast<ValueDecAST *>(ast)->getValBind());
+            break;
+        case ASTKind::FunctionDecAST:
+            addChildren(children, cast<FunctionDecAST *>(ast)->getFunBind());
+            break;
+        case ASTKind::TypeDecAST:
+            addChildren(children, cast<TypeDecAST *>(ast)->getTypBind());
+            break;
+        case ASTKind::LocalDecAST: {
+            auto dec = cast<LocalDecAST *>(ast);
+            addChildren(children, dec->getDec1(), dec->getDec2());
+            break;
+        }
+        case ASTKind::SequenceDecAST:
+            addChildren(children, cast<SequenceDecAST *>(ast)->getDecs());
+            break;
+        case ASTKind::LeftAssociativeInfixDecAST:
+            addChildren(children, cast<LeftAssociativeInfixDecAST *>(ast)->getIds());
+            break;
+        case ASTKind::RightAssociativeInfixDecAST:
+            addChildren(children, cast<RightAssociativeInfixDecAST *>(ast)->getIds());
+            break;
+        case ASTKind::NonfixDecAST:
+            addChildren(children, cast<NonfixDecAST *>(ast)->getIds());
+            break;
+        case ASTKind::DestructuringValBindAST: {
+            auto valBind = cast<DestructuringValBindAST *>(ast);
+            addChildren(children, valBind->getExp(), valBind->getPat(),
+                        valBind->getAndValBind());
+            break;
+        }
+        case ASTKind::RecursiveValBindAST:
+            addChildren(children, cast<RecursiveValBindAST *>(ast)->getValBind());
+            break;
+        case ASTKind::FunBindAST: {
+            auto funBind = cast<FunBindAST *>(ast);
+            addChildren(children, funBind->getFunMatch(), funBind->getAndFunBind());
+            break;
+        }
+        case ASTKind::FunMatchAST:
+        case ASTKind::NonFixFunMatchAST:
+        case ASTKind::InfixFunMatchAST: {
+            auto funMatch = cast<FunMatchAST *>(ast);
+            addChildren(children, funMatch->getId(), funMatch->getPats(),
+                        funMatch->getTyp(), funMatch->getExp(),
+                        funMatch->getOrFunMatch());
+            break;
+        }
+        case ASTKind::TypBindAST: {
+            auto typBind = cast<TypBindAST *>(ast);
+            addChildren(children,
+                        typBind->getId(), typBind->getTyp(), typBind->getTypBind());
+            break;
+        }
+        default:
+            // constants, ids, vars and the asts not implemented yet.
+            break;
+    }
+}
@@ -25,7 +25,9 @@
 
 *******************************************************************************/
 
+#include <atomic>
 #include <memory>
+#include <type_traits>
 #include <vector>
 
 //region APPLY_ALL forward declarations for all ast.
@@ -38,12 +40,32 @@
 APPLY_ALL
 
 #undef APPLY
+
+/**
+ * The kind of an ast, one for each ast class and named after it. It is set on
+ * construction, so that asts could be classified with a switch instead of a
+ * cascade of dynamic casts.
+ */
+enum class ASTKind {
+#define APPLY(CLASS) CLASS,
+
+    APPLY_ALL
+
+#undef APPLY
+};
+
 #undef APPLY_ALL
 #endif
 //endregion
 
 class ASTVisitor;
 
+class ASTProperty;
+
+class Type;
+
+enum class Primitive : unsigned char;
+
 /*******************************************************************************
 Base AST
 *******************************************************************************/
@@ -85,6 +107,61 @@ public:
         return std::static_pointer_cast<TCastToPtr>(ast);
     }
 
+    /**
+     * Check whether an ast of the kind is an instance of the class.
+     * @tparam TAST The class to check.
+     * @param kind The kind of the ast.
+     * @return Whether the class is the class of the kind or a base of it.
+     */
+    template<typename TAST>
+    static bool isKindOf(ASTKind kind);
+
+    /**
+     * Check whether an ast is an instance of the class by its kind.
+     * @tparam TAST The class to check.
+     * @param ast The ast to check, maybe null.
+     * @return Whether the ast is non-null and an instance of the class.
+     */
+    template<typename TAST>
+    static bool isa(const AST *const ast) {
+        return ast && isKindOf<TAST>(ast->getKind());
+    }
+
+    template<typename TAST, typename TFromAST>
+    static bool isa(const std::shared_ptr<TFromAST> &ast) {
+        return isa<TAST>(static_cast<const AST *>(ast.get()));
+    }
+
+    /**
+     * Down cast an ast pointer from base if it is an instance of the class.
+     * Unlike dynamic_cast, only the kind of the ast is checked.
+     * @tparam TAST The derived class type.
+     * @param ast The pointer to cast, maybe null.
+     * @return The pointer after the cast, or null if it is not an instance.
+     */
+    template<typename TAST>
+    static TAST *dynCast(AST *const ast) {
+        return isa<TAST>(ast) ? static_cast<TAST *>(ast) : nullptr;
+    }
+
+    /**
+     * Down cast an ast shared pointer from base if it is an instance of the
+     * class. Unlike std::dynamic_pointer_cast, only the kind of the ast is
+     * checked.
+     * @tparam TAST The derived class type.
+     * @param ast The pointer to cast, maybe null.
+     * @return The shared pointer after the cast, or null if it is not an
+     * instance.
+     */
+    template<typename TAST, typename TFromAST>
+    static std::shared_ptr<TAST>
+    dynCast(const std::shared_ptr<TFromAST> &ast) {
+        if (!isa<TAST>(ast)) {
+            return nullptr;
+        }
+        return std::static_pointer_cast<TAST>(ast);
+    }
+
     /**
      * Create a concrete ast shared pointer with constructor arguments.
      * @tparam TDerivedAST The concrete ast type.
@@ -97,11 +174,107 @@ public:
             typename ...Args,
             typename = std::enable_if_t<std::is_base_of_v<AST, TDerivedAST>>>
     static auto create(Args &&...args) {
-        return std::make_shared<TDerivedAST>(std::forward<Args>(args)...);
+        auto ast = std::make_shared<TDerivedAST>(std::forward<Args>(args)...);
+        if (_hashConsing) {
+            return std::static_pointer_cast<TDerivedAST>(intern(ast));
+        }
+        return ast;
     }
 
+    /**
+     * Statistics of hash consing since it is cleared.
+     */
+    struct HashConsStatistics {
+        /**
+         * The number of created asts replaced by an identical one.
+         */
+        size_t hits{};
+
+        /**
+         * The number of created asts kept as the shared one.
+         */
+        size_t misses{};
+
+        /**
+         * The bytes of the replaced asts, not counting the shared pointer
+         * control blocks.
+         */
+        size_t savedBytes{};
+    };
+
+    /**
+     * Turn on or off hash consing in create. When it is on, a created
+     * constant, id, long id or type expression is replaced by a structurally
+     * identical ast which is still alive, if any. Such asts are immutable and
+     * their children are replaced in turn, so children are compared by
+     * address.
+     *
+     * Types are recorded per ast, thus ids and long ids carry no type, see
+     * ASTProperty::getType. Types of constants and type expressions do not
+     * depend on where they occur, except that a type expression with a type
+     * variable is never shared.
+     * @param enabled Whether to turn on.
+     */
+    static void setHashConsing(bool enabled);
+
+    [[nodiscard]] static bool isHashConsing();
+
+    [[nodiscard]] static HashConsStatistics getHashConsStatistics();
+
+    /**
+     * Forget all asts to share and reset the statistics.
+     */
+    static void clearHashConsing();
+
+    /**
+     * Get the kind of the ast, i.e. the class it is constructed as.
+     * @return The kind.
+     */
+    [[nodiscard]] ASTKind getKind() const {
+        return _kind;
+    }
+
+    /**
+     * Get the children of the ast in the order they are evaluated, e.g. the
+     * expression of a value binding goes before its pattern. Null children
+     * are skipped.
+     * @param children The vector to append the children to.
+     */
+    void getChildren(std::vector<AST *> &children) const;
+
 protected:
-    AST() = default;
+    explicit AST(ASTKind kind) : _kind(kind) {}
+
+private:
+    friend class ASTProperty;
+
+    /**
+     * Get the shared ast structurally identical to the created one.
+     * @param ast The created ast.
+     * @return The shared ast, or the created ast if it could not be shared or
+     * it is the first one.
+     */
+    static std::shared_ptr<AST> intern(std::shared_ptr<AST> ast);
+
+    /**
+     * Read by create on the threads of parallel passes and checks.
+     */
+    static inline std::atomic<bool> _hashConsing{};
+
+    ASTKind _kind;
+
+    /**
+     * The type inferred by the type checker, accessed through ASTProperty.
+     * It lives and dies with the node itself, so a type never outlives the
+     * declaration it was inferred for.
+     */
+    Type *_type{};
+
+    /**
+     * The primitive resolved by the type checker for an application of a
+     * builtin arithmetic operator, accessed through ASTProperty.
+     */
+    Primitive _primitive{};
 };
 
 //region DECL_ACCEPT_VISITOR
@@ -131,7 +304,7 @@ class ConAST : public AST {
 DECL_ACCEPT_VISITOR
 
 protected:
-    ConAST() = default;
+    explicit ConAST(ASTKind kind) : AST(kind) {}
 };
 
 class IntConAST : public ConAST {
@@ -225,7 +398,7 @@ public:
     [[nodiscard]] const std::string &get() const;
 
 protected:
-    explicit IdAST(std::string id);
+    IdAST(ASTKind kind, std::string id);
 
 private:
     std::string id;
@@ -253,6 +426,9 @@ public:
 
     [[nodiscard]] const std::string &getVar() const;
 
+protected:
+    VarAST(ASTKind kind, std::string var);
+
 private:
     std::string _var;
 };
@@ -287,7 +463,7 @@ class LabAST : public AST {
 DECL_ACCEPT_VISITOR
 
 protected:
-    LabAST() = default;
+    explicit LabAST(ASTKind kind) : AST(kind) {}
 };
 
 class IdentifierLabAST : public LabAST {
@@ -362,11 +538,14 @@ class ExpAST : public AST {
 DECL_ACCEPT_VISITOR
 
 protected:
-    ExpAST() = default;
+    explicit ExpAST(ASTKind kind) : AST(kind) {}
 };
 
 class ExpRowAST : public AST {
 DECL_ACCEPT_VISITOR
+
+public:
+    ExpRowAST();
 };
 
 class MatchAST : public AST {
@@ -478,6 +657,9 @@ private:
 
 class RecordTupleExpAST : public ExpAST {
 DECL_ACCEPT_VISITOR
+
+public:
+    RecordTupleExpAST();
 };
 
 class RecordSelectorExpAST : public ExpAST {
@@ -486,8 +668,18 @@ DECL_ACCEPT_VISITOR
 public:
     explicit RecordSelectorExpAST(std::shared_ptr<LabAST> lab);
 
+    [[nodiscard]] const std::shared_ptr<LabAST> &getLab() const;
+
 private:
+    friend class ASTProperty;
+
     std::shared_ptr<LabAST> _lab;
+
+    /**
+     * The offset of the field selected, resolved by the type checker and
+     * accessed through ASTProperty.
+     */
+    int _fieldOffset{-1};
 };
 
 class ListExpAST : public ExpAST {
@@ -594,6 +786,10 @@ public:
     IterationExpAST(std::shared_ptr<ExpAST> exp1,
                     std::shared_ptr<ExpAST> exp2);
 
+    [[nodiscard]] const std::shared_ptr<ExpAST> &getExp1() const;
+
+    [[nodiscard]] const std::shared_ptr<ExpAST> &getExp2() const;
+
 private:
     std::shared_ptr<ExpAST> exp1;
     std::shared_ptr<ExpAST> exp2;
@@ -602,6 +798,9 @@ private:
 
 class CaseAnalysisExpAST : public ExpAST {
 DECL_ACCEPT_VISITOR
+
+public:
+    CaseAnalysisExpAST();
 };
 
 class FunctionExpAST : public ExpAST {
@@ -658,7 +857,7 @@ class PatAST : public AST {
 DECL_ACCEPT_VISITOR
 
 protected:
-    PatAST() = default;
+    explicit PatAST(ASTKind kind) : AST(kind) {}
 };
 
 class ConstantPatAST : public PatAST {
@@ -675,6 +874,9 @@ private:
 
 class WildCardPatAST : public PatAST {
 DECL_ACCEPT_VISITOR
+
+public:
+    WildCardPatAST();
 };
 
 class VariablePatAST : public PatAST {
@@ -783,17 +985,23 @@ private:
 
 class LayeredPatAST : public PatAST {
 DECL_ACCEPT_VISITOR
+
+public:
+    LayeredPatAST();
 };
 
 class PatRowAST : public AST {
 DECL_ACCEPT_VISITOR
 
 protected:
-    PatRowAST() = default;
+    explicit PatRowAST(ASTKind kind) : AST(kind) {}
 };
 
 class WildCardPatRowAST : public PatRowAST {
 DECL_ACCEPT_VISITOR
+
+public:
+    WildCardPatRowAST();
 };
 
 class PatternPatRowAST : public PatRowAST {
@@ -846,7 +1054,7 @@ class TypAST : public AST {
 DECL_ACCEPT_VISITOR
 
 protected:
-    TypAST() = default;
+    explicit TypAST(ASTKind kind) : AST(kind) {}
 };
 
 class VariableTypAST : public TypAST {
@@ -855,6 +1063,8 @@ DECL_ACCEPT_VISITOR
 public:
     explicit VariableTypAST(std::shared_ptr<VarAST> var);
 
+    [[nodiscard]] const std::shared_ptr<VarAST> &getVar() const;
+
 private:
     std::shared_ptr<VarAST> _var;
 };
@@ -1000,7 +1210,7 @@ class DecAST : public AST {
 DECL_ACCEPT_VISITOR
 
 protected:
-    DecAST() = default;
+    explicit DecAST(ASTKind kind) : AST(kind) {}
 };
 
 class ValueDecAST : public DecAST {
@@ -1041,6 +1251,9 @@ private:
 
 class DataTypeDecAST : public DecAST {
 DECL_ACCEPT_VISITOR
+
+public:
+    DataTypeDecAST();
 };
 
 class SequenceDecAST : public DecAST {
@@ -1059,6 +1272,10 @@ DECL_ACCEPT_VISITOR
 
     LocalDecAST(std::shared_ptr<DecAST> dec1, std::shared_ptr<DecAST> dec2);
 
+    [[nodiscard]] const std::shared_ptr<DecAST> &getDec1() const;
+
+    [[nodiscard]] const std::shared_ptr<DecAST> &getDec2() const;
+
 private:
     std::shared_ptr<DecAST> dec1;
     std::shared_ptr<DecAST> dec2;
@@ -1069,6 +1286,8 @@ DECL_ACCEPT_VISITOR
 
     explicit NonfixDecAST(std::vector<std::shared_ptr<IdAST>> ids);
 
+    [[nodiscard]] const std::vector<std::shared_ptr<IdAST>> &getIds() const;
+
 private:
     std::vector<std::shared_ptr<IdAST>> ids;
 };
@@ -1111,7 +1330,7 @@ class ValBindAST : public AST {
 DECL_ACCEPT_VISITOR
 
 protected:
-    ValBindAST() = default;
+    explicit ValBindAST(ASTKind kind) : AST(kind) {}
 };
 
 class DestructuringValBindAST : public ValBindAST {
@@ -1192,6 +1411,13 @@ public:
     void setOrFunMatch(const std::shared_ptr<FunMatchAST> &orFunMatch);
 
 protected:
+    FunMatchAST(ASTKind kind,
+                std::shared_ptr<IdAST> id,
+                std::vector<std::shared_ptr<PatAST>> pats,
+                std::shared_ptr<ExpAST> exp,
+                std::shared_ptr<TypAST> typ,
+                std::shared_ptr<FunMatchAST> orFunMatch);
+
     std::shared_ptr<IdAST> _id;
     std::vector<std::shared_ptr<PatAST>> _pats;
     std::shared_ptr<ExpAST> _exp;
@@ -1279,3 +1505,25 @@ DECL_ACCEPT_VISITOR
 
 #undef DECL_ACCEPT_VISITOR
 //endregion
+
+//region APPLY_ALL kind checks for all ast.
+#ifndef APPLY_ALL
+#include "ASTApplyMacro.h"
+#endif
+
+template<typename TAST>
+bool AST::isKindOf(ASTKind kind) {
+    switch (kind) {
+#define APPLY(CLASS) \
+        case ASTKind::CLASS: \
+            return std::is_base_of_v<TAST, CLASS>;
+
+        APPLY_ALL
+
+#undef APPLY
+    }
+    return false;
+}
+
+#undef APPLY_ALL
+//endregion
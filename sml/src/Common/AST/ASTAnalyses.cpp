@@ -0,0 +1,402 @@
+#include <numeric>
+#include "ASTAnalyses.h"
+
+using namespace std;
+
+//region NodeCountPass
+void NodeCountPass::enter(AST *ast) {
+    auto index = static_cast<size_t>(ast->getKind());
+    if (index >= _counts.size()) {
+        _counts.resize(index + 1);
+    }
+    ++_counts[index];
+}
+
+unique_ptr<ASTPass> NodeCountPass::fork() const {
+    return make_unique<NodeCountPass>();
+}
+
+void NodeCountPass::join(ASTPass &forked) {
+    auto &counts = static_cast<NodeCountPass &>(forked)._counts;
+    if (counts.size() > _counts.size()) {
+        _counts.resize(counts.size());
+    }
+    for (size_t i = 0; i < counts.size(); ++i) {
+        _counts[i] += counts[i];
+    }
+}
+
+size_t NodeCountPass::getCount(ASTKind kind) const {
+    auto index = static_cast<size_t>(kind);
+    return index < _counts.size() ? _counts[index] : 0;
+}
+
+size_t NodeCountPass::getTotal() const {
+    return accumulate(_counts.begin(), _counts.end(), size_t{});
+}
+//endregion
+
+//region ConstantPass
+static bool isBuiltinOperator(const string &op) {
+    static const unordered_set<string> operators{
+            "+", "-", "*", "/", "div", "mod", "^",
+            "=", "<>", "<", ">", "<=", ">="
+    };
+    return operators.count(op) > 0;
+}
+
+void ConstantPass::enter(AST */*ast*/) {
+    _allConstant.push_back(true);
+}
+
+void ConstantPass::leave(AST *ast) {
+    bool allConstant = _allConstant.back();
+    _allConstant.pop_back();
+    bool constant = false;
+    switch (ast->getKind()) {
+        case ASTKind::ConstantExpAST:
+            constant = true;
+            break;
+        case ASTKind::ParenthesesExpAST:
+        case ASTKind::TupleExpAST:
+        case ASTKind::ListExpAST:
+        case ASTKind::TypeAnnotationExpAST:
+        case ASTKind::ConjunctionExpAST:
+        case ASTKind::DisjunctionExpAST:
+        case ASTKind::ConditionalExpAST:
+            // only expression children are cared, not the operator id or the
+            // annotated type.
+            constant = allConstant;
+            break;
+        case ASTKind::InfixApplicationExpAST: {
+            auto &&id = AST::cast<InfixApplicationExpAST *>(ast)->getId();
+            constant = allConstant && id && isBuiltinOperator(id->get());
+            break;
+        }
+        default:
+            break;
+    }
+    if (constant) {
+        _constants.insert(ast);
+    } else if (!_allConstant.empty() && AST::isa<ExpAST>(ast)) {
+        _allConstant.back() = false;
+    }
+}
+
+unique_ptr<ASTPass> ConstantPass::fork() const {
+    return make_unique<ConstantPass>();
+}
+
+void ConstantPass::join(ASTPass &forked) {
+    auto &constants = static_cast<ConstantPass &>(forked)._constants;
+    _constants.insert(constants.begin(), constants.end());
+}
+
+bool ConstantPass::isConstant(const AST *ast) const {
+    return _constants.count(ast) > 0;
+}
+
+const unordered_set<const AST *> &ConstantPass::getConstants() const {
+    return _constants;
+}
+//endregion
+
+//region ScopedPass
+void ScopedPass::begin(AST *root) {
+    _scopes.clear();
+    _scopes.push_back({root, {}});
+}
+
+void ScopedPass::enter(AST *ast) {
+    switch (ast->getKind()) {
+        case ASTKind::VariablePatAST:
+            if (auto &&id = AST::cast<VariablePatAST *>(ast)->getId()) {
+                bind(id->get(), ast);
+            }
+            break;
+        case ASTKind::ConstructionPatAST: {
+            // a construction pattern without argument is a variable, unless
+            // it is a constructor, which is not tracked yet.
+            auto pat = AST::cast<ConstructionPatAST *>(ast);
+            auto &&longId = pat->getLongId();
+            if (!pat->getPat() && longId && longId->getIds().size() == 1) {
+                bind(longId->getIds()[0]->get(), ast);
+            }
+            break;
+        }
+        case ASTKind::FunBindAST:
+            // functions joined by `and' are bound before any of their bodies.
+            for (auto funBind = AST::cast<FunBindAST *>(ast);
+                 funBind;
+                 funBind = funBind->getAndFunBind().get()) {
+                if (auto &&funMatch = funBind->getFunMatch()) {
+                    bind(funMatch->getId()->get(), funMatch.get());
+                }
+            }
+            break;
+        case ASTKind::ValueOrConstructorIdentifierExpAST: {
+            auto &&longId =
+                    AST::cast<ValueOrConstructorIdentifierExpAST *>(ast)->getLongId();
+            if (!longId || longId->getIds().empty()) {
+                break;
+            }
+            auto &&ids = longId->getIds();
+            string name = ids[0]->get();
+            for (size_t i = 1; i < ids.size(); ++i) {
+                name += '.' + ids[i]->get();
+            }
+            use(ast, name, ids.size() == 1 ? lookup(name) : nullptr);
+            break;
+        }
+        case ASTKind::InfixApplicationExpAST:
+            if (auto &&id = AST::cast<InfixApplicationExpAST *>(ast)->getId()) {
+                use(ast, id->get(), lookup(id->get()));
+            }
+            break;
+        default:
+            break;
+    }
+    if (openScope(ast)) {
+        _scopes.push_back({ast, {}});
+    }
+}
+
+void ScopedPass::leave(AST *ast) {
+    if (_scopes.size() > 1 && _scopes.back().owner == ast) {
+        _scopes.pop_back();
+    }
+}
+
+void ScopedPass::bind(const string &name, AST *binding) {
+    _scopes.back().names[name] = binding;
+}
+
+AST *ScopedPass::lookup(const string &name) const {
+    for (auto it = _scopes.rbegin(); it != _scopes.rend(); ++it) {
+        auto found = it->names.find(name);
+        if (found != it->names.end()) {
+            return found->second;
+        }
+    }
+    return nullptr;
+}
+
+bool ScopedPass::openScope(AST *ast) {
+    auto owner = _scopes.back().owner;
+    bool alternative = false;
+    switch (ast->getKind()) {
+        case ASTKind::MatchAST:
+            alternative = owner->getKind() == ASTKind::MatchAST
+                          && AST::cast<MatchAST *>(owner)->getMatch().get() == ast;
+            break;
+        case ASTKind::FunMatchAST:
+        case ASTKind::NonFixFunMatchAST:
+        case ASTKind::InfixFunMatchAST:
+            alternative = AST::isa<FunMatchAST>(owner)
+                          && AST::cast<FunMatchAST *>(owner)->getOrFunMatch().get() == ast;
+            break;
+        case ASTKind::LocalDeclarationExpAST:
+            return true;
+        default:
+            return false;
+    }
+    // the previous alternative is done when the next one is entered, as it is
+    // the last child.
+    if (alternative) {
+        _scopes.back().names.clear();
+    }
+    return true;
+}
+//endregion
+
+//region NameResolutionPass
+unique_ptr<ASTPass> NameResolutionPass::fork() const {
+    return make_unique<NameResolutionPass>();
+}
+
+void NameResolutionPass::join(ASTPass &forked) {
+    auto &bindings = static_cast<NameResolutionPass &>(forked)._bindings;
+    _bindings.insert(bindings.begin(), bindings.end());
+}
+
+AST *NameResolutionPass::getBinding(const AST *use) const {
+    auto found = _bindings.find(use);
+    return found == _bindings.end() ? nullptr : found->second;
+}
+
+size_t NameResolutionPass::getUseCount() const {
+    return _bindings.size();
+}
+
+void NameResolutionPass::use(AST *ast, const string &/*name*/, AST *binding) {
+    _bindings[ast] = binding;
+}
+//endregion
+
+//region FreeVariablePass
+void FreeVariablePass::begin(AST *root) {
+    ScopedPass::begin(root);
+    _current.clear();
+}
+
+void FreeVariablePass::end(AST *root) {
+    _freeVariables[root] = std::move(_current);
+    _current.clear();
+}
+
+unique_ptr<ASTPass> FreeVariablePass::fork() const {
+    return make_unique<FreeVariablePass>();
+}
+
+void FreeVariablePass::join(ASTPass &forked) {
+    auto &freeVariables = static_cast<FreeVariablePass &>(forked)._freeVariables;
+    for (auto &&[root, names] : freeVariables) {
+        _freeVariables[root] = names;
+    }
+}
+
+const set<string> &FreeVariablePass::getFreeVariables(const AST *root) const {
+    static const set<string> empty;
+    auto found = _freeVariables.find(root);
+    return found == _freeVariables.end() ? empty : found->second;
+}
+
+void FreeVariablePass::use(AST */*ast*/, const string &name, AST *binding) {
+    if (!binding) {
+        _current.insert(name);
+    }
+}
+//endregion
+
+//region BoundNamePass
+void BoundNamePass::begin(AST */*root*/) {
+    _patterns = 0;
+    _current.clear();
+}
+
+void BoundNamePass::enter(AST *ast) {
+    if (AST::isa<PatAST>(ast)) {
+        ++_patterns;
+    } else if (AST::isa<FunMatchAST>(ast)) {
+        if (auto &&id = AST::cast<FunMatchAST *>(ast)->getId()) {
+            _current.insert(id->get());
+        }
+    } else if (_patterns && AST::isa<IdAST>(ast)) {
+        _current.insert(AST::cast<IdAST *>(ast)->get());
+    }
+}
+
+void BoundNamePass::leave(AST *ast) {
+    if (AST::isa<PatAST>(ast)) {
+        --_patterns;
+    }
+}
+
+void BoundNamePass::end(AST *root) {
+    _boundNames[root] = std::move(_current);
+    _current.clear();
+}
+
+unique_ptr<ASTPass> BoundNamePass::fork() const {
+    return make_unique<BoundNamePass>();
+}
+
+void BoundNamePass::join(ASTPass &forked) {
+    auto &boundNames = static_cast<BoundNamePass &>(forked)._boundNames;
+    for (auto &&[root, names] : boundNames) {
+        _boundNames[root] = std::move(names);
+    }
+}
+
+const set<string> &BoundNamePass::getBoundNames(const AST *root) const {
+    static const set<string> empty;
+    auto found = _boundNames.find(root);
+    return found == _boundNames.end() ? empty : found->second;
+}
+//endregion
+
+//region StructurePass
+template<typename T>
+static void appendBytes(string &bytes, const T &value) {
+    bytes.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+static void appendBytes(string &bytes, const string &value) {
+    appendBytes(bytes, value.size());
+    bytes += value;
+}
+
+void StructurePass::begin(AST */*root*/) {
+    _current.clear();
+}
+
+void StructurePass::enter(AST *ast) {
+    // the number of children tells where the children of an ast end, as null
+    // children are skipped.
+    vector<AST *> children;
+    ast->getChildren(children);
+    appendBytes(_current, ast->getKind());
+    appendBytes(_current, children.size());
+    switch (ast->getKind()) {
+        case ASTKind::IntConAST:
+            appendBytes(_current, AST::cast<IntConAST *>(ast)->get());
+            break;
+        case ASTKind::FloatConAST:
+            appendBytes(_current, AST::cast<FloatConAST *>(ast)->get());
+            break;
+        case ASTKind::BoolConAST:
+            appendBytes(_current, AST::cast<BoolConAST *>(ast)->get());
+            break;
+        case ASTKind::CharConAST:
+            appendBytes(_current, AST::cast<CharConAST *>(ast)->get());
+            break;
+        case ASTKind::StringConAST:
+            appendBytes(_current, AST::cast<StringConAST *>(ast)->get());
+            break;
+        case ASTKind::AlphanumericIdAST:
+        case ASTKind::SymbolicIdAST:
+            appendBytes(_current, AST::cast<IdAST *>(ast)->get());
+            break;
+        case ASTKind::VarAST:
+        case ASTKind::UnconstrainedVarAST:
+        case ASTKind::EqualityVarAST:
+            appendBytes(_current, AST::cast<VarAST *>(ast)->getVar());
+            break;
+        case ASTKind::NumberLabAST:
+            appendBytes(_current, AST::cast<NumberLabAST *>(ast)->getN());
+            break;
+        case ASTKind::LeftAssociativeInfixDecAST:
+            appendBytes(_current, AST::cast<LeftAssociativeInfixDecAST *>(
+                    ast)->getPriority());
+            break;
+        case ASTKind::RightAssociativeInfixDecAST:
+            appendBytes(_current, AST::cast<RightAssociativeInfixDecAST *>(
+                    ast)->getPriority());
+            break;
+        default:
+            break;
+    }
+}
+
+void StructurePass::end(AST *root) {
+    _structures[root] = std::move(_current);
+    _current.clear();
+}
+
+unique_ptr<ASTPass> StructurePass::fork() const {
+    return make_unique<StructurePass>();
+}
+
+void StructurePass::join(ASTPass &forked) {
+    auto &structures = static_cast<StructurePass &>(forked)._structures;
+    for (auto &&[root, structure] : structures) {
+        _structures[root] = std::move(structure);
+    }
+}
+
+const string &StructurePass::getStructure(const AST *root) const {
+    static const string empty;
+    auto found = _structures.find(root);
+    return found == _structures.end() ? empty : found->second;
+}
+//endregion
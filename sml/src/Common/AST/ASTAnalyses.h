@@ -0,0 +1,242 @@
+#pragma once
+
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "AST.h"
+#include "ASTPass.h"
+
+/**
+ * Counts the asts of each kind.
+ */
+class NodeCountPass : public ASTPass {
+public:
+    void enter(AST *ast) override;
+
+    [[nodiscard]] std::unique_ptr<ASTPass> fork() const override;
+
+    void join(ASTPass &forked) override;
+
+    [[nodiscard]] size_t getCount(ASTKind kind) const;
+
+    [[nodiscard]] size_t getTotal() const;
+
+private:
+    std::vector<size_t> _counts;
+};
+
+/**
+ * Finds the constant expressions, i.e. constants and parentheses, tuples,
+ * lists, type annotations, conditions, conjunctions, disjunctions and
+ * applications of builtin infix operators whose operands are all constant.
+ */
+class ConstantPass : public ASTPass {
+public:
+    void enter(AST *ast) override;
+
+    void leave(AST *ast) override;
+
+    [[nodiscard]] std::unique_ptr<ASTPass> fork() const override;
+
+    void join(ASTPass &forked) override;
+
+    [[nodiscard]] bool isConstant(const AST *ast) const;
+
+    [[nodiscard]] const std::unordered_set<const AST *> &getConstants() const;
+
+private:
+    /**
+     * Whether all expression children of each entered ast are constant.
+     */
+    std::vector<bool> _allConstant;
+
+    std::unordered_set<const AST *> _constants;
+};
+
+/**
+ * Tracks the names bound by patterns and function declarations in scope, and
+ * reports each use of a name with the ast binding it.
+ *
+ * Value bindings bind after their expression, functions bind their names for
+ * their own bodies and the following declarations, and a match or a clause of
+ * a function binds its patterns for its expression only. A name bound out of
+ * the top-level ast, e.g. by a previous top-level declaration or the builtin
+ * environment, is reported unbound.
+ */
+class ScopedPass : public ASTPass {
+public:
+    void begin(AST *root) override;
+
+    void enter(AST *ast) override;
+
+    void leave(AST *ast) override;
+
+protected:
+    /**
+     * Called on a use of a name, i.e. a value or constructor identifier, or
+     * an infix operator.
+     * @param ast The ast using the name.
+     * @param name The name.
+     * @param binding The variable pattern, construction pattern or function
+     * match binding the name, or null if it is not bound in the top-level ast.
+     */
+    virtual void use(AST *ast, const std::string &name, AST *binding) = 0;
+
+    /**
+     * Get the ast binding a name in the scopes the pass is in.
+     * @return The binding ast, or null if it is not bound in the top-level ast
+     * so far.
+     */
+    [[nodiscard]] AST *lookup(const std::string &name) const;
+
+private:
+    struct Scope {
+        /**
+         * The ast opening the scope.
+         */
+        AST *owner;
+
+        std::unordered_map<std::string, AST *> names;
+    };
+
+    void bind(const std::string &name, AST *binding);
+
+    /**
+     * Check whether an ast opens a scope, and drop the names of the previous
+     * alternative if it is an alternative of a match or a function.
+     * @param ast The ast.
+     * @return Whether the ast opens a scope.
+     */
+    bool openScope(AST *ast);
+
+    std::vector<Scope> _scopes;
+};
+
+/**
+ * Resolves each use of a name to the ast binding it.
+ */
+class NameResolutionPass : public ScopedPass {
+public:
+    [[nodiscard]] std::unique_ptr<ASTPass> fork() const override;
+
+    void join(ASTPass &forked) override;
+
+    /**
+     * Get the ast binding the name used.
+     * @param use The value or constructor identifier expression, or the infix
+     * application using a name.
+     * @return The binding ast, or null if it is not bound in its top-level
+     * ast or it is not a use.
+     */
+    [[nodiscard]] AST *getBinding(const AST *use) const;
+
+    [[nodiscard]] size_t getUseCount() const;
+
+protected:
+    void use(AST *ast, const std::string &name, AST *binding) override;
+
+private:
+    std::unordered_map<const AST *, AST *> _bindings;
+};
+
+/**
+ * Collects the names each top-level ast uses but does not bind, including
+ * builtin operators.
+ */
+class FreeVariablePass : public ScopedPass {
+public:
+    void begin(AST *root) override;
+
+    void end(AST *root) override;
+
+    [[nodiscard]] std::unique_ptr<ASTPass> fork() const override;
+
+    void join(ASTPass &forked) override;
+
+    /**
+     * Get the free names of a top-level ast.
+     * @param root The top-level ast.
+     * @return The sorted names.
+     */
+    [[nodiscard]] const std::set<std::string> &
+    getFreeVariables(const AST *root) const;
+
+protected:
+    void use(AST *ast, const std::string &name, AST *binding) override;
+
+private:
+    std::set<std::string> _current;
+
+    std::unordered_map<const AST *, std::set<std::string>> _freeVariables;
+};
+
+/**
+ * Collects the names each top-level ast may bind, i.e. the ids in any of its
+ * patterns and the names of its functions, wherever they are bound. The
+ * names bound locally are included, as the type checker may still leave
+ * them in the symbol table.
+ */
+class BoundNamePass : public ASTPass {
+public:
+    void begin(AST *root) override;
+
+    void enter(AST *ast) override;
+
+    void leave(AST *ast) override;
+
+    void end(AST *root) override;
+
+    [[nodiscard]] std::unique_ptr<ASTPass> fork() const override;
+
+    void join(ASTPass &forked) override;
+
+    /**
+     * Get the names a top-level ast may bind.
+     * @param root The top-level ast.
+     * @return The sorted names.
+     */
+    [[nodiscard]] const std::set<std::string> &
+    getBoundNames(const AST *root) const;
+
+private:
+    /**
+     * The number of patterns entered.
+     */
+    size_t _patterns{};
+
+    std::set<std::string> _current;
+
+    std::unordered_map<const AST *, std::set<std::string>> _boundNames;
+};
+
+/**
+ * Serializes each top-level ast into its structure, i.e. the kind, the own
+ * value and the number of children of each ast in preorder, so that asts
+ * built apart have the same structure if and only if they are identical.
+ */
+class StructurePass : public ASTPass {
+public:
+    void begin(AST *root) override;
+
+    void enter(AST *ast) override;
+
+    void end(AST *root) override;
+
+    [[nodiscard]] std::unique_ptr<ASTPass> fork() const override;
+
+    void join(ASTPass &forked) override;
+
+    /**
+     * Get the structure of a top-level ast.
+     * @param root The top-level ast.
+     * @return The bytes of the structure.
+     */
+    [[nodiscard]] const std::string &getStructure(const AST *root) const;
+
+private:
+    std::string _current;
+
+    std::unordered_map<const AST *, std::string> _structures;
+};
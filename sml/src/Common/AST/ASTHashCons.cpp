@@ -0,0 +1,186 @@
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "AST.h"
+
+using namespace std;
+
+namespace {
+    /**
+     * The structure of an ast to share, i.e. its kind, the bytes of its own
+     * value and the addresses of its shared children.
+     */
+    struct Structure {
+        ASTKind kind{};
+        string value;
+        vector<const AST *> children;
+
+        bool operator==(const Structure &rhs) const {
+            return kind == rhs.kind
+                   && value == rhs.value
+                   && children == rhs.children;
+        }
+    };
+
+    struct StructureHash {
+        size_t operator()(const Structure &structure) const noexcept {
+            auto seed = hash<int>()(static_cast<int>(structure.kind));
+            combine(seed, hash<string>()(structure.value));
+            for (auto child : structure.children) {
+                combine(seed, hash<const AST *>()(child));
+            }
+            return seed;
+        }
+
+    private:
+        static void combine(size_t &seed, size_t value) noexcept {
+            seed ^= value + 0x9e3779b9 + (seed << 6u) + (seed >> 2u);
+        }
+    };
+
+    template<typename T>
+    string bytesOf(const T &value) {
+        return string(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    /**
+     * Get the structure of an ast.
+     * @param ast The ast.
+     * @param structure The structure to fill.
+     * @param size The size of the ast class to fill.
+     * @return Whether the ast could be shared.
+     */
+    bool getStructure(AST *ast, Structure &structure, size_t &size) {
+        structure.kind = ast->getKind();
+        switch (ast->getKind()) {
+            case ASTKind::IntConAST:
+                structure.value = bytesOf(AST::cast<IntConAST *>(ast)->get());
+                size = sizeof(IntConAST);
+                return true;
+            case ASTKind::FloatConAST:
+                structure.value = bytesOf(AST::cast<FloatConAST *>(ast)->get());
+                size = sizeof(FloatConAST);
+                return true;
+            case ASTKind::BoolConAST:
+                structure.value = bytesOf(AST::cast<BoolConAST *>(ast)->get());
+                size = sizeof(BoolConAST);
+                return true;
+            case ASTKind::CharConAST:
+                structure.value = bytesOf(AST::cast<CharConAST *>(ast)->get());
+                size = sizeof(CharConAST);
+                return true;
+            case ASTKind::StringConAST:
+                structure.value = AST::cast<StringConAST *>(ast)->get();
+                size = sizeof(StringConAST);
+                return true;
+            case ASTKind::AlphanumericIdAST:
+            case ASTKind::SymbolicIdAST:
+                structure.value = AST::cast<IdAST *>(ast)->get();
+                size = sizeof(IdAST);
+                return true;
+            case ASTKind::LongIdAST:
+                for (auto &&id : AST::cast<LongIdAST *>(ast)->getIds()) {
+                    structure.children.push_back(id.get());
+                }
+                size = sizeof(LongIdAST);
+                return true;
+            case ASTKind::ConstructorTypAST:
+                structure.children.push_back(
+                        AST::cast<ConstructorTypAST *>(ast)->getLongId().get());
+                size = sizeof(ConstructorTypAST);
+                return true;
+            case ASTKind::ParenthesesTypAST:
+                structure.children.push_back(
+                        AST::cast<ParenthesesTypAST *>(ast)->getTyp().get());
+                size = sizeof(ParenthesesTypAST);
+                return true;
+            case ASTKind::FunctionTypAST: {
+                auto typ = AST::cast<FunctionTypAST *>(ast);
+                structure.children.push_back(typ->getTyp1().get());
+                structure.children.push_back(typ->getTyp2().get());
+                size = sizeof(FunctionTypAST);
+                return true;
+            }
+            case ASTKind::TupleTypAST:
+                for (auto &&typ : AST::cast<TupleTypAST *>(ast)->getTuple()) {
+                    structure.children.push_back(typ.get());
+                }
+                size = sizeof(TupleTypAST);
+                return true;
+            default:
+                // a type variable is bound where it occurs, so is every
+                // record type and ast not listed above.
+                return false;
+        }
+    }
+
+    struct HashConsTable {
+        mutex lock;
+        unordered_map<Structure, weak_ptr<AST>, StructureHash> asts;
+        AST::HashConsStatistics statistics;
+
+        /**
+         * The number of asts after the last purge of expired ones.
+         */
+        size_t purgedSize{};
+
+        void purge() {
+            for (auto it = asts.begin(); it != asts.end();) {
+                it = it->second.expired() ? asts.erase(it) : next(it);
+            }
+            purgedSize = asts.size();
+        }
+    };
+
+    HashConsTable &getTable() {
+        static HashConsTable table;
+        return table;
+    }
+}
+
+void AST::setHashConsing(bool enabled) {
+    _hashConsing = enabled;
+}
+
+bool AST::isHashConsing() {
+    return _hashConsing;
+}
+
+AST::HashConsStatistics AST::getHashConsStatistics() {
+    auto &table = getTable();
+    lock_guard<mutex> _1{table.lock};
+    return table.statistics;
+}
+
+void AST::clearHashConsing() {
+    auto &table = getTable();
+    lock_guard<mutex> _1{table.lock};
+    table.asts.clear();
+    table.statistics = {};
+    table.purgedSize = 0;
+}
+
+shared_ptr<AST> AST::intern(shared_ptr<AST> ast) {
+    Structure structure;
+    size_t size{};
+    if (!getStructure(ast.get(), structure, size)) {
+        return ast;
+    }
+
+    auto &table = getTable();
+    lock_guard<mutex> _1{table.lock};
+    auto &shared = table.asts[std::move(structure)];
+    if (auto existing = shared.lock()) {
+        ++table.statistics.hits;
+        table.statistics.savedBytes += size;
+        return existing;
+    }
+    shared = ast;
+    ++table.statistics.misses;
+    if (table.asts.size() > 2 * table.purgedSize + 1024) {
+        table.purge();
+    }
+    return ast;
+}
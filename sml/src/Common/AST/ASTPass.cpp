@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <thread>
+#include <utility>
+#include "AST.h"
+#include "ASTPass.h"
+#include "Symbol/Region.h"
+
+using namespace std;
+
+void ASTPassManager::addPass(ASTPass &pass) {
+    _passes.push_back(&pass);
+}
+
+void ASTPassManager::run(AST *root) {
+    run(_passes, root);
+}
+
+void ASTPassManager::run(const vector<shared_ptr<AST>> &roots,
+                         unsigned threads) {
+    auto parts = min<size_t>(max(threads, 1u), roots.size());
+    if (parts <= 1) {
+        for (auto &&root : roots) {
+            run(root.get());
+        }
+        return;
+    }
+
+    // the first part is run by the passes themselves in this thread, the
+    // others by the forks.
+    vector<vector<unique_ptr<ASTPass>>> forks(parts - 1);
+    vector<thread> workers;
+    // the forks allocate the symbols in the region of this thread.
+    auto &region = Region::getCurrent();
+    auto runPart = [&roots, parts](const vector<ASTPass *> &passes,
+                                   size_t part) {
+        auto first = roots.size() * part / parts;
+        auto last = roots.size() * (part + 1) / parts;
+        for (auto i = first; i < last; ++i) {
+            run(passes, roots[i].get());
+        }
+    };
+    for (size_t part = 1; part < parts; ++part) {
+        auto &partForks = forks[part - 1];
+        for (auto pass : _passes) {
+            partForks.push_back(pass->fork());
+        }
+        workers.emplace_back([&partForks, &runPart, &region, part] {
+            Region::Scope _1{region};
+            vector<ASTPass *> passes;
+            for (auto &&fork : partForks) {
+                passes.push_back(fork.get());
+            }
+            runPart(passes, part);
+        });
+    }
+    runPart(_passes, 0);
+    for (auto &&worker : workers) {
+        worker.join();
+    }
+    for (auto &&partForks : forks) {
+        for (size_t i = 0; i < _passes.size(); ++i) {
+            _passes[i]->join(*partForks[i]);
+        }
+    }
+}
+
+void ASTPassManager::run(const vector<ASTPass *> &passes, AST *root) {
+    if (!root) {
+        return;
+    }
+    for (auto pass : passes) {
+        pass->begin(root);
+    }
+
+    // an ast is pushed twice, once to enter and once to leave it, so that
+    // deep asts do not overflow the call stack.
+    vector<pair<AST *, bool>> stack{{root, false}};
+    vector<AST *> children;
+    while (!stack.empty()) {
+        auto [ast, entered] = stack.back();
+        stack.pop_back();
+        if (entered) {
+            for (auto pass : passes) {
+                pass->leave(ast);
+            }
+            continue;
+        }
+        for (auto pass : passes) {
+            pass->enter(ast);
+        }
+        stack.emplace_back(ast, true);
+        children.clear();
+        ast->getChildren(children);
+        for (auto it = children.rbegin(); it != children.rend(); ++it) {
+            stack.emplace_back(*it, false);
+        }
+    }
+
+    for (auto pass : passes) {
+        pass->end(root);
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+class AST;
+
+/**
+ * A lightweight analysis over asts, which is called back on each ast by an
+ * ASTPassManager instead of walking the asts itself, so that several passes
+ * could share a single traversal.
+ *
+ * The top-level asts given to a manager are independent, i.e. a pass never
+ * carries anything from one top-level ast to another but its results, thus
+ * they could be run in parallel by forks of the pass.
+ */
+class ASTPass {
+public:
+    virtual ~ASTPass() = default;
+
+    /**
+     * Called before a top-level ast is traversed.
+     * @param root The top-level ast.
+     */
+    virtual void begin(AST */*root*/) {}
+
+    /**
+     * Called on an ast before its children.
+     * @param ast The ast.
+     */
+    virtual void enter(AST */*ast*/) {}
+
+    /**
+     * Called on an ast after its children.
+     * @param ast The ast.
+     */
+    virtual void leave(AST */*ast*/) {}
+
+    /**
+     * Called after a top-level ast is traversed.
+     * @param root The top-level ast.
+     */
+    virtual void end(AST */*root*/) {}
+
+    /**
+     * Create an empty pass of the same analysis, to run over a part of the
+     * top-level asts in another thread.
+     * @return The forked pass.
+     */
+    [[nodiscard]] virtual std::unique_ptr<ASTPass> fork() const = 0;
+
+    /**
+     * Merge the results of a forked pass, which ran over the top-level asts
+     * following the ones of this pass.
+     * @param forked The pass forked from this one.
+     */
+    virtual void join(ASTPass &forked) = 0;
+};
+
+/**
+ * Runs the added passes fused, i.e. all of them are called back on an ast
+ * before the traversal moves on, in the order they are added.
+ */
+class ASTPassManager {
+public:
+    /**
+     * Add a pass to run, which is not owned by the manager.
+     * @param pass The pass.
+     */
+    void addPass(ASTPass &pass);
+
+    /**
+     * Run the passes over a top-level ast.
+     * @param root The top-level ast.
+     */
+    void run(AST *root);
+
+    /**
+     * Run the passes over independent top-level asts. The asts are split into
+     * contiguous parts, each run by forks of the passes in its own thread, and
+     * the results are joined in the order of the asts, so they are the same as
+     * running the asts one by one.
+     * @param roots The top-level asts.
+     * @param threads The number of threads to use at most.
+     */
+    void run(const std::vector<std::shared_ptr<AST>> &roots,
+             unsigned threads = 1);
+
+private:
+    static void run(const std::vector<ASTPass *> &passes, AST *root);
+
+    std::vector<ASTPass *> _passes;
+};
@@ -1,19 +1,44 @@
-#include <unordered_map>
+#include "AST.h"
 #include "ASTProperty.h"
 
 using namespace std;
 
-namespace {
-    unordered_map<AST *, Type *> astTypeMap;
+Type *ASTProperty::getType(AST *ast) {
+    return ast ? ast->_type : nullptr;
 }
 
-Type *ASTProperty::getType(AST *ast) {
-    if (astTypeMap.count(ast)) {
-        return astTypeMap[ast];
+void ASTProperty::setType(AST *ast, Type *type) {
+    if (!ast) {
+        return;
+    }
+    // an id or a long id may be shared by hash consing wherever it occurs,
+    // so its type would be the one of the last occurrence checked.
+    switch (ast->getKind()) {
+        case ASTKind::AlphanumericIdAST:
+        case ASTKind::SymbolicIdAST:
+        case ASTKind::LongIdAST:
+            return;
+        default:
+            ast->_type = type;
     }
-    return nullptr;
 }
 
-void ASTProperty::setType(AST *ast, Type *type) {
-    astTypeMap[ast] = type;
+Primitive ASTProperty::getPrimitive(AST *ast) {
+    return ast ? ast->_primitive : Primitive{};
+}
+
+void ASTProperty::setPrimitive(AST *ast, Primitive primitive) {
+    if (ast) {
+        ast->_primitive = primitive;
+    }
+}
+
+int ASTProperty::getFieldOffset(RecordSelectorExpAST *ast) {
+    return ast ? ast->_fieldOffset : -1;
+}
+
+void ASTProperty::setFieldOffset(RecordSelectorExpAST *ast, int offset) {
+    if (ast) {
+        ast->_fieldOffset = offset;
+    }
 }
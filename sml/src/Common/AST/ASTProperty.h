@@ -4,10 +4,24 @@
 
 class Type;
 
+enum class Primitive : unsigned char;
+
 class AST;
 
+class RecordSelectorExpAST;
+
+/**
+ * Properties attached to ast nodes by semantic analysis. They are stored in
+ * the nodes themselves, a null ast has no properties.
+ */
 class ASTProperty {
 public:
+    /**
+     * Get the type inferred for an ast. An id or a long id carries no type,
+     * as hash consing may share it between occurrences of different types;
+     * the type of an occurrence is the one of the ast using it.
+     * @return The type, or null if none.
+     */
     static Type *getType(AST *ast);
 
     static Type *getType(const std::shared_ptr<AST> &ast) {
@@ -19,4 +33,36 @@ public:
     static void setType(const std::shared_ptr<AST> &ast, Type *type) {
         setType(ast.get(), type);
     }
+
+    /**
+     * Get the primitive operation a builtin arithmetic operator applied by
+     * the ast is resolved to.
+     * @return The primitive, or Primitive::NONE if not resolved.
+     */
+    static Primitive getPrimitive(AST *ast);
+
+    static Primitive getPrimitive(const std::shared_ptr<AST> &ast) {
+        return getPrimitive(ast.get());
+    }
+
+    static void setPrimitive(AST *ast, Primitive primitive);
+
+    static void setPrimitive(const std::shared_ptr<AST> &ast,
+                             Primitive primitive) {
+        setPrimitive(ast.get(), primitive);
+    }
+
+    /**
+     * Get the offset of the field a record selector is resolved to, i.e. the
+     * index of the field in the record type it is applied to.
+     * @return The offset, or -1 if not resolved.
+     */
+    static int getFieldOffset(RecordSelectorExpAST *ast);
+
+    static int getFieldOffset(
+            const std::shared_ptr<RecordSelectorExpAST> &ast) {
+        return getFieldOffset(ast.get());
+    }
+
+    static void setFieldOffset(RecordSelectorExpAST *ast, int offset);
 };
@@ -0,0 +1,253 @@
+#include <vector>
+#include "ASTRewriter.h"
+
+using namespace std;
+
+namespace {
+    /**
+     * Rewrite each ast of a list in place.
+     * @return Whether any of the asts is rewritten.
+     */
+    template<typename TAST, typename TRewrite>
+    bool rewriteEach(vector<shared_ptr<TAST>> &asts, TRewrite &&rewrite) {
+        bool rewritten = false;
+        for (auto &&ast : asts) {
+            auto result = rewrite(ast);
+            rewritten = rewritten || result != ast;
+            ast = std::move(result);
+        }
+        return rewritten;
+    }
+}
+
+shared_ptr<AST> ASTRewriter::rewrite(const shared_ptr<AST> &ast) {
+    if (auto exp = AST::dynCast<ExpAST>(ast)) {
+        return rewriteExp(exp);
+    } else if (auto dec = AST::dynCast<DecAST>(ast)) {
+        return rewriteDec(dec);
+    }
+    return ast;
+}
+
+shared_ptr<ExpAST> ASTRewriter::rewriteExp(const shared_ptr<ExpAST> &exp) {
+    return rewriteChildren(exp);
+}
+
+shared_ptr<ExpAST> ASTRewriter::rewriteChildren(const shared_ptr<ExpAST> &exp) {
+    if (!exp) {
+        return exp;
+    }
+    auto rewriteExps = [this](vector<shared_ptr<ExpAST>> &exps) {
+        return rewriteEach(exps, [this](auto &&exp) {
+            return rewriteExp(exp);
+        });
+    };
+    switch (exp->getKind()) {
+        case ASTKind::ParenthesesExpAST: {
+            auto &&inner = AST::cast<ParenthesesExpAST>(exp)->getExp();
+            auto rewritten = rewriteExp(inner);
+            return rewritten == inner
+                   ? exp : rebuild<ParenthesesExpAST>(exp, rewritten);
+        }
+        case ASTKind::TypeAnnotationExpAST: {
+            auto ast = AST::cast<TypeAnnotationExpAST>(exp);
+            auto rewritten = rewriteExp(ast->getExp());
+            if (rewritten == ast->getExp()) {
+                return exp;
+            }
+            return rebuild<TypeAnnotationExpAST>(exp, rewritten, ast->getTyp());
+        }
+        case ASTKind::InfixApplicationExpAST: {
+            auto ast = AST::cast<InfixApplicationExpAST>(exp);
+            auto exp1 = rewriteExp(ast->getExp1());
+            auto exp2 = rewriteExp(ast->getExp2());
+            if (exp1 == ast->getExp1() && exp2 == ast->getExp2()) {
+                return exp;
+            }
+            return rebuild<InfixApplicationExpAST>(exp, exp1, ast->getId(), exp2);
+        }
+        case ASTKind::ApplicationExpAST: {
+            auto ast = AST::cast<ApplicationExpAST>(exp);
+            auto exp1 = rewriteExp(ast->getExp1());
+            auto exp2 = rewriteExp(ast->getExp2());
+            if (exp1 == ast->getExp1() && exp2 == ast->getExp2()) {
+                return exp;
+            }
+            return rebuild<ApplicationExpAST>(exp, exp1, exp2);
+        }
+        case ASTKind::ConjunctionExpAST: {
+            auto ast = AST::cast<ConjunctionExpAST>(exp);
+            auto exp1 = rewriteExp(ast->getExp1());
+            auto exp2 = rewriteExp(ast->getExp2());
+            if (exp1 == ast->getExp1() && exp2 == ast->getExp2()) {
+                return exp;
+            }
+            return rebuild<ConjunctionExpAST>(exp, exp1, exp2);
+        }
+        case ASTKind::DisjunctionExpAST: {
+            auto ast = AST::cast<DisjunctionExpAST>(exp);
+            auto exp1 = rewriteExp(ast->getExp1());
+            auto exp2 = rewriteExp(ast->getExp2());
+            if (exp1 == ast->getExp1() && exp2 == ast->getExp2()) {
+                return exp;
+            }
+            return rebuild<DisjunctionExpAST>(exp, exp1, exp2);
+        }
+        case ASTKind::ConditionalExpAST: {
+            auto ast = AST::cast<ConditionalExpAST>(exp);
+            auto exp1 = rewriteExp(ast->getExp1());
+            auto exp2 = rewriteExp(ast->getExp2());
+            auto exp3 = rewriteExp(ast->getExp3());
+            if (exp1 == ast->getExp1() && exp2 == ast->getExp2()
+                && exp3 == ast->getExp3()) {
+                return exp;
+            }
+            return rebuild<ConditionalExpAST>(exp, exp1, exp2, exp3);
+        }
+        case ASTKind::TupleExpAST: {
+            auto exps = AST::cast<TupleExpAST>(exp)->getExps();
+            return rewriteExps(exps)
+                   ? rebuild<TupleExpAST>(exp, std::move(exps)) : exp;
+        }
+        case ASTKind::ListExpAST: {
+            auto exps = AST::cast<ListExpAST>(exp)->getExps();
+            return rewriteExps(exps)
+                   ? rebuild<ListExpAST>(exp, std::move(exps)) : exp;
+        }
+        case ASTKind::LocalDeclarationExpAST: {
+            auto ast = AST::cast<LocalDeclarationExpAST>(exp);
+            auto dec = rewriteDec(ast->getDec());
+            auto exps = ast->getExps();
+            if (!rewriteExps(exps) && dec == ast->getDec()) {
+                return exp;
+            }
+            return rebuild<LocalDeclarationExpAST>(exp, dec, std::move(exps));
+        }
+        case ASTKind::FunctionExpAST: {
+            auto &&match = AST::cast<FunctionExpAST>(exp)->getMatch();
+            auto rewritten = rewriteMatch(match);
+            return rewritten == match
+                   ? exp : rebuild<FunctionExpAST>(exp, rewritten);
+        }
+        default:
+            return exp;
+    }
+}
+
+shared_ptr<MatchAST> ASTRewriter::rewriteMatch(const shared_ptr<MatchAST> &match) {
+    if (!match) {
+        return match;
+    }
+    auto exp = rewriteExp(match->getExp());
+    auto orMatch = rewriteMatch(match->getMatch());
+    if (exp == match->getExp() && orMatch == match->getMatch()) {
+        return match;
+    }
+    return rebuild<MatchAST>(match, match->getPat(), exp, orMatch);
+}
+
+shared_ptr<DecAST> ASTRewriter::rewriteDec(const shared_ptr<DecAST> &dec) {
+    if (!dec) {
+        return dec;
+    }
+    switch (dec->getKind()) {
+        case ASTKind::ValueDecAST: {
+            auto &&valBind = AST::cast<ValueDecAST>(dec)->getValBind();
+            auto rewritten = rewriteValBind(valBind);
+            return rewritten == valBind
+                   ? dec : rebuild<ValueDecAST>(dec, rewritten);
+        }
+        case ASTKind::FunctionDecAST: {
+            auto &&funBind = AST::cast<FunctionDecAST>(dec)->getFunBind();
+            auto rewritten = rewriteFunBind(funBind);
+            return rewritten == funBind
+                   ? dec : rebuild<FunctionDecAST>(dec, rewritten);
+        }
+        case ASTKind::SequenceDecAST: {
+            auto decs = AST::cast<SequenceDecAST>(dec)->getDecs();
+            auto rewritten = rewriteEach(decs, [this](auto &&dec) {
+                return rewriteDec(dec);
+            });
+            return rewritten
+                   ? rebuild<SequenceDecAST>(dec, std::move(decs)) : dec;
+        }
+        case ASTKind::LocalDecAST: {
+            auto ast = AST::cast<LocalDecAST>(dec);
+            auto dec1 = rewriteDec(ast->getDec1());
+            auto dec2 = rewriteDec(ast->getDec2());
+            if (dec1 == ast->getDec1() && dec2 == ast->getDec2()) {
+                return dec;
+            }
+            return rebuild<LocalDecAST>(dec, dec1, dec2);
+        }
+        default:
+            return dec;
+    }
+}
+
+shared_ptr<ValBindAST>
+ASTRewriter::rewriteValBind(const shared_ptr<ValBindAST> &valBind) {
+    if (!valBind) {
+        return valBind;
+    }
+    switch (valBind->getKind()) {
+        case ASTKind::DestructuringValBindAST: {
+            auto ast = AST::cast<DestructuringValBindAST>(valBind);
+            auto exp = rewriteExp(ast->getExp());
+            auto andValBind = rewriteValBind(ast->getAndValBind());
+            if (exp == ast->getExp() && andValBind == ast->getAndValBind()) {
+                return valBind;
+            }
+            return rebuild<DestructuringValBindAST>(
+                    valBind, ast->getPat(), exp, andValBind);
+        }
+        case ASTKind::RecursiveValBindAST: {
+            auto &&inner = AST::cast<RecursiveValBindAST>(valBind)->getValBind();
+            auto rewritten = rewriteValBind(inner);
+            return rewritten == inner
+                   ? valBind : rebuild<RecursiveValBindAST>(valBind, rewritten);
+        }
+        default:
+            return valBind;
+    }
+}
+
+shared_ptr<FunBindAST>
+ASTRewriter::rewriteFunBind(const shared_ptr<FunBindAST> &funBind) {
+    if (!funBind) {
+        return funBind;
+    }
+    auto funMatch = rewriteFunMatch(funBind->getFunMatch());
+    auto andFunBind = rewriteFunBind(funBind->getAndFunBind());
+    if (funMatch == funBind->getFunMatch()
+        && andFunBind == funBind->getAndFunBind()) {
+        return funBind;
+    }
+    return rebuild<FunBindAST>(funBind, funMatch, andFunBind);
+}
+
+shared_ptr<FunMatchAST>
+ASTRewriter::rewriteFunMatch(const shared_ptr<FunMatchAST> &funMatch) {
+    if (!funMatch) {
+        return funMatch;
+    }
+    auto exp = rewriteExp(funMatch->getExp());
+    auto orFunMatch = rewriteFunMatch(funMatch->getOrFunMatch());
+    if (exp == funMatch->getExp() && orFunMatch == funMatch->getOrFunMatch()) {
+        return funMatch;
+    }
+    auto &&id = funMatch->getId();
+    auto &&pats = funMatch->getPats();
+    auto &&typ = funMatch->getTyp();
+    switch (funMatch->getKind()) {
+        case ASTKind::NonFixFunMatchAST:
+            return rebuild<NonFixFunMatchAST>(
+                    funMatch, id, pats, exp, typ, orFunMatch);
+        case ASTKind::InfixFunMatchAST:
+            return rebuild<InfixFunMatchAST>(
+                    funMatch, id, pats, exp, typ, orFunMatch);
+        default:
+            return rebuild<FunMatchAST>(
+                    funMatch, id, pats, exp, typ, orFunMatch);
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+#include "AST.h"
+#include "ASTProperty.h"
+
+/**
+ * Rewrites the expressions of an ast bottom-up, i.e. an expression is
+ * rewritten after its children.
+ *
+ * The asts are never modified, as they may be shared, an ast is rebuilt
+ * instead once any of its children is rewritten, and a rebuilt ast keeps the
+ * type of the one it replaces.
+ */
+class ASTRewriter {
+public:
+    virtual ~ASTRewriter() = default;
+
+    /**
+     * Rewrite the expressions of an expression or a declaration.
+     * @param ast The ast.
+     * @return The rewritten ast, or the ast itself if nothing is rewritten.
+     */
+    std::shared_ptr<AST> rewrite(const std::shared_ptr<AST> &ast);
+
+protected:
+    /**
+     * Rewrite an expression, which only rewrites its children by default.
+     * @param exp The expression.
+     * @return The rewritten expression, or the expression itself.
+     */
+    virtual std::shared_ptr<ExpAST>
+    rewriteExp(const std::shared_ptr<ExpAST> &exp);
+
+    /**
+     * Rewrite the child expressions and declarations of an expression.
+     * @param exp The expression.
+     * @return The expression rebuilt with the rewritten children, or the
+     * expression itself if none of them is rewritten.
+     */
+    std::shared_ptr<ExpAST>
+    rewriteChildren(const std::shared_ptr<ExpAST> &exp);
+
+    std::shared_ptr<DecAST> rewriteDec(const std::shared_ptr<DecAST> &dec);
+
+    /**
+     * Create an ast in place of another one, with the type of it.
+     * @tparam TAST The concrete ast type.
+     * @param replaced The replaced ast.
+     * @param args The constructor arguments.
+     * @return The created ast.
+     */
+    template<typename TAST, typename ...Args>
+    static std::shared_ptr<TAST>
+    rebuild(const std::shared_ptr<AST> &replaced, Args &&...args) {
+        auto ast = AST::create<TAST>(std::forward<Args>(args)...);
+        ASTProperty::setType(ast, ASTProperty::getType(replaced));
+        ASTProperty::setPrimitive(ast, ASTProperty::getPrimitive(replaced));
+        return ast;
+    }
+
+private:
+    std::shared_ptr<MatchAST> rewriteMatch(const std::shared_ptr<MatchAST> &match);
+
+    std::shared_ptr<ValBindAST>
+    rewriteValBind(const std::shared_ptr<ValBindAST> &valBind);
+
+    std::shared_ptr<FunBindAST>
+    rewriteFunBind(const std::shared_ptr<FunBindAST> &funBind);
+
+    std::shared_ptr<FunMatchAST>
+    rewriteFunMatch(const std::shared_ptr<FunMatchAST> &funMatch);
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include "AST.h"
+#include "ASTVisitor.h"
+
+//region APPLY_ALL
+#ifndef APPLY_ALL
+#include "ASTApplyMacro.h"
+#endif
+
+/**
+ * Statically dispatched ast visitor with a typed result.
+ *
+ * A concrete visitor derives from `ASTTypedVisitor<Visitor, Result>' and
+ * declares public non-virtual handlers `Result visit(X *ast)' for the ast
+ * classes it cares about. For each concrete ast, overload resolution picks the
+ * handler with the most derived parameter type at compile time, so unhandled
+ * asts do not bounce up the class hierarchy through a chain of virtual calls,
+ * and results need not be casted from void pointers.
+ *
+ * A visitor should bring the fallback handler into scope with
+ * `using ASTTypedVisitor::visit;'.
+ *
+ * @tparam TDerived The concrete visitor class.
+ * @tparam TResult The result type of all handlers.
+ */
+template<typename TDerived, typename TResult>
+class ASTTypedVisitor {
+public:
+    using ResultType = TResult;
+
+    /**
+     * Visit the ast with the handler of its most derived class.
+     * @param ast The ast to visit.
+     * @return The result of the handler, or a value initialized result if the
+     * ast is null.
+     */
+    TResult dispatch(AST *ast) {
+        if (!ast) {
+            return TResult{};
+        }
+        if constexpr (std::is_pointer_v<TResult>) {
+            return static_cast<TResult>(ast->accept(&_adapter));
+        } else {
+            ast->accept(&_adapter);
+            return std::move(_result);
+        }
+    }
+
+    template<typename TAST>
+    TResult dispatch(const std::shared_ptr<TAST> &ast) {
+        return dispatch(static_cast<AST *>(ast.get()));
+    }
+
+    /**
+     * The fallback handler, used when no handler accepts the ast.
+     * @return A value initialized result.
+     */
+    TResult visit(AST *) {
+        return TResult{};
+    }
+
+protected:
+    ASTTypedVisitor() noexcept : _adapter(derived()) {}
+
+    ASTTypedVisitor(const ASTTypedVisitor &) noexcept : _adapter(derived()) {}
+
+    ASTTypedVisitor &operator=(const ASTTypedVisitor &) noexcept {
+        return *this;
+    }
+
+private:
+    TDerived *derived() noexcept {
+        return static_cast<TDerived *>(this);
+    }
+
+    /**
+     * Bridges the virtual accept of asts to the handlers of the visitor.
+     */
+    class Adapter : public ASTVisitor {
+    public:
+        explicit Adapter(TDerived *visitor) noexcept : _visitor(visitor) {}
+
+#define APPLY(CLASS) \
+        void *visit(CLASS *ast) override { \
+            return box(_visitor->visit(ast)); \
+        }
+
+        APPLY_ALL
+
+#undef APPLY
+
+    private:
+        void *box(TResult &&result) {
+            if constexpr (std::is_pointer_v<TResult>) {
+                return const_cast<void *>(static_cast<const void *>(result));
+            } else {
+                _visitor->_result = std::move(result);
+                return nullptr;
+            }
+        }
+
+        TDerived *_visitor;
+    } _adapter;
+
+    TResult _result{};
+};
+
+#undef APPLY_ALL
+//endregion
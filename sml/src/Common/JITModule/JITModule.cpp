@@ -19,33 +19,101 @@
 #include "llvm/Transforms/Scalar/GVN.h"
 #include "JITModule.h"
 
-llvm::LLVMContext TheContext;
-llvm::IRBuilder<> Builder(TheContext);
-std::unique_ptr<llvm::Module> TheModule;
-std::map<std::string, std::shared_ptr<AST>> FunctionProtos;
-std::unique_ptr<llvm::legacy::FunctionPassManager> TheFPM;
-std::map<std::string, llvm::Value *> NamedValues;
-std::unique_ptr<llvm::orc::KaleidoscopeJIT> TheJIT;
-std::map<std::string, llvm::Value *> temNamedValues;
+namespace {
+    /**
+     * Copy a constant generated, i.e. an int, a bool, a real or a string as
+     * an array of ints, into another context.
+     * @return The copy, or null if the value is no such constant.
+     */
+    llvm::Constant *copyConstant(llvm::Value *value,
+                                 llvm::LLVMContext &context) {
+        if (auto integer = llvm::dyn_cast<llvm::ConstantInt>(value)) {
+            return llvm::ConstantInt::get(context, integer->getValue());
+        }
+        if (auto real = llvm::dyn_cast<llvm::ConstantFP>(value)) {
+            return llvm::ConstantFP::get(context, real->getValueAPF());
+        }
+        auto type = llvm::dyn_cast<llvm::ArrayType>(value->getType());
+        if (!type || !type->getElementType()->isIntegerTy()) {
+            return nullptr;
+        }
+        // an array of ints may be kept as data instead of operands.
+        std::vector<llvm::Constant *> elements;
+        if (auto data = llvm::dyn_cast<llvm::ConstantDataArray>(value)) {
+            for (unsigned i = 0; i < data->getNumElements(); ++i) {
+                elements.push_back(
+                        copyConstant(data->getElementAsConstant(i), context));
+            }
+        } else if (auto array = llvm::dyn_cast<llvm::ConstantArray>(value)) {
+            for (auto &&operand : array->operands()) {
+                auto element = copyConstant(operand, context);
+                if (!element) {
+                    return nullptr;
+                }
+                elements.push_back(element);
+            }
+        } else if (!llvm::isa<llvm::ConstantAggregateZero>(value)) {
+            return nullptr;
+        }
+        auto elementType = llvm::IntegerType::get(
+                context, type->getElementType()->getIntegerBitWidth());
+        auto copiedType = llvm::ArrayType::get(elementType,
+                                               type->getNumElements());
+        if (elements.empty()) {
+            return llvm::ConstantAggregateZero::get(copiedType);
+        }
+        return llvm::ConstantArray::get(copiedType, elements);
+    }
+}
 
-void InitializeModuleAndPassManager() {
+JITModule::JITModule() : builder(context) {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    llvm::InitializeNativeTargetAsmParser();
+    jit = llvm::make_unique<llvm::orc::KaleidoscopeJIT>();
+    initializeModuleAndPassManager();
+}
+
+JITModule::~JITModule() = default;
+
+void JITModule::initializeModuleAndPassManager() {
 
 // Open a new module.
-    TheModule = llvm::make_unique<llvm::Module>("test", TheContext);
-    TheModule->setDataLayout(TheJIT->getTargetMachine().createDataLayout());
+    module = llvm::make_unique<llvm::Module>("test", context);
+    module->setDataLayout(jit->getTargetMachine().createDataLayout());
 
 // Create a new pass manager attached to it.
-    TheFPM = llvm::make_unique<llvm::legacy::FunctionPassManager>(TheModule.get());
+    passManager = llvm::make_unique<llvm::legacy::FunctionPassManager>(module.get());
 
 //四个add为添加优化
 // Do simple "peephole" optimizations and bit-twiddling optzns.
-    TheFPM->add(llvm::createInstructionCombiningPass());
+    passManager->add(llvm::createInstructionCombiningPass());
 // Reassociate expressions.
-    TheFPM->add(llvm::createReassociatePass());
+    passManager->add(llvm::createReassociatePass());
 //     Eliminate Common SubExpressions.
-    TheFPM->add(llvm::createGVNPass());
+    passManager->add(llvm::createGVNPass());
 // Simplify the control flow graph (deleting unreachable blocks, etc).
-    TheFPM->add(llvm::createCFGSimplificationPass());
+    passManager->add(llvm::createCFGSimplificationPass());
+
+    passManager->doInitialization();
+}
+
+std::unique_ptr<JITModule> JITModule::fork() const {
+    auto forked = std::make_unique<JITModule>();
+    forked->functionProtos = functionProtos;
+    functionProtos.forEach([&forked](Name name, auto &&) {
+        forked->uncompiled.insert(name.get());
+    });
+    // only the constants are independent of the code compiled by this JIT.
+    temNamedValues.forEach([&forked](Name name, llvm::Value *value) {
+        if (auto constant = copyConstant(value, forked->context)) {
+            forked->temNamedValues.insert(name, constant);
+        }
+    });
+    return forked;
+}
 
-    TheFPM->doInitialization();
-}
\ No newline at end of file
+JITModule *JITModule::getInstance() {
+    static JITModule instance;
+    return &instance;
+}
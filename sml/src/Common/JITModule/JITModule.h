@@ -1,7 +1,9 @@
 #pragma once
 
-#include <map>
 #include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/BasicBlock.h"
@@ -22,16 +24,83 @@
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Scalar/GVN.h"
 #include "KaleidoscopeJIT.h"
+#include "Symbol/FlatMap.h"
 
 class AST;
 
-extern llvm::LLVMContext TheContext;
-extern llvm::IRBuilder<> Builder;
-extern std::unique_ptr<llvm::Module> TheModule;
-extern std::map<std::string, std::shared_ptr<AST>> FunctionProtos;
-extern std::unique_ptr<llvm::legacy::FunctionPassManager> TheFPM;
-extern std::map<std::string, llvm::Value *> NamedValues;
-extern std::map<std::string, llvm::Value *> temNamedValues;
-extern std::unique_ptr<llvm::orc::KaleidoscopeJIT> TheJIT;
+/**
+ * The code generated by an interpreter session: the context of the code, the
+ * module being generated with its pass manager, the names bound to the values
+ * generated and the functions compiled by the JIT of the session. The code
+ * generator and the JIT of a session share it, independent of those of the
+ * other sessions.
+ */
+struct JITModule {
+    JITModule();
 
-void InitializeModuleAndPassManager();
\ No newline at end of file
+    ~JITModule();
+
+    JITModule(const JITModule &) = delete;
+
+    JITModule &operator=(const JITModule &) = delete;
+
+    /**
+     * Open a new module, with a new pass manager attached to it.
+     */
+    void initializeModuleAndPassManager();
+
+    /**
+     * Fork the functions compiled, e.g. by a library loaded once for many
+     * sessions, and the constants bound to names, into a new context. The
+     * functions are compiled again by the JIT of the fork once called. A name
+     * bound to a value not constant, e.g. the result of a call, is not bound
+     * in the fork, the code of which cannot refer to it.
+     * @return The fork.
+     */
+    [[nodiscard]] std::unique_ptr<JITModule> fork() const;
+
+    /**
+     * Get the state of the code generators and the JITs created with none.
+     */
+    static JITModule *getInstance();
+
+    /**
+     * The context owning the code, destroyed after all of it.
+     */
+    llvm::LLVMContext context;
+
+    llvm::IRBuilder<> builder;
+
+    std::unique_ptr<llvm::orc::KaleidoscopeJIT> jit;
+
+    std::unique_ptr<llvm::Module> module;
+
+    std::unique_ptr<llvm::legacy::FunctionPassManager> passManager;
+
+    /**
+     * The definitions of the functions compiled, by their names.
+     */
+    FlatMap<std::shared_ptr<AST>> functionProtos;
+
+    /**
+     * The parameters of the function being generated.
+     */
+    FlatMap<llvm::Value *> namedValues;
+
+    /**
+     * The values bound by the top-level declarations.
+     */
+    FlatMap<llvm::Value *> temNamedValues;
+
+    /**
+     * The functions forked but not yet compiled by the JIT.
+     */
+    std::unordered_set<std::string> uncompiled;
+
+    /**
+     * The functions forked and called by the code being generated, to be
+     * compiled before it is run.
+     */
+    std::vector<std::string> called;
+
+};
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Name.h"
+
+/**
+ * A map of names kept flat in one array, probed linearly from the hash of a
+ * name, so that a lookup reads adjacent slots instead of chasing nodes.
+ * Erasing shifts the following slots of the run back, so no slot is left
+ * deleted, and the array is doubled when it is three quarters full.
+ *
+ * The lookups never insert, and are counted as hits and misses.
+ *
+ * @tparam TValue The value bound, default constructible.
+ */
+template<typename TValue>
+class FlatMap {
+public:
+    struct Statistics {
+        size_t hits;
+        size_t misses;
+    };
+
+    /**
+     * @return The value bound to a name, or null if none. It is valid until
+     * the map is changed.
+     */
+    [[nodiscard]] const TValue *find(Name name) const {
+        auto index = probe(name);
+        if (index == NOT_FOUND) {
+            ++_statistics.misses;
+            return nullptr;
+        }
+        ++_statistics.hits;
+        return &_slots[index].value;
+    }
+
+    [[nodiscard]] TValue *find(Name name) {
+        return const_cast<TValue *>(std::as_const(*this).find(name));
+    }
+
+    /**
+     * Find a string, which is not interned if it is not yet.
+     */
+    [[nodiscard]] const TValue *find(const std::string &name) const {
+        return find(Name::find(name));
+    }
+
+    [[nodiscard]] TValue *find(const std::string &name) {
+        return find(Name::find(name));
+    }
+
+    /**
+     * @return The value bound to a name, or the default value if none.
+     */
+    [[nodiscard]] TValue lookup(const std::string &name) const {
+        auto found = find(name);
+        return found ? *found : TValue();
+    }
+
+    /**
+     * Bind a name, replacing its binding if any.
+     */
+    void insert(Name name, TValue value) {
+        if ((_size + 1) * 4 > _slots.size() * 3) {
+            grow();
+        }
+        auto mask = _slots.size() - 1;
+        for (auto i = getHome(name); ; i = (i + 1) & mask) {
+            auto &&slot = _slots[i];
+            if (!slot.name || slot.name == name) {
+                _size += !slot.name;
+                slot = {name, std::move(value)};
+                return;
+            }
+        }
+    }
+
+    void insert(const std::string &name, TValue value) {
+        insert(Name::intern(name), std::move(value));
+    }
+
+    /**
+     * Unbind a name. Nothing is done if it is not bound.
+     */
+    void erase(Name name) {
+        auto hole = probe(name);
+        if (hole == NOT_FOUND) {
+            return;
+        }
+        auto mask = _slots.size() - 1;
+        // a slot after the hole is moved into it unless its home lies
+        // cyclically in (hole, slot], i.e. it would be unreachable.
+        for (auto i = (hole + 1) & mask; _slots[i].name; i = (i + 1) & mask) {
+            auto home = getHome(_slots[i].name);
+            if (((i - home) & mask) >= ((i - hole) & mask)) {
+                _slots[hole] = std::move(_slots[i]);
+                hole = i;
+            }
+        }
+        _slots[hole] = {};
+        --_size;
+    }
+
+    void erase(const std::string &name) {
+        erase(Name::find(name));
+    }
+
+    void clear() {
+        _slots.clear();
+        _size = 0;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return _size;
+    }
+
+    /**
+     * Visit the name and the value of each binding, in no order.
+     */
+    template<typename TVisit>
+    void forEach(TVisit &&visit) const {
+        for (auto &&slot : _slots) {
+            if (slot.name) {
+                visit(slot.name, slot.value);
+            }
+        }
+    }
+
+    [[nodiscard]] Statistics getStatistics() const {
+        return _statistics;
+    }
+
+    void resetStatistics() {
+        _statistics = {};
+    }
+
+private:
+    static constexpr size_t NOT_FOUND = ~size_t();
+
+    static constexpr size_t MIN_CAPACITY = 16;
+
+    struct Slot {
+        Name name;
+        TValue value{};
+    };
+
+    [[nodiscard]] size_t getHome(Name name) const {
+        return Name::Hash()(name) >> _shift;
+    }
+
+    [[nodiscard]] size_t probe(Name name) const {
+        if (!name || _slots.empty()) {
+            return NOT_FOUND;
+        }
+        auto mask = _slots.size() - 1;
+        for (auto i = getHome(name); _slots[i].name; i = (i + 1) & mask) {
+            if (_slots[i].name == name) {
+                return i;
+            }
+        }
+        return NOT_FOUND;
+    }
+
+    void grow() {
+        auto slots = std::move(_slots);
+        auto capacity = slots.empty() ? MIN_CAPACITY : slots.size() * 2;
+        _slots = std::vector<Slot>(capacity);
+        _shift = sizeof(size_t) * 8;
+        for (auto bits = capacity; bits > 1; bits >>= 1) {
+            --_shift;
+        }
+        _size = 0;
+        for (auto &&slot : slots) {
+            if (slot.name) {
+                insert(slot.name, std::move(slot.value));
+            }
+        }
+    }
+
+    /**
+     * The slots, a power of two of them, a slot of no name being empty.
+     */
+    std::vector<Slot> _slots;
+
+    /**
+     * The shift of the hashes to the bits indexing the slots.
+     */
+    unsigned _shift{};
+
+    size_t _size{};
+
+    mutable Statistics _statistics{};
+};
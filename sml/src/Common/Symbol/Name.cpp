@@ -0,0 +1,46 @@
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include "Name.h"
+
+using namespace std;
+
+namespace {
+    /**
+     * The strings of the names by id, kept in a deque so that they never
+     * move, and the ids by string.
+     */
+    struct {
+        shared_mutex lock;
+        deque<string> strings;
+        unordered_map<string_view, uint32_t> ids;
+    } nameTable;
+}
+
+Name Name::intern(const std::string &name) {
+    if (auto interned = find(name)) {
+        return interned;
+    }
+    unique_lock<shared_mutex> _1{nameTable.lock};
+    // the name may be interned by another thread in between.
+    auto found = nameTable.ids.find(name);
+    if (found != nameTable.ids.end()) {
+        return Name(found->second);
+    }
+    auto id = uint32_t(nameTable.strings.size());
+    nameTable.ids.emplace(nameTable.strings.emplace_back(name), id);
+    return Name(id);
+}
+
+Name Name::find(const std::string &name) {
+    shared_lock<shared_mutex> _1{nameTable.lock};
+    auto found = nameTable.ids.find(name);
+    return found == nameTable.ids.end() ? Name() : Name(found->second);
+}
+
+const std::string &Name::get() const {
+    shared_lock<shared_mutex> _1{nameTable.lock};
+    return nameTable.strings[_id];
+}
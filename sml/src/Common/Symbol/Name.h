@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * An interned name, e.g. of a value or a type, identified by a number given
+ * once for the process, so that the maps of names compare and hash numbers
+ * instead of strings.
+ *
+ * The names are interned in parallel by the checks, so interning and finding
+ * are guarded by a lock.
+ */
+class Name {
+public:
+    /**
+     * Create no name.
+     */
+    Name() = default;
+
+    /**
+     * Get the name of a string, interning it if it is not yet.
+     */
+    static Name intern(const std::string &name);
+
+    /**
+     * Get the name of a string without interning it, e.g. for a lookup, which
+     * can only miss if the string is not interned.
+     * @return The name, or no name if the string is not interned.
+     */
+    static Name find(const std::string &name);
+
+    [[nodiscard]] uint32_t getId() const {
+        return _id;
+    }
+
+    /**
+     * @return The string of the name, valid for the process.
+     */
+    [[nodiscard]] const std::string &get() const;
+
+    explicit operator bool() const {
+        return _id != NONE;
+    }
+
+    bool operator==(Name rhs) const {
+        return _id == rhs._id;
+    }
+
+    bool operator!=(Name rhs) const {
+        return _id != rhs._id;
+    }
+
+    /**
+     * Spreads the ids, which are dense, over the bits of the hashes.
+     */
+    struct Hash {
+        size_t operator()(Name name) const noexcept {
+            return size_t(name._id) * 0x9e3779b97f4a7c15u;
+        }
+    };
+
+private:
+    static constexpr uint32_t NONE = ~uint32_t();
+
+    explicit Name(uint32_t id) : _id(id) {}
+
+    uint32_t _id = NONE;
+};
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * A persistent map, i.e. a hash array mapped trie whose nodes are shared by
+ * the copies of the map. Copying a map is constant time, and a copy only
+ * pays for the bindings it changes, by copying the nodes on their paths. A
+ * node owned by a single map is changed in place.
+ *
+ * Each node branches on 5 bits of the hashes, keeping its bindings and its
+ * children apart in the order of their bits, as in a compressed hash array
+ * mapped prefix tree. The keys of a hash are kept by a node below the bits.
+ *
+ * The copies of a map are not to be changed in parallel.
+ *
+ * @tparam TKey The key, e.g. a name.
+ * @tparam TValue The value bound.
+ * @tparam THash The hash of the keys.
+ */
+template<typename TKey, typename TValue, typename THash = std::hash<TKey>>
+class PersistentMap {
+public:
+    /**
+     * @return The value bound to a key, or null if none. It is valid until the
+     * map is changed.
+     */
+    [[nodiscard]] const TValue *find(const TKey &key) const {
+        auto hash = THash()(key);
+        auto node = _root.get();
+        for (unsigned shift = 0; node; shift += BITS) {
+            if (shift >= HASH_BITS) {
+                for (auto &&entry : node->entries) {
+                    if (entry.key == key) {
+                        return &entry.value;
+                    }
+                }
+                return nullptr;
+            }
+            auto bit = getBit(hash, shift);
+            if (node->dataMap & bit) {
+                auto &&entry = node->entries[getIndex(node->dataMap, bit)];
+                return entry.key == key ? &entry.value : nullptr;
+            }
+            if (!(node->nodeMap & bit)) {
+                return nullptr;
+            }
+            node = node->children[getIndex(node->nodeMap, bit)].get();
+        }
+        return nullptr;
+    }
+
+    /**
+     * Bind a key, replacing its binding if any.
+     */
+    void insert(const TKey &key, TValue value) {
+        auto hash = THash()(key);
+        if (!_root) {
+            _root = std::make_shared<Node>();
+        }
+        bool added = false;
+        _root = insert(std::move(_root), hash, 0, key, std::move(value), added);
+        _size += added;
+    }
+
+    /**
+     * Unbind a key. Nothing is done if it is not bound.
+     */
+    void erase(const TKey &key) {
+        if (!find(key)) {
+            return;
+        }
+        _root = erase(std::move(_root), THash()(key), 0, key);
+        --_size;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return _size;
+    }
+
+    /**
+     * Visit the bindings in no particular order.
+     * @param visit Called with each key and value.
+     */
+    template<typename TVisit>
+    void forEach(TVisit &&visit) const {
+        if (_root) {
+            forEach(*_root, visit);
+        }
+    }
+
+private:
+    static constexpr unsigned BITS = 5;
+    static constexpr unsigned HASH_BITS = sizeof(size_t) * 8;
+
+    struct Entry {
+        size_t hash;
+        TKey key;
+        TValue value;
+    };
+
+    struct Node;
+
+    using NodePtr = std::shared_ptr<Node>;
+
+    /**
+     * The bindings and the children of a node, each kept in the order of
+     * the bits of its map. A node below the bits of the hashes keeps the
+     * bindings of a hash with no map.
+     */
+    struct Node {
+        uint32_t dataMap{};
+        uint32_t nodeMap{};
+        std::vector<Entry> entries;
+        std::vector<NodePtr> children;
+    };
+
+    static uint32_t getBit(size_t hash, unsigned shift) {
+        return uint32_t(1) << ((hash >> shift) & ((1u << BITS) - 1));
+    }
+
+    static size_t getIndex(uint32_t map, uint32_t bit) {
+        return std::bitset<32>(map & (bit - 1)).count();
+    }
+
+    /**
+     * Get a node to change, the node itself if no other node or map shares
+     * it, otherwise a copy.
+     */
+    static NodePtr own(NodePtr &&node) {
+        return node.use_count() == 1 ? std::move(node)
+                                     : std::make_shared<Node>(*node);
+    }
+
+    static NodePtr merge(Entry &&first, Entry &&second, unsigned shift) {
+        auto node = std::make_shared<Node>();
+        if (shift >= HASH_BITS) {
+            node->entries.push_back(std::move(first));
+            node->entries.push_back(std::move(second));
+            return node;
+        }
+        auto firstBit = getBit(first.hash, shift);
+        auto secondBit = getBit(second.hash, shift);
+        if (firstBit == secondBit) {
+            node->nodeMap = firstBit;
+            node->children.push_back(
+                    merge(std::move(first), std::move(second), shift + BITS));
+            return node;
+        }
+        node->dataMap = firstBit | secondBit;
+        if (firstBit > secondBit) {
+            std::swap(first, second);
+        }
+        node->entries.push_back(std::move(first));
+        node->entries.push_back(std::move(second));
+        return node;
+    }
+
+    static NodePtr insert(NodePtr &&shared, size_t hash, unsigned shift,
+                          const TKey &key, TValue &&value, bool &added) {
+        auto node = own(std::move(shared));
+        if (shift >= HASH_BITS) {
+            for (auto &&entry : node->entries) {
+                if (entry.key == key) {
+                    entry.value = std::move(value);
+                    return node;
+                }
+            }
+            node->entries.push_back({hash, key, std::move(value)});
+            added = true;
+            return node;
+        }
+        auto bit = getBit(hash, shift);
+        if (node->dataMap & bit) {
+            auto index = getIndex(node->dataMap, bit);
+            auto &&entry = node->entries[index];
+            if (entry.key == key) {
+                entry.value = std::move(value);
+                return node;
+            }
+            // the binding is pushed down with the new one.
+            auto child = merge(std::move(entry), {hash, key, std::move(value)},
+                               shift + BITS);
+            node->entries.erase(node->entries.begin() + index);
+            node->dataMap ^= bit;
+            node->nodeMap |= bit;
+            node->children.insert(
+                    node->children.begin() + getIndex(node->nodeMap, bit),
+                    std::move(child));
+            added = true;
+            return node;
+        }
+        if (node->nodeMap & bit) {
+            auto &&child = node->children[getIndex(node->nodeMap, bit)];
+            child = insert(std::move(child), hash, shift + BITS, key,
+                           std::move(value), added);
+            return node;
+        }
+        node->dataMap |= bit;
+        node->entries.insert(
+                node->entries.begin() + getIndex(node->dataMap, bit),
+                {hash, key, std::move(value)});
+        added = true;
+        return node;
+    }
+
+    /**
+     * Erase a key bound below a node.
+     * @return The node, or null if it is left empty.
+     */
+    static NodePtr erase(NodePtr &&shared, size_t hash, unsigned shift,
+                         const TKey &key) {
+        auto node = own(std::move(shared));
+        if (shift >= HASH_BITS) {
+            for (auto it = node->entries.begin(); it != node->entries.end();
+                 ++it) {
+                if (it->key == key) {
+                    node->entries.erase(it);
+                    break;
+                }
+            }
+            return node->entries.empty() ? nullptr : node;
+        }
+        auto bit = getBit(hash, shift);
+        if (node->dataMap & bit) {
+            node->entries.erase(
+                    node->entries.begin() + getIndex(node->dataMap, bit));
+            node->dataMap ^= bit;
+        } else {
+            auto index = getIndex(node->nodeMap, bit);
+            auto child = erase(std::move(node->children[index]), hash,
+                               shift + BITS, key);
+            if (child && (!child->children.empty()
+                          || child->entries.size() > 1)) {
+                node->children[index] = std::move(child);
+                return node;
+            }
+            node->children.erase(node->children.begin() + index);
+            node->nodeMap ^= bit;
+            // a single binding left below is kept by the node instead.
+            if (child) {
+                node->dataMap |= bit;
+                node->entries.insert(
+                        node->entries.begin() + getIndex(node->dataMap, bit),
+                        std::move(child->entries.front()));
+            }
+        }
+        return node->entries.empty() && node->children.empty() ? nullptr
+                                                                : node;
+    }
+
+    template<typename TVisit>
+    static void forEach(const Node &node, TVisit &visit) {
+        for (auto &&entry : node.entries) {
+            visit(entry.key, entry.value);
+        }
+        for (auto &&child : node.children) {
+            forEach(*child, visit);
+        }
+    }
+
+    NodePtr _root;
+    size_t _size{};
+};
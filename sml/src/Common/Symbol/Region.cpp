@@ -0,0 +1,103 @@
+#include <new>
+#include <utility>
+#include "Region.h"
+
+using namespace std;
+
+namespace {
+    constexpr size_t alignment = alignof(max_align_t);
+
+    size_t alignUp(size_t size) {
+        return (size + alignment - 1) & ~(alignment - 1);
+    }
+
+    thread_local Region *currentRegion;
+}
+
+Region::Region(size_t chunkSize) : _chunkSize(alignUp(chunkSize)) {
+
+}
+
+Region::~Region() {
+    release();
+}
+
+void *Region::allocate(size_t size) noexcept {
+    size = alignUp(size ? size : 1);
+    lock_guard<mutex> _1{_lock};
+    ++_statistics.allocations;
+    _statistics.bytes += size;
+    if (size_t(_end - _next) >= size) {
+        return exchange(_next, _next + size);
+    }
+    // a large allocation is given a chunk of its own, leaving the current
+    // chunk to bump on.
+    auto chunkSize = size > _chunkSize / 4 ? size : _chunkSize;
+    auto chunk = new(nothrow) char[chunkSize];
+    if (!chunk) {
+        return nullptr;
+    }
+    _chunks.emplace_back(chunk, chunkSize);
+    ++_statistics.chunks;
+    _statistics.reserved += chunkSize;
+    if (chunkSize == size) {
+        return chunk;
+    }
+    _next = chunk + size;
+    _end = chunk + chunkSize;
+    return chunk;
+}
+
+void Region::addFinalizer(void (*finalize)(void *), void *object) {
+    lock_guard<mutex> _1{_lock};
+    _finalizers.emplace_back(finalize, object);
+}
+
+void Region::release() noexcept {
+    lock_guard<mutex> _1{_lock};
+    for (auto it = _finalizers.rbegin(); it != _finalizers.rend(); ++it) {
+        it->first(it->second);
+    }
+    _finalizers.clear();
+    _chunks.clear();
+    _next = _end = nullptr;
+    _statistics.chunks = 0;
+    _statistics.reserved = 0;
+}
+
+Region::Statistics Region::getStatistics() const {
+    lock_guard<mutex> _1{_lock};
+    return _statistics;
+}
+
+bool Region::contains(const void *p) const {
+    lock_guard<mutex> _1{_lock};
+    auto address = static_cast<const char *>(p);
+    for (auto &&chunk : _chunks) {
+        auto begin = chunk.first.get();
+        if (address >= begin && address < begin + chunk.second) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Region &Region::getProcess() noexcept {
+    // never destroyed, as symbols of static storage may be released
+    // after it would be.
+    static auto region = new Region;
+    return *region;
+}
+
+Region &Region::getCurrent() noexcept {
+    return currentRegion ? *currentRegion : getProcess();
+}
+
+Region::Scope::Scope(Region &region) noexcept
+        : _previous(currentRegion) {
+    currentRegion = &region;
+}
+
+Region::Scope::~Scope() noexcept {
+    currentRegion = _previous;
+}
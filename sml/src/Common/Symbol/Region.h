@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/**
+ * A region the symbols are allocated in by bumping a pointer through chunks
+ * of memory, e.g. for an interpreter session. Nothing is freed one by one,
+ * but all at once when the region is released or destroyed, after running
+ * the finalizers added, e.g. the destructors of the symbols owning memory out
+ * of the region.
+ *
+ * Allocating is guarded by a lock, as the checks in parallel allocate in the
+ * region of the thread starting them.
+ */
+class Region {
+public:
+    struct Statistics {
+        /**
+         * The number and the bytes of the allocations since the region is
+         * created, including those released.
+         */
+        size_t allocations;
+        size_t bytes;
+
+        /**
+         * The chunks held now, and their bytes.
+         */
+        size_t chunks;
+        size_t reserved;
+    };
+
+    /**
+     * @param chunkSize The size of a chunk, a larger allocation being given a
+     * chunk of its own.
+     */
+    explicit Region(size_t chunkSize = DEFAULT_CHUNK_SIZE);
+
+    ~Region();
+
+    Region(const Region &) = delete;
+
+    Region &operator=(const Region &) = delete;
+
+    /**
+     * Allocate memory aligned for any type.
+     * @return The memory, or null if out of memory.
+     */
+    void *allocate(size_t size) noexcept;
+
+    /**
+     * Run a finalizer on an object allocated in the region when the region
+     * is released, the last added first.
+     */
+    void addFinalizer(void (*finalize)(void *), void *object);
+
+    /**
+     * Run the finalizers, then free all the memory allocated in the region at
+     * once. The region can be allocated in again.
+     */
+    void release() noexcept;
+
+    [[nodiscard]] Statistics getStatistics() const;
+
+    /**
+     * @return Whether the memory is allocated in the region and not released,
+     * in time linear in the chunks.
+     */
+    [[nodiscard]] bool contains(const void *p) const;
+
+    /**
+     * Get the region of the process, which is never released.
+     */
+    static Region &getProcess() noexcept;
+
+    /**
+     * Get the region the calling thread allocates the symbols in, which is
+     * the one of the process unless a scope is entered.
+     */
+    static Region &getCurrent() noexcept;
+
+    /**
+     * Makes the calling thread allocate the symbols in a region for its
+     * lifetime.
+     */
+    struct Scope {
+        explicit Scope(Region &region) noexcept;
+
+        ~Scope() noexcept;
+
+        Scope(const Scope &) = delete;
+
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        Region *_previous;
+    };
+
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+private:
+    mutable std::mutex _lock;
+    /**
+     * The chunks with their sizes.
+     */
+    std::vector<std::pair<std::unique_ptr<char[]>, size_t>> _chunks;
+    std::vector<std::pair<void (*)(void *), void *>> _finalizers;
+    char *_next{};
+    char *_end{};
+    size_t _chunkSize;
+    Statistics _statistics{};
+};
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * A lexically scoped table of bindings. All the scopes share one map of the
+ * bindings visible, and an undo log of the bindings each scope replaces, so a
+ * lookup is one probe however deep the scopes are, and leaving a scope
+ * restores the shadowed bindings exactly in time proportional to the
+ * bindings it made.
+ *
+ * The outermost scope is never left, and its bindings are kept in the log in
+ * the order they are made, to be visited by forEachOutermost.
+ *
+ * @tparam TKey The key of a binding, e.g. a name.
+ * @tparam TValue The value bound.
+ */
+template<typename TKey, typename TValue>
+class ScopedTable {
+public:
+    /**
+     * Enter a new innermost scope.
+     */
+    void enterScope() {
+        _marks.push_back(_log.size());
+    }
+
+    /**
+     * Leave the innermost scope, undoing the bindings made in it. Nothing is
+     * done in the outermost scope.
+     */
+    void leaveScope() {
+        if (_marks.empty()) {
+            return;
+        }
+        for (auto mark = _marks.back(); _log.size() > mark; _log.pop_back()) {
+            auto &&[key, previous] = _log.back();
+            if (previous) {
+                _bindings.insert_or_assign(std::move(key),
+                                           std::move(*previous));
+            } else {
+                _bindings.erase(key);
+            }
+        }
+        _marks.pop_back();
+    }
+
+    /**
+     * @return The number of the scopes entered and not left.
+     */
+    [[nodiscard]] size_t getDepth() const {
+        return _marks.size();
+    }
+
+    /**
+     * Bind a key in the innermost scope, shadowing the binding of an outer
+     * scope until the scope is left.
+     */
+    void insert(const TKey &key, TValue value) {
+        auto found = _bindings.find(key);
+        if (found == _bindings.end()) {
+            _log.push_back({key, std::nullopt});
+            _bindings.emplace(key, std::move(value));
+            return;
+        }
+        // a key bound again by the outermost scope needs no undo.
+        if (!_marks.empty()) {
+            _log.push_back({key, std::move(found->second)});
+        }
+        found->second = std::move(value);
+    }
+
+    /**
+     * Unbind a key in the innermost scope, until the scope is left.
+     */
+    void erase(const TKey &key) {
+        auto found = _bindings.find(key);
+        if (found == _bindings.end()) {
+            return;
+        }
+        if (!_marks.empty()) {
+            _log.push_back({key, std::move(found->second)});
+        } else {
+            removeOutermost(key);
+        }
+        _bindings.erase(found);
+    }
+
+    /**
+     * @return The value bound to a key by the innermost scope binding it, or
+     * null if none.
+     */
+    [[nodiscard]] const TValue *find(const TKey &key) const {
+        auto found = _bindings.find(key);
+        return found == _bindings.end() ? nullptr : &found->second;
+    }
+
+    [[nodiscard]] TValue *find(const TKey &key) {
+        auto found = _bindings.find(key);
+        return found == _bindings.end() ? nullptr : &found->second;
+    }
+
+    /**
+     * Visit the keys bound by the outermost scope in the order they are first
+     * bound, with the values they are bound to, i.e. those of the outermost
+     * scope once the inner ones are left.
+     * @param visit Called with each key and value.
+     */
+    template<typename TVisit>
+    void forEachOutermost(TVisit &&visit) const {
+        auto end = _marks.empty() ? _log.size() : _marks.front();
+        for (size_t i = 0; i < end; ++i) {
+            auto &&key = _log[i].first;
+            if (auto value = find(key)) {
+                visit(key, *value);
+            }
+        }
+    }
+
+    void clear() {
+        _bindings.clear();
+        _log.clear();
+        _marks.clear();
+    }
+
+private:
+    void removeOutermost(const TKey &key) {
+        auto end = _marks.empty() ? _log.size() : _marks.front();
+        for (size_t i = 0; i < end; ++i) {
+            if (_log[i].first == key) {
+                _log.erase(_log.begin() + i);
+                return;
+            }
+        }
+    }
+
+    std::unordered_map<TKey, TValue> _bindings;
+
+    /**
+     * The keys bound, each with the value it is bound to before, or none if
+     * unbound. Those of the outermost scope are the keys first bound by it.
+     */
+    std::vector<std::pair<TKey, std::optional<TValue>>> _log;
+
+    /**
+     * The size of the log on entering each scope.
+     */
+    std::vector<size_t> _marks;
+};
@@ -1,9 +1,17 @@
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
-#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/LLVMContext.h"
+#include "Region.h"
 #include "SymbolTable.h"
 
 using namespace std;
@@ -11,64 +19,360 @@ using namespace std;
 inline namespace SymbolsCache {
     SymbolTable *symbolTableInstance;
 
-    unordered_set<void *> pointerCache;
+    /**
+     * The symbols allocated by the thread and not yet constructed, with the
+     * regions they are allocated in, the last allocated last. A symbol
+     * constructed in other memory, e.g. of static storage, is not among them.
+     */
+    thread_local vector<pair<const void *, Region *>> unconstructed;
+
+    /**
+     * The fields of a record type to intern, with their hash computed once
+     * and kept by the type.
+     */
+    struct RecordStructure {
+        vector<RecordType::Field> fields;
+        size_t hash;
+
+        bool operator==(const RecordStructure &rhs) const {
+            return hash == rhs.hash && fields == rhs.fields;
+        }
+    };
 
-    unordered_map<int, unique_ptr<IntValue>> intValueCache;
+    struct TypeStructureHash {
+        size_t operator()(Type *type) const noexcept {
+            return hash<Type *>()(type);
+        }
 
-    llvm::LLVMContext context;
+        size_t operator()(const vector<Type *> &types) const noexcept {
+            size_t seed = types.size();
+            for (auto type : types) {
+                combine(seed, (*this)(type));
+            }
+            return seed;
+        }
+
+        size_t operator()(
+                const vector<pair<Type *, Type *>> &types) const noexcept {
+            size_t seed = types.size();
+            for (auto &&[ret, param] : types) {
+                combine(seed, (*this)(ret));
+                combine(seed, (*this)(param));
+            }
+            return seed;
+        }
+
+        size_t operator()(
+                const vector<RecordType::Field> &fields) const noexcept {
+            size_t seed = fields.size();
+            for (auto &&[label, type] : fields) {
+                combine(seed, hash<RecordType::Label>()(label));
+                combine(seed, (*this)(type));
+            }
+            return seed;
+        }
+
+        size_t operator()(const RecordStructure &record) const noexcept {
+            return record.hash;
+        }
 
-    auto &getLLVMContext() {
-        return context;
+    private:
+        static void combine(size_t &seed, size_t value) noexcept {
+            seed ^= value + 0x9e3779b9 + (seed << 6u) + (seed >> 2u);
+        }
+    };
+
+    template<typename TStructure, typename TType>
+    using InternedTypes = unordered_map<TStructure, TType *, TypeStructureHash>;
+
+    /**
+     * The canonical structural types, keyed by their canonical children.
+     *
+     * They are allocated in the region of the process, as the symbol tables
+     * share them, unless a child is allocated in the region current to the
+     * thread, e.g. the one of a session, the type being allocated there too.
+     * Those with a child allocated in a region are to be forgotten before
+     * the region is released, so that no child released is a key.
+     */
+    struct {
+        mutex lock;
+        InternedTypes<vector<Type *>, TupleType> tuples;
+        InternedTypes<Type *, ListType> lists;
+        InternedTypes<vector<pair<Type *, Type *>>, FunctionType> functions;
+        InternedTypes<RecordStructure, RecordType> records;
+        Type::InternStatistics statistics;
+    } typeTable;
+
+    /**
+     * The interned labels of the record types.
+     */
+    struct {
+        mutex lock;
+        unordered_set<string> labels;
+    } labelTable;
+
+    // infix operators' priority:
+    // infix 7 * / div mod
+    // infix 6 + - ^
+    // infixr 5 :: @
+    // infix 4 = <> > >= < <=
+    // infix 3 := o
+    // infix 0 before
+    namespace Builtins {
+        struct NamedType {
+            const char *name;
+            Type::TypeId typeId;
+        };
+
+        constexpr NamedType types[] = {
+                {"int",    Type::INT},
+                {"real",   Type::REAL},
+                {"string", Type::STRING},
+                {"unit",   Type::UNIT},
+                {"bool",   Type::BOOL},
+                {"char",   Type::CHAR},
+        };
+
+        struct NamedOperator {
+            const char *name;
+            SymbolTable::Operator anOperator;
+        };
+
+        constexpr NamedOperator operators[] = {
+                {"*",   {SymbolTable::Operator::INFIX, 7}},
+                {"/",   {SymbolTable::Operator::INFIX, 7}},
+                {"div", {SymbolTable::Operator::INFIX, 7}},
+                {"mod", {SymbolTable::Operator::INFIX, 7}},
+                {"+",   {SymbolTable::Operator::INFIX, 6}},
+                {"-",   {SymbolTable::Operator::INFIX, 6}},
+                {"^",   {SymbolTable::Operator::INFIX, 6}},
+                {"=",   {SymbolTable::Operator::INFIX, 4}},
+                {"<>",  {SymbolTable::Operator::INFIX, 4}},
+                {">=",  {SymbolTable::Operator::INFIX, 4}},
+                {"<=",  {SymbolTable::Operator::INFIX, 4}},
+                {">",   {SymbolTable::Operator::INFIX, 4}},
+                {"<",   {SymbolTable::Operator::INFIX, 4}},
+        };
+
+        /**
+         * A builtin function, with an overload for each type of its operands,
+         * taking a tuple of them to one of the type. LIST stands for 'a list.
+         *
+         * TODO: the functions are not implemented yet, nor ::, :=, o, before.
+         */
+        struct NamedFunction {
+            const char *name;
+            Type::TypeId overloads[2];
+            size_t overloadCount;
+            size_t arity;
+            FunctionValue::OperationType operationType;
+            int priority;
+        };
+
+        constexpr NamedFunction functions[] = {
+                {"^", {Type::STRING}, 1, 2, FunctionValue::INFIX,  6},
+                {"@", {Type::LIST},   1, 2, FunctionValue::INFIXR, 5},
+                {"+", {Type::INT, Type::REAL}, 2, 2, FunctionValue::INFIX, 6},
+                {"-", {Type::INT, Type::REAL}, 2, 2, FunctionValue::INFIX, 6},
+                {"*", {Type::INT, Type::REAL}, 2, 2, FunctionValue::INFIX, 7},
+                {"~", {Type::INT, Type::REAL}, 2, 1, FunctionValue::NONFIX, 0},
+        };
+
+        Type *createType(Type::TypeId typeId) {
+            switch (typeId) {
+                case Type::INT:
+                    return IntType::create();
+                case Type::REAL:
+                    return RealType::create();
+                case Type::STRING:
+                    return StringType::create();
+                case Type::UNIT:
+                    return UnitType::create();
+                case Type::BOOL:
+                    return BoolType::create();
+                case Type::CHAR:
+                    return CharType::create();
+                case Type::LIST:
+                    return ListType::create(
+                            VariableTypeNameType::create("'a"));
+                default:
+                    return nullptr;
+            }
+        }
+
+        FunctionValue *createFunction(const NamedFunction &function) {
+            vector<pair<FunctionType *, void *>> overloads;
+            for (size_t i = 0; i < function.overloadCount; ++i) {
+                auto type = createType(function.overloads[i]);
+                auto paramTypes = vector<Type *>(function.arity, type);
+                overloads.emplace_back(
+                        FunctionType::create(type,
+                                             TupleType::create(paramTypes)),
+                        nullptr);
+            }
+            // a function not overloaded keeps no overloads.
+            auto res = overloads.size() == 1
+                       ? FunctionValue::create(overloads.front().first,
+                                               nullptr)
+                       : FunctionValue::create(std::move(overloads));
+            res->setOperationType(function.operationType);
+            res->setPriority(function.priority);
+            return res;
+        }
     }
-}
 
-template<typename TMap>
-static void removeFromMap(const std::string &name, TMap &map) {
-    auto it = map.find(name);
-    if (it == map.end()) {
-        return;
+    /**
+     * Destroy a symbol when the region it is allocated in is released, if it
+     * owns memory out of the region, e.g. the buffer of a vector.
+     * @param symbol The symbol just created, or null if out of memory.
+     * @return The symbol.
+     */
+    template<typename TSymbol>
+    TSymbol *finalized(TSymbol *symbol) {
+        if constexpr (!is_trivially_destructible_v<TSymbol>) {
+            if (symbol) {
+                Region::getCurrent().addFinalizer([](void *p) {
+                    static_cast<TSymbol *>(p)->~TSymbol();
+                }, symbol);
+            }
+        }
+        return symbol;
+    }
+
+    /**
+     * Visit the children of a structure.
+     */
+    template<typename TVisit>
+    void forEachChild(Type *type, TVisit &&visit) {
+        visit(type);
+    }
+
+    template<typename TVisit>
+    void forEachChild(const vector<Type *> &types, TVisit &&visit) {
+        for (auto type : types) {
+            visit(type);
+        }
+    }
+
+    template<typename TVisit>
+    void forEachChild(const vector<pair<Type *, Type *>> &types,
+                      TVisit &&visit) {
+        for (auto &&[ret, param] : types) {
+            visit(ret);
+            visit(param);
+        }
+    }
+
+    template<typename TVisit>
+    void forEachChild(const RecordStructure &record, TVisit &&visit) {
+        for (auto &&field : record.fields) {
+            visit(field.type);
+        }
+    }
+
+    /**
+     * Get the region to allocate the type of a structure in, which is the
+     * current one if a child is allocated in it, or else the one of the
+     * process.
+     */
+    template<typename TStructure>
+    Region &getRegionOfStructure(const TStructure &structure) {
+        auto &current = Region::getCurrent();
+        auto &process = Region::getProcess();
+        if (&current == &process) {
+            return process;
+        }
+        bool inCurrent = false;
+        forEachChild(structure, [&current, &inCurrent](Type *child) {
+            inCurrent = inCurrent || &child->getRegion() == &current;
+        });
+        return inCurrent ? current : process;
+    }
+
+    /**
+     * Get the interned type of a structure, or create and intern it.
+     * @param types The interned types of the kind.
+     * @param structure The structure.
+     * @param create The creator of a new type of the structure.
+     * @return The canonical type.
+     */
+    template<typename TStructure, typename TType, typename TCreate>
+    TType *intern(InternedTypes<TStructure, TType> &types,
+                  TStructure &&structure,
+                  TCreate &&create) {
+        lock_guard<mutex> _1{typeTable.lock};
+        auto it = types.find(structure);
+        if (it != types.end()) {
+            ++typeTable.statistics.hits;
+            return it->second;
+        }
+        ++typeTable.statistics.misses;
+        Region::Scope _2{getRegionOfStructure(structure)};
+        auto type = create(structure);
+        types.emplace(std::move(structure), type);
+        return type;
     }
-    map.erase(it);
 }
 
-template<typename TMap, typename TVal>
-static void insertToMap(const std::string &name, TVal &&val, TMap &map) {
-    map[name] = val;
+template<typename TVal>
+static void removeFromMap(const std::string &name,
+                          PersistentMap<Name, TVal, Name::Hash> &map) {
+    map.erase(Name::find(name));
 }
 
-template<typename TRet, typename TMap>
-static TRet getFromMap(const std::string &name, TMap &&map) {
-    auto it = map.find(name);
-    if (it == map.end()) {
-        return nullptr;
-    }
-    return it->second;
+template<typename TVal>
+static void insertToMap(
+        const std::string &name, TVal &&val,
+        PersistentMap<Name, std::decay_t<TVal>, Name::Hash> &map) {
+    map.insert(Name::intern(name), std::forward<TVal>(val));
 }
 
 void *MemoryCachedSymbol::operator new(size_t sz) noexcept {
-    auto res = ::operator new(sz, nothrow);
-    pointerCache.insert(res);
-    return res;
+    auto &region = Region::getCurrent();
+    auto p = region.allocate(sz);
+    if (p) {
+        unconstructed.emplace_back(p, &region);
+    }
+    return p;
 }
 
-void MemoryCachedSymbol::operator delete(void *p) noexcept {
-    if (auto it = pointerCache.find(p); it != pointerCache.end()) {
-        ::operator delete(p);
-        pointerCache.erase(it);
-    }
+void MemoryCachedSymbol::operator delete(void *) noexcept {
+    // freed with the region.
 }
 
 void MemoryCachedSymbol::clearMemory() noexcept {
-    for (auto &&p : pointerCache) {
-        ::operator delete(p);
-    }
-    pointerCache.clear();
+    Region::getCurrent().release();
 }
 
 void MemoryCachedSymbol::saveDeleteThis() noexcept {
     delete this;
 }
 
+Region &MemoryCachedSymbol::getRegion() const noexcept {
+    return *_region;
+}
+
+MemoryCachedSymbol::MemoryCachedSymbol() noexcept
+        : _region(&Region::getProcess()) {
+    // a symbol allocated while evaluating the arguments of the constructor
+    // of another is constructed first, so is the last allocated.
+    if (!unconstructed.empty() && unconstructed.back().first == this) {
+        _region = unconstructed.back().second;
+        unconstructed.pop_back();
+    }
+}
+
+MemoryCachedSymbol::MemoryCachedSymbol(const MemoryCachedSymbol &) noexcept
+        : MemoryCachedSymbol() {
+
+}
+
+MemoryCachedSymbol &
+MemoryCachedSymbol::operator=(const MemoryCachedSymbol &) noexcept {
+    // a symbol stays in the region it is allocated in.
+    return *this;
+}
+
 std::ostream &operator<<(std::ostream &o, Type const &type) {
     return type.print(o);
 }
@@ -77,20 +381,98 @@ std::ostream &operator<<(std::ostream &o, Value const &value) {
     return value.print(o);
 }
 
-llvm::Type *Type::getLLVMType() const {
-    return _llvmType;
+llvm::Type *Type::getLLVMType(llvm::LLVMContext &context) const {
+    // the layout of a record is the one of the tuple of its fields.
+    auto getStructType = [&context](auto &&types) -> llvm::Type * {
+        vector<llvm::Type *> temTypes;
+        temTypes.reserve(types.size());
+        for (auto type : types) {
+            temTypes.push_back(type->getLLVMType(context));
+        }
+        return llvm::StructType::get(context, temTypes);
+    };
+    switch (getTypeId()) {
+        case INT:
+            return llvm::Type::getInt32Ty(context);
+        case REAL:
+            return llvm::Type::getFloatTy(context);
+        case TUPLE:
+            return getStructType(toTupleType()->getTypes());
+        case RECORD: {
+            vector<Type *> types;
+            for (auto &&field : toRecordType()->getFields()) {
+                types.push_back(field.type);
+            }
+            return getStructType(types);
+        }
+        default:
+            return nullptr;
+    }
 }
 
-Type::Type(llvm::Type *llvmType)
-        : _llvmType(llvmType) {
+Type::InternStatistics Type::getInternStatistics() {
+    lock_guard<mutex> _1{typeTable.lock};
+    return typeTable.statistics;
+}
 
+void Type::clearInterned(const Region &region) {
+    lock_guard<mutex> _1{typeTable.lock};
+    // a type is forgotten if any child is released or forgotten, until none
+    // is forgotten.
+    unordered_set<const Type *> forgotten;
+    auto isReleased = [&region, &forgotten](const Type *type) {
+        return forgotten.count(type) || &type->getRegion() == &region;
+    };
+    auto forget = [&forgotten](auto &types, auto &&anyReleased) {
+        auto size = forgotten.size();
+        for (auto it = types.begin(); it != types.end();) {
+            if (anyReleased(it->first)) {
+                forgotten.insert(it->second);
+                it = types.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        return forgotten.size() > size;
+    };
+    for (bool changed = true; changed;) {
+        changed = forget(typeTable.tuples, [&](auto &&types) {
+            return any_of(types.begin(), types.end(), isReleased);
+        });
+        changed |= forget(typeTable.lists, isReleased);
+        changed |= forget(typeTable.functions, [&](auto &&overloads) {
+            return any_of(overloads.begin(), overloads.end(),
+                          [&](auto &&overload) {
+                              return isReleased(overload.first)
+                                     || isReleased(overload.second);
+                          });
+        });
+        changed |= forget(typeTable.records, [&](auto &&record) {
+            return any_of(record.fields.begin(), record.fields.end(),
+                          [&](auto &&field) {
+                              return isReleased(field.type);
+                          });
+        });
+    }
 }
 
-IntType::IntType()
-        : Type(llvm::Type::getInt32Ty(getLLVMContext())) {
+unsigned Type::beginWalk() {
+    static atomic<unsigned> walks;
+    auto walk = ++walks;
+    // no type is marked by walk 0.
+    return walk ? walk : ++walks;
+}
 
+bool Type::mark(unsigned walk) const {
+    if (_walk.load(memory_order_relaxed) == walk) {
+        return false;
+    }
+    _walk.store(walk, memory_order_relaxed);
+    return true;
 }
 
+IntType::IntType() = default;
+
 IntType *IntType::create() {
     static IntType intType;
     return &intType;
@@ -104,9 +486,7 @@ ostream &IntType::print(std::ostream &o) const {
     return o << "int";
 }
 
-RealType::RealType() : Type(llvm::Type::getFloatTy(getLLVMContext())) {
-
-}
+RealType::RealType() = default;
 
 RealType *RealType::create() {
     static RealType realType;
@@ -122,16 +502,14 @@ ostream &RealType::print(std::ostream &o) const {
 }
 
 TupleType::TupleType(const std::vector<Type *> &types)
-        : Type(nullptr), _types(types) {
-    for (int i = 0; i < types.size(); i++) {
-        TupleType::temTypes.push_back(types[i]->getLLVMType());
-    }
-    llvm::ArrayRef temArrayRef = llvm::ArrayRef(temTypes);
-    this->_llvmType = llvm::StructType::get(getLLVMContext(), temArrayRef);
+        : _types(types) {
+
 }
 
 TupleType *TupleType::create(const std::vector<Type *> &types) {
-    return new TupleType(types);
+    return intern(typeTable.tuples, vector<Type *>(types), [](auto &&types) {
+        return finalized(new TupleType(types));
+    });
 }
 
 const std::vector<Type *> &TupleType::getTypes() const {
@@ -151,8 +529,13 @@ ostream &TupleType::print(std::ostream &o) const {
     return o;
 }
 
-SymbolTable::SymbolTable() {
-    initBuiltinSymbols();
+SymbolTable::SymbolTable() : _environment(getBuiltinEnvironment()) {
+
+}
+
+SymbolTable::SymbolTable(Environment environment)
+        : _environment(std::move(environment)) {
+
 }
 
 SymbolTable::~SymbolTable() = default;
@@ -169,165 +552,227 @@ void SymbolTable::reset() {
     symbolTableInstance = nullptr;
 }
 
+template<typename TValue>
+const TValue *SymbolTable::find(const std::string &name,
+                                const NameMap<TValue> &map) const {
+    auto found = map.find(Name::find(name));
+    ++(found ? _hits : _misses);
+    return found;
+}
+
+template<typename TValue>
+TValue SymbolTable::getFromMap(const std::string &name,
+                               const NameMap<TValue> &map) const {
+    auto found = find(name, map);
+    return found ? *found : nullptr;
+}
+
 void SymbolTable::insertValue(const std::string &name, Value *value) {
-    insertToMap(name, value, _valueMap);
+    unique_lock<shared_mutex> _1{_lock};
+    insertToMap(name, value, _environment.values);
 }
 
 Value *SymbolTable::getValue(const std::string &name) const {
-    return getFromMap<Value *>(name, _valueMap);
+    shared_lock<shared_mutex> _1{_lock};
+    return getFromMap(name, _environment.values);
 }
 
-void SymbolTable::removeValue(const std::string &name) {
-    removeFromMap(name, _valueMap);
+Value *SymbolTable::getBuiltinValue(const std::string &name) const {
+    // the builtin symbols are never changed, thus need no lock.
+    return getFromMap(name, getBuiltinEnvironment().values);
 }
 
-llvm::LLVMContext &SymbolTable::getLLVMContext() {
-    return *(_context ? _context : _context = make_unique<llvm::LLVMContext>());
+void SymbolTable::removeValue(const std::string &name) {
+    unique_lock<shared_mutex> _1{_lock};
+    removeFromMap(name, _environment.values);
 }
 
 Type *SymbolTable::getType(const std::string &name) const {
-    return getFromMap<Type *>(name, _typeMap);
+    shared_lock<shared_mutex> _1{_lock};
+    return getFromMap(name, _environment.types);
 }
 
 void SymbolTable::insertType(const std::string &name, Type *type) {
-    insertToMap(name, type, _typeMap);
+    unique_lock<shared_mutex> _1{_lock};
+    insertToMap(name, type, _environment.types);
 }
 
 void SymbolTable::removeType(const std::string &name) {
-    removeFromMap(name, _typeMap);
-}
-
-void SymbolTable::initBuiltinSymbols() {
-    auto setType = [this](const char *name, Type *type) {
-        _typeMap[name] = type;
-    };
-    setType("int", IntType::create());
-    setType("real", RealType::create());
-    setType("string", StringType::create());
-    setType("unit", UnitType::create());
-    setType("bool", BoolType::create());
-    setType("char", CharType::create());
-
-    // FIXME: pattern and value maps are duplicated.
-    setOperator("*", {Operator::INFIX, 7});
-    setOperator("/", {Operator::INFIX, 7});
-    setOperator("div", {Operator::INFIX, 7});
-    setOperator("mod", {Operator::INFIX, 7});
-    setOperator("+", {Operator::INFIX, 6});
-    setOperator("-", {Operator::INFIX, 6});
-    setOperator("^", {Operator::INFIX, 6});
-    setOperator("=", {Operator::INFIX, 4});
-    setOperator("<>", {Operator::INFIX, 4});
-    setOperator(">=", {Operator::INFIX, 4});
-    setOperator("<=", {Operator::INFIX, 4});
-    setOperator(">", {Operator::INFIX, 4});
-    setOperator("<", {Operator::INFIX, 4});
-
-    // TODO: init builtin operators & functions
-    auto setValue = [this](const char *name, Value *value) {
-        _valueMap[name] = value;
-    };
-
-    // infix operators' priority:
-    // infix 7 * / div mod
-    // infix 6 + - ^
-    // infixr 5 :: @
-    // infix 4 = <> > >= < <=
-    // infix 3 := o
-    // infix 0 before
-
-    // the string concat operator
-    setValue("^", []() {
-        auto res = FunctionValue::create(
-                StringType::create(),
-                TupleType::create(
-                        {StringType::create(), StringType::create()}),
-                /*TODO: string concat fptr*/ nullptr);
-        res->setPriority(6);
-        res->setOperationType(FunctionValue::INFIX);
-        return res;
-    }());
-
-    // the list concat operator
-    setValue("@", []() {
-        auto aListType = ListType::create(VariableTypeNameType::create("'a"));
-        auto res = FunctionValue::create(
-                aListType,
-                TupleType::create({aListType, aListType}),
-                /*TODO: list concat fptr*/ nullptr);
-        res->setPriority(5);
-        res->setOperationType(FunctionValue::INFIXR);
-        return res;
-    }());
-
-    // TODO: + * - is overridden, how to?
-
-    // for reals' and ints' + * operation.
-    auto setValueSimpleArithmetic = [&setValue](const char *op, int pri) {
-        setValue(op, [pri]() {
-            auto intType = IntType::create();
-            auto intAdd = FunctionType::create(
-                    intType,
-                    TupleType::create({intType, intType}));
-            auto realType = RealType::create();
-            auto realAdd = FunctionType::create(
-                    realType,
-                    TupleType::create({realType, realType}));
-            auto res = FunctionValue::create(
-                    {{intAdd, /*TODO: int add impl*/  nullptr},
-                     {realAdd, /*TODO: real add impl*/nullptr}});
-            res->setOperationType(FunctionValue::OperationType::INFIX);
-            res->setPriority(pri);
-            return res;
-        }());
-    };
-    setValueSimpleArithmetic("+", 6);
-    setValueSimpleArithmetic("-", 6);
-    setValueSimpleArithmetic("*", 7);
-
-    // for int's and real's negation
-    setValue("~", []() {
-        auto intType = IntType::create();
-        auto realType = RealType::create();
-        auto intNeg = FunctionType::create(
-                intType,
-                TupleType::create({intType}));
-        auto realNeg = FunctionType::create(
-                realType,
-                TupleType::create({realType}));
-        auto res = FunctionValue::create(
-                {{intNeg, /*TODO: int neg impl*/  nullptr},
-                 {realNeg, /*TODO: real neg impl*/nullptr}}
-        );
-        return res;
-    }());
+    unique_lock<shared_mutex> _1{_lock};
+    removeFromMap(name, _environment.types);
+}
+
+const SymbolTable::Environment &SymbolTable::getBuiltinEnvironment() {
+    // the symbols are allocated in the region of the process, as the tables
+    // of all the sessions share them.
+    static const Environment builtins = [] {
+        Region::Scope _1{Region::getProcess()};
+        Environment environment;
+        for (auto &&[name, typeId] : Builtins::types) {
+            environment.types.insert(Name::intern(name),
+                                     Builtins::createType(typeId));
+        }
+        // FIXME: pattern and value maps are duplicated.
+        for (auto &&[name, anOperator] : Builtins::operators) {
+            environment.operators.insert(Name::intern(name), anOperator);
+        }
+        for (auto &&function : Builtins::functions) {
+            environment.values.insert(Name::intern(function.name),
+                                      Builtins::createFunction(function));
+        }
+        return environment;
+    }();
+    return builtins;
 }
 
 void SymbolTable::insertPatternType(const std::string &name, Type *type) {
-    insertToMap(name, type, _patternTypeMap);
+    unique_lock<shared_mutex> _1{_lock};
+    dropInlineFunctions(name);
+    insertToMap(name, type, _environment.patternTypes);
 }
 
 Type *SymbolTable::getPatternType(const std::string &name) const {
-    return getFromMap<Type *>(name, _patternTypeMap);
+    shared_lock<shared_mutex> _1{_lock};
+    return getFromMap(name, _environment.patternTypes);
 }
 
 void SymbolTable::removePatternType(const std::string &name) {
-    removeFromMap(name, _patternTypeMap);
+    unique_lock<shared_mutex> _1{_lock};
+    dropInlineFunctions(name);
+    removeFromMap(name, _environment.patternTypes);
+}
+
+void SymbolTable::insertInlineFunction(const std::string &name,
+                                       InlineFunction function) {
+    unique_lock<shared_mutex> _1{_lock};
+    auto &&inlineUsers = _environment.inlineUsers;
+    for (auto &&freeName : function.freeNames) {
+        auto key = Name::intern(freeName);
+        auto found = inlineUsers.find(key);
+        auto users = found ? *found : vector<string>();
+        users.push_back(name);
+        inlineUsers.insert(key, std::move(users));
+    }
+    // the function is shared, so that it is not copied with the paths.
+    insertToMap(name, make_shared<const InlineFunction>(std::move(function)),
+                _environment.inlineFunctions);
+}
+
+const SymbolTable::InlineFunction *
+SymbolTable::getInlineFunction(const std::string &name) const {
+    shared_lock<shared_mutex> _1{_lock};
+    return getFromMap(name, _environment.inlineFunctions).get();
+}
+
+void SymbolTable::dropInlineFunctions(const std::string &name) {
+    auto &&inlineFunctions = _environment.inlineFunctions;
+    auto key = Name::find(name);
+    inlineFunctions.erase(key);
+    auto users = _environment.inlineUsers.find(key);
+    if (!users) {
+        return;
+    }
+    // a user may be inserted again since, with a body not using the name.
+    for (auto &&user : *users) {
+        auto userKey = Name::find(user);
+        auto function = inlineFunctions.find(userKey);
+        if (function && (*function)->freeNames.count(name)) {
+            inlineFunctions.erase(userKey);
+        }
+    }
+    _environment.inlineUsers.erase(key);
 }
 
 void SymbolTable::setOperator(const std::string &name,
                               SymbolTable::Operator anOperator) {
-    _operatorMap[name] = anOperator;
+    unique_lock<shared_mutex> _1{_lock};
+    insertToMap(name, anOperator, _environment.operators);
 }
 
 const SymbolTable::Operator *
 SymbolTable::getOperator(const std::string &name) const {
-    return _operatorMap.count(name) ?
-           &_operatorMap.find(name)->second : nullptr;
+    shared_lock<shared_mutex> _1{_lock};
+    return find(name, _environment.operators);
 }
 
-void SymbolTable::setTempValueMap(const unordered_map<std::string, std::string> &tempValueMap) {
-    _tempValueMap = tempValueMap;
+void SymbolTable::enterScope() {
+    unique_lock<shared_mutex> _1{_lock};
+    _outerEnvironments.push_back(_environment);
+}
+
+void SymbolTable::leaveScope() {
+    unique_lock<shared_mutex> _1{_lock};
+    if (_outerEnvironments.empty()) {
+        return;
+    }
+    // the functions to inline dropped in the scope are not restored.
+    auto &&outer = _outerEnvironments.back();
+    _environment.values = std::move(outer.values);
+    _environment.types = std::move(outer.types);
+    _environment.patternTypes = std::move(outer.patternTypes);
+    _environment.operators = std::move(outer.operators);
+    _outerEnvironments.pop_back();
+}
+
+SymbolTable::LookupStatistics SymbolTable::getLookupStatistics() const {
+    return {_hits.load(), _misses.load()};
+}
+
+unique_ptr<SymbolTable> SymbolTable::fork() const {
+    shared_lock<shared_mutex> _1{_lock};
+    return unique_ptr<SymbolTable>(new SymbolTable(_environment));
+}
+
+SymbolTable::ScopeGuard::ScopeGuard(SymbolTable *symbolTable)
+        : _symbolTable(symbolTable) {
+    _symbolTable->enterScope();
+}
+
+SymbolTable::ScopeGuard::~ScopeGuard() {
+    _symbolTable->leaveScope();
+}
+
+namespace {
+    /**
+     * The primitives of the overloads of the builtin arithmetic operators,
+     * by the operator and the type id of the operands, i.e. int or real.
+     */
+    constexpr Primitive arithmeticOverloads[SymbolTable::NOT_ARITHMETIC][2] = {
+            {Primitive::INT_ADD, Primitive::REAL_ADD},
+            {Primitive::INT_SUB, Primitive::REAL_SUB},
+            {Primitive::INT_MUL, Primitive::REAL_MUL},
+            {Primitive::INT_NEG, Primitive::REAL_NEG},
+    };
+
+    static_assert(Type::INT == 0 && Type::REAL == 1,
+                  "the overloads are indexed by the type id of the operands");
+}
+
+SymbolTable::ArithmeticOperator
+SymbolTable::getArithmeticOperator(const std::string &name) {
+    if (name.size() != 1) {
+        return NOT_ARITHMETIC;
+    }
+    switch (name[0]) {
+        case '+':
+            return ADD;
+        case '-':
+            return SUB;
+        case '*':
+            return MUL;
+        case '~':
+            return NEG;
+        default:
+            return NOT_ARITHMETIC;
+    }
+}
+
+Primitive SymbolTable::resolveArithmetic(ArithmeticOperator op,
+                                         Type::TypeId operand) {
+    if (op >= NOT_ARITHMETIC || operand > Type::REAL) {
+        return Primitive::NONE;
+    }
+    return arithmeticOverloads[op][operand];
 }
 
 Value::Value(Type *type, llvm::Value *llvmValue)
@@ -394,14 +839,12 @@ int IntValue::get() const {
 
 }
 
-IntValue::IntValue(int v) : Value(
-        IntType::create(),
-        llvm::ConstantInt::get(llvm::Type::getInt32Ty(getLLVMContext()), v)) {
+IntValue::IntValue(int v) : Value(IntType::create(), nullptr) {
 
 }
 
 FunctionValue *FunctionValue::create(Type *retTy, Type *paramTy, void *fptr) {
-    return new FunctionValue(retTy, paramTy, fptr);
+    return finalized(new FunctionValue(retTy, paramTy, fptr));
 }
 
 int FunctionValue::getPriority() const {
@@ -431,7 +874,7 @@ FunctionValue::FunctionValue(FunctionType *funTy, void *fptr)
 }
 
 FunctionValue *FunctionValue::create(FunctionType *funTy, void *fptr) {
-    return new FunctionValue(funTy, fptr);
+    return finalized(new FunctionValue(funTy, fptr));
 }
 
 bool FunctionValue::isOverloaded() const {
@@ -455,28 +898,35 @@ FunctionValue::FunctionValue(
 
 FunctionValue *FunctionValue::create(
         std::vector<std::pair<FunctionType *, void *>> values) {
-    return new FunctionValue(std::move(values));
+    return finalized(new FunctionValue(std::move(values)));
 }
 
 const vector<std::pair<FunctionType *, void *>> &FunctionValue::get() const {
     return _values;
 }
 
-RecordValue *RecordValue::create(std::map<std::string, Value *> record) {
-    return nullptr;
+RecordValue *RecordValue::create(RecordType *type,
+                                 std::vector<Value *> values) {
+    return finalized(new RecordValue(type, std::move(values)));
 }
 
-const std::map<std::string, Value *> &RecordValue::get() const {
+const std::vector<Value *> &RecordValue::get() const {
+    return _values;
+}
 
+Value *RecordValue::get(RecordType::Label label) const {
+    auto offset = getType()->toRecordType()->getFieldOffset(label);
+    return offset < 0 || size_t(offset) >= _values.size() ? nullptr
+                                                           : _values[offset];
 }
 
-RecordValue::RecordValue(std::map<std::string, Value *> record)
-        : Value(RecordType::create({}), nullptr) {
+RecordValue::RecordValue(RecordType *type, std::vector<Value *> values)
+        : Value(type, nullptr), _values(std::move(values)) {
 
 }
 
 ListValue *ListValue::create(std::vector<Value *> values) {
-    return new ListValue(std::move(values));
+    return finalized(new ListValue(std::move(values)));
 }
 
 const std::vector<Value *> &ListValue::get() const {
@@ -504,7 +954,7 @@ UnitValue::UnitValue() : Value(UnitType::create(), nullptr) {
 }
 
 TupleValue *TupleValue::create(std::vector<Value *> values) {
-    return new TupleValue(std::move(values));
+    return finalized(new TupleValue(std::move(values)));
 }
 
 const std::vector<Value *> &TupleValue::get() const {
@@ -542,7 +992,7 @@ CharValue::CharValue(char c) : Value(CharType::create(), nullptr) {
 }
 
 StringValue *StringValue::create(std::string str) {
-    return new StringValue(std::move(str));
+    return finalized(new StringValue(std::move(str)));
 }
 
 const std::string &StringValue::get() const {
@@ -567,7 +1017,7 @@ RealValue::RealValue(double v) : Value(RealType::create(), nullptr) {
 }
 
 TypeNameType *TypeNameType::create(Type *aliasAs) {
-    return new TypeNameType(aliasAs);
+    return finalized(new TypeNameType(aliasAs));
 }
 
 TypeNameType::TypeNameType(Type *aliasAs)
@@ -592,7 +1042,7 @@ ostream &TypeNameType::print(std::ostream &o) const {
 }
 
 FunctionType *FunctionType::create(Type *ret, Type *param) {
-    return new FunctionType(ret, param);
+    return create({{ret, param}});
 }
 
 Type *FunctionType::getParameterType(size_t idx) const {
@@ -603,17 +1053,14 @@ Type *FunctionType::getReturnType(size_t idx) const {
     return _types.at(idx).first;
 }
 
-FunctionType::FunctionType(Type *ret, Type *param)
-        : _types({{ret, param}}) {
-
-}
-
 Type::TypeId FunctionType::getTypeId() const {
     return FUNCTION;
 }
 
 FunctionType *FunctionType::create(std::vector<std::pair<Type *, Type *>> tys) {
-    return new FunctionType(std::move(tys));
+    return intern(typeTable.functions, std::move(tys), [](auto &&tys) {
+        return finalized(new FunctionType(tys));
+    });
 }
 
 FunctionType::FunctionType(std::vector<std::pair<Type *, Type *>> tys)
@@ -640,15 +1087,59 @@ ostream &FunctionType::print(std::ostream &o) const {
     return o;
 }
 
-RecordType *RecordType::create(std::map<std::string, Type *> record) {
-    return new RecordType(std::move(record));
+RecordType::Label RecordType::getLabel(const std::string &name) {
+    lock_guard<mutex> _1{labelTable.lock};
+    return &*labelTable.labels.insert(name).first;
+}
+
+RecordType *RecordType::create(const std::map<std::string, Type *> &record) {
+    vector<Field> fields;
+    fields.reserve(record.size());
+    for (auto &&[name, type] : record) {
+        fields.push_back({getLabel(name), type});
+    }
+    return create(std::move(fields));
+}
+
+RecordType *RecordType::create(std::vector<Field> fields) {
+    auto byLabel = [](const Field &lhs, const Field &rhs) {
+        return *lhs.label < *rhs.label;
+    };
+    if (!is_sorted(fields.begin(), fields.end(), byLabel)) {
+        sort(fields.begin(), fields.end(), byLabel);
+    }
+    auto hash = TypeStructureHash()(fields);
+    return intern(typeTable.records, RecordStructure{std::move(fields), hash},
+                  [](auto &&record) {
+                      return finalized(
+                              new RecordType(record.fields, record.hash));
+                  });
+}
+
+const std::vector<RecordType::Field> &RecordType::getFields() const {
+    return _fields;
+}
+
+int RecordType::getFieldOffset(Label label) const {
+    for (size_t i = 0; i < _fields.size(); ++i) {
+        if (_fields[i].label == label) {
+            return int(i);
+        }
+    }
+    return -1;
 }
 
-const std::map<std::string, Type *> &RecordType::getRecordEntries() const {
+Type *RecordType::getFieldType(Label label) const {
+    auto offset = getFieldOffset(label);
+    return offset < 0 ? nullptr : _fields[offset].type;
+}
 
+size_t RecordType::getHash() const {
+    return _hash;
 }
 
-RecordType::RecordType(std::map<std::string, Type *> record) {
+RecordType::RecordType(std::vector<Field> fields, size_t hash)
+        : _fields(std::move(fields)), _hash(hash) {
 
 }
 
@@ -656,8 +1147,20 @@ Type::TypeId RecordType::getTypeId() const {
     return RECORD;
 }
 
+ostream &RecordType::print(std::ostream &o) const {
+    o << '{';
+    for (size_t i = 0; i < _fields.size(); ++i) {
+        o << (i ? ", " : "") << *_fields[i].label << ": ";
+        _fields[i].type->print(o);
+    }
+    o << '}';
+    return o;
+}
+
 ListType *ListType::create(Type *subtype) {
-    return new ListType(subtype);
+    return intern(typeTable.lists, std::move(subtype), [](auto &&subtype) {
+        return new ListType(subtype);
+    });
 }
 
 Type *ListType::getSubtype() const {
@@ -741,7 +1244,7 @@ Type::TypeId VariableTypeNameType::getTypeId() const {
 }
 
 VariableTypeNameType *VariableTypeNameType::create(std::string var) {
-    return new VariableTypeNameType(std::move(var));
+    return finalized(new VariableTypeNameType(std::move(var)));
 }
 
 VariableTypeNameType::VariableTypeNameType(std::string var)
@@ -749,8 +1252,73 @@ VariableTypeNameType::VariableTypeNameType(std::string var)
 
 }
 
-const string &VariableTypeNameType::getVar() const {
-    return _var;
+VariableTypeNameType::VariableTypeNameType(unsigned number)
+        : _number(number) {
+
+}
+
+string VariableTypeNameType::getName(unsigned number) {
+    // a bijective base-26 numeral, so that 'z is followed by 'aa.
+    string name;
+    do {
+        name += char('a' + number % 26);
+        number /= 26;
+    } while (number-- > 0);
+    name += '\'';
+    return {name.rbegin(), name.rend()};
+}
+
+string VariableTypeNameType::getVar() const {
+    return isNamed() ? _var : getName(_number);
+}
+
+bool VariableTypeNameType::isNamed() const {
+    return !_var.empty();
+}
+
+VariableTypeNameType *VariableTypeNameType::Pool::create() {
+    if (_next == _end) {
+        // the chunks grow with the check, from a few variables.
+        auto chunkSize = _chunkSize ? min<size_t>(_chunkSize * 2, 1024) : 16;
+        auto chunk = static_cast<VariableTypeNameType *>(
+                Region::getCurrent().allocate(
+                        chunkSize * sizeof(VariableTypeNameType)));
+        if (!chunk) {
+            return nullptr;
+        }
+        _chunkSize = chunkSize;
+        _next = chunk;
+        _end = _next + _chunkSize;
+    }
+    return ::new(_next++) VariableTypeNameType(_nextNumber++);
+}
+
+Type *VariableTypeNameType::getParent() const {
+    return _parent;
+}
+
+void VariableTypeNameType::setParent(Type *parent) {
+    _parent = parent;
+}
+
+unsigned VariableTypeNameType::getRank() const {
+    return _rank;
+}
+
+void VariableTypeNameType::setRank(unsigned rank) {
+    _rank = rank;
+}
+
+unsigned VariableTypeNameType::getLevel() const {
+    return _level;
+}
+
+void VariableTypeNameType::setLevel(unsigned level) {
+    _level = level;
+}
+
+bool VariableTypeNameType::isGeneric() const {
+    return _level == GENERIC_LEVEL;
 }
 
 ostream &VariableTypeNameType::print(std::ostream &o) const {
@@ -1,10 +1,18 @@
 #pragma once
 
+#include <atomic>
 #include <ostream>
 #include <map>
+#include <memory>
+#include <set>
+#include <shared_mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
+#include "Name.h"
+#include "PersistentMap.h"
+
+class Region;
 
 namespace llvm {
     class Value;
@@ -15,8 +23,12 @@ namespace llvm {
 }
 
 /**
- * Memory cache collector for all classes declared in this header. Any new
- * operator would cache the pointer and ready to be released on clear.
+ * Memory collector for all classes declared in this header. Any new operator
+ * bumps a pointer in the region current to the thread, e.g. the one of the
+ * interpreter session, and the memory is released with the region instead of
+ * by delete. A symbol owning memory out of the region, e.g. a vector, is
+ * destroyed when the region is released, thus is never to be deleted. Each
+ * symbol records the region it is allocated in.
  */
 class MemoryCachedSymbol {
 public:
@@ -26,10 +38,30 @@ public:
 
     virtual void saveDeleteThis() noexcept;
 
+    /**
+     * Release the region current to the thread, with all the symbols
+     * allocated in it.
+     */
     static void clearMemory() noexcept;
 
+    /**
+     * @return The region the symbol is allocated in, in constant time.
+     */
+    [[nodiscard]] Region &getRegion() const noexcept;
+
 protected:
-    MemoryCachedSymbol() noexcept = default;
+    MemoryCachedSymbol() noexcept;
+
+    MemoryCachedSymbol(const MemoryCachedSymbol &) noexcept;
+
+    MemoryCachedSymbol &operator=(const MemoryCachedSymbol &) noexcept;
+
+private:
+    /**
+     * The region operator new allocates the symbol in, or the one of the
+     * process if the symbol is of static storage.
+     */
+    Region *_region;
 };
 
 class Type;
@@ -94,6 +126,49 @@ public:
      */
     static Type *create() { return nullptr; }
 
+    /**
+     * Statistics of the structural types created, i.e. tuples, lists,
+     * functions and records, which are interned so that structurally equal
+     * types are the same pointer.
+     */
+    struct InternStatistics {
+        /**
+         * The number of creations returning an existing type.
+         */
+        size_t hits{};
+
+        /**
+         * The number of types allocated.
+         */
+        size_t misses{};
+    };
+
+    [[nodiscard]] static InternStatistics getInternStatistics();
+
+    /**
+     * Forget the structural types interned with a type allocated in a region
+     * among their children, before the region is released.
+     * @param region The region.
+     */
+    static void clearInterned(const Region &region);
+
+    /**
+     * Start a walk over types, e.g. the occurs check, which visits each type
+     * once by marking it with the number of the walk. No set of the visited
+     * types is needed, and the types shared in a type are visited once.
+     * @return The number of the walk, distinct from the previous ones.
+     */
+    static unsigned beginWalk();
+
+    /**
+     * Mark the type visited by a walk. The types are shared by the checks in
+     * parallel, whose walks may mark a type over each other, which only
+     * visits it again.
+     * @param walk The number of the walk.
+     * @return Whether the type is not visited by the walk before.
+     */
+    bool mark(unsigned walk) const;
+
     virtual std::ostream &print(std::ostream &o) const { return o; }
 
     //region down casts for convenience
@@ -129,21 +204,19 @@ public:
 #undef DOWN_CAST_TO
     //endregion
 
-    [[nodiscard]] llvm::Type *getLLVMType() const;
-
-protected:
     /**
-     * Constructor.
-     *
-     * Subclasses should give a type id for down cast convenience, and a pointer
-     * to a concrete llvm's type.
-     * @param typeId The type id.
-     * @param llvmType The raw LLVM type.
+     * Lower the type in an LLVM context, e.g. the one of the JITModule of a
+     * session, as the types are shared by all the symbol tables.
+     * @param context The context.
+     * @return The LLVM type, or null if the type has no layout yet.
      */
-    explicit Type(llvm::Type *llvmType = nullptr);
+    [[nodiscard]] llvm::Type *getLLVMType(llvm::LLVMContext &context) const;
 
 protected:
-    llvm::Type *_llvmType{};
+    Type() = default;
+
+private:
+    mutable std::atomic<unsigned> _walk{};
 };
 
 class IntType : public Type {
@@ -215,6 +288,12 @@ class TupleType : public Type {
 public:
     [[nodiscard]] TypeId getTypeId() const override;
 
+    /**
+     * Create a tuple type of some types. The same pointer is returned for the
+     * same types, which is never released.
+     * @param types The types of the entries.
+     * @return The canonical tuple type.
+     */
     static TupleType *create(const std::vector<Type *> &types);
 
     [[nodiscard]] const std::vector<Type *> &getTypes() const;
@@ -225,8 +304,6 @@ private:
     explicit TupleType(const std::vector<Type *> &types);
 
     std::vector<Type *> _types;
-
-    std::vector<llvm::Type *> temTypes;
 };
 
 class UnitType : public Type {
@@ -243,6 +320,9 @@ private:
 
 class ListType : public Type {
 public:
+    /**
+     * Create a list type of a subtype. Interned as TupleType::create.
+     */
     static ListType *create(Type *subtype);
 
     [[nodiscard]] Type *getSubtype() const;
@@ -259,20 +339,85 @@ private:
 
 class RecordType : public Type {
 public:
-    static RecordType *create(std::map<std::string, Type *> record);
+    /**
+     * A label interned once, so that the labels are compared by their
+     * pointers.
+     */
+    using Label = const std::string *;
+
+    /**
+     * A labeled type of a record. The fields are sorted by the text of their
+     * labels, thus the offset of a field is its index.
+     */
+    struct Field {
+        Label label;
+        Type *type;
+
+        bool operator==(const Field &rhs) const {
+            return label == rhs.label && type == rhs.type;
+        }
+    };
+
+    /**
+     * Get the interned label of a name, which is never released.
+     */
+    static Label getLabel(const std::string &name);
+
+    /**
+     * Create a record type of some labeled types. Interned as
+     * TupleType::create.
+     */
+    static RecordType *create(const std::map<std::string, Type *> &record);
+
+    /**
+     * Create a record type of some fields of distinct labels, in any order.
+     * Interned as TupleType::create.
+     */
+    static RecordType *create(std::vector<Field> fields);
+
+    /**
+     * @return The fields, sorted by their labels.
+     */
+    [[nodiscard]] const std::vector<Field> &getFields() const;
+
+    /**
+     * @return The offset of the field of a label, or -1 if none.
+     */
+    [[nodiscard]] int getFieldOffset(Label label) const;
+
+    /**
+     * @return The type of the field of a label, or null if none.
+     */
+    [[nodiscard]] Type *getFieldType(Label label) const;
 
-    [[nodiscard]] const std::map<std::string, Type *> &getRecordEntries() const;
+    /**
+     * @return The structural hash of the fields, computed once on creation.
+     */
+    [[nodiscard]] size_t getHash() const;
 
     [[nodiscard]] TypeId getTypeId() const override;
 
+    std::ostream &print(std::ostream &o) const override;
+
 private:
-    explicit RecordType(std::map<std::string, Type *> record);
+    RecordType(std::vector<Field> fields, size_t hash);
+
+    std::vector<Field> _fields;
+    size_t _hash;
 };
 
 class FunctionType : public Type {
 public:
+    /**
+     * Create a function type. Interned as TupleType::create.
+     */
     static FunctionType *create(Type *ret, Type *param);
 
+    /**
+     * Create an overloaded function type. Interned as TupleType::create, the
+     * order of the overloads matters.
+     * @param tys The return and parameter types of each overload.
+     */
     static FunctionType *create(std::vector<std::pair<Type *, Type *>> tys);
 
     [[nodiscard]] Type *getParameterType(size_t idx = 0) const;
@@ -291,8 +436,6 @@ public:
     std::ostream &print(std::ostream &o) const override;
 
 private:
-    FunctionType(Type *ret, Type *param);
-
     explicit FunctionType(std::vector<std::pair<Type *, Type *>> tys);
 
     std::vector<std::pair<Type *, Type *>> _types;
@@ -334,26 +477,117 @@ private:
 /**
  * Variable type name.
  *
- * A variable type name consists only the literal name, like 'a.
+ * A variable type name consists only the literal name, like 'a, or a number
+ * if it is created by a type check, which is named on printing.
  */
 class VariableTypeNameType : public Type {
 public:
+    /**
+     * The level of a generalized variable, which is instantiated by a fresh
+     * variable on each use.
+     */
+    static constexpr unsigned GENERIC_LEVEL = ~0u;
+
+    /**
+     * Creates the numbered variables of a type check, allocated in chunks
+     * instead of one by one. The chunks are allocated in the region current
+     * to the thread and released with it, not with the pool, as the types
+     * bound by the check may still refer the variables. A numbered variable
+     * owns no memory, thus needs no finalizer.
+     */
+    class Pool {
+    public:
+        /**
+         * Create a variable numbered after the last one created by the pool.
+         * @return The new variable, which is generalized, or null if out of
+         * memory.
+         */
+        VariableTypeNameType *create();
+
+    private:
+        VariableTypeNameType *_next{};
+        VariableTypeNameType *_end{};
+        size_t _chunkSize{};
+        unsigned _nextNumber{};
+    };
+
+    /**
+     * Create a type variable. Unlike the structural types, a new variable is
+     * returned on each call, as variables of the same name are distinct
+     * unless unified. The variable is generalized, like those of the
+     * builtins.
+     * @param var The name of the variable.
+     * @return The new variable.
+     */
     static VariableTypeNameType *create(std::string var);
 
+    /**
+     * Get the name of a numbered variable, i.e. 'a, 'b, ..., 'z, 'aa, 'ab and
+     * so on.
+     * @param number The number.
+     * @return The name.
+     */
+    static std::string getName(unsigned number);
+
     [[nodiscard]] TypeId getTypeId() const override;
 
     /**
      * Get the variable name's literal.
-     * @return The variable name.
+     * @return The variable name, or the name of its number if it is created
+     * by a pool.
+     */
+    [[nodiscard]] std::string getVar() const;
+
+    /**
+     * @return Whether the variable is created with a name, or by a pool.
+     */
+    [[nodiscard]] bool isNamed() const;
+
+    /**
+     * Get the type the variable is unified with, i.e. its parent in the
+     * union-find forest of the running type check.
+     * @return The parent, or null if the variable is a representative.
+     */
+    [[nodiscard]] Type *getParent() const;
+
+    void setParent(Type *parent);
+
+    /**
+     * Get the upper bound of the height of the variables unified with the
+     * variable, when it is a representative.
+     * @return The rank.
+     */
+    [[nodiscard]] unsigned getRank() const;
+
+    void setRank(unsigned rank);
+
+    /**
+     * Get the number of the declarations enclosing where the variable is
+     * bound, which is lowered once it is unified with a type bound outer.
+     * @return The level, or GENERIC_LEVEL if the variable is generalized.
      */
-    [[nodiscard]] const std::string &getVar() const;
+    [[nodiscard]] unsigned getLevel() const;
+
+    void setLevel(unsigned level);
+
+    [[nodiscard]] bool isGeneric() const;
 
     std::ostream &print(std::ostream &o) const override;
 
 private:
     explicit VariableTypeNameType(std::string var);
 
+    explicit VariableTypeNameType(unsigned number);
+
     std::string _var;
+
+    unsigned _number{};
+
+    Type *_parent{};
+
+    unsigned _rank{};
+
+    unsigned _level = GENERIC_LEVEL;
 };
 
 class Value;
@@ -519,12 +753,24 @@ private:
 
 class RecordValue : public Value {
 public:
-    static RecordValue *create(std::map<std::string, Value *> record = {});
+    /**
+     * Create a record value of a record type.
+     * @param values The values of the fields, in the order of their offsets.
+     */
+    static RecordValue *create(RecordType *type,
+                               std::vector<Value *> values = {});
+
+    [[nodiscard]] const std::vector<Value *> &get() const;
 
-    [[nodiscard]] const std::map<std::string, Value *> &get() const;
+    /**
+     * @return The value of the field of a label, or null if none.
+     */
+    [[nodiscard]] Value *get(RecordType::Label label) const;
 
 private:
-    explicit RecordValue(std::map<std::string, Value *> record);
+    RecordValue(RecordType *type, std::vector<Value *> values);
+
+    std::vector<Value *> _values;
 };
 
 class FunctionValue : public Value {
@@ -601,6 +847,26 @@ private:
     std::vector<std::pair<FunctionType *, void *>> _values;
 };
 
+class ExpAST;
+
+class PatAST;
+
+/**
+ * The primitive operations the overloaded builtin arithmetic operators are
+ * resolved to by the type check, according to the type of their operands.
+ */
+enum class Primitive : unsigned char {
+    NONE, ///< not a builtin arithmetic operator, or not resolved
+    INT_ADD,
+    INT_SUB,
+    INT_MUL,
+    INT_NEG,
+    REAL_ADD,
+    REAL_SUB,
+    REAL_MUL,
+    REAL_NEG,
+};
+
 class VariableTypeNameValue : public Value {
 public:
     static VariableTypeNameValue *create(VariableTypeNameType *t);
@@ -614,12 +880,28 @@ private:
 class SymbolTable {
 public:
     /**
-     * Reset the singleton instance and all symbol caches.
+     * Create a symbol table of the builtin symbols, e.g. for an interpreter.
+     * The symbol tables are independent of each other, and only share the
+     * types and the builtin symbols, which are created once for the process
+     * and never copied. The table holds no LLVM context, the code of a session
+     * being generated in the one of its JITModule.
+     */
+    SymbolTable();
+
+    ~SymbolTable();
+
+    SymbolTable(const SymbolTable &) = delete;
+
+    SymbolTable &operator=(const SymbolTable &) = delete;
+
+    /**
+     * Reset the default instance.
      */
     static void reset();
 
     /**
-     * Get the singleton instance.
+     * Get the default instance, used by the parser, the semantic analyzer
+     * and the code generator not given a symbol table, e.g. in the tests.
      * @return The instance of symbol table.
      */
     static SymbolTable *getInstance();
@@ -652,6 +934,14 @@ public:
     [[deprecated("Use getPatternType instead.")]]
     [[nodiscard]] Value *getValue(const std::string &name) const;
 
+    /**
+     * Return a builtin value, e.g. of an operator, which the declarations
+     * bind again as pattern types, not as values.
+     * @param name The name of value.
+     * @return The pointer of a value, null if not builtin.
+     */
+    [[nodiscard]] Value *getBuiltinValue(const std::string &name) const;
+
     /**
      * Return a type in current scope with a name.
      * @param name The name of type.
@@ -675,6 +965,42 @@ public:
 
     void removePatternType(const std::string &name);
 
+    /**
+     * A small non-recursive function, whose calls could be substituted by its
+     * body.
+     */
+    struct InlineFunction {
+        /**
+         * The patterns of the parameters, each of which is a variable pattern
+         * or a type annotated one.
+         */
+        std::vector<std::shared_ptr<PatAST>> pats;
+
+        std::shared_ptr<ExpAST> body;
+
+        /**
+         * The names used by the body besides the parameters.
+         */
+        std::set<std::string> freeNames;
+    };
+
+    /**
+     * Insert a function to inline with its name. The function is dropped
+     * once its name or any free name of its body is bound to a pattern type
+     * again, as its body would refer to other values then.
+     * @param name The name.
+     * @param function The function.
+     */
+    void insertInlineFunction(const std::string &name, InlineFunction function);
+
+    /**
+     * Return a function to inline with a name.
+     * @param name The name of function.
+     * @return The pointer of the function, null if not recorded or dropped.
+     */
+    [[nodiscard]] const InlineFunction *
+    getInlineFunction(const std::string &name) const;
+
     struct Operator {
         enum OperatorType {
             NONFIX, INFIX, INFIXR
@@ -686,32 +1012,158 @@ public:
 
     const Operator *getOperator(const std::string &name) const;
 
-    void setTempValueMap(const std::unordered_map<std::string, std::string> &tempValueMap);
+    /**
+     * The overloaded builtin arithmetic operators, ~ being the negation.
+     */
+    enum ArithmeticOperator {
+        ADD,
+        SUB,
+        MUL,
+        NEG,
+        NOT_ARITHMETIC,
+    };
+
+    /**
+     * Get the builtin arithmetic operator of a name, without hashing it.
+     * @param name The name.
+     * @return The operator, or NOT_ARITHMETIC if the name is none of + - * ~.
+     */
+    static ArithmeticOperator getArithmeticOperator(const std::string &name);
+
+    /**
+     * Resolve an overload of a builtin arithmetic operator in constant time,
+     * by a table of the int and real overloads keyed by the operator and the
+     * type id of the operands.
+     * @param op The operator.
+     * @param operand The type id of the operands.
+     * @return The primitive operation, or NONE if no overload takes operands
+     * of the type.
+     */
+    static Primitive resolveArithmetic(ArithmeticOperator op,
+                                       Type::TypeId operand);
+
+    /**
+     * Enter a scope, e.g. of a let expression. The values, types, pattern
+     * types and operators bound in it shadow the outer ones until the scope
+     * is left, which restores the outer ones exactly. The functions to inline
+     * dropped in it are not restored.
+     */
+    void enterScope();
+
+    /**
+     * Leave the innermost scope, in constant time.
+     */
+    void leaveScope();
+
+    /**
+     * Enters a scope of the symbol table for its lifetime.
+     */
+    struct ScopeGuard {
+        explicit ScopeGuard(SymbolTable *symbolTable);
+
+        ~ScopeGuard();
+
+        ScopeGuard(const ScopeGuard &) = delete;
+
+        ScopeGuard &operator=(const ScopeGuard &) = delete;
+
+    private:
+        SymbolTable *_symbolTable;
+    };
+
+    /**
+     * Fork a symbol table of the symbols bound in the innermost scope, e.g.
+     * of a library loaded once for many sessions, in constant time. The
+     * table and its forks share their symbols until either binds a name
+     * again, which copies only the path of the name in the maps.
+     *
+     * The fork refers to the values and the types of the table, which are to
+     * outlive it. Like the table, it holds no LLVM context, the code of its
+     * session being generated in the one of the JITModule of the session.
+     * The table and its forks are not to be checked in parallel, as the
+     * checks unify the variables of the types they share.
+     * @return The fork.
+     */
+    [[nodiscard]] std::unique_ptr<SymbolTable> fork() const;
 
-    llvm::LLVMContext &getLLVMContext();
+    /**
+     * The lookups of names in the table which find a symbol and which do
+     * not, e.g. for profiling.
+     */
+    struct LookupStatistics {
+        size_t hits;
+        size_t misses;
+    };
+
+    [[nodiscard]] LookupStatistics getLookupStatistics() const;
 
 private:
-    SymbolTable();
+    /**
+     * A map of names, keyed by their interned ids, so that a lookup compares
+     * numbers instead of strings, and a name never bound misses without
+     * probing.
+     */
+    template<typename TValue>
+    using NameMap = PersistentMap<Name, TValue, Name::Hash>;
 
-    ~SymbolTable();
+    /**
+     * Find a name in a map, counting the lookup.
+     * @return The value bound, or null if none.
+     */
+    template<typename TValue>
+    const TValue *find(const std::string &name,
+                       const NameMap<TValue> &map) const;
+
+    template<typename TValue>
+    TValue getFromMap(const std::string &name,
+                      const NameMap<TValue> &map) const;
+
+    void dropInlineFunctions(const std::string &name);
 
-    void initBuiltinSymbols();
+    /**
+     * Guards the maps of values, types, pattern types and inline functions,
+     * which are read by checks in parallel.
+     */
+    mutable std::shared_mutex _lock;
+
+    /**
+     * The symbols of a scope, shared with the outer scopes and the forks.
+     */
+    struct Environment {
+        NameMap<Value *> values;
+
+        NameMap<Type *> types;
 
-    std::unordered_map<std::string, Value *> _valueMap;
+        NameMap<Type *> patternTypes;
 
-    std::unordered_map<std::string, Type *> _typeMap;
+        NameMap<Operator> operators;
 
-    std::unordered_map<std::string, Type *> _patternTypeMap;
+        NameMap<std::shared_ptr<const InlineFunction>> inlineFunctions;
 
-    std::unordered_map<std::string, Operator> _operatorMap;
+        /**
+         * The names of inline functions using each name.
+         */
+        NameMap<std::vector<std::string>> inlineUsers;
+    };
+
+    explicit SymbolTable(Environment environment);
 
-    std::unordered_map<std::string,std::string> _tempValueMap; //比如在let中声明的val a  = 1;存个名字就可以
+    /**
+     * Get the builtin symbols, created once for the process from constant
+     * tables and shared by all the tables.
+     */
+    static const Environment &getBuiltinEnvironment();
 
-    std::unordered_map<std::string, Operator> _tempFunMap; // 存名字、结合性、优先级
+    Environment _environment;
 
+    /**
+     * The environments of the outer scopes when the inner ones are entered.
+     */
+    std::vector<Environment> _outerEnvironments;
 
+    mutable std::atomic<size_t> _hits{};
 
-    std::unique_ptr<llvm::LLVMContext> _context;
+    mutable std::atomic<size_t> _misses{};
 };
 
 std::ostream &operator<<(std::ostream &o, Type const &type);
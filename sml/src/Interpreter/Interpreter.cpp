@@ -1,12 +1,63 @@
+#include <memory>
+#include <string>
+#include "AST/AST.h"
 #include "CodeGenerator.h"
 #include "Interpreter.h"
 #include "JIT.h"
+#include "JITModule/JITModule.h"
 #include "Parser.h"
 #include "Scanner.h"
 #include "SemanticAnalyzer.h"
+#include "Symbol/Region.h"
 #include "Symbol/SymbolTable.h"
 
+namespace {
+    /**
+     * Get the constant a top-level value declaration binds a name to, once
+     * folded by the semantic analyzer, e.g. val x = 3 * 4 + 1.
+     * @param name Set to the name bound.
+     * @return The constant, or null if the ast is no such declaration.
+     */
+    std::shared_ptr<ConstantExpAST>
+    getBoundConstant(const std::shared_ptr<AST> &ast, std::string &name) {
+        auto dec = AST::dynCast<ValueDecAST>(ast);
+        auto valBind = dec ? AST::dynCast<DestructuringValBindAST>(
+                dec->getValBind()) : nullptr;
+        if (!valBind || valBind->getAndValBind()) {
+            return nullptr;
+        }
+        auto constant = AST::dynCast<ConstantExpAST>(valBind->getExp());
+        auto pat = valBind->getPat();
+        if (auto annotation = AST::dynCast<TypeAnnotationPatAST>(pat)) {
+            pat = annotation->getPat();
+        }
+        auto construction = AST::dynCast<ConstructionPatAST>(pat);
+        if (!constant || !construction
+            || construction->getLongId()->getIds().size() != 1) {
+            return nullptr;
+        }
+        name = construction->getLongId()->getIds()[0]->get();
+        return constant;
+    }
+}
+
 struct Interpreter::Impl {
+    /**
+     * The region of the session, released after all the others.
+     */
+    Region region;
+
+    /**
+     * The symbol table of the session, with the builtin symbols allocated in
+     * its region.
+     */
+    std::unique_ptr<SymbolTable> symbolTable;
+
+    /**
+     * The code generated by the session, shared by its code generator and
+     * its JIT.
+     */
+    std::unique_ptr<JITModule> jitModule;
     Interpreter *const interpreter;
     Scanner scanner;
     Parser parser;
@@ -14,15 +65,32 @@ struct Interpreter::Impl {
     CodeGenerator codeGenerator;
     JIT jit;
 
-    explicit Impl(Interpreter *interp, std::istream &in) :
+    explicit Impl(Interpreter *interp, std::istream &in,
+                  const Impl *base = nullptr) :
+            symbolTable(createSymbolTable(
+                    region, base ? base->symbolTable.get() : nullptr)),
+            jitModule(base ? base->jitModule->fork()
+                           : std::make_unique<JITModule>()),
             interpreter(interp),
             scanner(in),
-            parser(interp),
-            semanticAnalyzer(),
-            codeGenerator(),
-            jit() {
+            parser(interp, symbolTable.get()),
+            semanticAnalyzer(symbolTable.get()),
+            codeGenerator(symbolTable.get(), jitModule.get()),
+            jit(symbolTable.get(), jitModule.get()) {
 
     }
+
+    ~Impl() {
+        // the types shared with the other sessions are not to refer to the
+        // symbols of the session once the region is released.
+        Type::clearInterned(region);
+    }
+
+    static std::unique_ptr<SymbolTable>
+    createSymbolTable(Region &region, const SymbolTable *base) {
+        Region::Scope _1{region};
+        return base ? base->fork() : std::make_unique<SymbolTable>();
+    }
 };
 
 Interpreter::Interpreter(std::istream &in)
@@ -30,20 +98,44 @@ Interpreter::Interpreter(std::istream &in)
 
 }
 
+Interpreter::Interpreter(std::istream &in, const Interpreter &base)
+        : _impl(std::make_unique<Impl>(this, in, base._impl.get())) {
+
+}
+
 Interpreter::Interpreter() = default;
 
 Interpreter::~Interpreter() = default;
 
 void Interpreter::interpret() {
+    Region::Scope _1{_impl->region};
     while (!eof()) {
         checkAndRun(getParser()->parse(), true);
     }
-    SymbolTable::reset();
 }
 
 void Interpreter::checkAndRun(const std::shared_ptr<AST> &ast, bool output) {
     if (auto &&sem = getSemanticAnalyzer()) {
         if (auto &&ast1 = sem->check(ast)) {
+            // a top-level expression folded into a constant needs no code.
+            if (auto constant = AST::dynCast<ConstantExpAST>(ast1)) {
+                if (auto &&jit = getJIT()) {
+                    jit->run(constant);
+                }
+                return;
+            }
+            // nor does a value bound to one, which is only to be bound for
+            // the code generated after.
+            std::string name;
+            if (auto constant = getBoundConstant(ast1, name)) {
+                if (auto &&codegen = getCodeGenerator()) {
+                    codegen->bind(name, constant);
+                }
+                if (auto &&jit = getJIT()) {
+                    jit->run(constant);
+                }
+                return;
+            }
             if (auto &&codegen = getCodeGenerator()) {
                 auto &&value = (llvm::Function*)codegen->generate(ast1);
                 if (auto &&jit = getJIT()) {
@@ -81,6 +173,14 @@ JIT *Interpreter::getJIT() const {
     return &_impl->jit;
 }
 
+Region &Interpreter::getRegion() const {
+    return _impl->region;
+}
+
+SymbolTable *Interpreter::getSymbolTable() const {
+    return _impl->symbolTable.get();
+}
+
 bool Interpreter::eof() const {
     return _impl->scanner.eof();
 }
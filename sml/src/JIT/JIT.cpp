@@ -1,5 +1,6 @@
 #include <src/Common/AST/ASTProperty.h>
 #include "llvm/IR/Value.h"
+#include "AST/AST.h"
 #include "JIT.h"
 #include "JITModule/JITModule.h"
 #include "KaleidoscopeJIT.h"
@@ -11,14 +12,20 @@
  * 因此我们将编写一个函数来为我们创建和初始化模块和pass manager：
  */
 
+JIT::JIT(SymbolTable *symbolTable, JITModule *jitModule)
+        : _symbolTable(symbolTable ? symbolTable : SymbolTable::getInstance()),
+          _jitModule(jitModule ? jitModule : JITModule::getInstance()) {
+
+}
+
 ///需要创建FunctionAST作为入口
 void JIT::run(llvm::Function* theFun) {
     theFun->print(llvm::errs());
-    auto H = TheJIT->addModule(std::move(TheModule));
-    InitializeModuleAndPassManager();
+    auto H = _jitModule->jit->addModule(std::move(_jitModule->module));
+    _jitModule->initializeModuleAndPassManager();
 
-    if(auto ExprSymbol = TheJIT->findSymbol("__anon_expr")){
-        auto temType = SymbolTable::getInstance()->getPatternType("it");
+    if(auto ExprSymbol = _jitModule->jit->findSymbol("__anon_expr")){
+        auto temType = _symbolTable->getPatternType("it");
         if(temType->getTypeId() == Type::INT){
             int (*FP)() = (int (*)()) (intptr_t) cantFail(ExprSymbol.getAddress());
             fprintf(stderr, "Evaluated to %i\n", FP());
@@ -30,6 +37,34 @@ void JIT::run(llvm::Function* theFun) {
 //        FP =(intptr_t) cantFail(ExprSymbol.getAddress());
 //        fprintf(stderr, "Evaluated to %i\n", FP);
 
-        TheJIT->removeModule(H);
+        _jitModule->jit->removeModule(H);
+    }
+}
+
+void JIT::run(const std::shared_ptr<ConstantExpAST> &exp) {
+    auto &&con = exp->getCon();
+    switch (con->getKind()) {
+        case ASTKind::IntConAST:
+            fprintf(stderr, "Evaluated to %i\n",
+                    AST::cast<IntConAST>(con)->get());
+            break;
+        case ASTKind::FloatConAST:
+            fprintf(stderr, "Evaluated to %f\n",
+                    AST::cast<FloatConAST>(con)->get());
+            break;
+        case ASTKind::BoolConAST:
+            fprintf(stderr, "Evaluated to %s\n",
+                    AST::cast<BoolConAST>(con)->get() ? "true" : "false");
+            break;
+        case ASTKind::CharConAST:
+            fprintf(stderr, "Evaluated to #\"%c\"\n",
+                    AST::cast<CharConAST>(con)->get());
+            break;
+        case ASTKind::StringConAST:
+            fprintf(stderr, "Evaluated to \"%s\"\n",
+                    AST::cast<StringConAST>(con)->get().c_str());
+            break;
+        default:
+            break;
     }
-}
\ No newline at end of file
+}
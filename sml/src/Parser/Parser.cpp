@@ -5,11 +5,14 @@
 #include "Token.h"
 #include <unordered_set>
 
-Parser::Parser(Scanner &scanner) {
+Parser::Parser(Scanner &scanner, SymbolTable *symbolTable)
+        : symbolTable(symbolTable ? symbolTable : SymbolTable::getInstance()) {
 
 }
 
-Parser::Parser(Interpreter *interpreter) : interpreter(interpreter) {
+Parser::Parser(Interpreter *interpreter, SymbolTable *symbolTable)
+        : interpreter(interpreter),
+          symbolTable(symbolTable ? symbolTable : SymbolTable::getInstance()) {
 
 }
 
@@ -133,19 +136,19 @@ std::shared_ptr<ConAST> Parser::genConsAST() {
     std::shared_ptr<ConAST> result = nullptr;
     switch (tokType){
         case Token::INT:
-            result.reset(new IntConAST(curTok->getInt()));
+            result = AST::create<IntConAST>(curTok->getInt());
             break;
         case Token::STRING:
-            result.reset(new StringConAST(curTok->getString()));
+            result = AST::create<StringConAST>(curTok->getString());
             break;
         case Token::CHAR:
-            result.reset(new CharConAST(curTok->getChar()));
+            result = AST::create<CharConAST>(curTok->getChar());
             break;
         case Token::REAL:
-            result.reset(new FloatConAST(curTok->getReal()));
+            result = AST::create<FloatConAST>(curTok->getReal());
             break;
         case Token::BOOL:
-            result.reset(new BoolConAST(curTok->getBool()));
+            result = AST::create<BoolConAST>(curTok->getBool());
             break;
     }
     eat();
@@ -367,7 +370,7 @@ std::shared_ptr<LeftAssociativeInfixDecAST> Parser::parseLeftAssociativeDec() {
     std::vector<std::shared_ptr<IdAST>> ids;
     if(priority >= 0){
         while(true){
-            SymbolTable::getInstance()->setOperator(tokVal, {SymbolTable::Operator::INFIX,  priority});
+            symbolTable->setOperator(tokVal, {SymbolTable::Operator::INFIX,  priority});
             ids.push_back(std::move(parseId()));
             if(tokType!= Token::ID) break;
         }
@@ -375,7 +378,7 @@ std::shared_ptr<LeftAssociativeInfixDecAST> Parser::parseLeftAssociativeDec() {
         return leftAss;
     }else {
         while (true) {
-            SymbolTable::getInstance()->setOperator(tokVal, {SymbolTable::Operator::INFIX});
+            symbolTable->setOperator(tokVal, {SymbolTable::Operator::INFIX});
             ids.push_back(std::move(parseId()));
             if (tokType != Token::ID) break;
         }
@@ -395,7 +398,7 @@ std::shared_ptr<RightAssociativeInfixDecAST> Parser::parseRightAssociativeDec()
     }
     std::vector<std::shared_ptr<IdAST>> ids;
     while(true){
-        SymbolTable::getInstance()->setOperator(tokVal, {SymbolTable::Operator::INFIXR});
+        symbolTable->setOperator(tokVal, {SymbolTable::Operator::INFIXR});
         ids.push_back(std::move(parseId()));
         if(tokType!= Token::ID) break;
     }
@@ -418,13 +421,13 @@ std::shared_ptr<NonfixDecAST> Parser::parseNonfixDec() {
     std::vector<std::shared_ptr<IdAST>> ids;
     if(priority >= 0){
         while (true) {
-            SymbolTable::getInstance()->setOperator(tokVal, {SymbolTable::Operator::NONFIX,priority});
+            symbolTable->setOperator(tokVal, {SymbolTable::Operator::NONFIX,priority});
             ids.push_back(std::move(parseId()));
             if (tokType != Token::ID) break;
         }
     }else {
         while (true) {
-            SymbolTable::getInstance()->setOperator(tokVal, {SymbolTable::Operator::NONFIX});
+            symbolTable->setOperator(tokVal, {SymbolTable::Operator::NONFIX});
             ids.push_back(std::move(parseId()));
             if (tokType != Token::ID) break;
         }
@@ -523,10 +526,10 @@ std::shared_ptr<TypAST> Parser::parseTyp() {
         typ.reset(new VariableTypAST(std::move(varAst)));
     } else if (tokType == Token::ID) {
         std::shared_ptr<LongIdAST> longId(parseLongId());
-        typ.reset(new ConstructorTypAST(longId));
+        typ = AST::create<ConstructorTypAST>(longId);
     } else if (tokVal == "(") {
         eat();
-        std::shared_ptr<ParenthesesTypAST> ptyp(new ParenthesesTypAST(parseTyp()));
+        auto ptyp = AST::create<ParenthesesTypAST>(parseTyp());
         if (tokVal != ")") {
             genErrMsg();
             return nullptr;
@@ -540,7 +543,7 @@ std::shared_ptr<TypAST> Parser::parseTyp() {
     if (tokVal != "->" and tokVal != "*") return typ;
     if (tokVal == "->") {
         eat();
-        std::shared_ptr<FunctionTypAST> ftype(new FunctionTypAST(typ, parseTyp()));
+        auto ftype = AST::create<FunctionTypAST>(typ, parseTyp());
         return ftype;
     } else if (tokVal == "*") {
         //此处遇到阻碍
@@ -554,10 +557,10 @@ std::shared_ptr<TypAST> Parser::parseTyp() {
                 nextTyp.reset(new VariableTypAST(std::move(varAst)));
             } else if (tokType == Token::ID) {
                 std::shared_ptr<LongIdAST> longId(parseLongId());
-                nextTyp.reset(new ConstructorTypAST(longId));
+                nextTyp = AST::create<ConstructorTypAST>(longId);
             } else if (tokVal == "(") {
                 eat();
-                std::shared_ptr<ParenthesesTypAST> ptyp(new ParenthesesTypAST(parseTyp()));
+                auto ptyp = AST::create<ParenthesesTypAST>(parseTyp());
                 if (tokVal != ")") {
                     genErrMsg();
                     return nullptr;
@@ -570,7 +573,7 @@ std::shared_ptr<TypAST> Parser::parseTyp() {
             }
             typs.push_back(nextTyp);
             if (tokVal != "*") {
-                return std::shared_ptr<TupleTypAST>(new TupleTypAST(typs));
+                return AST::create<TupleTypAST>(typs);
             }
         }
     }
@@ -620,9 +623,9 @@ std::shared_ptr<IdAST> Parser::parseId() {
     int distL = tokVal[0] - 'A';
     //把两种Id分开看
     if((distS >= 0 && distS <= 26) || (distL >= 0 && distL <= 26) ){
-        idAST.reset(new AlphanumericIdAST(this->tokVal));
+        idAST = AST::create<AlphanumericIdAST>(this->tokVal);
     }else{
-        idAST.reset(new SymbolicIdAST(this->tokVal));
+        idAST = AST::create<SymbolicIdAST>(this->tokVal);
     }
     eat();
     return idAST;
@@ -741,7 +744,6 @@ std::shared_ptr<MatchAST> Parser::parseMatch() {
 int Parser::getIdPrecedence() {
     //查阅符号表，先读出是否为infix，且判断一下结合性
     //再读取一下优先级
-    auto symbolTable = SymbolTable::getInstance();
     auto thisOp = symbolTable->getOperator(tokVal);
     if(thisOp == nullptr) return -1;
     auto typ = thisOp->operatorType;
@@ -848,8 +850,7 @@ std::shared_ptr<ExpAST> Parser::parsePrimaryExp() {
 }
 
 bool Parser::isNonfixId() {
-    auto symbolTB = SymbolTable::getInstance();
-    return FunctionValue::NONFIX == ( (FunctionValue *) symbolTB->getValue(tokVal) )->getOperationType();
+    return FunctionValue::NONFIX == ( (FunctionValue *) symbolTable->getValue(tokVal) )->getOperationType();
 }
 
 std::shared_ptr<LabAST> Parser::parseLab() {
@@ -901,6 +902,8 @@ std::shared_ptr<LocalDeclarationExpAST> Parser::parseLocalDeclarationExp() {
         return nullptr;
     }
     eat();
+    // the fixities declared by the let are visible until its end.
+    SymbolTable::ScopeGuard _1{symbolTable};
     std::shared_ptr<DecAST> dec(parseDec());
     if (dec == nullptr) return nullptr;
     std::vector<std::shared_ptr<DecAST>> decs;
@@ -970,8 +973,7 @@ void Parser::genErrMsg() {
 }
 
 bool Parser::isInfixFunction(std::shared_ptr<Token> tok) {
-    auto SymTb = SymbolTable::getInstance();
-    auto getOp = SymTb->getOperator(tok->getValue());
+    auto getOp = symbolTable->getOperator(tok->getValue());
     if (getOp == nullptr) return false;
     return getOp->operatorType == SymbolTable::Operator::INFIX or getOp->operatorType == SymbolTable::Operator::INFIXR;
 }
@@ -999,7 +1001,7 @@ std::shared_ptr<LongIdAST> Parser::parseLongId() {
     auto id = parseId();
     if(id == nullptr) return nullptr;
     std::vector<std::shared_ptr<IdAST>> ids{id};
-    std::shared_ptr<LongIdAST> longid(new LongIdAST(ids));
+    auto longid = AST::create<LongIdAST>(ids);
     return longid;
 }
 
@@ -0,0 +1,223 @@
+#include <limits>
+#include <optional>
+#include <string>
+#include "AST/AST.h"
+#include "AST/ASTProperty.h"
+#include "ConstantFolder.h"
+#include "Symbol/SymbolTable.h"
+
+using namespace std;
+
+namespace {
+    template<typename TCon, typename TValue>
+    shared_ptr<ExpAST> constant(Type *type, TValue value) {
+        auto exp = AST::create<ConstantExpAST>(AST::create<TCon>(value));
+        ASTProperty::setType(exp, type);
+        return exp;
+    }
+
+    ConAST *getCon(const shared_ptr<ExpAST> &exp) {
+        auto constant = AST::dynCast<ConstantExpAST>(exp.get());
+        return constant ? constant->getCon().get() : nullptr;
+    }
+
+    optional<bool> getBool(const shared_ptr<ExpAST> &exp) {
+        auto con = getCon(exp);
+        if (!con || con->getKind() != ASTKind::BoolConAST) {
+            return nullopt;
+        }
+        return AST::cast<BoolConAST *>(con)->get();
+    }
+
+    template<typename T>
+    optional<bool> compare(const string &op, const T &lhs, const T &rhs) {
+        if (op == "=") {
+            return lhs == rhs;
+        } else if (op == "<>") {
+            return lhs != rhs;
+        } else if (op == "<") {
+            return lhs < rhs;
+        } else if (op == ">") {
+            return lhs > rhs;
+        } else if (op == "<=") {
+            return lhs <= rhs;
+        } else if (op == ">=") {
+            return lhs >= rhs;
+        }
+        return nullopt;
+    }
+
+    /**
+     * Apply the primitive a builtin arithmetic operator is resolved to, in a
+     * wider type for ints so that overflows are detected.
+     */
+    template<typename T>
+    optional<T> arithmetic(Primitive primitive, const T &lhs, const T &rhs) {
+        switch (primitive) {
+            case Primitive::INT_ADD:
+            case Primitive::REAL_ADD:
+                return lhs + rhs;
+            case Primitive::INT_SUB:
+            case Primitive::REAL_SUB:
+                return lhs - rhs;
+            case Primitive::INT_MUL:
+            case Primitive::REAL_MUL:
+                return lhs * rhs;
+            default:
+                return nullopt;
+        }
+    }
+
+    /**
+     * Check whether ^ is still the builtin string concatenation, i.e. not
+     * bound again by a declaration.
+     */
+    bool isStringConcatenation(SymbolTable *symbolTable) {
+        if (symbolTable->getPatternType("^")) {
+            return false;
+        }
+        auto value = symbolTable->getBuiltinValue("^");
+        auto type = value ? value->getType() : nullptr;
+        if (!type || type->getTypeId() != Type::FUNCTION) {
+            return false;
+        }
+        auto returnType = type->toFunctionType()->getReturnType();
+        return returnType && returnType->getTypeId() == Type::STRING;
+    }
+}
+
+ConstantFolder::ConstantFolder(SymbolTable *symbolTable)
+        : _symbolTable(symbolTable ? symbolTable : SymbolTable::getInstance()) {
+
+}
+
+shared_ptr<AST> ConstantFolder::fold(const shared_ptr<AST> &ast) {
+    return rewrite(ast);
+}
+
+size_t ConstantFolder::getFoldedCount() const {
+    return _folded;
+}
+
+shared_ptr<ExpAST> ConstantFolder::rewriteExp(const shared_ptr<ExpAST> &exp) {
+    auto rewritten = rewriteChildren(exp);
+    if (!rewritten) {
+        return rewritten;
+    }
+    shared_ptr<ExpAST> folded;
+    switch (rewritten->getKind()) {
+        case ASTKind::ParenthesesExpAST: {
+            auto &&inner = AST::cast<ParenthesesExpAST>(rewritten)->getExp();
+            if (AST::isa<ConstantExpAST>(inner)) {
+                folded = inner;
+            }
+            break;
+        }
+        case ASTKind::TypeAnnotationExpAST: {
+            // the annotation is already checked, and a constant has the same
+            // type.
+            auto &&inner = AST::cast<TypeAnnotationExpAST>(rewritten)->getExp();
+            if (AST::isa<ConstantExpAST>(inner)) {
+                folded = inner;
+            }
+            break;
+        }
+        case ASTKind::InfixApplicationExpAST:
+            folded = evaluate(AST::cast<InfixApplicationExpAST>(rewritten));
+            break;
+        case ASTKind::ConjunctionExpAST: {
+            // false andalso e is false, and true andalso e is e.
+            auto ast = AST::cast<ConjunctionExpAST>(rewritten);
+            if (auto test = getBool(ast->getExp1())) {
+                folded = *test ? ast->getExp2() : ast->getExp1();
+            }
+            break;
+        }
+        case ASTKind::DisjunctionExpAST: {
+            // true orelse e is true, and false orelse e is e.
+            auto ast = AST::cast<DisjunctionExpAST>(rewritten);
+            if (auto test = getBool(ast->getExp1())) {
+                folded = *test ? ast->getExp1() : ast->getExp2();
+            }
+            break;
+        }
+        case ASTKind::ConditionalExpAST: {
+            auto ast = AST::cast<ConditionalExpAST>(rewritten);
+            if (auto test = getBool(ast->getExp1())) {
+                folded = *test ? ast->getExp2() : ast->getExp3();
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    if (!folded) {
+        return rewritten;
+    }
+    ++_folded;
+    return folded;
+}
+
+shared_ptr<ExpAST> ConstantFolder::evaluate(
+        const shared_ptr<InfixApplicationExpAST> &ast) {
+    auto con1 = getCon(ast->getExp1());
+    auto con2 = getCon(ast->getExp2());
+    if (!con1 || !con2 || con1->getKind() != con2->getKind()) {
+        return nullptr;
+    }
+
+    // the type check takes the arithmetic and comparison operators as builtin
+    // regardless of the symbol table, so only the concatenation is looked up.
+    auto type = ASTProperty::getType(ast.get());
+    auto primitive = ASTProperty::getPrimitive(ast);
+    auto &&op = ast->getId()->get();
+    auto comparison = [&op, type](auto &&lhs, auto &&rhs) {
+        auto result = compare(op, lhs, rhs);
+        return result ? constant<BoolConAST>(type, *result) : nullptr;
+    };
+    switch (con1->getKind()) {
+        case ASTKind::IntConAST: {
+            auto lhs = AST::cast<IntConAST *>(con1)->get();
+            auto rhs = AST::cast<IntConAST *>(con2)->get();
+            if (auto result = arithmetic<long long>(primitive, lhs, rhs)) {
+                // an overflow raises at runtime, leave it there.
+                if (*result < numeric_limits<int>::min()
+                    || *result > numeric_limits<int>::max()) {
+                    return nullptr;
+                }
+                return constant<IntConAST>(type, int(*result));
+            }
+            return comparison(lhs, rhs);
+        }
+        case ASTKind::FloatConAST: {
+            auto lhs = AST::cast<FloatConAST *>(con1)->get();
+            auto rhs = AST::cast<FloatConAST *>(con2)->get();
+            if (auto result = arithmetic(primitive, lhs, rhs)) {
+                return constant<FloatConAST>(type, *result);
+            }
+            return comparison(lhs, rhs);
+        }
+        case ASTKind::StringConAST: {
+            auto &&lhs = AST::cast<StringConAST *>(con1)->get();
+            auto &&rhs = AST::cast<StringConAST *>(con2)->get();
+            if (op == "^") {
+                return isStringConcatenation(_symbolTable)
+                       ? constant<StringConAST>(StringType::create(), lhs + rhs)
+                       : nullptr;
+            }
+            return comparison(lhs, rhs);
+        }
+        case ASTKind::CharConAST:
+            return comparison(AST::cast<CharConAST *>(con1)->get(),
+                              AST::cast<CharConAST *>(con2)->get());
+        case ASTKind::BoolConAST:
+            // bools are equality types only.
+            if (op != "=" && op != "<>") {
+                return nullptr;
+            }
+            return comparison(AST::cast<BoolConAST *>(con1)->get(),
+                              AST::cast<BoolConAST *>(con2)->get());
+        default:
+            return nullptr;
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include "AST/ASTRewriter.h"
+
+class SymbolTable;
+
+/**
+ * Folds the constant expressions of a type checked ast, i.e. applications of
+ * the builtin arithmetic, comparison and string concatenation operators to
+ * constants, conjunctions and disjunctions with a constant operand, and
+ * conditions with a constant test. The folded expressions keep the types
+ * recorded by the type check.
+ */
+class ConstantFolder : protected ASTRewriter {
+public:
+    /**
+     * @param symbolTable The symbol table, or null for the default one.
+     */
+    explicit ConstantFolder(SymbolTable *symbolTable = nullptr);
+
+    /**
+     * Fold the constant expressions of an ast.
+     * @param ast The type checked ast.
+     * @return The folded ast, or the ast itself if nothing is folded.
+     */
+    std::shared_ptr<AST> fold(const std::shared_ptr<AST> &ast);
+
+    /**
+     * @return The number of expressions folded or simplified so far.
+     */
+    [[nodiscard]] size_t getFoldedCount() const;
+
+protected:
+    std::shared_ptr<ExpAST>
+    rewriteExp(const std::shared_ptr<ExpAST> &exp) override;
+
+private:
+    /**
+     * Evaluate a builtin infix operator applied to constants.
+     * @param ast The infix application with folded operands.
+     * @return The constant expression of the result, or null if the operator
+     * is not builtin, an operand is not constant or the result is left to the
+     * runtime, e.g. on an overflow.
+     */
+    std::shared_ptr<ExpAST>
+    evaluate(const std::shared_ptr<InfixApplicationExpAST> &ast);
+
+    SymbolTable *_symbolTable;
+
+    size_t _folded{};
+};
@@ -0,0 +1,972 @@
+#include <sstream>
+#include <utility>
+#include "AST/AST.h"
+#include "AST/ASTProperty.h"
+#include "ConstraintSolver.h"
+
+using namespace std;
+
+namespace {
+    /**
+     * The level of the variable a use is instantiated into, which takes the
+     * level of the instance, as TypeCheck uses the instance itself.
+     */
+    constexpr unsigned UNLEVELED = VariableTypeNameType::GENERIC_LEVEL - 1;
+
+    /**
+     * The constructor of a missing type, e.g. of a function body which is
+     * not typed, which TypeCheck goes on with as a null type. It is unified
+     * with nothing.
+     */
+    constexpr auto MISSING = Type::TYPE_NAME;
+
+    Type *createBasicType(Type::TypeId typeId) {
+        switch (typeId) {
+            case Type::INT:
+                return IntType::create();
+            case Type::REAL:
+                return RealType::create();
+            case Type::STRING:
+                return StringType::create();
+            case Type::CHAR:
+                return CharType::create();
+            case Type::BOOL:
+                return BoolType::create();
+            case Type::UNIT:
+                return UnitType::create();
+            default:
+                return nullptr;
+        }
+    }
+}
+
+ConstraintSolver::ConstraintSolver(SymbolTable *symbolTable)
+        : _symbolTable(symbolTable ? symbolTable : SymbolTable::getInstance()) {
+
+}
+
+bool ConstraintSolver::solve(AST *ast) {
+    _variables.assign(1, Variable{});
+    _components.clear();
+    _constraints.clear();
+    _typedASTs.clear();
+    _primitives.clear();
+    _scopes.clear();
+    _outerVariables.clear();
+    _search = VALUE;
+    _level = 0;
+    _unsupported = false;
+    _visited.clear();
+    _walk = 0;
+    _verified[0].clear();
+    _verified[1].clear();
+    _namedCount = 0;
+    _bindings.clear();
+    _errors.clear();
+    _solved = false;
+
+    auto root = dispatch(ast);
+    if (_unsupported) {
+        return false;
+    }
+    // the constraints emitted are solved even if the ast is not typed, for
+    // the errors in it.
+    if (!solveConstraints() || !root) {
+        return false;
+    }
+    _scopes.forEachOutermost([this](auto &&name, unsigned var) {
+        if (auto type = verify(var)) {
+            _bindings.emplace_back(name, type);
+        }
+    });
+    generalize(root, 0);
+    auto type = verify(root);
+    if (!type) {
+        return false;
+    }
+    _bindings.emplace_back("it", type);
+    return _solved = true;
+}
+
+void ConstraintSolver::apply() {
+    if (!_solved) {
+        return;
+    }
+    for (auto &&[ast, var] : _typedASTs) {
+        ASTProperty::setType(ast, verify(var, false));
+    }
+    for (auto &&[ast, primitive] : _primitives) {
+        ASTProperty::setPrimitive(ast, primitive);
+    }
+}
+
+bool ConstraintSolver::isUnsupported() const {
+    return _unsupported;
+}
+
+const ConstraintSolver::Bindings &ConstraintSolver::getBindings() const {
+    return _bindings;
+}
+
+const vector<pair<AST *, Primitive>> &ConstraintSolver::getPrimitives() const {
+    return _primitives;
+}
+
+const vector<string> &ConstraintSolver::getErrors() const {
+    return _errors;
+}
+
+size_t ConstraintSolver::getConstraintCount() const {
+    return _constraints.size();
+}
+
+unsigned ConstraintSolver::visit(ValueDecAST *ast) {
+    ++_level;
+    auto var = dispatch(ast->getValBind());
+    --_level;
+    if (var) {
+        emit(Constraint::GENERALIZE, var);
+    }
+    return typed(var, ast);
+}
+
+unsigned ConstraintSolver::visit(DestructuringValBindAST *ast) {
+    if (ast->getAndValBind()) {
+        return 0;
+    }
+    SearchGuard _1{*this, VALUE};
+    auto exp = dispatch(ast->getExp());
+    SearchGuard _2{*this, PATTERN};
+    auto pat = dispatch(ast->getPat());
+    return equal(pat, exp, ast);
+}
+
+unsigned ConstraintSolver::visit(TypeAnnotationExpAST *ast) {
+    SearchGuard _1{*this, VALUE};
+    auto exp = dispatch(ast->getExp());
+    SearchGuard _2{*this, TYPE};
+    auto typ = dispatch(ast->getTyp());
+    return equal(exp, typ, ast);
+}
+
+unsigned ConstraintSolver::visit(TypeAnnotationPatAST *ast) {
+    SearchGuard _1{*this, PATTERN};
+    auto pat = dispatch(ast->getPat());
+    SearchGuard _2{*this, TYPE};
+    auto typ = dispatch(ast->getTyp());
+    return equal(pat, typ, ast);
+}
+
+unsigned ConstraintSolver::visit(VariablePatAST *ast) {
+    return dispatch(ast->getId());
+}
+
+unsigned ConstraintSolver::visit(IdAST *ast) {
+    auto &&name = ast->get();
+    unsigned var{};
+    switch (_search) {
+        case TYPE:
+            if (auto type = _symbolTable->getType(name)) {
+                var = import(type);
+            }
+            break;
+        case VALUE:
+            if (auto local = getPatternVariable(name)) {
+                var = createVariable(UNLEVELED);
+                emit(Constraint::INSTANTIATE, var, local);
+            } else if (auto type =
+                    _symbolTable->getPatternType(name)) {
+                var = import(type);
+            } else {
+                var = constructBuiltinArithmetic(name);
+            }
+            break;
+        case PATTERN: {
+            var = fresh();
+            _scopes.insert(name, var);
+            break;
+        }
+    }
+    return typed(var, ast);
+}
+
+unsigned ConstraintSolver::visit(ConstantExpAST *ast) {
+    return typed(dispatch(ast->getCon()), ast);
+}
+
+unsigned ConstraintSolver::visit(IntConAST *ast) {
+    return typed(construct(Type::INT), ast);
+}
+
+unsigned ConstraintSolver::visit(FloatConAST *ast) {
+    return typed(construct(Type::REAL), ast);
+}
+
+unsigned ConstraintSolver::visit(BoolConAST *ast) {
+    return typed(construct(Type::BOOL), ast);
+}
+
+unsigned ConstraintSolver::visit(CharConAST *ast) {
+    return typed(construct(Type::CHAR), ast);
+}
+
+unsigned ConstraintSolver::visit(StringConAST *ast) {
+    return typed(construct(Type::STRING), ast);
+}
+
+unsigned ConstraintSolver::visit(ListExpAST *ast) {
+    auto &&exps = ast->getExps();
+    if (exps.empty()) {
+        return typed(construct(Type::LIST, {fresh()}), ast);
+    }
+    auto var = dispatch(exps[0]);
+    for (size_t i = 1; var && i < exps.size(); ++i) {
+        var = equal(var, dispatch(exps[i]));
+    }
+    return typed(var ? construct(Type::LIST, {var}) : 0, ast);
+}
+
+unsigned ConstraintSolver::visit(TupleExpAST *ast) {
+    vector<unsigned> vars;
+    for (auto &&exp : ast->getExps()) {
+        if (auto var = dispatch(exp)) {
+            vars.push_back(var);
+        } else {
+            return 0;
+        }
+    }
+    return typed(construct(Type::TUPLE, vars), ast);
+}
+
+unsigned ConstraintSolver::visit(ApplicationExpAST *ast) {
+    auto &&exp1 = ast->getExp1();
+    if (isBuiltinNegation(exp1.get())) {
+        auto operand = dispatch(ast->getExp2());
+        if (!operand) {
+            return 0;
+        }
+        auto var = fresh();
+        emit(Constraint::NEGATE, var, operand, 0, ast);
+        return typed(var, ast);
+    }
+    auto function = dispatch(exp1);
+    if (!function) {
+        return 0;
+    }
+    emit(Constraint::FUNCTION, function);
+    auto param = dispatch(ast->getExp2());
+    auto ret = fresh();
+    if (!equal(function, param ? construct(Type::FUNCTION, {ret, param}) : 0)) {
+        return 0;
+    }
+    return typed(ret, ast);
+}
+
+unsigned ConstraintSolver::visit(InfixApplicationExpAST *ast) {
+    auto &&name = ast->getId()->get();
+    auto op = SymbolTable::getArithmeticOperator(name);
+    if (op != SymbolTable::NOT_ARITHMETIC && op != SymbolTable::NEG) {
+        auto lhs = dispatch(ast->getExp1());
+        auto rhs = lhs ? dispatch(ast->getExp2()) : 0;
+        if (!rhs) {
+            return 0;
+        }
+        auto var = fresh();
+        emit(Constraint::ARITHMETIC, var, lhs, rhs, ast, op);
+        return typed(var, ast);
+    }
+
+    if (name == "=" || name == "<>" || name == "<" || name == ">"
+        || name == "<=" || name == ">=") {
+        auto lhs = dispatch(ast->getExp1());
+        auto rhs = dispatch(ast->getExp2());
+        return typed(equal(lhs, rhs) ? construct(Type::BOOL) : 0, ast);
+    }
+
+    auto value = _symbolTable->getBuiltinValue(name);
+    if (!value || !value->getType()
+        || value->getType()->getTypeId() != Type::FUNCTION) {
+        return 0;
+    }
+    auto infix = import(value->getType());
+    auto lhs = dispatch(ast->getExp1());
+    auto rhs = dispatch(ast->getExp2());
+    if (!infix || !lhs || !rhs) {
+        return 0;
+    }
+    auto ret = fresh();
+    auto function = construct(Type::FUNCTION,
+                              {ret, construct(Type::TUPLE, {lhs, rhs})});
+    return typed(equal(function, infix) ? ret : 0, ast);
+}
+
+unsigned ConstraintSolver::visit(ConjunctionExpAST *ast) {
+    auto lhs = dispatch(ast->getExp1());
+    auto rhs = dispatch(ast->getExp2());
+    return equal(equal(lhs, rhs), construct(Type::BOOL), ast);
+}
+
+unsigned ConstraintSolver::visit(DisjunctionExpAST *ast) {
+    auto lhs = dispatch(ast->getExp1());
+    auto rhs = dispatch(ast->getExp2());
+    return equal(equal(lhs, rhs), construct(Type::BOOL), ast);
+}
+
+unsigned ConstraintSolver::visit(ConditionalExpAST *ast) {
+    if (!equal(dispatch(ast->getExp1()), construct(Type::BOOL))) {
+        return 0;
+    }
+    auto then = dispatch(ast->getExp2());
+    auto otherwise = dispatch(ast->getExp3());
+    return equal(then, otherwise, ast);
+}
+
+unsigned ConstraintSolver::visit(ConstructorTypAST *ast) {
+    return typed(dispatch(ast->getLongId()), ast);
+}
+
+unsigned ConstraintSolver::visit(FunctionTypAST *ast) {
+    auto param = dispatch(ast->getTyp1());
+    auto ret = dispatch(ast->getTyp2());
+    return typed(param && ret ? construct(Type::FUNCTION, {ret, param}) : 0,
+                 ast);
+}
+
+unsigned ConstraintSolver::visit(RecordTypAST *) {
+    _unsupported = true;
+    return 0;
+}
+
+unsigned ConstraintSolver::visit(RecordSelectorExpAST *) {
+    _unsupported = true;
+    return 0;
+}
+
+unsigned ConstraintSolver::visit(LongIdAST *ast) {
+    if (ast->getIds().size() == 1) {
+        return typed(dispatch(ast->getIds()[0]), ast);
+    }
+    // a qualified name is left to the type check.
+    _unsupported = true;
+    return 0;
+}
+
+unsigned ConstraintSolver::visit(ValueOrConstructorIdentifierExpAST *ast) {
+    return typed(dispatch(ast->getLongId()), ast);
+}
+
+unsigned ConstraintSolver::visit(FunctionExpAST *ast) {
+    return typed(dispatch(ast->getMatch()), ast);
+}
+
+unsigned ConstraintSolver::visit(MatchAST *ast) {
+    SearchGuard _1{*this, PATTERN};
+    auto pat = dispatch(ast->getPat());
+    SearchGuard _2{*this, VALUE};
+    auto exp = dispatch(ast->getExp());
+    return typed(pat && exp ? construct(Type::FUNCTION, {exp, pat}) : 0, ast);
+}
+
+unsigned ConstraintSolver::visit(ConstructionPatAST *ast) {
+    return dispatch(ast->getLongId());
+}
+
+unsigned ConstraintSolver::visit(TuplePatAST *ast) {
+    vector<unsigned> vars;
+    for (auto &&pat : ast->getPats()) {
+        if (auto var = dispatch(pat)) {
+            vars.push_back(var);
+        } else {
+            return 0;
+        }
+    }
+    return typed(construct(Type::TUPLE, vars), ast);
+}
+
+unsigned ConstraintSolver::visit(LocalDeclarationExpAST *ast) {
+    ScopeGuard _1{*this};
+    unsigned var{};
+    if (dispatch(ast->getDec())) {
+        SearchGuard _2{*this, VALUE};
+        for (auto &&exp : ast->getExps()) {
+            if (!(var = dispatch(exp))) {
+                break;
+            }
+        }
+    }
+    return typed(var, ast);
+}
+
+unsigned ConstraintSolver::visit(SequenceDecAST *ast) {
+    unsigned var{};
+    for (auto &&dec : ast->getDecs()) {
+        if (!(var = dispatch(dec))) {
+            break;
+        }
+    }
+    return typed(var, ast);
+}
+
+unsigned ConstraintSolver::visit(FunctionDecAST *ast) {
+    ++_level;
+    auto var = dispatch(ast->getFunBind());
+    --_level;
+    if (var) {
+        emit(Constraint::GENERALIZE, var);
+    }
+    return var;
+}
+
+unsigned ConstraintSolver::visit(FunBindAST *ast) {
+    auto var = dispatch(ast->getFunMatch());
+    if (auto &&andFunBind = ast->getAndFunBind()) {
+        var = equal(var, dispatch(andFunBind));
+    }
+    return typed(var, ast);
+}
+
+unsigned ConstraintSolver::visit(NonFixFunMatchAST *ast) {
+    SearchGuard _1{*this, PATTERN};
+    auto id = dispatch(ast->getId());
+    ScopeGuard _2{*this};
+    vector<unsigned> params;
+    for (auto &&pat : ast->getPats()) {
+        if (auto var = dispatch(pat)) {
+            params.push_back(var);
+        } else {
+            return 0;
+        }
+    }
+    // curried as TypeCheck does.
+    unsigned var{};
+    for (auto it = params.rbegin(); it != params.rend(); ++it) {
+        var = var ? construct(Type::FUNCTION, {var, *it}) : *it;
+    }
+    SearchGuard _3{*this, VALUE};
+    emit(Constraint::BEGIN_BODY, 0);
+    auto exp = dispatch(ast->getExp());
+    auto body = createVariable(UNLEVELED);
+    emit(Constraint::END_BODY, body, exp);
+    if (!var) {
+        return 0;
+    }
+    var = construct(Type::FUNCTION, {body, var});
+    if (auto &&orfm = ast->getOrFunMatch()) {
+        var = equal(var, dispatch(orfm));
+    }
+    if (auto &&typ = ast->getTyp()) {
+        SearchGuard _4{*this, TYPE};
+        var = equal(var, dispatch(typ));
+    }
+    return typed(equal(var, id), ast);
+}
+
+unsigned ConstraintSolver::visit(InfixFunMatchAST *ast) {
+    SearchGuard _1{*this, PATTERN};
+    auto lhs = dispatch(ast->getPat1());
+    auto rhs = dispatch(ast->getPat2());
+    if (!lhs || !rhs) {
+        return 0;
+    }
+    auto param = construct(Type::TUPLE, {lhs, rhs});
+    SearchGuard _2{*this, VALUE};
+    auto exp = dispatch(ast->getExp());
+    if (!exp) {
+        return 0;
+    }
+    auto var = construct(Type::FUNCTION, {exp, param});
+    if (auto &&orfm = ast->getOrFunMatch()) {
+        var = equal(var, dispatch(orfm));
+    }
+    SearchGuard _3{*this, PATTERN};
+    var = equal(var, dispatch(ast->getId()));
+    if (auto &&typ = ast->getTyp()) {
+        SearchGuard _4{*this, TYPE};
+        var = equal(var, dispatch(typ));
+    }
+    return typed(var, ast);
+}
+
+ConstraintSolver::SearchGuard::SearchGuard(ConstraintSolver &solver,
+                                           Search search) noexcept
+        : _solver(solver), _previous(solver._search) {
+    _solver._search = search;
+}
+
+ConstraintSolver::SearchGuard::~SearchGuard() noexcept {
+    _solver._search = _previous;
+}
+
+ConstraintSolver::ScopeGuard::ScopeGuard(ConstraintSolver &solver) noexcept
+        : _solver(solver) {
+    _solver._scopes.enterScope();
+}
+
+ConstraintSolver::ScopeGuard::~ScopeGuard() noexcept {
+    _solver._scopes.leaveScope();
+}
+
+unsigned ConstraintSolver::createVariable(unsigned level) {
+    auto var = unsigned(_variables.size());
+    _variables.push_back({var, 0, level, false, Type::VARIABLE_TYPE_NAME,
+                          0, 0, nullptr});
+    return var;
+}
+
+unsigned ConstraintSolver::fresh() {
+    return createVariable(_level);
+}
+
+unsigned ConstraintSolver::construct(Type::TypeId typeId,
+                                     initializer_list<unsigned> components) {
+    auto var = fresh();
+    auto &&variable = _variables[var];
+    variable.constructed = true;
+    variable.typeId = typeId;
+    variable.first = unsigned(_components.size());
+    variable.count = unsigned(components.size());
+    _components.insert(_components.end(), components);
+    return var;
+}
+
+unsigned ConstraintSolver::construct(Type::TypeId typeId,
+                                     const vector<unsigned> &components) {
+    auto var = construct(typeId);
+    auto &&variable = _variables[var];
+    variable.count = unsigned(components.size());
+    _components.insert(_components.end(), components.begin(), components.end());
+    return var;
+}
+
+unsigned ConstraintSolver::import(Type *type) {
+    unordered_map<Type *, unsigned> fresh;
+    return import(type, fresh);
+}
+
+unsigned ConstraintSolver::import(Type *type,
+                                  unordered_map<Type *, unsigned> &fresh) {
+    while (type->getTypeId() == Type::TYPE_NAME) {
+        type = type->toTypeNameType()->getBoundType();
+    }
+    switch (type->getTypeId()) {
+        case Type::INT:
+        case Type::REAL:
+        case Type::STRING:
+        case Type::CHAR:
+        case Type::BOOL:
+        case Type::UNIT:
+            return construct(type->getTypeId());
+        case Type::LIST: {
+            auto subtype = import(type->toListType()->getSubtype(), fresh);
+            return subtype ? construct(Type::LIST, {subtype}) : 0;
+        }
+        case Type::TUPLE: {
+            vector<unsigned> vars;
+            for (auto entry : type->toTupleType()->getTypes()) {
+                if (auto var = import(entry, fresh)) {
+                    vars.push_back(var);
+                } else {
+                    return 0;
+                }
+            }
+            return construct(Type::TUPLE, vars);
+        }
+        case Type::FUNCTION: {
+            auto function = type->toFunctionType();
+            if (function->isOverloaded()) {
+                break;
+            }
+            auto ret = import(function->getReturnType(), fresh);
+            auto param = ret ? import(function->getParameterType(), fresh) : 0;
+            return param ? construct(Type::FUNCTION, {ret, param}) : 0;
+        }
+        case Type::VARIABLE_TYPE_NAME: {
+            auto outer = type->toVariableTypeNameType();
+            auto &&var = (outer->isGeneric() ? fresh : _outerVariables)[type];
+            if (!var) {
+                var = createVariable(outer->isGeneric() ? _level
+                                                        : outer->getLevel());
+                _variables[var].outer = outer->isGeneric() ? nullptr : type;
+            }
+            return var;
+        }
+        default:
+            break;
+    }
+    _unsupported = true;
+    return 0;
+}
+
+void ConstraintSolver::emit(Constraint::Kind kind, unsigned var,
+                            unsigned other, unsigned third, AST *ast,
+                            SymbolTable::ArithmeticOperator op) {
+    _constraints.push_back({kind, op, var, other, third, _level, ast});
+}
+
+unsigned ConstraintSolver::equal(unsigned var, unsigned other, AST *ast) {
+    if (!var || !other) {
+        return 0;
+    }
+    if (var != other) {
+        emit(Constraint::EQUAL, var, other);
+    }
+    return typed(var, ast);
+}
+
+unsigned ConstraintSolver::typed(unsigned var, AST *ast) {
+    if (var && ast) {
+        _typedASTs.emplace_back(ast, var);
+    }
+    return var;
+}
+
+unsigned ConstraintSolver::getPatternVariable(const string &name) {
+    auto var = _scopes.find(name);
+    return var ? *var : 0;
+}
+
+bool ConstraintSolver::isBuiltinNegation(ExpAST *exp) {
+    auto id = AST::dynCast<ValueOrConstructorIdentifierExpAST>(exp);
+    if (!id || !id->getLongId() || id->getLongId()->getIds().size() != 1) {
+        return false;
+    }
+    auto &&name = id->getLongId()->getIds()[0]->get();
+    return SymbolTable::getArithmeticOperator(name) == SymbolTable::NEG
+           && !getPatternVariable(name)
+           && !_symbolTable->getPatternType(name);
+}
+
+unsigned ConstraintSolver::constructBuiltinArithmetic(const string &name) {
+    auto op = SymbolTable::getArithmeticOperator(name);
+    if (op == SymbolTable::NOT_ARITHMETIC
+        || !_symbolTable->getBuiltinValue(name)
+        || SymbolTable::resolveArithmetic(op, Type::INT) == Primitive::NONE) {
+        return 0;
+    }
+    auto param = op == SymbolTable::NEG
+                 ? construct(Type::INT)
+                 : construct(Type::TUPLE, {construct(Type::INT),
+                                           construct(Type::INT)});
+    return construct(Type::FUNCTION, {construct(Type::INT), param});
+}
+
+unsigned ConstraintSolver::find(unsigned var) {
+    auto root = var;
+    while (_variables[root].parent != root) {
+        root = _variables[root].parent;
+    }
+    while (_variables[var].parent != root) {
+        var = exchange(_variables[var].parent, root);
+    }
+    return root;
+}
+
+bool ConstraintSolver::unify(unsigned var, unsigned other) {
+    _worklist.clear();
+    _worklist.emplace_back(var, other);
+    while (!_worklist.empty()) {
+        auto [s, t] = _worklist.back();
+        _worklist.pop_back();
+        s = find(s);
+        t = find(t);
+        auto &&sv = _variables[s];
+        auto &&tv = _variables[t];
+        if ((sv.constructed && sv.typeId == MISSING)
+            || (tv.constructed && tv.typeId == MISSING)) {
+            return false;
+        }
+        if (s == t) {
+            continue;
+        }
+        if (!sv.constructed || !tv.constructed) {
+            auto unbound = sv.constructed ? t : s;
+            auto type = sv.constructed ? s : t;
+            if (occurs(unbound, type)) {
+                error(unbound, type, ", which is circular");
+                return false;
+            }
+            link(unbound, type);
+            continue;
+        }
+        if (sv.typeId != tv.typeId) {
+            error(s, t);
+            return false;
+        }
+        if (sv.count != tv.count) {
+            return false;
+        }
+        for (unsigned i = 0; i < sv.count; ++i) {
+            _worklist.emplace_back(_components[sv.first + i],
+                                   _components[tv.first + i]);
+        }
+        link(s, t);
+    }
+    return true;
+}
+
+void ConstraintSolver::link(unsigned var, unsigned parent) {
+    auto *child = &_variables[var];
+    auto *root = &_variables[parent];
+    if (!child->constructed && !root->constructed) {
+        if (child->rank > root->rank) {
+            swap(var, parent);
+            swap(child, root);
+        } else if (child->rank == root->rank) {
+            ++root->rank;
+        }
+        if (!root->outer) {
+            root->outer = child->outer;
+        }
+    }
+    if (!child->constructed) {
+        adjustLevels(parent, child->level);
+    }
+    child->parent = parent;
+}
+
+bool ConstraintSolver::occurs(unsigned var, unsigned other) {
+    ++_walk;
+    _stack.assign(1, other);
+    while (!_stack.empty()) {
+        auto next = find(_stack.back());
+        _stack.pop_back();
+        if (next == var) {
+            return true;
+        }
+        if (!mark(next)) {
+            continue;
+        }
+        auto &&variable = _variables[next];
+        _stack.insert(_stack.end(), _components.begin() + variable.first,
+                      _components.begin() + variable.first + variable.count);
+    }
+    return false;
+}
+
+void ConstraintSolver::adjustLevels(unsigned var, unsigned level) {
+    ++_walk;
+    _stack.assign(1, var);
+    while (!_stack.empty()) {
+        auto next = find(_stack.back());
+        _stack.pop_back();
+        if (!mark(next)) {
+            continue;
+        }
+        auto &&variable = _variables[next];
+        if (!variable.constructed) {
+            variable.level = min(variable.level, level);
+            continue;
+        }
+        _stack.insert(_stack.end(), _components.begin() + variable.first,
+                      _components.begin() + variable.first + variable.count);
+    }
+}
+
+void ConstraintSolver::generalize(unsigned var, unsigned level) {
+    ++_walk;
+    _stack.assign(1, var);
+    while (!_stack.empty()) {
+        auto next = find(_stack.back());
+        _stack.pop_back();
+        if (!mark(next)) {
+            continue;
+        }
+        auto &&variable = _variables[next];
+        if (!variable.constructed) {
+            if (variable.level > level) {
+                variable.level = VariableTypeNameType::GENERIC_LEVEL;
+            }
+            continue;
+        }
+        _stack.insert(_stack.end(), _components.begin() + variable.first,
+                      _components.begin() + variable.first + variable.count);
+    }
+}
+
+unsigned ConstraintSolver::instantiate(
+        unsigned var, unsigned level, unordered_map<unsigned, unsigned> &fresh) {
+    var = find(var);
+    auto found = fresh.find(var);
+    if (found != fresh.end()) {
+        return found->second;
+    }
+    auto variable = _variables[var];
+    if (!variable.constructed) {
+        auto generic = variable.level == VariableTypeNameType::GENERIC_LEVEL;
+        return fresh[var] = generic ? createVariable(level) : var;
+    }
+    vector<unsigned> components;
+    auto instantiated = false;
+    for (unsigned i = 0; i < variable.count; ++i) {
+        auto component = _components[variable.first + i];
+        auto instance = instantiate(component, level, fresh);
+        instantiated = instantiated || instance != find(component);
+        components.push_back(instance);
+    }
+    return fresh[var] = instantiated ? construct(variable.typeId, components)
+                                     : var;
+}
+
+bool ConstraintSolver::solveConstraints() {
+    size_t bodies = 0;
+    for (size_t i = 0; i < _constraints.size(); ++i) {
+        auto &&constraint = _constraints[i];
+        switch (constraint.kind) {
+            case Constraint::BEGIN_BODY:
+                ++bodies;
+                break;
+            case Constraint::END_BODY: {
+                --bodies;
+                auto &&[kind, op, body, exp, _1, _2, _3] = constraint;
+                if (!exp || !unify(body, exp)) {
+                    link(body, missing());
+                }
+                break;
+            }
+            default:
+                if (solve(constraint)) {
+                    break;
+                }
+                if (!bodies) {
+                    return false;
+                }
+                for (size_t depth = 0;; ++i) {
+                    auto kind = _constraints[i + 1].kind;
+                    if (kind == Constraint::BEGIN_BODY) {
+                        ++depth;
+                    } else if (kind == Constraint::END_BODY && !depth--) {
+                        break;
+                    }
+                }
+                --bodies;
+                link(_constraints[++i].var, missing());
+                break;
+        }
+    }
+    return true;
+}
+
+bool ConstraintSolver::solve(const Constraint &constraint) {
+    auto &&[kind, op, var, other, third, level, ast] = constraint;
+    switch (kind) {
+        case Constraint::EQUAL:
+            return unify(var, other);
+        case Constraint::INSTANTIATE: {
+            unordered_map<unsigned, unsigned> fresh;
+            return unify(var, instantiate(other, level, fresh));
+        }
+        case Constraint::GENERALIZE:
+            generalize(find(var), level);
+            return true;
+        case Constraint::FUNCTION: {
+            auto &&function = _variables[find(var)];
+            return function.constructed && function.typeId == Type::FUNCTION;
+        }
+        case Constraint::ARITHMETIC: {
+            auto isArithmetic = [this](unsigned operand) {
+                auto &&variable = _variables[find(operand)];
+                return !variable.constructed || variable.typeId == Type::INT
+                       || variable.typeId == Type::REAL;
+            };
+            if (!isArithmetic(other) || !isArithmetic(third)) {
+                _primitives.emplace_back(ast, Primitive::NONE);
+                return false;
+            }
+            auto bothVariables = !_variables[find(other)].constructed
+                                 && !_variables[find(third)].constructed;
+            if (!unify(other, third)
+                || (bothVariables && !unify(other, construct(Type::INT)))) {
+                _primitives.emplace_back(ast, Primitive::NONE);
+                return false;
+            }
+            _primitives.emplace_back(ast, SymbolTable::resolveArithmetic(
+                    op, _variables[find(other)].typeId));
+            return unify(var, other);
+        }
+        case Constraint::NEGATE: {
+            if (!_variables[find(other)].constructed
+                && !unify(other, construct(Type::INT))) {
+                return false;
+            }
+            auto primitive = SymbolTable::resolveArithmetic(
+                    SymbolTable::NEG, _variables[find(other)].typeId);
+            _primitives.emplace_back(ast, primitive);
+            return primitive != Primitive::NONE && unify(var, other);
+        }
+        default:
+            return true;
+    }
+}
+
+unsigned ConstraintSolver::missing() {
+    return construct(MISSING);
+}
+
+bool ConstraintSolver::mark(unsigned var) {
+    if (_visited.size() < _variables.size()) {
+        _visited.resize(_variables.size());
+    }
+    return exchange(_visited[var], _walk) != _walk;
+}
+
+Type *ConstraintSolver::verify(unsigned var, bool named) {
+    var = find(var);
+    auto &&verified = _verified[named];
+    auto found = verified.find(var);
+    if (found != verified.end()) {
+        return found->second;
+    }
+    auto variable = _variables[var];
+    Type *type{};
+    if (variable.constructed && variable.typeId == MISSING) {
+        return nullptr;
+    }
+    if (!variable.constructed) {
+        if (variable.outer) {
+            type = variable.outer;
+        } else if (named) {
+            type = VariableTypeNameType::create(
+                    VariableTypeNameType::getName(_namedCount++));
+        } else {
+            auto numbered = _pool.create();
+            numbered->setLevel(0);
+            type = numbered;
+        }
+    } else {
+        vector<Type *> components;
+        for (unsigned i = 0; i < variable.count; ++i) {
+            components.push_back(
+                    verify(_components[variable.first + i], named));
+        }
+        switch (variable.typeId) {
+            case Type::LIST:
+                type = ListType::create(components[0]);
+                break;
+            case Type::TUPLE:
+                type = TupleType::create(components);
+                break;
+            case Type::FUNCTION:
+                type = FunctionType::create(components[0], components[1]);
+                break;
+            default:
+                type = createBasicType(variable.typeId);
+                break;
+        }
+    }
+    return verified[var] = type;
+}
+
+void ConstraintSolver::error(unsigned var, unsigned other,
+                             const char *reason) {
+    stringstream ss;
+    if (auto type = verify(var, false)) {
+        type->print(ss);
+    }
+    ss << " and ";
+    if (auto type = verify(other, false)) {
+        type->print(ss);
+    }
+    _errors.push_back("Could not match " + ss.str() + reason + '.');
+    // the types are unified further by later constraints, if any.
+    _verified[false].clear();
+}
@@ -0,0 +1,396 @@
+#pragma once
+
+#include <initializer_list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "AST/ASTTypedVisitor.h"
+#include "Symbol/ScopedTable.h"
+#include "Symbol/SymbolTable.h"
+
+/**
+ * Infers the types of a top-level ast in two phases, as an alternative to
+ * TypeCheck which unifies the types as it visits the ast.
+ *
+ * The ast is first visited to emit a flat array of constraints over integer
+ * type variables, one for each typed ast. The constraints are then solved in
+ * order by a union-find over an array of the variables, where the pairs of
+ * variables left to unify are kept in a worklist instead of recursing into
+ * the types. No type of the symbol table is created until the result is
+ * verified.
+ *
+ * The scopes, levels and name lookups follow TypeCheck, so that both infer the
+ * same types, and the builtins are checked at the same points. A check is
+ * unsupported if it uses a type the solver does not model, i.e. a record or
+ * an overloaded function other than the arithmetic builtins.
+ */
+class ConstraintSolver : public ASTTypedVisitor<ConstraintSolver, unsigned> {
+public:
+    using Bindings = std::vector<std::pair<std::string, Type *>>;
+
+    /**
+     * @param symbolTable The symbol table, or null for the default one.
+     */
+    explicit ConstraintSolver(SymbolTable *symbolTable = nullptr);
+
+    /**
+     * Infer the types of a top-level ast. Nothing is bound in the symbol table
+     * or set in the ast until apply.
+     * @param ast The top-level ast.
+     * @return Whether the ast is well typed.
+     */
+    bool solve(AST *ast);
+
+    /**
+     * Set the inferred types and the resolved primitives in the asts of the
+     * last successful solve.
+     */
+    void apply();
+
+    /**
+     * @return Whether the last solve met a type it does not model, in which
+     * case it fails.
+     */
+    [[nodiscard]] bool isUnsupported() const;
+
+    /**
+     * Get the pattern types of the names bound by the ast, followed by the
+     * type of the ast as it, verified like TypeCheck does.
+     * @return The names and their types.
+     */
+    [[nodiscard]] const Bindings &getBindings() const;
+
+    /**
+     * @return The primitive resolved for each arithmetic ast.
+     */
+    [[nodiscard]] const std::vector<std::pair<AST *, Primitive>> &
+    getPrimitives() const;
+
+    [[nodiscard]] const std::vector<std::string> &getErrors() const;
+
+    /**
+     * @return The number of constraints emitted by the last solve.
+     */
+    [[nodiscard]] size_t getConstraintCount() const;
+
+    using ASTTypedVisitor::visit;
+
+    unsigned visit(ValueDecAST *ast);
+
+    unsigned visit(DestructuringValBindAST *ast);
+
+    unsigned visit(TypeAnnotationExpAST *ast);
+
+    unsigned visit(TypeAnnotationPatAST *ast);
+
+    unsigned visit(VariablePatAST *ast);
+
+    unsigned visit(IdAST *ast);
+
+    unsigned visit(ConstantExpAST *ast);
+
+    unsigned visit(IntConAST *ast);
+
+    unsigned visit(FloatConAST *ast);
+
+    unsigned visit(BoolConAST *ast);
+
+    unsigned visit(CharConAST *ast);
+
+    unsigned visit(StringConAST *ast);
+
+    unsigned visit(ListExpAST *ast);
+
+    unsigned visit(TupleExpAST *ast);
+
+    unsigned visit(ApplicationExpAST *ast);
+
+    unsigned visit(InfixApplicationExpAST *ast);
+
+    unsigned visit(ConjunctionExpAST *ast);
+
+    unsigned visit(DisjunctionExpAST *ast);
+
+    unsigned visit(ConditionalExpAST *ast);
+
+    unsigned visit(ConstructorTypAST *ast);
+
+    unsigned visit(FunctionTypAST *ast);
+
+    unsigned visit(RecordTypAST *ast);
+
+    unsigned visit(RecordSelectorExpAST *ast);
+
+    unsigned visit(LongIdAST *ast);
+
+    unsigned visit(ValueOrConstructorIdentifierExpAST *ast);
+
+    unsigned visit(FunctionExpAST *ast);
+
+    unsigned visit(MatchAST *ast);
+
+    unsigned visit(ConstructionPatAST *ast);
+
+    unsigned visit(TuplePatAST *ast);
+
+    unsigned visit(LocalDeclarationExpAST *ast);
+
+    unsigned visit(SequenceDecAST *ast);
+
+    unsigned visit(FunctionDecAST *ast);
+
+    unsigned visit(FunBindAST *ast);
+
+    unsigned visit(NonFixFunMatchAST *ast);
+
+    unsigned visit(InfixFunMatchAST *ast);
+
+private:
+    /**
+     * A type variable, which is either unbound, or a type constructor applied
+     * to the variables of its components. Variable 0 is none, for an ast
+     * without a type.
+     */
+    struct Variable {
+        /**
+         * The variable it is unified with, or itself if a representative.
+         */
+        unsigned parent;
+
+        unsigned rank;
+
+        /**
+         * The level of an unbound variable, as TypeCheck.
+         */
+        unsigned level;
+
+        /**
+         * Whether it is a type constructor, with the type id. A type name
+         * stands for a missing type, as the aliases are stripped.
+         */
+        bool constructed;
+        Type::TypeId typeId;
+
+        /**
+         * The range of the components in _components, i.e. the subtype of a
+         * list, the entries of a tuple, or the return then the parameter
+         * type of a function.
+         */
+        unsigned first;
+        unsigned count;
+
+        /**
+         * The variable of the symbol table it stands for, if any.
+         */
+        Type *outer;
+    };
+
+    struct Constraint {
+        enum Kind : unsigned char {
+            EQUAL, ///< var = other
+            INSTANTIATE, ///< var = an instance at level of other
+            GENERALIZE, ///< generalize the variables of var deeper than level
+            FUNCTION, ///< var is a function, i.e. it is applicable
+            ARITHMETIC, ///< var = other op third, resolved for ast
+            NEGATE, ///< var = ~other, resolved for ast
+            BEGIN_BODY, ///< the constraints of a function body follow
+            END_BODY, ///< var = the body other, or missing if not solved
+        } kind;
+        SymbolTable::ArithmeticOperator op;
+        unsigned var;
+        unsigned other;
+        unsigned third;
+        unsigned level;
+        AST *ast;
+    };
+
+    /**
+     * The next identifier to search, as TypeCheck.
+     */
+    enum Search {
+        TYPE,
+        VALUE,
+        PATTERN,
+    };
+
+    struct SearchGuard {
+        SearchGuard(ConstraintSolver &solver, Search search) noexcept;
+
+        ~SearchGuard() noexcept;
+
+    private:
+        ConstraintSolver &_solver;
+        Search _previous;
+    };
+
+    struct ScopeGuard {
+        explicit ScopeGuard(ConstraintSolver &solver) noexcept;
+
+        ~ScopeGuard() noexcept;
+
+    private:
+        ConstraintSolver &_solver;
+    };
+
+    //region generation
+    unsigned createVariable(unsigned level);
+
+    /**
+     * Create an unbound variable of the current level.
+     */
+    unsigned fresh();
+
+    unsigned construct(Type::TypeId typeId,
+                       std::initializer_list<unsigned> components = {});
+
+    unsigned construct(Type::TypeId typeId,
+                       const std::vector<unsigned> &components);
+
+    /**
+     * Create the variables of a type of the symbol table. Its generalized
+     * variables are replaced by fresh ones, as TypeCheck instantiates them.
+     */
+    unsigned import(Type *type);
+
+    unsigned import(Type *type, std::unordered_map<Type *, unsigned> &fresh);
+
+    void emit(Constraint::Kind kind, unsigned var, unsigned other = 0,
+              unsigned third = 0, AST *ast = nullptr,
+              SymbolTable::ArithmeticOperator op = SymbolTable::NOT_ARITHMETIC);
+
+    /**
+     * Emit the unification of two variables, both typing the ast.
+     * @return The first, or none if either is.
+     */
+    unsigned equal(unsigned var, unsigned other, AST *ast = nullptr);
+
+    /**
+     * Record the variable typing an ast.
+     * @return The variable.
+     */
+    unsigned typed(unsigned var, AST *ast);
+
+    unsigned getPatternVariable(const std::string &name);
+
+    bool isBuiltinNegation(ExpAST *exp);
+
+    /**
+     * Construct the type of a builtin arithmetic operator not applied, its
+     * int overload, as TypeCheck does.
+     * @return The variable, or 0 if the name is no such builtin.
+     */
+    unsigned constructBuiltinArithmetic(const std::string &name);
+    //endregion
+
+    //region solving
+    unsigned find(unsigned var);
+
+    /**
+     * Unify two variables by the worklist.
+     * @return Whether they are unified.
+     */
+    bool unify(unsigned var, unsigned other);
+
+    /**
+     * @return Whether an unbound variable occurs in the type of another, so
+     * that unifying them would make a cyclic type.
+     */
+    bool occurs(unsigned var, unsigned other);
+
+    /**
+     * Union two variables, lowering the levels of the variables of the one
+     * not a representative any more as TypeCheck does.
+     */
+    void link(unsigned var, unsigned parent);
+
+    void adjustLevels(unsigned var, unsigned level);
+
+    void generalize(unsigned var, unsigned level);
+
+    unsigned instantiate(unsigned var, unsigned level,
+                         std::unordered_map<unsigned, unsigned> &fresh);
+
+    /**
+     * Solve the constraints in order. A constraint failing in the body of a
+     * function declaration skips the rest of the body, which is then
+     * missing, as TypeCheck goes on with a null type for it.
+     * @return Whether any constraint failing is in a body.
+     */
+    bool solveConstraints();
+
+    bool solve(const Constraint &constraint);
+
+    unsigned missing();
+
+    /**
+     * Mark a variable visited by the current walk.
+     * @return Whether it is not visited before.
+     */
+    bool mark(unsigned var);
+    //endregion
+
+    //region output
+    /**
+     * Create the type of a variable, with the unbound variables named in
+     * the order they are met. The verified variables are generic.
+     * @param var The variable.
+     * @param named Whether to name the variables, or to number them.
+     * @return The type, with null for the missing types TypeCheck goes on
+     * with.
+     */
+    Type *verify(unsigned var, bool named = true);
+
+    void error(unsigned var, unsigned other, const char *reason = "");
+    //endregion
+
+    std::vector<Variable> _variables;
+    std::vector<unsigned> _components;
+    std::vector<Constraint> _constraints;
+
+    /**
+     * The variable typing each ast, in the order they are visited.
+     */
+    std::vector<std::pair<AST *, unsigned>> _typedASTs;
+
+    std::vector<std::pair<AST *, Primitive>> _primitives;
+
+    /**
+     * The variables of the pattern types of the scopes, the outermost of
+     * which are bound by the ast in the order they are first bound.
+     */
+    ScopedTable<std::string, unsigned> _scopes;
+
+    /**
+     * The variables standing for the non-generalized variables of the symbol
+     * table, shared by all imports.
+     */
+    std::unordered_map<Type *, unsigned> _outerVariables;
+
+    SymbolTable *_symbolTable;
+
+    Search _search{VALUE};
+    unsigned _level{};
+    bool _unsupported{};
+
+    std::vector<std::pair<unsigned, unsigned>> _worklist;
+    std::vector<unsigned> _stack;
+
+    /**
+     * The walk each variable is last visited by.
+     */
+    std::vector<unsigned> _visited;
+    unsigned _walk{};
+
+    /**
+     * The verified type of each representative. The named and the numbered
+     * types are kept apart.
+     */
+    std::unordered_map<unsigned, Type *> _verified[2];
+    VariableTypeNameType::Pool _pool;
+    unsigned _namedCount{};
+
+    Bindings _bindings;
+    std::vector<std::string> _errors;
+    bool _solved{};
+};
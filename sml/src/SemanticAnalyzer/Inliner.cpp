@@ -0,0 +1,384 @@
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "AST/AST.h"
+#include "AST/ASTAnalyses.h"
+#include "AST/ASTPass.h"
+#include "AST/ASTProperty.h"
+#include "Inliner.h"
+#include "Symbol/SymbolTable.h"
+
+using namespace std;
+
+namespace {
+    struct Substitute {
+        shared_ptr<ExpAST> arg;
+
+        /**
+         * The type annotation of the parameter, kept for an argument without
+         * a known type.
+         */
+        shared_ptr<TypAST> typ;
+    };
+
+    using Substitutes = unordered_map<string, Substitute>;
+
+    /**
+     * Get the name of an identifier expression of a single id.
+     * @return The name, or null if the expression is not.
+     */
+    const string *getName(ExpAST *exp) {
+        auto id = AST::dynCast<ValueOrConstructorIdentifierExpAST>(exp);
+        if (!id || !id->getLongId() || id->getLongId()->getIds().size() != 1) {
+            return nullptr;
+        }
+        return &id->getLongId()->getIds()[0]->get();
+    }
+
+    /**
+     * Get the name bound by a parameter.
+     * @param pat The pattern of the parameter.
+     * @param typ Set to the annotated type of the parameter if any.
+     * @return The name, or null if the pattern is not a variable.
+     */
+    const string *getParam(PatAST *pat, shared_ptr<TypAST> &typ) {
+        switch (pat->getKind()) {
+            case ASTKind::VariablePatAST:
+                return &AST::cast<VariablePatAST *>(pat)->getId()->get();
+            case ASTKind::ParenthesesPatAST:
+                return getParam(
+                        AST::cast<ParenthesesPatAST *>(pat)->getPat().get(),
+                        typ);
+            case ASTKind::TypeAnnotationPatAST: {
+                auto annotation = AST::cast<TypeAnnotationPatAST *>(pat);
+                typ = annotation->getTyp();
+                return getParam(annotation->getPat().get(), typ);
+            }
+            default:
+                return nullptr;
+        }
+    }
+
+    /**
+     * Finds the uses of the recorded functions where a free name of their
+     * body is bound locally, so that a copy of the body would refer to the
+     * local binding instead of the top-level one.
+     */
+    class CapturePass : public ScopedPass {
+    public:
+        explicit CapturePass(SymbolTable *symbolTable)
+                : _symbolTable(symbolTable) {}
+
+        [[nodiscard]] unique_ptr<ASTPass> fork() const override {
+            return make_unique<CapturePass>(_symbolTable);
+        }
+
+        void join(ASTPass &forked) override {
+            auto &captured = static_cast<CapturePass &>(forked)._captured;
+            _captured.insert(captured.begin(), captured.end());
+        }
+
+        [[nodiscard]] const unordered_set<const AST *> &getCaptured() const {
+            return _captured;
+        }
+
+    protected:
+        void use(AST *ast, const string &name, AST *binding) override {
+            auto function = binding ? nullptr
+                                    : _symbolTable->getInlineFunction(name);
+            if (!function) {
+                return;
+            }
+            for (auto &&freeName : function->freeNames) {
+                if (lookup(freeName)) {
+                    _captured.insert(ast);
+                    return;
+                }
+            }
+        }
+
+    private:
+        SymbolTable *_symbolTable;
+
+        unordered_set<const AST *> _captured;
+    };
+
+    bool isAtomic(const shared_ptr<ExpAST> &exp) {
+        return AST::isa<ConstantExpAST>(exp)
+               || AST::isa<ValueOrConstructorIdentifierExpAST>(exp);
+    }
+
+    /**
+     * Check whether an expression binds no name, and count its asts.
+     * @param ast The expression or an ast in it.
+     * @param size The number of asts counted so far.
+     * @param threshold The maximum number of asts.
+     * @return Whether the expression binds no name and has at most threshold
+     * asts.
+     */
+    bool isInlinable(AST *ast, size_t &size, size_t threshold) {
+        if (++size > threshold) {
+            return false;
+        }
+        switch (ast->getKind()) {
+            case ASTKind::ConstantExpAST:
+            case ASTKind::ValueOrConstructorIdentifierExpAST:
+            case ASTKind::ApplicationExpAST:
+            case ASTKind::InfixApplicationExpAST:
+            case ASTKind::ParenthesesExpAST:
+            case ASTKind::TupleExpAST:
+            case ASTKind::ListExpAST:
+            case ASTKind::TypeAnnotationExpAST:
+            case ASTKind::ConjunctionExpAST:
+            case ASTKind::DisjunctionExpAST:
+            case ASTKind::ConditionalExpAST:
+                break;
+            default:
+                // ids, constants and types are fine in the expressions above.
+                if (AST::isa<ExpAST>(ast)) {
+                    return false;
+                }
+        }
+        vector<AST *> children;
+        ast->getChildren(children);
+        return all_of(children.begin(), children.end(),
+                      [&size, threshold](AST *child) {
+                          return isInlinable(child, size, threshold);
+                      });
+    }
+
+    /**
+     * Copy an inlinable expression without types, with the parameters
+     * substituted.
+     */
+    shared_ptr<ExpAST> copy(const shared_ptr<ExpAST> &exp,
+                            const Substitutes &substitutes) {
+        static const Substitutes noSubstitutes;
+        auto copyAll = [&substitutes](const vector<shared_ptr<ExpAST>> &exps) {
+            vector<shared_ptr<ExpAST>> copies;
+            for (auto &&exp : exps) {
+                copies.push_back(copy(exp, substitutes));
+            }
+            return copies;
+        };
+        switch (exp->getKind()) {
+            case ASTKind::ConstantExpAST:
+                return AST::create<ConstantExpAST>(
+                        AST::cast<ConstantExpAST>(exp)->getCon());
+            case ASTKind::ValueOrConstructorIdentifierExpAST: {
+                if (auto name = getName(exp.get())) {
+                    auto found = substitutes.find(*name);
+                    if (found != substitutes.end()) {
+                        auto &&[arg, typ] = found->second;
+                        auto copied = copy(arg, noSubstitutes);
+                        if (typ) {
+                            return AST::create<TypeAnnotationExpAST>(copied, typ);
+                        }
+                        return copied;
+                    }
+                }
+                return AST::create<ValueOrConstructorIdentifierExpAST>(
+                        AST::cast<ValueOrConstructorIdentifierExpAST>(exp)
+                                ->getLongId());
+            }
+            case ASTKind::ApplicationExpAST: {
+                auto ast = AST::cast<ApplicationExpAST>(exp);
+                return AST::create<ApplicationExpAST>(
+                        copy(ast->getExp1(), substitutes),
+                        copy(ast->getExp2(), substitutes));
+            }
+            case ASTKind::InfixApplicationExpAST: {
+                auto ast = AST::cast<InfixApplicationExpAST>(exp);
+                return AST::create<InfixApplicationExpAST>(
+                        copy(ast->getExp1(), substitutes),
+                        ast->getId(),
+                        copy(ast->getExp2(), substitutes));
+            }
+            case ASTKind::ParenthesesExpAST:
+                return AST::create<ParenthesesExpAST>(
+                        copy(AST::cast<ParenthesesExpAST>(exp)->getExp(),
+                             substitutes));
+            case ASTKind::TupleExpAST:
+                return AST::create<TupleExpAST>(
+                        copyAll(AST::cast<TupleExpAST>(exp)->getExps()));
+            case ASTKind::ListExpAST:
+                return AST::create<ListExpAST>(
+                        copyAll(AST::cast<ListExpAST>(exp)->getExps()));
+            case ASTKind::TypeAnnotationExpAST: {
+                auto ast = AST::cast<TypeAnnotationExpAST>(exp);
+                return AST::create<TypeAnnotationExpAST>(
+                        copy(ast->getExp(), substitutes), ast->getTyp());
+            }
+            case ASTKind::ConjunctionExpAST: {
+                auto ast = AST::cast<ConjunctionExpAST>(exp);
+                return AST::create<ConjunctionExpAST>(
+                        copy(ast->getExp1(), substitutes),
+                        copy(ast->getExp2(), substitutes));
+            }
+            case ASTKind::DisjunctionExpAST: {
+                auto ast = AST::cast<DisjunctionExpAST>(exp);
+                return AST::create<DisjunctionExpAST>(
+                        copy(ast->getExp1(), substitutes),
+                        copy(ast->getExp2(), substitutes));
+            }
+            case ASTKind::ConditionalExpAST: {
+                auto ast = AST::cast<ConditionalExpAST>(exp);
+                return AST::create<ConditionalExpAST>(
+                        copy(ast->getExp1(), substitutes),
+                        copy(ast->getExp2(), substitutes),
+                        copy(ast->getExp3(), substitutes));
+            }
+            default:
+                return exp;
+        }
+    }
+}
+
+Inliner::Inliner(size_t threshold, SymbolTable *symbolTable)
+        : _threshold(threshold),
+          _symbolTable(symbolTable ? symbolTable : SymbolTable::getInstance()) {
+
+}
+
+shared_ptr<AST> Inliner::inlineCalls(const shared_ptr<AST> &ast) {
+    _inlinedCalls.clear();
+    if (!_threshold || !ast) {
+        return ast;
+    }
+    NameResolutionPass nameResolution;
+    CapturePass capture(_symbolTable);
+    ASTPassManager manager;
+    manager.addPass(nameResolution);
+    manager.addPass(capture);
+    manager.run(ast.get());
+    _nameResolution = &nameResolution;
+    _capturedUses = &capture.getCaptured();
+    auto result = rewrite(ast);
+    _nameResolution = nullptr;
+    _capturedUses = nullptr;
+    return result;
+}
+
+void Inliner::record(const shared_ptr<AST> &ast) {
+    auto dec = AST::dynCast<FunctionDecAST>(ast);
+    if (!_threshold || !dec) {
+        return;
+    }
+    auto &&funBind = dec->getFunBind();
+    if (!funBind || funBind->getAndFunBind()) {
+        return;
+    }
+    auto &&funMatch = funBind->getFunMatch();
+    if (!funMatch || funMatch->getOrFunMatch()
+        || funMatch->getKind() != ASTKind::NonFixFunMatchAST) {
+        return;
+    }
+
+    SymbolTable::InlineFunction function;
+    set<string> params;
+    for (auto &&pat : funMatch->getPats()) {
+        shared_ptr<TypAST> typ;
+        auto param = getParam(pat.get(), typ);
+        if (!param || !params.insert(*param).second) {
+            return;
+        }
+        function.pats.push_back(pat);
+    }
+    if (params.empty()) {
+        return;
+    }
+    function.body = funMatch->getExp();
+    if (auto &&typ = funMatch->getTyp()) {
+        function.body = AST::create<TypeAnnotationExpAST>(function.body, typ);
+    }
+    size_t size = 0;
+    if (!isInlinable(function.body.get(), size, _threshold)) {
+        return;
+    }
+
+    FreeVariablePass freeVariables;
+    ASTPassManager manager;
+    manager.addPass(freeVariables);
+    manager.run(function.body.get());
+    auto &&name = funMatch->getId()->get();
+    for (auto &&freeName : freeVariables.getFreeVariables(function.body.get())) {
+        if (freeName == name) {
+            return;
+        }
+        if (!params.count(freeName)) {
+            function.freeNames.insert(freeName);
+        }
+    }
+    _symbolTable->insertInlineFunction(name, std::move(function));
+}
+
+const map<string, size_t> &Inliner::getInlinedCalls() const {
+    return _inlinedCalls;
+}
+
+size_t Inliner::getThreshold() const {
+    return _threshold;
+}
+
+void Inliner::setThreshold(size_t threshold) {
+    _threshold = threshold;
+}
+
+shared_ptr<ExpAST> Inliner::rewriteExp(const shared_ptr<ExpAST> &exp) {
+    // the arguments are inlined first. the copied bodies are not inlined
+    // again, as the calls in them are inlined before they are recorded.
+    auto rewritten = rewriteChildren(exp);
+    if (auto call = AST::dynCast<ApplicationExpAST>(rewritten)) {
+        if (auto inlined = inlineCall(call)) {
+            return inlined;
+        }
+    }
+    return rewritten;
+}
+
+shared_ptr<ExpAST>
+Inliner::inlineCall(const shared_ptr<ApplicationExpAST> &call) {
+    // a curried call f a b is parsed as (f a) b.
+    vector<shared_ptr<ExpAST>> args;
+    shared_ptr<ExpAST> callee = call;
+    while (auto app = AST::dynCast<ApplicationExpAST>(callee)) {
+        args.push_back(app->getExp2());
+        callee = app->getExp1();
+    }
+    reverse(args.begin(), args.end());
+
+    auto name = getName(callee.get());
+    if (!name || _nameResolution->getBinding(callee.get())
+        || _capturedUses->count(callee.get())) {
+        return nullptr;
+    }
+    auto function = _symbolTable->getInlineFunction(*name);
+    if (!function || function->pats.size() != args.size()) {
+        return nullptr;
+    }
+    Substitutes substitutes;
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (!isAtomic(args[i])) {
+            return nullptr;
+        }
+        // an argument named as a free name of the body could not be told
+        // from it in the copy.
+        auto argName = getName(args[i].get());
+        if (argName && function->freeNames.count(*argName)) {
+            return nullptr;
+        }
+        shared_ptr<TypAST> typ;
+        auto param = getParam(function->pats[i].get(), typ);
+        // the annotation only matters to an argument of a type variable, as
+        // the call is checked.
+        auto type = ASTProperty::getType(args[i]);
+        if (type && type->getTypeId() != Type::VARIABLE_TYPE_NAME) {
+            typ = nullptr;
+        }
+        substitutes[*param] = {args[i], typ};
+    }
+    ++_inlinedCalls[*name];
+    return copy(function->body, substitutes);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include "AST/ASTRewriter.h"
+
+class NameResolutionPass;
+
+class SymbolTable;
+
+/**
+ * Inlines the calls of small non-recursive functions declared by previous
+ * top-level declarations, which are compiled into modules of their own and
+ * never inlined by LLVM.
+ *
+ * A function declared alone, by a single clause of variable parameters, is
+ * recorded in the symbol table once checked, if its body is an expression
+ * without any binding of at most threshold asts. A call applying it to all of
+ * its parameters is substituted by a copy of its body, if each argument is a
+ * constant or an identifier, so that no evaluation is duplicated or dropped,
+ * and no free name of the body is bound at the call again, by the ast or as
+ * an argument, so that the copy refers to the same bindings.
+ */
+class Inliner : protected ASTRewriter {
+public:
+    static constexpr size_t DEFAULT_THRESHOLD = 32;
+
+    /**
+     * @param symbolTable The symbol table recording the functions, or null for
+     * the default one.
+     */
+    explicit Inliner(size_t threshold = DEFAULT_THRESHOLD,
+                     SymbolTable *symbolTable = nullptr);
+
+    /**
+     * Inline the calls of the recorded functions in a checked ast. The copied
+     * bodies have no types, thus the ast should be checked again if any call
+     * is inlined.
+     * @param ast The checked top-level ast.
+     * @return The ast with the calls inlined, or the ast itself if none is.
+     */
+    std::shared_ptr<AST> inlineCalls(const std::shared_ptr<AST> &ast);
+
+    /**
+     * Record the function declared by a checked top-level ast in the symbol
+     * table, if it could be inlined.
+     * @param ast The checked top-level ast.
+     */
+    void record(const std::shared_ptr<AST> &ast);
+
+    /**
+     * @return The number of calls inlined of each function by the last
+     * inlineCalls.
+     */
+    [[nodiscard]] const std::map<std::string, size_t> &getInlinedCalls() const;
+
+    [[nodiscard]] size_t getThreshold() const;
+
+    /**
+     * Set the maximum number of asts in the body of a function to record.
+     * @param threshold The threshold, 0 to disable inlining.
+     */
+    void setThreshold(size_t threshold);
+
+protected:
+    std::shared_ptr<ExpAST>
+    rewriteExp(const std::shared_ptr<ExpAST> &exp) override;
+
+private:
+    std::shared_ptr<ExpAST>
+    inlineCall(const std::shared_ptr<ApplicationExpAST> &call);
+
+    size_t _threshold;
+
+    SymbolTable *_symbolTable;
+
+    /**
+     * The names resolved in the ast whose calls are being inlined, to skip
+     * the calls of local names.
+     */
+    NameResolutionPass *_nameResolution{};
+
+    /**
+     * The uses of the recorded functions in the ast where a free name of
+     * their body is bound locally, to skip as the body would be captured.
+     */
+    const std::unordered_set<const AST *> *_capturedUses{};
+
+    std::map<std::string, size_t> _inlinedCalls;
+};
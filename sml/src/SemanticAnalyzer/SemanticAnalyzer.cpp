@@ -2,7 +2,8 @@
 #include "SemanticAnalyzerImpl.h"
 using namespace std;
 
-SemanticAnalyzer::SemanticAnalyzer() : _impl(std::make_unique<Impl>()) {
+SemanticAnalyzer::SemanticAnalyzer(SymbolTable *symbolTable)
+        : _impl(std::make_unique<Impl>(symbolTable)) {
 
 }
 
@@ -11,3 +12,30 @@ SemanticAnalyzer::~SemanticAnalyzer() = default;
 std::shared_ptr<AST> SemanticAnalyzer::check(const std::shared_ptr<AST>& ast) {
     return _impl->check(ast);
 }
+
+std::vector<std::shared_ptr<AST>> SemanticAnalyzer::checkAll(
+        const std::vector<std::shared_ptr<AST>> &asts, unsigned threads) {
+    return _impl->checkAll(asts, threads);
+}
+
+const std::map<std::string, size_t> &SemanticAnalyzer::getInlinedCalls() const {
+    return _impl->inliner.getInlinedCalls();
+}
+
+void SemanticAnalyzer::setInlineThreshold(size_t threshold) {
+    _impl->inliner.setThreshold(threshold);
+}
+
+SemanticAnalyzer::TypeCacheStatistics
+SemanticAnalyzer::getTypeCacheStatistics() const {
+    return _impl->typeCacheStatistics;
+}
+
+void SemanticAnalyzer::setInferenceEngine(InferenceEngine engine) {
+    _impl->inferenceEngine = engine;
+}
+
+SemanticAnalyzer::DifferentialStatistics
+SemanticAnalyzer::getDifferentialStatistics() const {
+    return _impl->differentialStatistics;
+}
@@ -1,21 +1,547 @@
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include "AST/AST.h"
+#include "AST/ASTAnalyses.h"
+#include "AST/ASTPass.h"
+#include "AST/ASTProperty.h"
+#include "ConstantFolder.h"
+#include "ConstraintSolver.h"
+#include "Error.h"
 #include "SemanticAnalyzerImpl.h"
+#include "Symbol/Region.h"
 #include "Symbol/SymbolTable.h"
 #include "TypeCheck.h"
 
 using namespace std;
 
+namespace {
+    /**
+     * Check whether two verified types are the same up to a renaming of
+     * their variables.
+     * @param renamed The variables of the first renamed to those of the
+     * second, and back, so far.
+     */
+    bool isAlphaEquivalent(Type *s, Type *t,
+                           unordered_map<Type *, Type *> &renamed) {
+        if (!s || !t || s->getTypeId() != t->getTypeId()) {
+            return s == t;
+        }
+        switch (s->getTypeId()) {
+            case Type::LIST:
+                return isAlphaEquivalent(s->toListType()->getSubtype(),
+                                         t->toListType()->getSubtype(),
+                                         renamed);
+            case Type::TUPLE: {
+                auto &&types1 = s->toTupleType()->getTypes();
+                auto &&types2 = t->toTupleType()->getTypes();
+                if (types1.size() != types2.size()) {
+                    return false;
+                }
+                for (size_t i = 0; i < types1.size(); ++i) {
+                    if (!isAlphaEquivalent(types1[i], types2[i], renamed)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            case Type::FUNCTION: {
+                auto &&types1 = s->toFunctionType()->getTypes();
+                auto &&types2 = t->toFunctionType()->getTypes();
+                if (types1.size() != types2.size()) {
+                    return false;
+                }
+                for (size_t i = 0; i < types1.size(); ++i) {
+                    if (!isAlphaEquivalent(types1[i].first, types2[i].first,
+                                           renamed)
+                        || !isAlphaEquivalent(types1[i].second,
+                                              types2[i].second, renamed)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            case Type::VARIABLE_TYPE_NAME:
+                // the variables of both are apart, thus they are renamed in
+                // one map.
+                return renamed.emplace(s, t).first->second == t
+                       && renamed.emplace(t, s).first->second == s;
+            case Type::RECORD:
+            case Type::TYPE_NAME:
+                return s == t;
+            default:
+                return true;
+        }
+    }
+
+    bool isAlphaEquivalent(Type *s, Type *t) {
+        unordered_map<Type *, Type *> renamed;
+        return isAlphaEquivalent(s, t, renamed);
+    }
+
+    template<typename TVisit>
+    void visitPreorder(AST *ast, TVisit &&visit) {
+        visit(ast);
+        vector<AST *> children;
+        ast->getChildren(children);
+        for (auto child : children) {
+            visitPreorder(child, visit);
+        }
+    }
+
+    /**
+     * Resolve the types of the asts by a check, whose variables die with it.
+     */
+    void resolveTypes(AST *ast, TypeCheck &typeCheck) {
+        visitPreorder(ast, [&typeCheck](AST *node) {
+            if (auto type = ASTProperty::getType(node)) {
+                ASTProperty::setType(node, typeCheck.verify(type));
+            }
+        });
+    }
+
+    template<typename T>
+    void appendBytes(string &bytes, const T &value) {
+        bytes.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    /**
+     * Append the structure of a type to a key.
+     * @param type The type, which may be null if the name is not bound.
+     * @param variables The number of each variable met.
+     * @return Whether the type has no variable bound outside.
+     */
+    bool appendType(string &key, Type *type,
+                    unordered_map<Type *, size_t> &variables) {
+        if (!type) {
+            key += '\0';
+            return true;
+        }
+        auto typeId = type->getTypeId();
+        appendBytes(key, typeId);
+        switch (typeId) {
+            case Type::LIST:
+                return appendType(key, type->toListType()->getSubtype(),
+                                  variables);
+            case Type::TUPLE: {
+                auto &&types = type->toTupleType()->getTypes();
+                appendBytes(key, types.size());
+                for (auto subtype : types) {
+                    if (!appendType(key, subtype, variables)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            case Type::FUNCTION: {
+                auto &&types = type->toFunctionType()->getTypes();
+                appendBytes(key, types.size());
+                for (auto &&[ret, param] : types) {
+                    if (!appendType(key, ret, variables)
+                        || !appendType(key, param, variables)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            case Type::RECORD: {
+                auto &&fields = type->toRecordType()->getFields();
+                appendBytes(key, fields.size());
+                for (auto &&[label, subtype] : fields) {
+                    // the labels are interned once.
+                    appendBytes(key, label);
+                    if (!appendType(key, subtype, variables)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            case Type::TYPE_NAME:
+                appendBytes(key, type);
+                return true;
+            case Type::VARIABLE_TYPE_NAME: {
+                // a generalized variable is instantiated on each use, thus
+                // only its position matters.
+                if (!type->toVariableTypeNameType()->isGeneric()) {
+                    return false;
+                }
+                auto number = variables.emplace(type, variables.size());
+                appendBytes(key, number.first->second);
+                return true;
+            }
+            default:
+                return true;
+        }
+    }
+}
+
+SemanticAnalyzer::Impl::Impl(SymbolTable *symbolTable)
+        : symbolTable(symbolTable ? symbolTable : SymbolTable::getInstance()),
+          inliner(Inliner::DEFAULT_THRESHOLD, this->symbolTable) {
+
+}
+
 std::shared_ptr<AST> SemanticAnalyzer::Impl::check(
         const std::shared_ptr<AST> &ast) {
-    if (!ast) {
-        return ast;
+    if (!ast || !typeCheck(ast)) {
+        return nullptr;
+    }
+    return optimize(ast);
+}
+
+std::shared_ptr<AST> SemanticAnalyzer::Impl::optimize(
+        const std::shared_ptr<AST> &ast) {
+    // the copied bodies of inlined functions are typed by checking again.
+    auto result = inliner.inlineCalls(ast);
+    if (result != ast && !typeCheck(result)) {
+        typeCheck(ast);
+        result = ast;
+    }
+    inliner.record(result);
+    return ConstantFolder(symbolTable).fold(result);
+}
+
+vector<shared_ptr<AST>> SemanticAnalyzer::Impl::checkAll(
+        const vector<shared_ptr<AST>> &asts, unsigned threads) {
+    vector<shared_ptr<AST>> results(asts.size());
+    // shared asts would be typed by several checks at once.
+    if (threads <= 1 || asts.size() <= 1 || AST::isHashConsing()) {
+        for (size_t i = 0; i < asts.size(); ++i) {
+            results[i] = check(asts[i]);
+        }
+        return results;
+    }
+
+    // an ast depends on the last ast before it which may bind any of its free
+    // names. asts only see the ones before them, thus the graph is acyclic.
+    FreeVariablePass freeVariables;
+    BoundNamePass boundNames;
+    ASTPassManager manager;
+    manager.addPass(freeVariables);
+    manager.addPass(boundNames);
+    manager.run(asts, threads);
+    vector<vector<size_t>> dependents(asts.size());
+    vector<size_t> dependencies(asts.size());
+    unordered_map<string, size_t> lastBinders;
+    for (size_t i = 0; i < asts.size(); ++i) {
+        if (!asts[i]) {
+            continue;
+        }
+        set<size_t> binders;
+        for (auto &&name : freeVariables.getFreeVariables(asts[i].get())) {
+            auto found = lastBinders.find(name);
+            if (found != lastBinders.end()) {
+                binders.insert(found->second);
+            }
+        }
+        for (auto binder : binders) {
+            dependents[binder].push_back(i);
+        }
+        dependencies[i] = binders.size();
+        for (auto &&name : boundNames.getBoundNames(asts[i].get())) {
+            lastBinders[name] = i;
+        }
+        lastBinders["it"] = i;
+    }
+
+    // the asts are checked by the workers once their dependencies are
+    // committed, i.e. bound in the symbol table by this thread in the order
+    // of the asts, so that each of them sees the same symbols as checked one
+    // by one.
+    struct Inferred {
+        bool done{};
+
+        /**
+         * Whether the ast is left to be checked on commit, as it could not be
+         * cached.
+         */
+        bool deferred{};
+
+        bool typed{};
+
+        Bindings bindings;
+
+        vector<string> errors;
+    };
+    vector<Inferred> inferred(asts.size());
+    priority_queue<size_t, vector<size_t>, greater<>> ready;
+    for (size_t i = 0; i < asts.size(); ++i) {
+        if (asts[i] && !dependencies[i]) {
+            ready.push(i);
+        }
     }
-    TypeCheck typeCheck;
-    if (auto type = (Type *) ast->accept(&typeCheck)) {
-        typeCheck.fillTypes();
-        type = typeCheck.verify(type);
-        SymbolTable::getInstance()->insertPatternType("it", type);
-        return ast;
+    mutex lock;
+    condition_variable readyChanged, doneChanged;
+    bool finished = false;
+
+    auto infer = [this, &asts](Inferred &result, size_t i) {
+        auto &&ast = asts[i];
+        string key;
+        if (!getCacheKey(ast.get(), key)) {
+            // unifying the variables of its free names would race with the
+            // other checks using them.
+            result.deferred = true;
+            return;
+        }
+        if (reuse(ast.get(), key, result.bindings)) {
+            result.typed = true;
+            return;
+        }
+        TypeCheck typeCheck(true, symbolTable);
+        auto type = typeCheck.dispatch(ast);
+        if (type) {
+            typeCheck.fillTypes();
+            typeCheck.generalize(type);
+            type = typeCheck.verify(type);
+            resolveTypes(ast.get(), typeCheck);
+        }
+        result.typed = type;
+        result.bindings = typeCheck.getBindings();
+        result.errors = typeCheck.getErrors();
+        if (type) {
+            result.bindings.emplace_back("it", type);
+            cache(ast.get(), std::move(key), result.bindings);
+        }
+    };
+    vector<thread> workers;
+    // the workers allocate the symbols in the region of this thread.
+    auto &region = Region::getCurrent();
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            Region::Scope _1{region};
+            unique_lock<mutex> guard{lock};
+            while (true) {
+                readyChanged.wait(guard, [&] {
+                    return finished || !ready.empty();
+                });
+                if (ready.empty()) {
+                    return;
+                }
+                auto i = ready.top();
+                ready.pop();
+                guard.unlock();
+                infer(inferred[i], i);
+                guard.lock();
+                inferred[i].done = true;
+                doneChanged.notify_all();
+            }
+        });
+    }
+
+    for (size_t i = 0; i < asts.size(); ++i) {
+        if (!asts[i]) {
+            continue;
+        }
+        {
+            unique_lock<mutex> guard{lock};
+            doneChanged.wait(guard, [&] { return inferred[i].done; });
+        }
+        auto &result = inferred[i];
+        if (result.deferred) {
+            results[i] = check(asts[i]);
+        } else {
+            for (auto &&[name, type] : result.bindings) {
+                symbolTable->insertPatternType(name, type);
+            }
+            for (auto &&error : result.errors) {
+                Error(error);
+            }
+            if (result.typed) {
+                results[i] = optimize(asts[i]);
+            }
+        }
+        lock_guard<mutex> guard{lock};
+        for (auto dependent : dependents[i]) {
+            if (!--dependencies[dependent]) {
+                ready.push(dependent);
+            }
+        }
+        readyChanged.notify_all();
+    }
+    {
+        lock_guard<mutex> guard{lock};
+        finished = true;
+        readyChanged.notify_all();
+    }
+    for (auto &&worker : workers) {
+        worker.join();
+    }
+    return results;
+}
+
+bool SemanticAnalyzer::Impl::typeCheck(const std::shared_ptr<AST> &ast) {
+    string key;
+    bool cacheable = getCacheKey(ast.get(), key);
+    if (cacheable) {
+        Bindings cached;
+        if (reuse(ast.get(), key, cached)) {
+            for (auto &&[name, type] : cached) {
+                symbolTable->insertPatternType(name, type);
+            }
+            return true;
+        }
+    } else {
+        lock_guard<mutex> _1{typeCacheLock};
+        ++typeCacheStatistics.misses;
+    }
+
+    Bindings bindings;
+    if (!infer(ast.get(), bindings)) {
+        return false;
+    }
+    if (cacheable) {
+        cache(ast.get(), std::move(key), std::move(bindings));
+    }
+    return true;
+}
+
+bool SemanticAnalyzer::Impl::infer(AST *ast, Bindings &bindings) {
+    using clock = chrono::steady_clock;
+    if (inferenceEngine == InferenceEngine::TYPE_CHECK) {
+        return inferByTypeCheck(ast, bindings);
+    }
+    ConstraintSolver solver(symbolTable);
+    auto start = clock::now();
+    auto solved = solver.solve(ast);
+    auto solverTime = clock::now() - start;
+    if (solver.isUnsupported()) {
+        return inferByTypeCheck(ast, bindings);
+    }
+    if (inferenceEngine == InferenceEngine::CONSTRAINT_SOLVER) {
+        for (auto &&error : solver.getErrors()) {
+            Error(error);
+        }
+        if (!solved) {
+            return false;
+        }
+        solver.apply();
+        bindings = solver.getBindings();
+        for (auto &&[name, type] : bindings) {
+            symbolTable->insertPatternType(name, type);
+        }
+        return true;
+    }
+
+    start = clock::now();
+    auto typed = inferByTypeCheck(ast, bindings);
+    auto typeCheckTime = clock::now() - start;
+    auto &&statistics = differentialStatistics;
+    ++statistics.checks;
+    statistics.solverSeconds += chrono::duration<double>(solverTime).count();
+    statistics.typeCheckSeconds +=
+            chrono::duration<double>(typeCheckTime).count();
+    auto agreed = solved == typed;
+    if (agreed && typed) {
+        // the last binding of a name is the one left in the symbol table.
+        unordered_map<string, Type *> solvedTypes, typedTypes;
+        for (auto &&[name, type] : solver.getBindings()) {
+            solvedTypes[name] = type;
+        }
+        for (auto &&[name, type] : bindings) {
+            typedTypes[name] = type;
+        }
+        for (auto &&[name, type] : solvedTypes) {
+            auto found = typedTypes.find(name);
+            agreed = agreed && found != typedTypes.end()
+                     && isAlphaEquivalent(type, found->second);
+        }
+        for (auto &&[node, primitive] : solver.getPrimitives()) {
+            agreed = agreed && ASTProperty::getPrimitive(node) == primitive;
+        }
+    }
+    statistics.mismatches += !agreed;
+    return typed;
+}
+
+bool SemanticAnalyzer::Impl::inferByTypeCheck(AST *ast, Bindings &bindings) {
+    TypeCheck typeCheck(false, symbolTable);
+    auto type = typeCheck.dispatch(ast);
+    if (!type) {
+        return false;
+    }
+    typeCheck.fillTypes();
+    typeCheck.generalize(type);
+    type = typeCheck.verify(type);
+    resolveTypes(ast, typeCheck);
+    symbolTable->insertPatternType("it", type);
+    bindings = typeCheck.getBindings();
+    bindings.emplace_back("it", type);
+    return true;
+}
+
+bool SemanticAnalyzer::Impl::reuse(AST *ast, const string &key,
+                                   Bindings &bindings) {
+    CachedCheck cached;
+    {
+        lock_guard<mutex> _1{typeCacheLock};
+        auto found = typeCache.find(key);
+        if (found == typeCache.end()) {
+            ++typeCacheStatistics.misses;
+            return false;
+        }
+        ++typeCacheStatistics.hits;
+        // the check may be evicted once unlocked.
+        cached = found->second;
+    }
+    auto next = cached.types.begin();
+    auto nextPrimitive = cached.primitives.begin();
+    auto nextOffset = cached.fieldOffsets.begin();
+    visitPreorder(ast, [&next, &nextPrimitive, &nextOffset](AST *node) {
+        ASTProperty::setType(node, *next++);
+        ASTProperty::setPrimitive(node, *nextPrimitive++);
+        if (auto selector = AST::dynCast<RecordSelectorExpAST>(node)) {
+            ASTProperty::setFieldOffset(selector, *nextOffset++);
+        }
+    });
+    bindings = std::move(cached.bindings);
+    return true;
+}
+
+void SemanticAnalyzer::Impl::cache(AST *ast, string key, Bindings bindings) {
+    CachedCheck cached{std::move(bindings), {}, {}, {}};
+    visitPreorder(ast, [&cached](AST *node) {
+        cached.types.push_back(ASTProperty::getType(node));
+        cached.primitives.push_back(ASTProperty::getPrimitive(node));
+        if (auto selector = AST::dynCast<RecordSelectorExpAST>(node)) {
+            cached.fieldOffsets.push_back(
+                    ASTProperty::getFieldOffset(selector));
+        }
+    });
+    lock_guard<mutex> _1{typeCacheLock};
+    auto [inserted, isNew] = typeCache.emplace(std::move(key),
+                                              std::move(cached));
+    if (!isNew) {
+        return;
+    }
+    typeCacheOrder.push_back(&inserted->first);
+    if (typeCacheOrder.size() > TYPE_CACHE_CAPACITY) {
+        typeCache.erase(typeCache.find(*typeCacheOrder.front()));
+        typeCacheOrder.pop_front();
+    }
+}
+
+bool SemanticAnalyzer::Impl::getCacheKey(AST *ast, string &key) {
+    StructurePass structure;
+    FreeVariablePass freeVariables;
+    ASTPassManager manager;
+    manager.addPass(structure);
+    manager.addPass(freeVariables);
+    manager.run(ast);
+    key = structure.getStructure(ast);
+    unordered_map<Type *, size_t> variables;
+    for (auto &&name : freeVariables.getFreeVariables(ast)) {
+        appendBytes(key, name.size());
+        key += name;
+        auto type = symbolTable->getPatternType(name);
+        if (!appendType(key, type, variables)) {
+            return false;
+        }
     }
-    return nullptr;
+    return true;
 }
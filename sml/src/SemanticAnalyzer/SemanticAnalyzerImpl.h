@@ -1,15 +1,139 @@
 #pragma once
 
+#include <deque>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Inliner.h"
 #include "SemanticAnalyzer.h"
 
 class AST;
 
 class Type;
 
+enum class Primitive : unsigned char;
+
 struct SemanticAnalyzer::Impl {
+    explicit Impl(SymbolTable *symbolTable);
+
     ~Impl() = default;
 
     std::shared_ptr<AST> check(const std::shared_ptr<AST> &ast);
-};
\ No newline at end of file
+
+    std::vector<std::shared_ptr<AST>>
+    checkAll(const std::vector<std::shared_ptr<AST>> &asts, unsigned threads);
+
+    /**
+     * Inline the calls and fold the constants of a type checked ast.
+     * @param ast The type checked ast.
+     * @return The ast to generate code for.
+     */
+    std::shared_ptr<AST> optimize(const std::shared_ptr<AST> &ast);
+
+    /**
+     * Type check an ast, and bind the names it declares. The types are
+     * reused from the cache if an identical ast is checked before with the
+     * same types of its free names.
+     * @param ast The ast.
+     * @return Whether the ast is well typed.
+     */
+    bool typeCheck(const std::shared_ptr<AST> &ast);
+
+    /**
+     * Get the key of an ast in the cache, i.e. its structure followed by the
+     * types of its free names, whose variables are numbered in the order
+     * they occur.
+     * @param ast The ast.
+     * @param key Set to the key.
+     * @return Whether the ast could be cached, which it could not if any free
+     * name has a type of a variable bound outside, as unifying it would bind
+     * the free name too.
+     */
+    bool getCacheKey(AST *ast, std::string &key);
+
+    using Bindings = std::vector<std::pair<std::string, Type *>>;
+
+    /**
+     * Infer the types of an ast by the selected engine, and bind the names it
+     * declares.
+     * @param ast The ast.
+     * @param bindings Set to the pattern types bound, including it.
+     * @return Whether the ast is well typed.
+     */
+    bool infer(AST *ast, Bindings &bindings);
+
+    bool inferByTypeCheck(AST *ast, Bindings &bindings);
+
+    /**
+     * The result of a successful type check of a top-level ast.
+     */
+    struct CachedCheck {
+        /**
+         * The pattern types bound in the symbol table, including it.
+         */
+        Bindings bindings;
+
+        /**
+         * The type of each ast in preorder.
+         */
+        std::vector<Type *> types;
+
+        /**
+         * The primitive resolved for each ast in preorder.
+         */
+        std::vector<Primitive> primitives;
+
+        /**
+         * The field offset resolved for each record selector in preorder.
+         */
+        std::vector<int> fieldOffsets;
+    };
+
+    /**
+     * Find the cached check of an ast and type the ast by it, with the
+     * resolved primitives and field offsets, and count the check as a hit or a miss.
+     * @param ast The ast.
+     * @param key The key of the ast.
+     * @param bindings Set to the cached pattern types, including it.
+     * @return Whether the check is cached.
+     */
+    bool reuse(AST *ast, const std::string &key, Bindings &bindings);
+
+    /**
+     * Cache a successful check of an ast, evicting the oldest check when
+     * more than TYPE_CACHE_CAPACITY are cached.
+     * @param ast The checked ast.
+     * @param key The key of the ast.
+     * @param bindings The pattern types bound, including it.
+     */
+    void cache(AST *ast, std::string key, Bindings bindings);
+
+    SymbolTable *symbolTable;
+
+    Inliner inliner;
+
+    /**
+     * Guards the cache and its statistics, which are shared by the checks
+     * in parallel.
+     */
+    std::mutex typeCacheLock;
+
+    static constexpr size_t TYPE_CACHE_CAPACITY = 1024;
+
+    std::unordered_map<std::string, CachedCheck> typeCache;
+
+    /**
+     * The keys of the cached checks, the oldest first.
+     */
+    std::deque<const std::string *> typeCacheOrder;
+
+    TypeCacheStatistics typeCacheStatistics;
+
+    InferenceEngine inferenceEngine{InferenceEngine::TYPE_CHECK};
+
+    DifferentialStatistics differentialStatistics;
+};
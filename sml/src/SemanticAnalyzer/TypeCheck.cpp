@@ -15,11 +15,18 @@ static Type *setASTType(AST *ast, Type *type) {
     return type;
 }
 
-void *TypeCheck::visit(ValueDecAST *ast) {
-    return unify(visitAsType(ast->getValBind()), ast);
+Type *TypeCheck::visit(ValueDecAST *ast) {
+    Type *type;
+    {
+        IncreaseLevelGuard _1{*this};
+        type = visitAsType(ast->getValBind());
+    }
+    // there is no reference, thus no value restriction is needed.
+    generalize(type);
+    return unify(type, ast);
 }
 
-void *TypeCheck::visit(DestructuringValBindAST *ast) {
+Type *TypeCheck::visit(DestructuringValBindAST *ast) {
     // TODO: multiple valbind
     if (auto &&andValBind = ast->getAndValBind()) {
         return nullptr;
@@ -27,40 +34,40 @@ void *TypeCheck::visit(DestructuringValBindAST *ast) {
     // visit value first, in case that we meet
     // val i = i;
     // where i is defined before and assign it to i itself.
-    NextIdToSearchGuard _2{VALUE};
+    NextIdToSearchGuard _2{*this, VALUE};
     auto typeExp = visitAsType(ast->getExp());
-    NextIdToSearchGuard _1{PATTERN};
+    NextIdToSearchGuard _1{*this, PATTERN};
     auto typePat = visitAsType(ast->getPat());
     auto res = unify(typePat, typeExp, ast);
     return res;
 }
 
-void *TypeCheck::visit(TypeAnnotationExpAST *ast) {
-    NextIdToSearchGuard _1{VALUE};
+Type *TypeCheck::visit(TypeAnnotationExpAST *ast) {
+    NextIdToSearchGuard _1{*this, VALUE};
     auto typeExp = visitAsType(ast->getExp());
-    NextIdToSearchGuard _2{TYPE};
+    NextIdToSearchGuard _2{*this, TYPE};
     auto typeTyp = visitAsType(ast->getTyp());
     return unify(typeExp, typeTyp, ast);
 }
 
-void *TypeCheck::visit(TypeAnnotationPatAST *ast) {
-    NextIdToSearchGuard _1{PATTERN};
+Type *TypeCheck::visit(TypeAnnotationPatAST *ast) {
+    NextIdToSearchGuard _1{*this, PATTERN};
     auto typeExp = visitAsType(ast->getPat());
-    NextIdToSearchGuard _2{TYPE};
+    NextIdToSearchGuard _2{*this, TYPE};
     auto typeTyp = visitAsType(ast->getTyp());
     return unify(typeExp, typeTyp, ast);
 }
 
-void *TypeCheck::visit(VariablePatAST *ast) {
-    return ast->getId()->accept(this);
+Type *TypeCheck::visit(VariablePatAST *ast) {
+    return dispatch(ast->getId());
 }
 
-void *TypeCheck::visit(IdAST *ast) {
+Type *TypeCheck::visit(IdAST *ast) {
     auto &&name = ast->get();
     Type *res{};
     switch (getNextIdToSearch()) {
         case TYPE:
-            if (auto type = SymbolTable::getInstance()->getType(name)) {
+            if (auto type = _symbolTable->getType(name)) {
                 res = type;
             }
             break;
@@ -68,11 +75,13 @@ void *TypeCheck::visit(IdAST *ast) {
             // a value must be defined before, no matter it is a function
             // parameter or a defined variable.
             if (auto type = getPatternType(name)) {
-                type = find(type);
+                type = find(instantiate(type));
                 if (type->getTypeId() == Type::VARIABLE_TYPE_NAME) {
                     insertVarTypePatternToFill(name, type);
                 }
                 res = type;
+            } else if (auto type = getBuiltinArithmeticType(name)) {
+                res = type;
             }
             // now, for sentences like fn x => y, the rhs y is not existing in
             // the symbol table, and we do not have to add the var type value
@@ -90,33 +99,223 @@ void *TypeCheck::visit(IdAST *ast) {
     return unify(res, ast);
 }
 
-void *TypeCheck::visit(ConstantExpAST *ast) {
+Type *TypeCheck::visit(ConstantExpAST *ast) {
     return unify(visitAsType(ast->getCon()), ast);
 }
 
-void *TypeCheck::visit(IntConAST *ast) {
+Type *TypeCheck::visit(IntConAST *ast) {
     return unify(getIntType(), ast);
 }
 
 Type *TypeCheck::find(Type *t) {
-    // if t is not exists in dsu, set dsu[t] = t. the following codes do the
-    // same stuff.
-    if (!t) {
+    if (!t || t->getTypeId() != Type::VARIABLE_TYPE_NAME) {
         return t;
     }
-    if (dsu[t] == nullptr) {
-        return dsu[t] = t;
+    auto var = t->toVariableTypeNameType();
+    auto parent = var->getParent();
+    if (!parent) {
+        return t;
+    }
+    auto root = find(parent);
+    if (root != parent) {
+        var->setParent(root);
     }
-    return t == dsu[t] ? t : dsu[t] = find(dsu[t]);
+    return root;
 }
 
 Type *TypeCheck::uni(Type *t1, Type *t2) {
     t1 = find(t1);
     t2 = find(t2);
-    if (t1->getTypeId() == Type::VARIABLE_TYPE_NAME) {
-        return dsu[t1] = t2;
+    if (t1 == t2) {
+        return t1;
+    }
+    auto isVar1 = t1->getTypeId() == Type::VARIABLE_TYPE_NAME;
+    auto isVar2 = t2->getTypeId() == Type::VARIABLE_TYPE_NAME;
+    if (isVar1 && isVar2) {
+        auto var1 = t1->toVariableTypeNameType();
+        auto var2 = t2->toVariableTypeNameType();
+        if (var1->getRank() > var2->getRank()) {
+            link(var2, var1);
+            return var1;
+        }
+        if (var1->getRank() == var2->getRank()) {
+            var2->setRank(var2->getRank() + 1);
+            _unifiedVariables.push_back(var2);
+        }
+        link(var1, var2);
+        return var2;
+    }
+    if (isVar1 || isVar2) {
+        auto var = (isVar1 ? t1 : t2)->toVariableTypeNameType();
+        auto type = isVar1 ? t2 : t1;
+        if (occurs(var, type)) {
+            stringstream ss;
+            var->print(ss);
+            ss << " and ";
+            type->print(ss);
+            error("Could not match " + ss.str() + ", which is circular.");
+            return nullptr;
+        }
+        link(var, type);
+        return type;
+    }
+    // structural types are unified by their components.
+    return t1;
+}
+
+void TypeCheck::link(VariableTypeNameType *var, Type *parent) {
+    adjustLevels(parent, var->getLevel());
+    var->setParent(parent);
+    _unifiedVariables.push_back(var);
+}
+
+template<typename TVisit>
+void TypeCheck::walk(Type *type, TVisit &&visit) {
+    auto walk = Type::beginWalk();
+    _walkStack.assign(1, type);
+    while (!_walkStack.empty()) {
+        auto next = find(_walkStack.back());
+        _walkStack.pop_back();
+        if (!next || !next->mark(walk) || !visit(next)) {
+            continue;
+        }
+        switch (next->getTypeId()) {
+            case Type::LIST:
+                _walkStack.push_back(next->toListType()->getSubtype());
+                break;
+            case Type::RECORD:
+                for (auto &&field : next->toRecordType()->getFields()) {
+                    _walkStack.push_back(field.type);
+                }
+                break;
+            case Type::TUPLE: {
+                auto &&types = next->toTupleType()->getTypes();
+                _walkStack.insert(_walkStack.end(), types.begin(), types.end());
+                break;
+            }
+            case Type::FUNCTION:
+                for (auto &&[ret, param] : next->toFunctionType()->getTypes()) {
+                    _walkStack.push_back(ret);
+                    _walkStack.push_back(param);
+                }
+                break;
+            default:
+                break;
+        }
     }
-    return dsu[t2] = t1;
+}
+
+bool TypeCheck::occurs(VariableTypeNameType *var, Type *type) {
+    auto found = false;
+    walk(type, [var, &found](Type *t) {
+        found = found || t == var;
+        return !found;
+    });
+    return found;
+}
+
+void TypeCheck::adjustLevels(Type *type, unsigned level) {
+    walk(type, [this, level](Type *t) {
+        if (t->getTypeId() == Type::VARIABLE_TYPE_NAME) {
+            auto var = t->toVariableTypeNameType();
+            if (var->getLevel() > level) {
+                _adjustedLevels.emplace_back(var, var->getLevel());
+                var->setLevel(level);
+            }
+        }
+        return true;
+    });
+}
+
+void TypeCheck::generalize(Type *type) {
+    walk(type, [this](Type *t) {
+        if (t->getTypeId() == Type::VARIABLE_TYPE_NAME) {
+            auto var = t->toVariableTypeNameType();
+            if (var->getLevel() > _level) {
+                var->setLevel(VariableTypeNameType::GENERIC_LEVEL);
+            }
+        }
+        return true;
+    });
+}
+
+Type *TypeCheck::instantiate(Type *type) {
+    unordered_map<Type *, Type *> fresh;
+    return instantiate(type, fresh);
+}
+
+Type *TypeCheck::instantiate(Type *type,
+                             unordered_map<Type *, Type *> &fresh) {
+    type = find(type);
+    if (!type) {
+        return type;
+    }
+    // a type shared by several others is instantiated once.
+    auto found = fresh.find(type);
+    if (found != fresh.end()) {
+        return found->second;
+    }
+    Type *instance = type;
+    switch (type->getTypeId()) {
+        case Type::VARIABLE_TYPE_NAME:
+            if (type->toVariableTypeNameType()->isGeneric()) {
+                instance = getNextVariableTypeNameType();
+            }
+            break;
+        case Type::LIST: {
+            auto subtype = type->toListType()->getSubtype();
+            auto subinstance = instantiate(subtype, fresh);
+            if (subinstance != subtype) {
+                instance = ListType::create(subinstance);
+            }
+            break;
+        }
+        case Type::RECORD: {
+            auto fields = type->toRecordType()->getFields();
+            auto instantiated = false;
+            for (auto &&field : fields) {
+                auto fieldInstance = instantiate(field.type, fresh);
+                instantiated = instantiated || fieldInstance != field.type;
+                field.type = fieldInstance;
+            }
+            if (instantiated) {
+                instance = RecordType::create(std::move(fields));
+            }
+            break;
+        }
+        case Type::TUPLE: {
+            auto types = type->toTupleType()->getTypes();
+            auto instantiated = false;
+            for (auto &entry : types) {
+                auto entryInstance = instantiate(entry, fresh);
+                instantiated = instantiated || entryInstance != entry;
+                entry = entryInstance;
+            }
+            if (instantiated) {
+                instance = TupleType::create(types);
+            }
+            break;
+        }
+        case Type::FUNCTION: {
+            auto types = type->toFunctionType()->getTypes();
+            auto instantiated = false;
+            for (auto &&[ret, param] : types) {
+                auto retInstance = instantiate(ret, fresh);
+                auto paramInstance = instantiate(param, fresh);
+                instantiated = instantiated
+                               || retInstance != ret || paramInstance != param;
+                ret = retInstance;
+                param = paramInstance;
+            }
+            if (instantiated) {
+                instance = FunctionType::create(std::move(types));
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    return fresh[type] = instance;
 }
 
 Type *TypeCheck::unify(Type *s, Type *t, AST *ast) {
@@ -138,7 +337,7 @@ Type *TypeCheck::unify(Type *s, Type *t, AST *ast) {
         s = s->toTypeNameType()->getBoundType();
     }
 
-    // do a dsu find
+    // find the representatives
     s = find(s);
     t = find(t);
 
@@ -158,7 +357,7 @@ Type *TypeCheck::unify(Type *s, Type *t, AST *ast) {
         s->print(ss);
         ss << " and ";
         t->print(ss);
-        Error("Could not match " + ss.str() + '.');
+        error("Could not match " + ss.str() + '.');
         return setASTType(ast, nullptr);
     }
     switch (sid) {
@@ -176,18 +375,25 @@ Type *TypeCheck::unify(Type *s, Type *t, AST *ast) {
                                          t->toListType()->getSubtype())
                                    ? uni(s, t) : nullptr);
         case Type::RECORD: {
-            // both are records, unify each record entry's type
-            auto rec1 = s->toRecordType();
-            auto rec2 = t->toRecordType();
-            const auto &ent1 = rec1->getRecordEntries();
-            const auto &ent2 = rec2->getRecordEntries();
-            if (ent1.size() != ent2.size()) {
+            // both are records, unify the types of the fields of the same
+            // labels. the fields are sorted by their labels, thus merged in
+            // one pass.
+            const auto &fields1 = s->toRecordType()->getFields();
+            const auto &fields2 = t->toRecordType()->getFields();
+            auto matched = fields1.size() == fields2.size();
+            for (size_t i = 0; matched && i < fields1.size(); ++i) {
+                matched = fields1[i].label == fields2[i].label;
+            }
+            if (!matched) {
+                stringstream ss;
+                s->print(ss);
+                ss << " and ";
+                t->print(ss);
+                error("Could not match " + ss.str() + '.');
                 return setASTType(ast, nullptr);
             }
-            for (auto &&[key, val] : ent1) {
-                if (auto it = ent2.find(key); it == ent2.end()) {
-                    return setASTType(ast, nullptr);
-                } else if (it->second != val) {
+            for (size_t i = 0; i < fields1.size(); ++i) {
+                if (!unify(fields1[i].type, fields2[i].type)) {
                     return setASTType(ast, nullptr);
                 }
             }
@@ -239,18 +445,17 @@ Type *TypeCheck::unify(Type *s, Type *t, AST *ast) {
     return setASTType(ast, nullptr);
 }
 
-void *TypeCheck::visit(InfixApplicationExpAST *ast) {
+Type *TypeCheck::visit(InfixApplicationExpAST *ast) {
     Type *res{};
     auto &&idAST = ast->getId();
     auto &&idStr = idAST->get();
 
-    static unordered_set<string> arithmeticBuiltins =
-            {"+", "*", "-"};
     static unordered_set<string> comparableBuiltins =
             {"=", "<>", "<", ">", "<=", ">="};
     // for overloaded arithmetic builtins, check if their types are operand
-    // compatible and identical.
-    if (arithmeticBuiltins.count(idStr)) {
+    // compatible and identical, and resolve the overload by their type.
+    auto op = SymbolTable::getArithmeticOperator(idStr);
+    if (op != SymbolTable::NOT_ARITHMETIC && op != SymbolTable::NEG) {
         static auto isArithmeticType = [](Type *type) {
             if (!type) {
                 return false;
@@ -272,6 +477,8 @@ void *TypeCheck::visit(InfixApplicationExpAST *ast) {
                 }
             }
         }
+        ASTProperty::setPrimitive(ast, res ? SymbolTable::resolveArithmetic(
+                op, find(res)->getTypeId()) : Primitive::NONE);
         return unify(res, ast);
     }
 
@@ -289,17 +496,21 @@ void *TypeCheck::visit(InfixApplicationExpAST *ast) {
     // otherwise, the id is not builtin, get its value from symbol table and
     // treat it as an infix applicable function. here, the infix property is
     // ensured by the parser on building the ast.
-    auto value = SymbolTable::getInstance()->getValue(ast->getId()->get());
+    auto value = _symbolTable->getValue(ast->getId()->get());
     if (value) {
-        auto type = value->getType();
+        auto type = instantiate(value->getType());
         if (type->getTypeId() == Type::FUNCTION) {
             auto infixType = type->toFunctionType();
             auto lhsType = visitAsType(ast->getExp1());
             auto rhsType = visitAsType(ast->getExp2());
+            auto returnType = getNextVariableTypeNameType();
             auto tmpFunctionType = FunctionType::create(
-                    VariableTypeNameType::create(tempVarType.nextSmall()),
+                    returnType,
                     TupleType::create({lhsType, rhsType}));
-            res = unify(tmpFunctionType, infixType);
+            // the application has the return type, not the function type.
+            if (unify(tmpFunctionType, infixType)) {
+                res = find(returnType);
+            }
         }
     }
     return unify(res, ast);
@@ -313,19 +524,19 @@ Type *TypeCheck::visitBoolExp(
     return nullptr;
 }
 
-void *TypeCheck::visit(ConjunctionExpAST *ast) {
+Type *TypeCheck::visit(ConjunctionExpAST *ast) {
     auto ty1 = visitAsType(ast->getExp1());
     auto ty2 = visitAsType(ast->getExp2());
     return unify(unify(ty1, ty2), getBoolType(), ast);
 }
 
-void *TypeCheck::visit(DisjunctionExpAST *ast) {
+Type *TypeCheck::visit(DisjunctionExpAST *ast) {
     auto ty1 = visitAsType(ast->getExp1());
     auto ty2 = visitAsType(ast->getExp2());
     return unify(unify(ty1, ty2), getBoolType(), ast);
 }
 
-void *TypeCheck::visit(ConditionalExpAST *ast) {
+Type *TypeCheck::visit(ConditionalExpAST *ast) {
     if (unify(visitAsType(ast->getExp1()), getBoolType())) {
         return unify(visitAsType(ast->getExp2()),
                      visitAsType(ast->getExp3()),
@@ -335,18 +546,18 @@ void *TypeCheck::visit(ConditionalExpAST *ast) {
     }
 }
 
-void *TypeCheck::visit(ConstructorTypAST *ast) {
+Type *TypeCheck::visit(ConstructorTypAST *ast) {
     return unify(visitAsType(ast->getLongId()), ast);
 }
 
-void *TypeCheck::visit(LongIdAST *ast) {
+Type *TypeCheck::visit(LongIdAST *ast) {
     Type *res{};
     // TODO: long id with more than 1 id
     if (ast->getIds().size() == 1) {
         res = visitAsType(ast->getIds()[0]);
     } else {
         for (auto &&id : ast->getIds()) {
-            if (!id->accept(this)) {
+            if (!dispatch(id)) {
                 return nullptr;
             }
         }
@@ -354,35 +565,34 @@ void *TypeCheck::visit(LongIdAST *ast) {
     return unify(res, ast);
 }
 
-void *TypeCheck::visit(FloatConAST *ast) {
+Type *TypeCheck::visit(FloatConAST *ast) {
     return unify(getRealType(), ast);
 }
 
 TypeCheck::NextIdToSearchType TypeCheck::getNextIdToSearch() const {
-    if (NextIdToSearchGuard::_nextIdToSearch.empty()) {
+    if (_nextIdToSearch.empty()) {
         return VALUE;
     }
-    return static_cast<NextIdToSearchType>
-    (NextIdToSearchGuard::_nextIdToSearch.back());
+    return _nextIdToSearch.back();
 }
 
-void *TypeCheck::visit(BoolConAST *ast) {
+Type *TypeCheck::visit(BoolConAST *ast) {
     return unify(getBoolType(), ast);
 }
 
-void *TypeCheck::visit(CharConAST *ast) {
+Type *TypeCheck::visit(CharConAST *ast) {
     return unify(getCharType(), ast);
 }
 
-void *TypeCheck::visit(StringConAST *ast) {
+Type *TypeCheck::visit(StringConAST *ast) {
     return unify(getStringType(), ast);
 }
 
-void *TypeCheck::visit(ListExpAST *ast) {
+Type *TypeCheck::visit(ListExpAST *ast) {
     Type *res{};
     auto &&exps = ast->getExps();
     if (exps.empty()) {
-        res = ListType::create(VariableTypeNameType::create("'a"));
+        res = ListType::create(getNextVariableTypeNameType());
     } else {
         auto firstType = visitAsType(exps[0]);
         for (size_t i = 1; firstType && i < exps.size(); ++i) {
@@ -403,22 +613,102 @@ BoolType *TypeCheck::getBoolType() {
     return _boolType ?: _boolType = BoolType::create();
 }
 
-void *TypeCheck::visit(ApplicationExpAST *ast) {
+Type *TypeCheck::visit(ApplicationExpAST *ast) {
     Type *res{};
     auto &&exp1 = ast->getExp1();
+    // the builtin negation is overloaded like the arithmetic builtins, thus
+    // it has no pattern type unless bound again. resolve it by its operand.
+    if (isBuiltinNegation(exp1.get())) {
+        auto operandType = visitAsType(ast->getExp2());
+        if (operandType
+            && find(operandType)->getTypeId() == Type::VARIABLE_TYPE_NAME) {
+            operandType = unify(getIntType(), operandType);
+        }
+        auto primitive = operandType ? SymbolTable::resolveArithmetic(
+                SymbolTable::NEG, find(operandType)->getTypeId())
+                                     : Primitive::NONE;
+        ASTProperty::setPrimitive(ast, primitive);
+        if (primitive != Primitive::NONE) {
+            res = find(operandType);
+        }
+        return unify(res, ast);
+    }
+    if (auto selector = AST::dynCast<RecordSelectorExpAST>(exp1.get())) {
+        return unify(select(selector, visitAsType(ast->getExp2())), ast);
+    }
     auto lhsType = visitAsType(exp1);
-    if (lhsType->getTypeId() == Type::FUNCTION) {
+    if (lhsType && lhsType->getTypeId() == Type::FUNCTION) {
         auto rhsType = visitAsType(ast->getExp2());
         auto lhsFuncType = lhsType->toFunctionType();
-        Type *tmpFuncType;
-        tmpFuncType = FunctionType::create(
-                VariableTypeNameType::create(tempVarType.nextSmall()),
-                rhsType);
-        res = unify(lhsFuncType, tmpFuncType);
+        auto returnType = getNextVariableTypeNameType();
+        auto tmpFuncType = FunctionType::create(returnType, rhsType);
+        // the application has the return type, not the function type.
+        if (unify(lhsFuncType, tmpFuncType)) {
+            res = find(returnType);
+        }
     }
     return unify(res, ast);
 }
 
+bool TypeCheck::isBuiltinNegation(ExpAST *exp) {
+    auto id = AST::dynCast<ValueOrConstructorIdentifierExpAST>(exp);
+    if (!id || !id->getLongId() || id->getLongId()->getIds().size() != 1) {
+        return false;
+    }
+    auto &&name = id->getLongId()->getIds()[0]->get();
+    return SymbolTable::getArithmeticOperator(name) == SymbolTable::NEG
+           && !getPatternType(name);
+}
+
+Type *TypeCheck::getBuiltinArithmeticType(const std::string &name) {
+    auto op = SymbolTable::getArithmeticOperator(name);
+    if (op == SymbolTable::NOT_ARITHMETIC
+        || !_symbolTable->getBuiltinValue(name)
+        || SymbolTable::resolveArithmetic(op, Type::INT) == Primitive::NONE) {
+        return nullptr;
+    }
+    auto intType = getIntType();
+    Type *paramType = intType;
+    if (op != SymbolTable::NEG) {
+        paramType = TupleType::create({intType, intType});
+    }
+    return FunctionType::create(intType, paramType);
+}
+
+Type *TypeCheck::select(RecordSelectorExpAST *selector, Type *record) {
+    if (!record) {
+        return nullptr;
+    }
+    auto label = getLabel(selector->getLab().get());
+    record = find(record);
+    while (record->getTypeId() == Type::TYPE_NAME) {
+        record = find(record->toTypeNameType()->getBoundType());
+    }
+    if (record->getTypeId() != Type::RECORD) {
+        error("Could not resolve the record selected by #" + *label + '.');
+        return nullptr;
+    }
+    auto offset = record->toRecordType()->getFieldOffset(label);
+    ASTProperty::setFieldOffset(selector, offset);
+    if (offset < 0) {
+        stringstream ss;
+        record->print(ss);
+        error("Could not select " + *label + " of " + ss.str() + '.');
+        return nullptr;
+    }
+    auto field = record->toRecordType()->getFields()[offset].type;
+    unify(FunctionType::create(field, record), selector);
+    return field;
+}
+
+RecordType::Label TypeCheck::getLabel(LabAST *lab) {
+    if (auto number = AST::dynCast<NumberLabAST>(lab)) {
+        return RecordType::getLabel(to_string(number->getN()));
+    }
+    return RecordType::getLabel(
+            AST::cast<IdentifierLabAST *>(lab)->getId()->get());
+}
+
 RealType *TypeCheck::getRealType() {
     return _realType ?: _realType = RealType::create();
 }
@@ -431,20 +721,20 @@ StringType *TypeCheck::getStringType() {
     return _stringType ?: _stringType = StringType::create();
 }
 
-void *TypeCheck::visit(ValueOrConstructorIdentifierExpAST *ast) {
+Type *TypeCheck::visit(ValueOrConstructorIdentifierExpAST *ast) {
     return unify(visitAsType(ast->getLongId()), ast);
 }
 
-void *TypeCheck::visit(FunctionExpAST *ast) {
+Type *TypeCheck::visit(FunctionExpAST *ast) {
     return unify(visitAsType(ast->getMatch()), ast);
 }
 
-void *TypeCheck::visit(MatchAST *ast) {
+Type *TypeCheck::visit(MatchAST *ast) {
     Type *res{};
     // function's argument list first
-    NextIdToSearchGuard _1{PATTERN};
+    NextIdToSearchGuard _1{*this, PATTERN};
     auto patTyp = visitAsType(ast->getPat());
-    NextIdToSearchGuard _2{VALUE};
+    NextIdToSearchGuard _2{*this, VALUE};
     auto expTyp = visitAsType(ast->getExp());
     if (patTyp && expTyp) {
         fillVarTypePatterns();
@@ -453,7 +743,7 @@ void *TypeCheck::visit(MatchAST *ast) {
     return unify(res, ast);
 }
 
-void *TypeCheck::visit(ConstructionPatAST *ast) {
+Type *TypeCheck::visit(ConstructionPatAST *ast) {
     return visitAsType(ast->getLongId());
 }
 
@@ -461,23 +751,42 @@ void TypeCheck::insertVarTypePatternToFill(const std::string &name, Type *type)
     _varTypePatternToFill.emplace_back(name, type);
 }
 
+void TypeCheck::bind(const std::string &name, Type *type) {
+    if (_deferred) {
+        _deferredTypes[name] = type;
+    } else {
+        _symbolTable->insertPatternType(name, type);
+    }
+    _bindings.emplace_back(name, type);
+}
+
+const std::vector<std::pair<std::string, Type *>> &
+TypeCheck::getBindings() const {
+    return _bindings;
+}
+
+const std::vector<std::string> &TypeCheck::getErrors() const {
+    return _errors;
+}
+
+void TypeCheck::error(const std::string &message) {
+    if (_deferred) {
+        _errors.push_back(message);
+    } else {
+        Error(message);
+    }
+}
+
 void TypeCheck::fillVarTypePatterns() {
-    tempVarType.reset();
     for (auto &&[name, type_] : _varTypePatternToFill) {
-        if (auto type = find(type_)) {
-            if (type->getTypeId() != Type::VARIABLE_TYPE_NAME) {
-                SymbolTable::getInstance()->insertPatternType(name, type);
-            } else {
-                SymbolTable::getInstance()->insertPatternType(
-                        name,
-                        VariableTypeNameType::create(tempVarType.nextSmall()));
-            }
+        if (auto type = verify(type_)) {
+            bind(name, type);
         }
     }
     _varTypePatternToFill.clear();
 }
 
-void *TypeCheck::visit(TuplePatAST *ast) {
+Type *TypeCheck::visit(TuplePatAST *ast) {
     vector<Type *> types;
     for (auto &&pat : ast->getPats()) {
         if (auto type = visitAsType(pat)) {
@@ -489,104 +798,39 @@ void *TypeCheck::visit(TuplePatAST *ast) {
     return unify(TupleType::create(types), ast);
 }
 
-void TypeCheck::TempVarType::reset() {
-    curBig = 'Z';
-    curBig.shrink_to_fit();
-    curSmall = 'a';
-    curSmall.shrink_to_fit();
-}
-
-std::string TypeCheck::TempVarType::nextBig() {
-    auto ret = '\'' + curBig;
-    if (curBig.back() == 'A') {
-        if (all_of(curBig.rbegin(),
-                   curBig.rend(),
-                   [](char c) { return c == 'A'; })) {
-            for (auto &c : curBig) {
-                c = 'Z';
-            }
-            curBig += 'Z';
-        } else {
-            for (auto it = curBig.rbegin(); it != curBig.rend();) {
-                --*it;
-                if (*it < 'A') {
-                    *it = 'Z';
-                    --*++it;
-                } else {
-                    break;
-                }
-            }
-        }
-    } else {
-        --curBig.back();
-    }
-
-    return ret;
-}
-
-std::string TypeCheck::TempVarType::nextSmall() {
-    auto ret = '\'' + curSmall;
-    if (curSmall.back() == 'z') {
-        if (all_of(curSmall.rbegin(),
-                   curSmall.rend(),
-                   [](char c) { return c == 'z'; })) {
-            for (auto &c : curSmall) {
-                c = 'a';
-            }
-            curSmall += 'a';
-        } else {
-            for (auto it = curSmall.rbegin(); it != curSmall.rend();) {
-                ++*it;
-                if (*it > 'z') {
-                    *it = 'a';
-                    ++*++it;
-                } else {
-                    break;
-                }
-            }
-        }
-    } else {
-        ++curSmall.back();
-    }
-    return ret;
-}
-
 TypeCheck::NextIdToSearchGuard::NextIdToSearchGuard(
-        TypeCheck::NextIdToSearchType type) noexcept {
-    _nextIdToSearch.push_back(type);
+        TypeCheck &typeCheck, TypeCheck::NextIdToSearchType type) noexcept
+        : _typeCheck(typeCheck) {
+    _typeCheck._nextIdToSearch.push_back(type);
 }
 
 TypeCheck::NextIdToSearchGuard::~NextIdToSearchGuard() noexcept {
-    _nextIdToSearch.pop_back();
+    _typeCheck._nextIdToSearch.pop_back();
 }
 
-std::vector<TypeCheck::NextIdToSearchType>
-        TypeCheck::NextIdToSearchGuard::_nextIdToSearch;
-
 void TypeCheck::insertPatternType(const std::string &name, Type *type) {
-    auto &depth = IncreaseDepthGuard::_depth;
-    if (depth == -1) {
-        SymbolTable::getInstance()->insertPatternType(name, type);
-    } else {
-        IncreaseDepthGuard::_localTypes[depth][name] = type;
-    }
+    _localTypes.insert(name, type);
 }
 
 Type *TypeCheck::getPatternType(const std::string &name) {
-    for (auto i = IncreaseDepthGuard::_depth; i > -1; --i) {
-        if (IncreaseDepthGuard::_localTypes[i].count(name)) {
-            return IncreaseDepthGuard::_localTypes[i][name];
+    if (auto type = _localTypes.find(name)) {
+        return *type;
+    }
+    if (_deferred) {
+        auto found = _deferredTypes.find(name);
+        if (found != _deferredTypes.end()) {
+            return found->second;
         }
     }
-    return SymbolTable::getInstance()->getPatternType(name);
+    return _symbolTable->getPatternType(name);
 }
 
-void *TypeCheck::visit(LocalDeclarationExpAST *ast) {
-    IncreaseDepthGuard _1;
+Type *TypeCheck::visit(LocalDeclarationExpAST *ast) {
+    IncreaseDepthGuard _1{*this};
     auto decTyp = visitAsType(ast->getDec());
     Type *type{};
     if (decTyp) {
-        NextIdToSearchGuard _2{VALUE};
+        NextIdToSearchGuard _2{*this, VALUE};
         for (auto &&exp : ast->getExps()) {
             type = visitAsType(exp);
             if (!type) {
@@ -597,30 +841,26 @@ void *TypeCheck::visit(LocalDeclarationExpAST *ast) {
     return unify(type, ast);
 }
 
-Type *TypeCheck::unify(void *type, AST *ast) {
-    return unify(static_cast<Type *>(type), static_cast<Type *>(type), ast);
+Type *TypeCheck::unify(Type *type, AST *ast) {
+    return unify(type, type, ast);
 }
 
 void TypeCheck::fillTypes() {
-    tempVarType.reset();
-    for (auto &&[name, type_] : IncreaseDepthGuard::_localTypes[0]) {
+    _localTypes.forEachOutermost([this](auto &&name, Type *type_) {
         if (auto type = verify(type_)) {
-            if (type->getTypeId() != Type::VARIABLE_TYPE_NAME) {
-                SymbolTable::getInstance()->insertPatternType(name, type);
-            } else {
-                SymbolTable::getInstance()->insertPatternType(
-                        name,
-                        VariableTypeNameType::create(tempVarType.nextSmall()));
-            }
+            bind(name, type);
         }
-    }
+    });
 }
 
-Type *TypeCheck::getNextVariableTypeNameType() {
-    return VariableTypeNameType::create(tempVarType.nextSmall());
+VariableTypeNameType *TypeCheck::getNextVariableTypeNameType() {
+    auto var = _variables.create();
+    var->setLevel(_level);
+    _createdVariables.push_back(var);
+    return var;
 }
 
-void *TypeCheck::visit(FunctionTypAST *ast) {
+Type *TypeCheck::visit(FunctionTypAST *ast) {
     auto typ1 = visitAsType(ast->getTyp1());
     auto typ2 = visitAsType(ast->getTyp2());
     Type *res{};
@@ -630,15 +870,44 @@ void *TypeCheck::visit(FunctionTypAST *ast) {
     return unify(res, ast);
 }
 
-void *TypeCheck::visit(FunctionDecAST *ast) {
-    return ast->getFunBind()->accept(this);
+Type *TypeCheck::visit(RecordTypAST *ast) {
+    vector<RecordType::Field> fields;
+    for (auto row = ast->getTypRow().get(); row; row = row->getTypRow().get()) {
+        auto label = getLabel(row->getLab().get());
+        for (auto &&field : fields) {
+            if (field.label == label) {
+                error("Label " + *label + " is bound twice.");
+                return unify(nullptr, ast);
+            }
+        }
+        auto type = visitAsType(row->getTyp());
+        if (!type) {
+            return unify(nullptr, ast);
+        }
+        fields.push_back({label, type});
+    }
+    // {} is unit.
+    if (fields.empty()) {
+        return unify(UnitType::create(), ast);
+    }
+    return unify(RecordType::create(std::move(fields)), ast);
+}
+
+Type *TypeCheck::visit(FunctionDecAST *ast) {
+    Type *type;
+    {
+        IncreaseLevelGuard _1{*this};
+        type = dispatch(ast->getFunBind());
+    }
+    generalize(type);
+    return type;
 }
 
-void *TypeCheck::visit(NonFixFunMatchAST *ast) {
-    NextIdToSearchGuard _1{PATTERN};
+Type *TypeCheck::visit(NonFixFunMatchAST *ast) {
+    NextIdToSearchGuard _1{*this, PATTERN};
     auto idTyp = visitAsType(ast->getId());
     vector<Type *> types;
-    IncreaseDepthGuard _4;
+    IncreaseDepthGuard _4{*this};
     for (auto &&pat : ast->getPats()) {
         if (auto type = visitAsType(pat)) {
             types.push_back(type);
@@ -657,22 +926,22 @@ void *TypeCheck::visit(NonFixFunMatchAST *ast) {
             res = type;
         }
     }
-    NextIdToSearchGuard _2{VALUE};
+    NextIdToSearchGuard _2{*this, VALUE};
     auto expTyp = visitAsType(ast->getExp());
     res = FunctionType::create(expTyp, res);
     if (auto &&orfm = ast->getOrFunMatch()) {
         res = unify(res, visitAsType(orfm));
     }
     if (auto &&typ = ast->getTyp()) {
-        NextIdToSearchGuard _3{TYPE};
+        NextIdToSearchGuard _3{*this, TYPE};
         res = unify(res, visitAsType(typ));
     }
     res = unify(res, idTyp);
     return unify(res, ast);
 }
 
-void *TypeCheck::visit(InfixFunMatchAST *ast) {
-    NextIdToSearchGuard _1{PATTERN};
+Type *TypeCheck::visit(InfixFunMatchAST *ast) {
+    NextIdToSearchGuard _1{*this, PATTERN};
     auto typ1 = visitAsType(ast->getPat1());
     auto typ2 = visitAsType(ast->getPat2());
     Type *paramTyp{};
@@ -682,7 +951,7 @@ void *TypeCheck::visit(InfixFunMatchAST *ast) {
     } else {
         return nullptr;
     }
-    NextIdToSearchGuard _2{VALUE};
+    NextIdToSearchGuard _2{*this, VALUE};
     auto expTyp = visitAsType(ast->getExp());
     if (expTyp) {
         res = FunctionType::create(expTyp, paramTyp);
@@ -692,16 +961,16 @@ void *TypeCheck::visit(InfixFunMatchAST *ast) {
     if (auto &&orfm = ast->getOrFunMatch()) {
         res = unify(res, visitAsType(orfm));
     }
-    NextIdToSearchGuard _3{PATTERN};
+    NextIdToSearchGuard _3{*this, PATTERN};
     res = unify(res, visitAsType(ast->getId()));
     if (auto &&typ = ast->getTyp()) {
-        NextIdToSearchGuard _4{TYPE};
+        NextIdToSearchGuard _4{*this, TYPE};
         res = unify(res, visitAsType(typ));
     }
     return unify(res, ast);
 }
 
-void *TypeCheck::visit(FunBindAST *ast) {
+Type *TypeCheck::visit(FunBindAST *ast) {
     auto fmTyp = visitAsType(ast->getFunMatch());
     if (auto &&andFunBind = ast->getAndFunBind()) {
         fmTyp = unify(fmTyp, visitAsType(andFunBind));
@@ -710,33 +979,44 @@ void *TypeCheck::visit(FunBindAST *ast) {
 }
 
 Type *TypeCheck::verify(Type *type) {
+    unordered_map<Type *, Type *> verified;
+    return verify(type, verified);
+}
+
+Type *TypeCheck::verify(Type *type, unordered_map<Type *, Type *> &verified) {
     if (type == nullptr) {
         return type;
     }
+    // a type shared by several others is verified once.
+    auto found = verified.find(type);
+    if (found != verified.end()) {
+        return found->second;
+    }
+    Type *result = type;
     switch (type->getTypeId()) {
-        case Type::INT:
-        case Type::REAL:
-        case Type::STRING:
-        case Type::CHAR:
-        case Type::BOOL:
-        case Type::UNIT:
-            return type;
         case Type::LIST: {
             auto lty = type->toListType();
             auto sub = lty->getSubtype();
-            sub = verify(sub);
-            return ListType::create(sub);
+            sub = verify(sub, verified);
+            result = ListType::create(sub);
+            break;
         }
-        case Type::RECORD:
-            // not implemented
+        case Type::RECORD: {
+            auto fields = type->toRecordType()->getFields();
+            for (auto &&field : fields) {
+                field.type = verify(field.type, verified);
+            }
+            result = RecordType::create(std::move(fields));
             break;
+        }
         case Type::TUPLE: {
             auto tupleTyp = type->toTupleType();
             vector<Type *> types;
             for (auto ty : tupleTyp->getTypes()) {
-                types.emplace_back(verify(ty));
+                types.emplace_back(verify(ty, verified));
             }
-            return TupleType::create(types);
+            result = TupleType::create(types);
+            break;
         }
         case Type::FUNCTION: {
             auto funType = type->toFunctionType();
@@ -745,27 +1025,66 @@ Type *TypeCheck::verify(Type *type) {
             for (auto i = 0; i < n; ++i) {
                 auto retTyp = funType->getReturnType(i);
                 auto parTyp = funType->getParameterType(i);
-                retTyp = verify(retTyp);
-                parTyp = verify(parTyp);
+                retTyp = verify(retTyp, verified);
+                parTyp = verify(parTyp, verified);
                 types.emplace_back(retTyp, parTyp);
             }
-            return FunctionType::create(std::move(types));
+            result = FunctionType::create(std::move(types));
+            break;
         }
-        case Type::TYPE_NAME:
-            return type;
-        case Type::VARIABLE_TYPE_NAME:
-            return find(type);
+        case Type::VARIABLE_TYPE_NAME: {
+            // the type the variable is unified with may have variables too.
+            auto representative = find(type);
+            if (representative != type) {
+                result = verify(representative, verified);
+            } else if (!type->toVariableTypeNameType()->isNamed()) {
+                auto &named = _namedVariables[type];
+                result = named ? named : named = VariableTypeNameType::create(
+                        VariableTypeNameType::getName(
+                                _namedVariables.size() - 1));
+            }
+            break;
+        }
+        default:
+            break;
     }
-    return type;
+    return verified[type] = result;
 }
 
-TypeCheck::TypeCheck() {
-    TypeCheck::IncreaseDepthGuard::_depth = 0;
-    TypeCheck::IncreaseDepthGuard::_localTypes.clear();
-    TypeCheck::IncreaseDepthGuard::_localTypes.emplace_back();
+TypeCheck::TypeCheck(bool deferred, SymbolTable *symbolTable)
+        : _deferred(deferred),
+          _symbolTable(symbolTable ? symbolTable : SymbolTable::getInstance()) {
+
 }
 
-void *TypeCheck::visit(TupleExpAST *ast) {
+TypeCheck::~TypeCheck() {
+    for (auto var : _unifiedVariables) {
+        var->setParent(nullptr);
+        var->setRank(0);
+    }
+    for (auto it = _adjustedLevels.rbegin(); it != _adjustedLevels.rend(); ++it) {
+        if (!it->first->isGeneric()) {
+            it->first->setLevel(it->second);
+        }
+    }
+    // the remaining variables are bound by the symbol table, if any.
+    for (auto var : _createdVariables) {
+        if (!var->isGeneric()) {
+            var->setLevel(0);
+        }
+    }
+}
+
+TypeCheck::IncreaseLevelGuard::IncreaseLevelGuard(TypeCheck &typeCheck) noexcept
+        : _typeCheck(typeCheck) {
+    ++_typeCheck._level;
+}
+
+TypeCheck::IncreaseLevelGuard::~IncreaseLevelGuard() noexcept {
+    --_typeCheck._level;
+}
+
+Type *TypeCheck::visit(TupleExpAST *ast) {
     vector<Type *> types;
     for (auto &&exp : ast->getExps()) {
         if (auto type = visitAsType(exp)) {
@@ -777,7 +1096,7 @@ void *TypeCheck::visit(TupleExpAST *ast) {
     return unify(TupleType::create(types), ast);
 }
 
-void *TypeCheck::visit(SequenceDecAST *ast) {
+Type *TypeCheck::visit(SequenceDecAST *ast) {
     Type *type{};
     for (auto &&dec : ast->getDecs()) {
         type = visitAsType(dec);
@@ -788,24 +1107,19 @@ void *TypeCheck::visit(SequenceDecAST *ast) {
     return unify(type, ast);
 }
 
-void *TypeCheck::visit(LeftAssociativeInfixDecAST *ast) {
+Type *TypeCheck::visit(LeftAssociativeInfixDecAST *ast) {
     return unify(nullptr, ast);
 }
 
-void *TypeCheck::visit(RightAssociativeInfixDecAST *ast) {
+Type *TypeCheck::visit(RightAssociativeInfixDecAST *ast) {
     return unify(nullptr, ast);
 }
 
-int TypeCheck::IncreaseDepthGuard::_depth;
-std::vector<std::unordered_map<std::string, Type *>>
-        TypeCheck::IncreaseDepthGuard::_localTypes;
-
-TypeCheck::IncreaseDepthGuard::IncreaseDepthGuard() noexcept {
-    _localTypes.emplace_back();
-    ++_depth;
+TypeCheck::IncreaseDepthGuard::IncreaseDepthGuard(TypeCheck &typeCheck) noexcept
+        : _typeCheck(typeCheck) {
+    _typeCheck._localTypes.enterScope();
 }
 
 TypeCheck::IncreaseDepthGuard::~IncreaseDepthGuard() noexcept {
-    _localTypes.pop_back();
-    --_depth;
+    _typeCheck._localTypes.leaveScope();
 }
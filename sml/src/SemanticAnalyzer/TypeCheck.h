@@ -1,8 +1,10 @@
 #pragma once
 
-#include "AST/ASTVisitor.h"
+#include "AST/ASTTypedVisitor.h"
 #include "SemanticAnalyzer.h"
 #include "SemanticAnalyzerImpl.h"
+#include "Symbol/ScopedTable.h"
+#include "Symbol/SymbolTable.h"
 
 class Type;
 
@@ -23,102 +25,158 @@ class RealType;
 class VariableTypeNameType;
 
 // TODO: add detailed comments and sort the functions
-class TypeCheck : public ASTVisitor {
+class TypeCheck : public ASTTypedVisitor<TypeCheck, Type *> {
 public:
-    TypeCheck();
+    /**
+     * @param deferred Whether to defer the bindings and the errors of the
+     * check, which are then recorded instead of bound in the symbol table or
+     * reported, to be replayed in order later. The names bound by a deferred
+     * check are looked up among its own bindings first, so that checks of
+     * different asts could run in parallel.
+     * @param symbolTable The symbol table, or null for the default one.
+     */
+    explicit TypeCheck(bool deferred = false,
+                       SymbolTable *symbolTable = nullptr);
+
+    /**
+     * Undo the unification of the variables, which are shared by the symbol
+     * table and the next checks.
+     */
+    ~TypeCheck();
+
+    TypeCheck(const TypeCheck &) = delete;
+
+    TypeCheck &operator=(const TypeCheck &) = delete;
 
-    void *visit(TupleExpAST *ast) override;
+    using ASTTypedVisitor::visit;
 
-    void *visit(VariablePatAST *ast) override;
+    Type *visit(TupleExpAST *ast);
 
-    void *visit(TypeAnnotationExpAST *ast) override;
+    Type *visit(VariablePatAST *ast);
 
-    void *visit(TypeAnnotationPatAST *ast) override;
+    Type *visit(TypeAnnotationExpAST *ast);
 
-    void *visit(DestructuringValBindAST *ast) override;
+    Type *visit(TypeAnnotationPatAST *ast);
 
-    void *visit(ValueOrConstructorIdentifierExpAST *ast) override;
+    Type *visit(DestructuringValBindAST *ast);
 
-    void *visit(FunctionExpAST *ast) override;
+    Type *visit(ValueOrConstructorIdentifierExpAST *ast);
 
-    void *visit(FunctionTypAST *ast) override;
+    Type *visit(FunctionExpAST *ast);
 
-    void *visit(ValueDecAST *ast) override;
+    Type *visit(FunctionTypAST *ast);
 
-    void *visit(FloatConAST *ast) override;
+    Type *visit(RecordTypAST *ast);
 
-    void *visit(IntConAST *ast) override;
+    Type *visit(ValueDecAST *ast);
 
-    void *visit(BoolConAST *ast) override;
+    Type *visit(FloatConAST *ast);
 
-    void *visit(CharConAST *ast) override;
+    Type *visit(IntConAST *ast);
 
-    void *visit(StringConAST *ast) override;
+    Type *visit(BoolConAST *ast);
 
-    void *visit(ConstantExpAST *ast) override;
+    Type *visit(CharConAST *ast);
 
-    void *visit(IdAST *ast) override;
+    Type *visit(StringConAST *ast);
 
-    void *visit(ListExpAST *ast) override;
+    Type *visit(ConstantExpAST *ast);
 
-    void *visit(ApplicationExpAST *ast) override;
+    Type *visit(IdAST *ast);
 
-    void *visit(InfixApplicationExpAST *ast) override;
+    Type *visit(ListExpAST *ast);
 
-    void *visit(ConjunctionExpAST *ast) override;
+    Type *visit(ApplicationExpAST *ast);
 
-    void *visit(DisjunctionExpAST *ast) override;
+    Type *visit(InfixApplicationExpAST *ast);
 
-    void *visit(ConditionalExpAST *ast) override;
+    Type *visit(ConjunctionExpAST *ast);
 
-    void *visit(ConstructorTypAST *ast) override;
+    Type *visit(DisjunctionExpAST *ast);
 
-    void *visit(LongIdAST *ast) override;
+    Type *visit(ConditionalExpAST *ast);
 
-    void *visit(MatchAST *ast) override;
+    Type *visit(ConstructorTypAST *ast);
 
-    void *visit(ConstructionPatAST *ast) override;
+    Type *visit(LongIdAST *ast);
 
-    void *visit(TuplePatAST *ast) override;
+    Type *visit(MatchAST *ast);
 
-    void *visit(LocalDeclarationExpAST *ast) override;
+    Type *visit(ConstructionPatAST *ast);
 
-    void *visit(SequenceDecAST *ast) override;
+    Type *visit(TuplePatAST *ast);
 
-    void *visit(FunctionDecAST *ast) override;
+    Type *visit(LocalDeclarationExpAST *ast);
 
-    void *visit(NonFixFunMatchAST *ast) override;
+    Type *visit(SequenceDecAST *ast);
 
-    void *visit(InfixFunMatchAST *ast) override;
+    Type *visit(FunctionDecAST *ast);
 
-    void *visit(FunBindAST *ast) override;
+    Type *visit(NonFixFunMatchAST *ast);
 
-    void *visit(LeftAssociativeInfixDecAST *ast) override;
+    Type *visit(InfixFunMatchAST *ast);
 
-    void *visit(RightAssociativeInfixDecAST *ast) override;
+    Type *visit(FunBindAST *ast);
+
+    Type *visit(LeftAssociativeInfixDecAST *ast);
+
+    Type *visit(RightAssociativeInfixDecAST *ast);
 
     Type *unify(Type *t1, Type *t2, AST *ast = nullptr);
 
-    Type *unify(void *type, AST *ast);
+    Type *unify(Type *type, AST *ast);
 
+    /**
+     * Get the type a type is resolved to for the output, e.g. the symbol
+     * table. The numbered variables left are replaced by named ones, as 'a,
+     * 'b and so on.
+     * @param type The type.
+     * @return The verified type.
+     */
     Type *verify(Type *type);
 
+    /**
+     * @param verified The types verified so far, and their verified types.
+     */
+    Type *verify(Type *type, std::unordered_map<Type *, Type *> &verified);
+
+    /**
+     * Generalize the variables of a type bound deeper than the current
+     * level, i.e. those not bound by any enclosing declaration. Any use of a
+     * generalized variable is then instantiated by a fresh one.
+     * @param type The verified type of a declaration or a top-level
+     * expression.
+     */
+    void generalize(Type *type);
+
     void fillTypes();
 
-private:
+    /**
+     * Get the pattern types bound in the symbol table by the check, in the
+     * order they are bound.
+     * @return The names and their types.
+     */
+    [[nodiscard]] const std::vector<std::pair<std::string, Type *>> &
+    getBindings() const;
 
-    class TempVarType {
-    public:
-        void reset();
+    /**
+     * Get the errors of the check, which are only recorded if it is deferred.
+     * @return The error messages.
+     */
+    [[nodiscard]] const std::vector<std::string> &getErrors() const;
 
-        std::string nextBig();
+private:
 
-        std::string nextSmall();
+    /**
+     * The fresh variables of the check, numbered.
+     */
+    VariableTypeNameType::Pool _variables;
 
-    private:
-        std::string curBig = "Z";
-        std::string curSmall = "a";
-    } tempVarType;
+    /**
+     * The named variables verified in place of the numbered ones, named in
+     * the order they are verified.
+     */
+    std::unordered_map<Type *, Type *> _namedVariables;
 
     // Basic type cache for type check convenience.
     IntType *getIntType();
@@ -147,18 +205,124 @@ private:
 
     void fillVarTypePatterns();
 
+    /**
+     * Bind a pattern type in the symbol table, and record the binding.
+     */
+    void bind(const std::string &name, Type *type);
+
+    std::vector<std::pair<std::string, Type *>> _bindings;
+
+    /**
+     * Report an error, or record it if the check is deferred.
+     */
+    void error(const std::string &message);
+
+    bool _deferred;
+
+    SymbolTable *_symbolTable;
+
+    /**
+     * The last type bound to each name by a deferred check.
+     */
+    std::unordered_map<std::string, Type *> _deferredTypes;
+
+    std::vector<std::string> _errors;
+
     [[nodiscard]] Type *visitBoolExp(
             const std::shared_ptr<ExpAST> &exp, AST *ast);
 
+    /**
+     * Find the representative of a type, compressing the path to it. Only
+     * variables are unified with other types, any other type is a
+     * representative itself.
+     */
     Type *find(Type *t);
 
+    /**
+     * Union the classes of two types, by rank if both are variables.
+     * @return The representative of the union.
+     */
     Type *uni(Type *t1, Type *t2);
 
-    inline Type *visitAsType(const std::shared_ptr<AST> &ast) {
-        return static_cast<Type *>(ast->accept(this));
+    void link(VariableTypeNameType *var, Type *parent);
+
+    /**
+     * Check whether a variable occurs in a type, in which case unifying them
+     * would make the type cyclic.
+     */
+    bool occurs(VariableTypeNameType *var, Type *type);
+
+    /**
+     * Visit the representatives of the types in a type once each, in a walk
+     * marking the types visited, so that a type shared by several others is
+     * not visited again.
+     * @param visit Called with each representative, returning whether to
+     * visit the types in it.
+     */
+    template<typename TVisit>
+    void walk(Type *type, TVisit &&visit);
+
+    /**
+     * The types left to visit by walk.
+     */
+    std::vector<Type *> _walkStack;
+
+    /**
+     * Lower the levels of the variables of a type to a level at most, as the
+     * type is unified with a variable of the level.
+     */
+    void adjustLevels(Type *type, unsigned level);
+
+    /**
+     * Replace the generalized variables of a type by fresh ones.
+     * @param type The type of a use.
+     * @param fresh The instances of the types instantiated so far, e.g. the
+     * fresh variables of the generalized ones replaced.
+     * @return The instantiated type, or the type itself if it has no
+     * generalized variable.
+     */
+    Type *instantiate(Type *type,
+                      std::unordered_map<Type *, Type *> &fresh);
+
+    Type *instantiate(Type *type);
+
+    template<typename TAST>
+    inline Type *visitAsType(const std::shared_ptr<TAST> &ast) {
+        return dispatch(ast);
     }
 
-    std::unordered_map<Type *, Type *> dsu;
+    /**
+     * The variables whose parent or rank is set by this check, to be reset on
+     * destruction.
+     */
+    std::vector<VariableTypeNameType *> _unifiedVariables;
+
+    /**
+     * The variables created by this check, which are left at the outermost
+     * level on destruction unless generalized.
+     */
+    std::vector<VariableTypeNameType *> _createdVariables;
+
+    /**
+     * The variables whose levels are lowered by this check, with their levels
+     * before, to be restored on destruction unless generalized since.
+     */
+    std::vector<std::pair<VariableTypeNameType *, unsigned>> _adjustedLevels;
+
+    /**
+     * The number of the declarations enclosing what is being checked.
+     */
+    unsigned _level{};
+
+    struct IncreaseLevelGuard {
+    public:
+        explicit IncreaseLevelGuard(TypeCheck &typeCheck) noexcept;
+
+        ~IncreaseLevelGuard() noexcept;
+
+    private:
+        TypeCheck &_typeCheck;
+    };
 
     /**
      * The next identifier to search is a type or a value.
@@ -173,29 +337,69 @@ private:
 
     struct NextIdToSearchGuard {
     public:
-        explicit NextIdToSearchGuard(NextIdToSearchType type) noexcept;
+        NextIdToSearchGuard(TypeCheck &typeCheck,
+                            NextIdToSearchType type) noexcept;
 
         ~NextIdToSearchGuard() noexcept;
 
-        static std::vector<NextIdToSearchType> _nextIdToSearch;
+    private:
+        TypeCheck &_typeCheck;
     };
 
     NextIdToSearchType getNextIdToSearch() const;
 
+    std::vector<NextIdToSearchType> _nextIdToSearch;
+
+    /**
+     * Opens a scope of local pattern types, e.g. of a let expression.
+     */
     struct IncreaseDepthGuard {
     public:
-        IncreaseDepthGuard() noexcept;
+        explicit IncreaseDepthGuard(TypeCheck &typeCheck) noexcept;
 
         ~IncreaseDepthGuard() noexcept;
 
-        static int _depth;
-
-        static std::vector<std::unordered_map<std::string, Type *>> _localTypes;
+    private:
+        TypeCheck &_typeCheck;
     };
 
-    Type *getNextVariableTypeNameType();
+    /**
+     * The pattern types of the scopes, the outermost of which are bound in
+     * the symbol table by fillTypes.
+     */
+    ScopedTable<std::string, Type *> _localTypes;
+
+    /**
+     * Create a fresh variable of the current level.
+     */
+    VariableTypeNameType *getNextVariableTypeNameType();
 
     void insertPatternType(const std::string &name, Type *type);
 
     Type *getPatternType(const std::string &name);
+
+    /**
+     * Check whether an expression is the builtin negation ~, i.e. ~ is not
+     * bound to a pattern type.
+     */
+    bool isBuiltinNegation(ExpAST *exp);
+
+    /**
+     * Get the type of a builtin arithmetic operator not applied, e.g. op +,
+     * which is its int overload as in SML, as it is overloaded thus has no
+     * pattern type unless bound again.
+     * @return The type, or null if the name is no such builtin.
+     */
+    Type *getBuiltinArithmeticType(const std::string &name);
+
+    /**
+     * Resolve the field a record selector applied to a record selects. The
+     * record type must be known by then, as no flexible record is modeled.
+     * @param selector The record selector.
+     * @param record The type of the record.
+     * @return The type of the field, or null if it could not be resolved.
+     */
+    Type *select(RecordSelectorExpAST *selector, Type *record);
+
+    static RecordType::Label getLabel(LabAST *lab);
 };
@@ -1,8 +1,12 @@
 #include <memory>
 #include "gtest/gtest.h"
 #include "AST/AST.h"
+#include "AST/ASTAnalyses.h"
+#include "AST/ASTPass.h"
+#include "AST/ASTProperty.h"
 #include "AST/ASTVisitor.h"
 #include "ASTPrinter.h"
+#include "Symbol/SymbolTable.h"
 
 using namespace std;
 
@@ -30,3 +34,180 @@ TEST_F(ASTTest, ASTTest_Print_Test) {
     ASTPrinter astPrinter;
     dec->accept(&astPrinter);
 }
+
+TEST_F(ASTTest, ASTTest_PropertyType_Test) {
+    auto con1 = create(IntConAST(1));
+    auto con2 = create(IntConAST(1));
+    auto type = IntType::create();
+    ASSERT_EQ(ASTProperty::getType(con1), nullptr);
+    ASTProperty::setType(con1, type);
+    ASSERT_EQ(ASTProperty::getType(con1), type);
+    ASSERT_EQ(ASTProperty::getType(con2), nullptr);
+    ASTProperty::setType(nullptr, type);
+    ASSERT_EQ(ASTProperty::getType(nullptr), nullptr);
+
+    // an id may be shared, thus carries no type.
+    auto id = create(AlphanumericIdAST("x"));
+    ASTProperty::setType(id, type);
+    ASSERT_EQ(ASTProperty::getType(id), nullptr);
+}
+
+TEST_F(ASTTest, ASTTest_Kind_Test) {
+    auto id = create(AlphanumericIdAST("x"));
+    auto var = create(EqualityVarAST("'a"));
+    auto match = create(NonFixFunMatchAST(id, {}, nullptr));
+    auto exp = create(ConstantExpAST(create(IntConAST(2))));
+    ASSERT_EQ(id->getKind(), ASTKind::AlphanumericIdAST);
+    ASSERT_EQ(var->getKind(), ASTKind::EqualityVarAST);
+    ASSERT_EQ(match->getKind(), ASTKind::NonFixFunMatchAST);
+    ASSERT_EQ(exp->getKind(), ASTKind::ConstantExpAST);
+    ASSERT_EQ(create(VarAST("'b"))->getKind(), ASTKind::VarAST);
+    ASSERT_EQ(create(WildCardPatAST())->getKind(), ASTKind::WildCardPatAST);
+
+    ASSERT_TRUE(AST::isa<IdAST>(id));
+    ASSERT_TRUE(AST::isa<AST>(id));
+    ASSERT_FALSE(AST::isa<SymbolicIdAST>(id));
+    ASSERT_TRUE(AST::isa<VarAST>(var));
+    ASSERT_TRUE(AST::isa<FunMatchAST>(match));
+    ASSERT_FALSE(AST::isa<ExpAST>(std::shared_ptr<AST>()));
+
+    std::shared_ptr<AST> ast = exp;
+    ASSERT_EQ(AST::dynCast<ExpAST>(ast), exp);
+    ASSERT_EQ(AST::dynCast<ConstantExpAST>(ast.get()), exp.get());
+    ASSERT_EQ(AST::dynCast<PatAST>(ast), nullptr);
+}
+
+TEST_F(ASTTest, ASTTest_HashConsing_Test) {
+    auto intTyp = [] {
+        return AST::create<ConstructorTypAST>(
+                AST::create<LongIdAST>(std::vector<std::shared_ptr<IdAST>>{
+                        AST::create<AlphanumericIdAST>("int")}));
+    };
+    auto varTyp = [] {
+        return AST::create<VariableTypAST>(AST::create<VarAST>("'a"));
+    };
+
+    AST::clearHashConsing();
+    ASSERT_NE(AST::create<IntConAST>(1), AST::create<IntConAST>(1));
+
+    AST::setHashConsing(true);
+    auto con1 = AST::create<IntConAST>(1);
+    ASSERT_EQ(AST::create<IntConAST>(1), con1);
+    ASSERT_NE(AST::create<IntConAST>(2), con1);
+    ASSERT_NE(AST::create<FloatConAST>(1.0), AST::create<FloatConAST>(1.5));
+    ASSERT_EQ(AST::create<StringConAST>("s"), AST::create<StringConAST>("s"));
+    ASSERT_NE(std::static_pointer_cast<IdAST>(
+                      AST::create<AlphanumericIdAST>("x")),
+              std::static_pointer_cast<IdAST>(
+                      AST::create<SymbolicIdAST>("x")));
+
+    auto fn1 = AST::create<FunctionTypAST>(intTyp(), intTyp());
+    ASSERT_EQ(AST::create<FunctionTypAST>(intTyp(), intTyp()), fn1);
+    ASSERT_EQ(fn1->getTyp1(), fn1->getTyp2());
+    ASSERT_NE(AST::create<FunctionTypAST>(varTyp(), intTyp()),
+              AST::create<FunctionTypAST>(varTyp(), intTyp()));
+
+    // a replaced ast is never kept alive by the table.
+    std::weak_ptr<IntConAST> con3 = AST::create<IntConAST>(3);
+    ASSERT_TRUE(con3.expired());
+    ASSERT_NE(AST::create<IntConAST>(3), nullptr);
+
+    auto statistics = AST::getHashConsStatistics();
+    ASSERT_GT(statistics.hits, 0u);
+    ASSERT_GT(statistics.savedBytes, 0u);
+
+    AST::setHashConsing(false);
+    AST::clearHashConsing();
+    ASSERT_NE(AST::create<IntConAST>(1), con1);
+    ASSERT_EQ(AST::getHashConsStatistics().hits, 0u);
+}
+
+TEST_F(ASTTest, ASTTest_Pass_Test) {
+    auto id = [](const std::string &name) {
+        return AST::create<AlphanumericIdAST>(name);
+    };
+    auto var = [&](const std::string &name) {
+        return AST::create<ValueOrConstructorIdentifierExpAST>(
+                AST::create<LongIdAST>(
+                        std::vector<std::shared_ptr<IdAST>>{id(name)}));
+    };
+    auto con = [](int v) {
+        return AST::create<ConstantExpAST>(AST::create<IntConAST>(v));
+    };
+
+    // fun f x = x + y
+    auto x = AST::create<VariablePatAST>(id("x"));
+    auto useX = var("x");
+    auto fun = AST::create<FunctionDecAST>(
+            AST::create<FunBindAST>(
+                    AST::create<NonFixFunMatchAST>(
+                            id("f"),
+                            std::vector<std::shared_ptr<PatAST>>{x},
+                            AST::create<InfixApplicationExpAST>(
+                                    useX, id("+"), var("y")))));
+    // val z = f (1 + 2)
+    auto sum = AST::create<InfixApplicationExpAST>(con(1), id("+"), con(2));
+    auto val = AST::create<ValueDecAST>(
+            AST::create<DestructuringValBindAST>(
+                    AST::create<VariablePatAST>(id("z")),
+                    AST::create<ApplicationExpAST>(
+                            var("f"),
+                            AST::create<ParenthesesExpAST>(sum))));
+    std::vector<std::shared_ptr<AST>> roots{fun, val, fun, val};
+    // val z = f (1 + 2) built apart, and val z = f (1 + 3)
+    auto valOf = [&](int v) {
+        return AST::create<ValueDecAST>(
+                AST::create<DestructuringValBindAST>(
+                        AST::create<VariablePatAST>(id("z")),
+                        AST::create<ApplicationExpAST>(
+                                var("f"),
+                                AST::create<ParenthesesExpAST>(
+                                        AST::create<InfixApplicationExpAST>(
+                                                con(1), id("+"), con(v))))));
+    };
+    auto same = valOf(2);
+    auto other = valOf(3);
+
+    for (unsigned threads : {1u, 3u}) {
+        NodeCountPass nodeCount;
+        ConstantPass constant;
+        NameResolutionPass nameResolution;
+        FreeVariablePass freeVariable;
+        BoundNamePass boundName;
+        StructurePass structure;
+        ASTPassManager manager;
+        manager.addPass(nodeCount);
+        manager.addPass(constant);
+        manager.addPass(nameResolution);
+        manager.addPass(freeVariable);
+        manager.addPass(boundName);
+        manager.addPass(structure);
+        manager.run(roots, threads);
+        ASTPassManager structureManager;
+        structureManager.addPass(structure);
+        structureManager.run(same.get());
+        structureManager.run(other.get());
+
+        ASSERT_EQ(nodeCount.getCount(ASTKind::ConstantExpAST), 4u);
+        ASSERT_EQ(nodeCount.getCount(ASTKind::FunctionDecAST), 2u);
+        ASSERT_TRUE(constant.isConstant(sum.get()));
+        ASSERT_FALSE(constant.isConstant(val.get()));
+        ASSERT_EQ(constant.getConstants().size(), 4u);
+        ASSERT_EQ(nameResolution.getBinding(useX.get()), x.get());
+        ASSERT_EQ(nameResolution.getBinding(sum.get()), nullptr);
+        ASSERT_EQ(freeVariable.getFreeVariables(fun.get()),
+                  (std::set<std::string>{"+", "y"}));
+        ASSERT_EQ(freeVariable.getFreeVariables(val.get()),
+                  (std::set<std::string>{"+", "f"}));
+        ASSERT_EQ(boundName.getBoundNames(fun.get()),
+                  (std::set<std::string>{"f", "x"}));
+        ASSERT_EQ(boundName.getBoundNames(val.get()),
+                  (std::set<std::string>{"z"}));
+        ASSERT_EQ(structure.getStructure(same.get()),
+                  structure.getStructure(val.get()));
+        ASSERT_NE(structure.getStructure(other.get()),
+                  structure.getStructure(val.get()));
+        ASSERT_NE(structure.getStructure(fun.get()),
+                  structure.getStructure(val.get()));
+    }
+}
@@ -1,6 +1,9 @@
+#include <cstdlib>
 #include <memory>
+#include <sstream>
 #include "gtest/gtest.h"
 #include "AST/AST.h"
+#include "AST/ASTProperty.h"
 #include "AST/ASTVisitor.h"
 #include "SemanticAnalyzer.h"
 #include "src/SemanticAnalyzer/TypeCheck.h"
@@ -8,6 +11,43 @@
 
 using namespace std;
 
+/**
+ * Reports the differential checks of the constraint solver against the type
+ * check over all the tests, with the speedup of the solver, if the
+ * SML_DIFFERENTIAL_REPORT environment variable is set.
+ */
+class DifferentialEnvironment : public testing::Environment {
+public:
+    using Statistics = SemanticAnalyzer::DifferentialStatistics;
+
+    static void add(const Statistics &before, const Statistics &after) {
+        totals.checks += after.checks - before.checks;
+        totals.mismatches += after.mismatches - before.mismatches;
+        totals.typeCheckSeconds +=
+                after.typeCheckSeconds - before.typeCheckSeconds;
+        totals.solverSeconds += after.solverSeconds - before.solverSeconds;
+    }
+
+    void TearDown() override {
+        if (!std::getenv("SML_DIFFERENTIAL_REPORT")) {
+            return;
+        }
+        printf("[ DIFFERENTIAL ] %zu checks, %zu mismatches, "
+               "type check %.3f ms, constraint solver %.3f ms, "
+               "speedup %.2fx\n",
+               totals.checks, totals.mismatches,
+               totals.typeCheckSeconds * 1e3, totals.solverSeconds * 1e3,
+               totals.solverSeconds > 0
+               ? totals.typeCheckSeconds / totals.solverSeconds : 0);
+    }
+
+private:
+    inline static Statistics totals;
+};
+
+static auto *const differentialEnvironment =
+        testing::AddGlobalTestEnvironment(new DifferentialEnvironment);
+
 class SemaTest : public testing::Test {
 protected:
     template<typename ASTT>
@@ -20,11 +60,73 @@ protected:
         return std::make_shared<ASTT>(std::forward<ASTT>(p));
     }
 
+    inline auto var(const char *name) {
+        return create(ValueOrConstructorIdentifierExpAST(
+                create(LongIdAST({create(AlphanumericIdAST(name))}))));
+    }
+
+    inline auto constant(int i) {
+        return create(ConstantExpAST(create(IntConAST(i))));
+    }
+
+    inline auto constant(bool b) {
+        return create(ConstantExpAST(create(BoolConAST(b))));
+    }
+
+    template<typename ConT>
+    inline auto constant(ConT &&con) {
+        return create(ConstantExpAST(create(std::forward<ConT>(con))));
+    }
+
+    inline auto fun(const char *name, const char *param,
+                    shared_ptr<ExpAST> const &body) {
+        return create(FunctionDecAST(
+                create(FunBindAST(
+                        create(NonFixFunMatchAST(
+                                create(AlphanumericIdAST(name)),
+                                {create(VariablePatAST(
+                                        create(AlphanumericIdAST(param))))},
+                                body))))));
+    }
+
+    inline auto fn(const char *param, shared_ptr<ExpAST> const &body) {
+        return create(FunctionExpAST(create(MatchAST(
+                create(VariablePatAST(create(AlphanumericIdAST(param)))),
+                body))));
+    }
+
+    inline auto val(const char *name, shared_ptr<ExpAST> const &exp) {
+        return create(ValueDecAST(
+                create(DestructuringValBindAST(
+                        create(VariablePatAST(create(AlphanumericIdAST(name)))),
+                        exp))));
+    }
+
+    inline auto app(shared_ptr<ExpAST> const &exp1,
+                    shared_ptr<ExpAST> const &exp2) {
+        return create(ApplicationExpAST(exp1, exp2));
+    }
+
+    inline auto infix(shared_ptr<ExpAST> const &exp1, const char *op,
+                      shared_ptr<ExpAST> const &exp2) {
+        return create(InfixApplicationExpAST(
+                exp1, create(AlphanumericIdAST(op)), exp2));
+    }
+
     inline auto check(shared_ptr<AST> const &ast, bool reserved = false) {
         if (!reserved || !semanticAnalyzer) {
             semanticAnalyzer = std::make_unique<SemanticAnalyzer>();
+            semanticAnalyzer->setInferenceEngine(
+                    SemanticAnalyzer::InferenceEngine::DIFFERENTIAL);
         }
-        return semanticAnalyzer->check(ast);
+        // each check is inferred by the constraint solver too, which should
+        // agree with the type check.
+        auto before = semanticAnalyzer->getDifferentialStatistics();
+        auto result = semanticAnalyzer->check(ast);
+        auto after = semanticAnalyzer->getDifferentialStatistics();
+        EXPECT_EQ(after.mismatches, before.mismatches);
+        DifferentialEnvironment::add(before, after);
+        return result;
     }
 
     inline static auto addPattern(
@@ -64,6 +166,100 @@ class FunctionDecTest : public SemaTest {
 
 };
 
+class InlinerTest : public SemaTest {
+protected:
+    inline static auto inlineFunction(const std::string &name) {
+        return SymbolTable::getInstance()->getInlineFunction(name);
+    }
+};
+
+class GeneralizationTest : public SemaTest {
+
+};
+
+class TypeCacheTest : public SemaTest {
+
+};
+
+class ParallelCheckTest : public SemaTest {
+protected:
+    /**
+     * Print the type bound to each name, or - if none.
+     */
+    inline static auto typesOf(const std::vector<std::string> &names) {
+        std::stringstream ss;
+        for (auto &&name : names) {
+            ss << name << ": ";
+            if (auto type = typeOf(name)) {
+                ss << *type;
+            } else {
+                ss << '-';
+            }
+            ss << '\n';
+        }
+        return ss.str();
+    }
+};
+
+class OccursCheckTest : public SemaTest {
+
+};
+
+class RecordTest : public SemaTest {
+protected:
+    inline auto typ(const char *name) {
+        return create(ConstructorTypAST(
+                create(LongIdAST({create(AlphanumericIdAST(name))}))));
+    }
+
+    inline auto label(const char *name) {
+        return create(IdentifierLabAST(create(AlphanumericIdAST(name))));
+    }
+
+    /**
+     * {a: int, b: real} for {{"a", "int"}, {"b", "real"}}.
+     */
+    inline auto record(
+            const std::vector<std::pair<const char *, const char *>> &rows) {
+        shared_ptr<TypRowAST> row;
+        for (auto it = rows.rbegin(); it != rows.rend(); ++it) {
+            row = create(TypRowAST(label(it->first), typ(it->second), row));
+        }
+        return create(RecordTypAST(row));
+    }
+
+    /**
+     * fn (r : record) => #lab r
+     */
+    inline auto selectFn(shared_ptr<TypAST> const &record, const char *lab) {
+        auto pat = create(VariablePatAST(create(AlphanumericIdAST("r"))));
+        shared_ptr<PatAST> param = pat;
+        if (record) {
+            param = create(TypeAnnotationPatAST(pat, record));
+        }
+        return create(FunctionExpAST(create(MatchAST(param, app(
+                create(RecordSelectorExpAST(label(lab))), var("r"))))));
+    }
+};
+
+class ConstantFoldingTest : public SemaTest {
+protected:
+    template<typename ConT>
+    inline static auto foldedTo(shared_ptr<AST> const &ast) {
+        auto exp = AST::dynCast<ConstantExpAST>(ast);
+        return exp && AST::isa<ConT>(exp->getCon())
+               ? AST::cast<ConT>(exp->getCon()) : nullptr;
+    }
+};
+
+class ArithmeticResolutionTest : public ConstantFoldingTest {
+
+};
+
+class UnifyTest : public SemaTest {
+
+};
+
 TEST_F(ValDecTest, ValDecTest_TypeCheck_Test) {
     //region val i : int = 2; // must be ok
     {
@@ -1030,6 +1226,33 @@ EXPECT_TRUE(typecheck.unify(a, b)) \
 #pragma pop_macro("EXPECT_EQ_TYPE")
 }
 
+TEST_F(TopLevelExpTest, TopLevelExpTest_Application_Test) {
+    //region (fn x => x) 42; int, not int -> int
+    {
+        auto appExp =
+                create(ApplicationExpAST(
+                        create(FunctionExpAST(
+                                create(MatchAST(
+                                        create(VariablePatAST(
+                                                create(AlphanumericIdAST("x"))
+                                        )),
+                                        create(ValueOrConstructorIdentifierExpAST(
+                                                create(LongIdAST(
+                                                        {create(AlphanumericIdAST("x"))}
+                                                ))
+                                        ))
+                                ))
+                        )),
+                        create(ConstantExpAST(
+                                create(IntConAST(42))
+                        ))
+                ));
+        EXPECT_TRUE(check(appExp));
+        EXPECT_EQ(typeIdOf("it"), Type::INT);
+    }
+    //endregion
+}
+
 TEST_F(ConditionalExpTest, ConditionalExpTest_ConditionalExp_Test) {
     //region val i : int = if true then 42 else 0; ok
     {
@@ -1346,3 +1569,587 @@ TEST_F(FunctionDecTest, FunctionDecTest_SimpleFunctionDec_Test) {
     }
     //endregion
 }
+
+TEST_F(ConstantFoldingTest, ConstantFoldingTest_Fold_Test) {
+    //region 1 + 2 * 3; folded to 7
+    {
+        auto exp = infix(constant(IntConAST(1)), "+",
+                         infix(constant(IntConAST(2)), "*",
+                               constant(IntConAST(3))));
+        auto folded = foldedTo<IntConAST>(check(exp));
+        ASSERT_TRUE(folded);
+        EXPECT_EQ(folded->get(), 7);
+        EXPECT_EQ(typeIdOf("it"), Type::INT);
+    }
+    //endregion
+
+    //region 1.5 * 2.0 - 0.5; folded to 2.5
+    {
+        auto exp = infix(infix(constant(FloatConAST(1.5)), "*",
+                               constant(FloatConAST(2.0))), "-",
+                         constant(FloatConAST(0.5)));
+        auto folded = foldedTo<FloatConAST>(check(exp));
+        ASSERT_TRUE(folded);
+        EXPECT_DOUBLE_EQ(folded->get(), 2.5);
+    }
+    //endregion
+
+    //region if 1 < 2 andalso true then "a" ^ "b" else "c"; folded to "ab"
+    {
+        auto exp = create(ConditionalExpAST(
+                create(ConjunctionExpAST(
+                        infix(constant(IntConAST(1)), "<",
+                              constant(IntConAST(2))),
+                        constant(BoolConAST(true)))),
+                infix(constant(StringConAST("a")), "^",
+                      constant(StringConAST("b"))),
+                constant(StringConAST("c"))));
+        auto folded = foldedTo<StringConAST>(check(exp));
+        ASSERT_TRUE(folded);
+        EXPECT_EQ(folded->get(), "ab");
+    }
+    //endregion
+
+    //region false orelse #"a" = #"b"; folded to false
+    {
+        auto exp = create(DisjunctionExpAST(
+                constant(BoolConAST(false)),
+                infix(constant(CharConAST('a')), "=",
+                      constant(CharConAST('b')))));
+        auto folded = foldedTo<BoolConAST>(check(exp));
+        ASSERT_TRUE(folded);
+        EXPECT_FALSE(folded->get());
+    }
+    //endregion
+
+    //region 2147483647 + 1; overflows, left to the runtime
+    {
+        auto exp = infix(constant(IntConAST(2147483647)), "+",
+                         constant(IntConAST(1)));
+        EXPECT_EQ(check(exp), exp);
+    }
+    //endregion
+
+    //region val x = 3 * 4 + 1; the bound expression is folded to 13
+    {
+        auto dec = create(ValueDecAST(
+                create(DestructuringValBindAST(
+                        create(VariablePatAST(create(AlphanumericIdAST("x")))),
+                        infix(infix(constant(IntConAST(3)), "*",
+                                    constant(IntConAST(4))), "+",
+                              constant(IntConAST(1)))))));
+        auto folded = AST::dynCast<ValueDecAST>(check(dec));
+        ASSERT_TRUE(folded);
+        auto valBind = AST::cast<DestructuringValBindAST>(folded->getValBind());
+        auto bound = foldedTo<IntConAST>(valBind->getExp());
+        ASSERT_TRUE(bound);
+        EXPECT_EQ(bound->get(), 13);
+        EXPECT_EQ(typeIdOf("x"), Type::INT);
+        resetSymbols();
+    }
+    //endregion
+
+    //region val i = x + 1 * 3; the operand is folded and typed
+    {
+        addPattern("x");
+        auto exp = infix(create(ValueOrConstructorIdentifierExpAST(
+                                 create(LongIdAST({create(
+                                         AlphanumericIdAST("x"))})))), "+",
+                         infix(constant(IntConAST(1)), "*",
+                               constant(IntConAST(3))));
+        auto dec = create(ValueDecAST(
+                create(DestructuringValBindAST(
+                        create(VariablePatAST(create(AlphanumericIdAST("i")))),
+                        exp))));
+        auto folded = AST::dynCast<ValueDecAST>(check(dec));
+        ASSERT_TRUE(folded);
+        EXPECT_NE(folded, dec);
+        auto valBind = AST::cast<DestructuringValBindAST>(folded->getValBind());
+        auto infixExp = AST::cast<InfixApplicationExpAST>(valBind->getExp());
+        auto operand = foldedTo<IntConAST>(infixExp->getExp2());
+        ASSERT_TRUE(operand);
+        EXPECT_EQ(operand->get(), 3);
+        EXPECT_EQ(ASTProperty::getType(infixExp->getExp2())->getTypeId(),
+                  Type::INT);
+        resetSymbols();
+    }
+    //endregion
+}
+
+TEST_F(ArithmeticResolutionTest, ArithmeticResolutionTest_Primitive_Test) {
+    EXPECT_EQ(SymbolTable::getArithmeticOperator("+"), SymbolTable::ADD);
+    EXPECT_EQ(SymbolTable::getArithmeticOperator("~"), SymbolTable::NEG);
+    EXPECT_EQ(SymbolTable::getArithmeticOperator("^"),
+              SymbolTable::NOT_ARITHMETIC);
+    EXPECT_EQ(SymbolTable::getArithmeticOperator("<>"),
+              SymbolTable::NOT_ARITHMETIC);
+    EXPECT_EQ(SymbolTable::resolveArithmetic(SymbolTable::SUB, Type::REAL),
+              Primitive::REAL_SUB);
+    EXPECT_EQ(SymbolTable::resolveArithmetic(SymbolTable::MUL, Type::STRING),
+              Primitive::NONE);
+
+    //region x + 1.5; resolved to the real addition
+    {
+        addPattern("x");
+        auto exp = infix(var("x"), "+", constant(FloatConAST(1.5)));
+        EXPECT_EQ(ASTProperty::getPrimitive(check(exp)), Primitive::REAL_ADD);
+        EXPECT_EQ(typeIdOf("it"), Type::REAL);
+        resetSymbols();
+    }
+    //endregion
+
+    //region x * y; the variables default to int
+    {
+        addPattern("x");
+        addPattern("y", "'b");
+        auto exp = infix(var("x"), "*", var("y"));
+        EXPECT_EQ(ASTProperty::getPrimitive(check(exp)), Primitive::INT_MUL);
+        EXPECT_EQ(typeIdOf("it"), Type::INT);
+        resetSymbols();
+    }
+    //endregion
+
+    //region "a" - "b"; no
+    {
+        auto exp = infix(constant(StringConAST("a")), "-",
+                         constant(StringConAST("b")));
+        EXPECT_FALSE(check(exp));
+        EXPECT_EQ(ASTProperty::getPrimitive(exp), Primitive::NONE);
+    }
+    //endregion
+
+    //region ~ 1.5; resolved to the real negation
+    {
+        auto exp = create(ApplicationExpAST(var("~"),
+                                            constant(FloatConAST(1.5))));
+        EXPECT_EQ(ASTProperty::getPrimitive(check(exp)), Primitive::REAL_NEG);
+        EXPECT_EQ(typeIdOf("it"), Type::REAL);
+    }
+    //endregion
+
+    //region ~ "a"; no
+    {
+        auto exp = create(ApplicationExpAST(var("~"),
+                                            constant(StringConAST("a"))));
+        EXPECT_FALSE(check(exp));
+    }
+    //endregion
+}
+
+TEST_F(InlinerTest, InlinerTest_Inline_Test) {
+    resetSymbols();
+
+    //region fun sq x = x * x; recorded
+    {
+        EXPECT_TRUE(check(fun("sq", "x", infix(var("x"), "*", var("x")))));
+        ASSERT_TRUE(inlineFunction("sq"));
+        EXPECT_EQ(inlineFunction("sq")->freeNames, set<string>{"*"});
+    }
+    //endregion
+
+    //region sq 3; inlined and folded to 9
+    {
+        auto result = check(app(var("sq"), create(ConstantExpAST(
+                create(IntConAST(3))))));
+        auto exp = AST::dynCast<ConstantExpAST>(result);
+        ASSERT_TRUE(exp);
+        EXPECT_EQ(AST::cast<IntConAST>(exp->getCon())->get(), 9);
+        EXPECT_EQ(semanticAnalyzer->getInlinedCalls(),
+                  (map<string, size_t>{{"sq", 1}}));
+    }
+    //endregion
+
+    //region val y = 2; val z = sq y; inlined to y * y and typed
+    {
+        EXPECT_TRUE(check(val("y", create(ConstantExpAST(
+                create(IntConAST(2)))))));
+        auto result = AST::dynCast<ValueDecAST>(
+                check(val("z", app(var("sq"), var("y")))));
+        ASSERT_TRUE(result);
+        auto valBind = AST::cast<DestructuringValBindAST>(result->getValBind());
+        auto exp = AST::dynCast<InfixApplicationExpAST>(valBind->getExp());
+        ASSERT_TRUE(exp);
+        EXPECT_EQ(ASTProperty::getType(exp)->getTypeId(), Type::INT);
+        EXPECT_EQ(ASTProperty::getType(exp->getExp1())->getTypeId(), Type::INT);
+        EXPECT_EQ(typeIdOf("z"), Type::INT);
+    }
+    //endregion
+
+    //region fun f x = sq x; fun g x = g x; the call is inlined in the body, and
+    // the recursive one is not recorded
+    {
+        EXPECT_TRUE(check(fun("f", "x", app(var("sq"), var("x")))));
+        ASSERT_TRUE(inlineFunction("f"));
+        EXPECT_EQ(inlineFunction("f")->body->getKind(),
+                  ASTKind::InfixApplicationExpAST);
+        EXPECT_TRUE(check(fun("g", "x", app(var("g"), var("x")))));
+        EXPECT_FALSE(inlineFunction("g"));
+    }
+    //endregion
+
+    //region fun h x = x + y; val y = 3; h is dropped as y is bound again
+    {
+        EXPECT_TRUE(check(fun("h", "x", infix(var("x"), "+", var("y")))));
+        EXPECT_TRUE(inlineFunction("h"));
+        EXPECT_TRUE(check(val("y", create(ConstantExpAST(
+                create(IntConAST(3)))))));
+        EXPECT_FALSE(inlineFunction("h"));
+        EXPECT_TRUE(inlineFunction("sq"));
+    }
+    //endregion
+
+    //region val y = 3; fun h x = x + y; let val y = 100 in h 1 end; not
+    // inlined, as the body would refer to the local y
+    {
+        EXPECT_TRUE(check(val("y", create(ConstantExpAST(
+                create(IntConAST(3)))))));
+        EXPECT_TRUE(check(fun("h", "x", infix(var("x"), "+", var("y")))));
+        ASSERT_TRUE(inlineFunction("h"));
+        auto exp = create(LocalDeclarationExpAST(
+                val("y", create(ConstantExpAST(create(IntConAST(100))))),
+                {app(var("h"), create(ConstantExpAST(
+                        create(IntConAST(1)))))}));
+        EXPECT_EQ(check(exp), exp);
+        EXPECT_TRUE(semanticAnalyzer->getInlinedCalls().empty());
+    }
+    //endregion
+
+    //region h y; not inlined, as the argument is named as the free y
+    {
+        auto exp = app(var("h"), var("y"));
+        EXPECT_EQ(check(exp), exp);
+        EXPECT_TRUE(semanticAnalyzer->getInlinedCalls().empty());
+    }
+    //endregion
+
+    //region fn sq : int -> int => sq 3; a local name is not inlined
+    {
+        auto intTyp = create(ConstructorTypAST(
+                create(LongIdAST({create(AlphanumericIdAST("int"))}))));
+        auto exp = create(FunctionExpAST(
+                create(MatchAST(
+                        create(TypeAnnotationPatAST(
+                                create(VariablePatAST(
+                                        create(AlphanumericIdAST("sq")))),
+                                create(FunctionTypAST(intTyp, intTyp)))),
+                        app(var("sq"), create(ConstantExpAST(
+                                create(IntConAST(3)))))))));
+        EXPECT_EQ(check(exp), exp);
+        EXPECT_TRUE(semanticAnalyzer->getInlinedCalls().empty());
+    }
+    //endregion
+
+    //region sq 3; not inlined with a threshold of 0
+    {
+        semanticAnalyzer->setInlineThreshold(0);
+        auto exp = app(var("sq"), create(ConstantExpAST(
+                create(IntConAST(3)))));
+        EXPECT_EQ(check(exp, true), exp);
+        EXPECT_TRUE(semanticAnalyzer->getInlinedCalls().empty());
+    }
+    //endregion
+
+    resetSymbols();
+}
+
+TEST_F(UnifyTest, UnifyTest_UnionFind_Test) {
+    auto a = VariableTypeNameType::create("'a");
+    auto b = VariableTypeNameType::create("'b");
+    auto c = VariableTypeNameType::create("'c");
+    auto intType = IntType::create();
+    auto realType = RealType::create();
+    {
+        TypeCheck typeCheck;
+        EXPECT_TRUE(typeCheck.unify(a, b));
+        EXPECT_TRUE(typeCheck.unify(c, b));
+        EXPECT_TRUE(typeCheck.unify(ListType::create(c), ListType::create(intType)));
+        EXPECT_EQ(typeCheck.verify(a), intType);
+        EXPECT_EQ(typeCheck.verify(b), intType);
+        EXPECT_FALSE(typeCheck.unify(a, realType));
+    }
+    // the unification is undone with the check.
+    for (auto var : {a, b, c}) {
+        EXPECT_EQ(var->getParent(), nullptr);
+        EXPECT_EQ(var->getRank(), 0u);
+    }
+    TypeCheck typeCheck;
+    EXPECT_TRUE(typeCheck.unify(a, realType));
+    EXPECT_EQ(typeCheck.verify(a), realType);
+    EXPECT_EQ(typeCheck.verify(b), b);
+}
+
+TEST_F(OccursCheckTest, OccursCheckTest_Circular_Test) {
+    auto a = VariableTypeNameType::create("'a");
+    auto b = VariableTypeNameType::create("'b");
+    {
+        TypeCheck typeCheck(true);
+        EXPECT_FALSE(typeCheck.unify(a, ListType::create(a)));
+        EXPECT_FALSE(typeCheck.unify(FunctionType::create(IntType::create(), a),
+                                     a));
+        EXPECT_EQ(typeCheck.verify(a), a);
+    }
+    // a type sharing its components, i.e. ('a * 'a) * ('a * 'a) and so on,
+    // is walked once per component.
+    Type *shared = a;
+    for (auto i = 0; i < 64; ++i) {
+        shared = TupleType::create({shared, shared});
+    }
+    {
+        TypeCheck typeCheck(true);
+        EXPECT_TRUE(typeCheck.unify(b, shared));
+        EXPECT_FALSE(typeCheck.unify(a, ListType::create(b)));
+        EXPECT_TRUE(typeCheck.unify(a, IntType::create()));
+        auto type = typeCheck.verify(b);
+        ASSERT_TRUE(type);
+        for (auto i = 0; i < 64; ++i) {
+            ASSERT_EQ(type->getTypeId(), Type::TUPLE);
+            auto &&types = type->toTupleType()->getTypes();
+            ASSERT_EQ(types.size(), 2u);
+            EXPECT_EQ(types[0], types[1]);
+            type = types[0];
+        }
+        EXPECT_EQ(type, IntType::create());
+    }
+
+    //region fun f x = f; must be wrong
+    {
+        resetSymbols();
+        EXPECT_FALSE(check(fun("f", "x", var("f"))));
+    }
+    //endregion
+}
+
+TEST_F(RecordTest, RecordTest_Select_Test) {
+    auto intType = IntType::create();
+    auto realType = RealType::create();
+    auto a = VariableTypeNameType::create("'a");
+    auto b = VariableTypeNameType::create("'b");
+    {
+        TypeCheck typeCheck(true);
+        auto record1 = RecordType::create({{"a", a}, {"b", intType}});
+        auto record2 = RecordType::create({{"b", b}, {"a", realType}});
+        EXPECT_TRUE(typeCheck.unify(record1, record2));
+        EXPECT_EQ(typeCheck.verify(record1),
+                  RecordType::create({{"a", realType}, {"b", intType}}));
+        EXPECT_FALSE(typeCheck.unify(RecordType::create({{"a", intType}}),
+                                     RecordType::create({{"b", intType}})));
+    }
+
+    //region val f = fn (r : {b: real, a: int}) => #b r; ok
+    {
+        resetSymbols();
+        auto fn = selectFn(record({{"b", "real"}, {"a", "int"}}), "b");
+        EXPECT_TRUE(check(val("f", fn)));
+        EXPECT_EQ(typeOf("f"), FunctionType::create(
+                realType,
+                RecordType::create({{"a", intType}, {"b", realType}})));
+        // the fields are sorted by their labels.
+        auto selector = AST::cast<RecordSelectorExpAST>(
+                AST::cast<ApplicationExpAST>(fn->getMatch()->getExp())
+                        ->getExp1());
+        EXPECT_EQ(ASTProperty::getFieldOffset(selector), 1);
+    }
+    //endregion
+
+    //region the same val f checked again, the offset is reused too
+    {
+        auto fn = selectFn(record({{"b", "real"}, {"a", "int"}}), "b");
+        EXPECT_TRUE(check(val("f", fn), true));
+        EXPECT_EQ(semanticAnalyzer->getTypeCacheStatistics().hits, 1u);
+        auto selector = AST::cast<RecordSelectorExpAST>(
+                AST::cast<ApplicationExpAST>(fn->getMatch()->getExp())
+                        ->getExp1());
+        EXPECT_EQ(ASTProperty::getFieldOffset(selector), 1);
+    }
+    //endregion
+
+    //region fn (r : {a: int}) => #c r; must be wrong
+    {
+        resetSymbols();
+        EXPECT_FALSE(check(selectFn(record({{"a", "int"}}), "c")));
+    }
+    //endregion
+
+    //region fn r => #a r; must be wrong, as the record is not known
+    {
+        resetSymbols();
+        EXPECT_FALSE(check(selectFn(nullptr, "a")));
+    }
+    //endregion
+}
+
+TEST_F(GeneralizationTest, GeneralizationTest_LetPolymorphism_Test) {
+    resetSymbols();
+
+    //region fun id x = x; val a = id 1; val b = id true; ok
+    {
+        EXPECT_TRUE(check(create(SequenceDecAST({
+                fun("id", "x", var("x")),
+                val("a", app(var("id"), constant(1))),
+                val("b", app(var("id"), constant(true)))}))));
+        ASSERT_TRUE(typeOf("id"));
+        ASSERT_EQ(typeIdOf("id"), Type::FUNCTION);
+        auto param = typeOf("id")->toFunctionType()->getParameterType();
+        ASSERT_EQ(param->getTypeId(), Type::VARIABLE_TYPE_NAME);
+        EXPECT_TRUE(param->toVariableTypeNameType()->isGeneric());
+        resetSymbols();
+    }
+    //endregion
+
+    //region let val f = fn y => y in (f 1, f true) end; ok
+    {
+        EXPECT_TRUE(check(create(LocalDeclarationExpAST(
+                val("f", fn("y", var("y"))),
+                {create(TupleExpAST({app(var("f"), constant(1)),
+                                     app(var("f"), constant(true))}))}))));
+        resetSymbols();
+    }
+    //endregion
+
+    //region fn x => let val y = x in y + 1 end; ok int -> int, the type of y
+    // is not generalized as it is of x
+    {
+        EXPECT_TRUE(check(fn("x", create(LocalDeclarationExpAST(
+                val("y", var("x")),
+                {infix(var("y"), "+", constant(1))})))));
+        ASSERT_TRUE(typeOf("it"));
+        ASSERT_EQ(typeIdOf("it"), Type::FUNCTION);
+        auto funType = typeOf("it")->toFunctionType();
+        EXPECT_EQ(funType->getParameterType()->getTypeId(), Type::INT);
+        EXPECT_EQ(funType->getReturnType()->getTypeId(), Type::INT);
+        resetSymbols();
+    }
+    //endregion
+
+    //region fn x => let val y = x in (y 1, y true) end; no
+    {
+        EXPECT_FALSE(check(fn("x", create(LocalDeclarationExpAST(
+                val("y", var("x")),
+                {create(TupleExpAST({app(var("y"), constant(1)),
+                                     app(var("y"), constant(true))}))})))));
+        resetSymbols();
+    }
+    //endregion
+}
+
+TEST_F(TypeCacheTest, TypeCacheTest_Reuse_Test) {
+    resetSymbols();
+
+    //region fun inc x = x + 1; twice, the second reuses the types
+    {
+        auto first = fun("inc", "x", infix(var("x"), "+", constant(1)));
+        EXPECT_TRUE(check(first));
+        auto type = typeOf("inc");
+        auto body = infix(var("x"), "+", constant(1));
+        EXPECT_TRUE(check(fun("inc", "x", body), true));
+        auto statistics = semanticAnalyzer->getTypeCacheStatistics();
+        EXPECT_EQ(statistics.hits, 1u);
+        EXPECT_EQ(statistics.misses, 1u);
+        EXPECT_EQ(typeOf("inc"), type);
+        ASSERT_TRUE(ASTProperty::getType(body));
+        EXPECT_EQ(ASTProperty::getType(body)->getTypeId(), Type::INT);
+        resetSymbols();
+    }
+    //endregion
+
+    //region val y = x; with x of int, then of bool, then of int again
+    {
+        SymbolTable::getInstance()->insertPatternType("x", IntType::create());
+        EXPECT_TRUE(check(val("y", var("x"))));
+        SymbolTable::getInstance()->insertPatternType("x", BoolType::create());
+        EXPECT_TRUE(check(val("y", var("x")), true));
+        EXPECT_EQ(typeIdOf("y"), Type::BOOL);
+        SymbolTable::getInstance()->insertPatternType("x", IntType::create());
+        EXPECT_TRUE(check(val("y", var("x")), true));
+        EXPECT_EQ(typeIdOf("y"), Type::INT);
+        auto statistics = semanticAnalyzer->getTypeCacheStatistics();
+        EXPECT_EQ(statistics.hits, 1u);
+        EXPECT_EQ(statistics.misses, 2u);
+        resetSymbols();
+    }
+    //endregion
+
+    //region val z = x; with x of 'a, then of 'b, the same up to renaming
+    {
+        addPattern("x", "'a");
+        EXPECT_TRUE(check(val("z", var("x"))));
+        addPattern("x", "'b");
+        EXPECT_TRUE(check(val("z", var("x")), true));
+        EXPECT_EQ(semanticAnalyzer->getTypeCacheStatistics().hits, 1u);
+        resetSymbols();
+    }
+    //endregion
+
+    //region fun id x = x; twice, the reused types outlive the first check
+    {
+        EXPECT_TRUE(check(fun("id", "x", var("x"))));
+        auto body = var("x");
+        EXPECT_TRUE(check(fun("id", "x", body), true));
+        auto type = ASTProperty::getType(body);
+        ASSERT_TRUE(type);
+        ASSERT_EQ(type->getTypeId(), Type::VARIABLE_TYPE_NAME);
+        EXPECT_TRUE(type->toVariableTypeNameType()->isNamed());
+        resetSymbols();
+    }
+    //endregion
+}
+
+TEST_F(ParallelCheckTest, ParallelCheckTest_SameAsSequential_Test) {
+    resetSymbols();
+    auto program = [this]() -> std::vector<shared_ptr<AST>> {
+        return {fun("id", "x", var("x")),
+                val("a", app(var("id"), constant(1))),
+                val("b", app(var("id"), constant(true))),
+                fun("inc", "y", infix(var("y"), "+", constant(1))),
+                val("c", app(var("inc"), var("a"))),
+                val("d", infix(var("a"), "+", constant(2))),
+                val("e", infix(var("b"), "+", constant(1))),
+                fun("twice", "z", app(var("inc"), app(var("inc"), var("z")))),
+                val("f", app(var("twice"), var("c"))),
+                val("g", var("it")),
+                val("a", constant(true)),
+                val("h", var("a"))};
+    };
+    std::vector<std::string> names{"id", "a", "b", "inc", "c", "d", "e",
+                                   "twice", "f", "g", "h", "x", "y", "z", "it"};
+
+    std::vector<bool> sequential;
+    for (auto &&ast : program()) {
+        sequential.push_back(bool(check(ast, true)));
+    }
+    auto expected = typesOf(names);
+    resetSymbols();
+
+    for (unsigned threads : {1u, 4u}) {
+        semanticAnalyzer = std::make_unique<SemanticAnalyzer>();
+        auto results = semanticAnalyzer->checkAll(program(), threads);
+        ASSERT_EQ(results.size(), sequential.size());
+        for (size_t i = 0; i < results.size(); ++i) {
+            EXPECT_EQ(bool(results[i]), sequential[i]) << i;
+        }
+        EXPECT_EQ(typesOf(names), expected);
+        resetSymbols();
+    }
+}
+
+TEST_F(ParallelCheckTest, ParallelCheckTest_Reentrant_Test) {
+    resetSymbols();
+
+    //region fn x => 1; checked around a check of val y = 1
+    {
+        TypeCheck outer;
+        ASSERT_TRUE(outer.dispatch(fn("x", constant(1))));
+        {
+            TypeCheck inner;
+            ASSERT_TRUE(inner.dispatch(val("y", constant(1))));
+            inner.fillTypes();
+        }
+        outer.fillTypes();
+        ASSERT_TRUE(typeOf("x"));
+        EXPECT_EQ(typeIdOf("x"), Type::VARIABLE_TYPE_NAME);
+        ASSERT_TRUE(typeOf("y"));
+        EXPECT_EQ(typeIdOf("y"), Type::INT);
+        resetSymbols();
+    }
+    //endregion
+}
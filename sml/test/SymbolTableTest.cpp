@@ -1,4 +1,9 @@
 #include "gtest/gtest.h"
+#include "llvm/IR/LLVMContext.h"
+#include "src/Common/Symbol/FlatMap.h"
+#include "src/Common/Symbol/PersistentMap.h"
+#include "src/Common/Symbol/Region.h"
+#include "src/Common/Symbol/ScopedTable.h"
 #include "src/Common/Symbol/SymbolTable.h"
 
 class SymbolTableTest : public testing::Test {
@@ -15,3 +20,328 @@ TEST_F(SymbolTableTest, SymbolTableTest_NewDeleteMemory_Test) {
     delete ltibtype;
     delete ltibtype;
 }
+
+TEST_F(SymbolTableTest, SymbolTableTest_InternTypes_Test) {
+    auto itype = IntType::create();
+    auto btype = BoolType::create();
+    auto tuple = TupleType::create({itype, btype});
+    EXPECT_EQ(tuple, TupleType::create({itype, btype}));
+    EXPECT_NE(tuple, TupleType::create({btype, itype}));
+    llvm::LLVMContext context;
+    EXPECT_EQ(tuple->getLLVMType(context),
+              TupleType::create({itype, btype})->getLLVMType(context));
+
+    auto list = ListType::create(tuple);
+    EXPECT_EQ(list, ListType::create(TupleType::create({itype, btype})));
+    EXPECT_NE(list, ListType::create(itype));
+
+    auto fun = FunctionType::create(list, itype);
+    EXPECT_EQ(fun, FunctionType::create(list, itype));
+    EXPECT_EQ(fun, FunctionType::create({{list, itype}}));
+    EXPECT_NE(fun, FunctionType::create(itype, list));
+
+    auto record = RecordType::create({{"a", itype}, {"b", list}});
+    EXPECT_EQ(record, RecordType::create({{"b", list}, {"a", itype}}));
+    EXPECT_EQ(record->getFieldType(RecordType::getLabel("b")), list);
+    EXPECT_EQ(record->getFieldOffset(RecordType::getLabel("b")), 1);
+    EXPECT_EQ(record->getFieldOffset(RecordType::getLabel("c")), -1);
+    EXPECT_NE(record, RecordType::create({{"a", itype}}));
+
+    // variables of the same name are still distinct, and so are the types
+    // built of them.
+    auto var1 = VariableTypeNameType::create("'a");
+    auto var2 = VariableTypeNameType::create("'a");
+    EXPECT_NE(var1, var2);
+    EXPECT_NE(ListType::create(var1), ListType::create(var2));
+    EXPECT_EQ(ListType::create(var1), ListType::create(var1));
+
+    auto before = Type::getInternStatistics();
+    TupleType::create({itype, btype});
+    TupleType::create({itype, itype, btype});
+    auto after = Type::getInternStatistics();
+    EXPECT_EQ(after.hits, before.hits + 1);
+    EXPECT_EQ(after.misses, before.misses + 1);
+}
+
+TEST_F(SymbolTableTest, SymbolTableTest_NumberedVariables_Test) {
+    EXPECT_EQ(VariableTypeNameType::getName(0), "'a");
+    EXPECT_EQ(VariableTypeNameType::getName(25), "'z");
+    EXPECT_EQ(VariableTypeNameType::getName(26), "'aa");
+    EXPECT_EQ(VariableTypeNameType::getName(27), "'ab");
+    EXPECT_EQ(VariableTypeNameType::getName(701), "'zz");
+    EXPECT_EQ(VariableTypeNameType::getName(702), "'aaa");
+
+    VariableTypeNameType::Pool pool;
+    std::vector<VariableTypeNameType *> vars;
+    for (int i = 0; i < 100; ++i) {
+        vars.push_back(pool.create());
+    }
+    EXPECT_FALSE(vars[0]->isNamed());
+    EXPECT_EQ(vars[0]->getVar(), "'a");
+    EXPECT_EQ(vars[99]->getVar(), VariableTypeNameType::getName(99));
+    EXPECT_NE(vars[0], vars[1]);
+    EXPECT_TRUE(VariableTypeNameType::create("'a")->isNamed());
+}
+
+TEST_F(SymbolTableTest, SymbolTableTest_Scopes_Test) {
+    auto itype = IntType::create();
+    auto btype = BoolType::create();
+    auto rtype = RealType::create();
+    SymbolTable::reset();
+    auto symbolTable = SymbolTable::getInstance();
+    symbolTable->insertPatternType("x", itype);
+    {
+        SymbolTable::ScopeGuard _1{symbolTable};
+        symbolTable->insertPatternType("x", btype);
+        symbolTable->insertPatternType("y", btype);
+        symbolTable->setOperator("++", {SymbolTable::Operator::INFIX, 5});
+        {
+            SymbolTable::ScopeGuard _2{symbolTable};
+            symbolTable->insertPatternType("x", rtype);
+            symbolTable->removePatternType("y");
+            EXPECT_EQ(symbolTable->getPatternType("x"), rtype);
+            EXPECT_EQ(symbolTable->getPatternType("y"), nullptr);
+        }
+        // the shadowed bindings are restored.
+        EXPECT_EQ(symbolTable->getPatternType("x"), btype);
+        EXPECT_EQ(symbolTable->getPatternType("y"), btype);
+        EXPECT_TRUE(symbolTable->getOperator("++"));
+    }
+    EXPECT_EQ(symbolTable->getPatternType("x"), itype);
+    EXPECT_EQ(symbolTable->getPatternType("y"), nullptr);
+    EXPECT_FALSE(symbolTable->getOperator("++"));
+    EXPECT_EQ(symbolTable->getType("int"), itype);
+    SymbolTable::reset();
+
+    // the outermost bindings are visited in the order they are first bound.
+    ScopedTable<std::string, int> table;
+    table.insert("b", 1);
+    table.insert("a", 2);
+    table.enterScope();
+    table.insert("c", 3);
+    table.insert("b", 4);
+    table.leaveScope();
+    table.insert("b", 5);
+    std::vector<std::pair<std::string, int>> outermost;
+    table.forEachOutermost([&outermost](auto &&key, int value) {
+        outermost.emplace_back(key, value);
+    });
+    EXPECT_EQ(outermost, (std::vector<std::pair<std::string, int>>{
+            {"b", 5}, {"a", 2}}));
+}
+
+TEST_F(SymbolTableTest, SymbolTableTest_Region_Test) {
+    Region region(1024);
+    {
+        Region::Scope _1{region};
+        EXPECT_EQ(&Region::getCurrent(), &region);
+        auto var = VariableTypeNameType::create("'x");
+        auto tuple = TupleType::create({var, IntType::create()});
+        EXPECT_EQ(tuple, TupleType::create({var, IntType::create()}));
+        // an interned type with a child in the region is allocated there, so
+        // it is released with the region, the others in the process.
+        EXPECT_TRUE(region.contains(var));
+        EXPECT_TRUE(region.contains(tuple));
+        EXPECT_EQ(&tuple->getRegion(), &region);
+        EXPECT_EQ(&IntType::create()->getRegion(), &Region::getProcess());
+        auto list = ListType::create(tuple);
+        EXPECT_TRUE(region.contains(list));
+        EXPECT_FALSE(region.contains(TupleType::create({IntType::create()})));
+        auto statistics = region.getStatistics();
+        EXPECT_EQ(statistics.allocations, 3u);
+        EXPECT_GE(statistics.bytes, sizeof(*var) + sizeof(*tuple));
+        EXPECT_EQ(statistics.chunks, 1u);
+        EXPECT_EQ(statistics.reserved, 1024u);
+
+        // the types with a child in the region, directly or not, are
+        // forgotten.
+        auto kept = ListType::create(IntType::create());
+        Type::clearInterned(region);
+        EXPECT_NE(tuple, TupleType::create({var, IntType::create()}));
+        EXPECT_NE(list, ListType::create(tuple));
+        EXPECT_EQ(kept, ListType::create(IntType::create()));
+        // those interned since are forgotten before the region is released.
+        Type::clearInterned(region);
+    }
+    EXPECT_NE(&Region::getCurrent(), &region);
+
+    // the allocations are bumped through a chunk, aligned for any type, and
+    // a large one is given a chunk of its own.
+    auto p1 = static_cast<char *>(region.allocate(1));
+    auto p2 = static_cast<char *>(region.allocate(1));
+    EXPECT_EQ(p2 - p1, ptrdiff_t(alignof(std::max_align_t)));
+    region.allocate(4096);
+    EXPECT_EQ(region.allocate(1), p2 + alignof(std::max_align_t));
+    auto statistics = region.getStatistics();
+    EXPECT_EQ(statistics.allocations, 9u);
+    EXPECT_EQ(statistics.chunks, 2u);
+    EXPECT_EQ(statistics.reserved, 1024u + 4096u);
+
+    region.release();
+    statistics = region.getStatistics();
+    EXPECT_EQ(statistics.allocations, 9u);
+    EXPECT_EQ(statistics.chunks, 0u);
+    EXPECT_EQ(statistics.reserved, 0u);
+    EXPECT_TRUE(region.allocate(1));
+
+    // the finalizers run on release, the last added first.
+    static std::vector<int> finalized;
+    for (int i = 0; i < 3; ++i) {
+        auto number = new(region.allocate(sizeof(int))) int(i);
+        region.addFinalizer([](void *p) {
+            finalized.push_back(*static_cast<int *>(p));
+        }, number);
+    }
+    EXPECT_TRUE(finalized.empty());
+    region.release();
+    EXPECT_EQ(finalized, std::vector<int>({2, 1, 0}));
+    region.release();
+    EXPECT_EQ(finalized.size(), 3u);
+}
+
+TEST_F(SymbolTableTest, SymbolTableTest_Instances_Test) {
+    SymbolTable first, second;
+    EXPECT_EQ(first.getType("int"), IntType::create());
+    EXPECT_EQ(second.getType("int"), IntType::create());
+
+    first.insertPatternType("x", IntType::create());
+    first.setOperator("++", {SymbolTable::Operator::INFIX, 5});
+    second.insertPatternType("x", BoolType::create());
+    EXPECT_EQ(first.getPatternType("x"), IntType::create());
+    EXPECT_EQ(second.getPatternType("x"), BoolType::create());
+    EXPECT_TRUE(first.getOperator("++"));
+    EXPECT_FALSE(second.getOperator("++"));
+    EXPECT_FALSE(SymbolTable::getInstance()->getPatternType("x"));
+}
+
+TEST_F(SymbolTableTest, SymbolTableTest_PersistentMap_Test) {
+    PersistentMap<int, int> map;
+    for (int i = 0; i < 1000; ++i) {
+        map.insert(i, i);
+    }
+    auto copy = map;
+    for (int i = 0; i < 1000; i += 2) {
+        copy.insert(i, -i);
+    }
+    for (int i = 1; i < 1000; i += 4) {
+        copy.erase(i);
+    }
+    copy.insert(1000, 1000);
+    EXPECT_EQ(map.size(), 1000u);
+    EXPECT_EQ(copy.size(), 751u);
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(map.find(i));
+        EXPECT_EQ(*map.find(i), i);
+        auto found = copy.find(i);
+        if (i % 4 == 1) {
+            EXPECT_FALSE(found);
+        } else {
+            ASSERT_TRUE(found);
+            EXPECT_EQ(*found, i % 2 ? i : -i);
+        }
+    }
+    EXPECT_FALSE(map.find(1000));
+
+    // the keys of a hash are kept below the bits of the hashes.
+    struct Colliding {
+        size_t operator()(int) const { return 42; }
+    };
+    PersistentMap<int, int, Colliding> collisions;
+    collisions.insert(1, 1);
+    collisions.insert(2, 2);
+    auto collisionsCopy = collisions;
+    collisionsCopy.erase(1);
+    EXPECT_EQ(*collisions.find(1), 1);
+    EXPECT_FALSE(collisionsCopy.find(1));
+    EXPECT_EQ(*collisionsCopy.find(2), 2);
+    size_t visited = 0;
+    collisions.forEach([&visited](int, int) { ++visited; });
+    EXPECT_EQ(visited, 2u);
+}
+
+TEST_F(SymbolTableTest, SymbolTableTest_Fork_Test) {
+    SymbolTable library;
+    library.insertPatternType("x", IntType::create());
+    library.setOperator("++", {SymbolTable::Operator::INFIX, 5});
+    library.enterScope();
+    library.insertPatternType("y", IntType::create());
+
+    // a fork has the bindings of the innermost scope, in a scope of its own.
+    auto fork = library.fork();
+    library.leaveScope();
+    EXPECT_FALSE(library.getPatternType("y"));
+    EXPECT_EQ(fork->getPatternType("y"), IntType::create());
+    fork->leaveScope();
+    EXPECT_EQ(fork->getPatternType("y"), IntType::create());
+
+    fork->insertPatternType("x", BoolType::create());
+    fork->setOperator("--", {SymbolTable::Operator::INFIX, 5});
+    EXPECT_EQ(library.getPatternType("x"), IntType::create());
+    EXPECT_EQ(fork->getPatternType("x"), BoolType::create());
+    EXPECT_TRUE(fork->getOperator("++"));
+    EXPECT_FALSE(library.getOperator("--"));
+    EXPECT_EQ(fork->getType("int"), IntType::create());
+}
+
+TEST_F(SymbolTableTest, SymbolTableTest_Builtins_Test) {
+    Region region;
+    Region::Scope _1{region};
+    SymbolTable first;
+    SymbolTable second;
+    auto add = first.getBuiltinValue("+");
+    ASSERT_TRUE(add);
+    EXPECT_TRUE(add->toFunctionValue()->isOverloaded());
+    EXPECT_EQ(add->toFunctionValue()->getPriority(), 6);
+    EXPECT_EQ(first.getType("string"), StringType::create());
+    ASSERT_TRUE(first.getOperator("div"));
+    EXPECT_EQ(first.getOperator("div")->priority, 7);
+
+    // the builtin symbols are shared, not created in the region.
+    EXPECT_EQ(second.getBuiltinValue("+"), add);
+    EXPECT_FALSE(region.contains(add));
+    EXPECT_EQ(region.getStatistics().allocations, 0u);
+
+    first.insertValue("+", IntValue::create(1));
+    EXPECT_EQ(second.getBuiltinValue("+"), add);
+}
+
+TEST_F(SymbolTableTest, SymbolTableTest_FlatMap_Test) {
+    EXPECT_EQ(Name::intern("flat0"), Name::intern("flat0"));
+    EXPECT_NE(Name::intern("flat0"), Name::intern("flat1"));
+    EXPECT_EQ(Name::intern("flat0").get(), "flat0");
+    EXPECT_FALSE(Name::find("never interned"));
+
+    FlatMap<int> map;
+    for (int i = 0; i < 1000; ++i) {
+        map.insert("flat" + std::to_string(i), i);
+    }
+    for (int i = 1; i < 1000; i += 3) {
+        map.erase("flat" + std::to_string(i));
+    }
+    map.insert("flat0", -1);
+    EXPECT_EQ(map.size(), 667u);
+    map.resetStatistics();
+    for (int i = 0; i < 1000; ++i) {
+        auto found = map.find("flat" + std::to_string(i));
+        if (i % 3 == 1) {
+            EXPECT_FALSE(found);
+        } else {
+            ASSERT_TRUE(found);
+            EXPECT_EQ(*found, i ? i : -1);
+        }
+    }
+    EXPECT_EQ(map.getStatistics().hits, 667u);
+    EXPECT_EQ(map.getStatistics().misses, 333u);
+
+    // a lookup never binds a name, nor interns it.
+    EXPECT_EQ(map.lookup("never interned"), 0);
+    EXPECT_FALSE(Name::find("never interned"));
+    EXPECT_EQ(map.size(), 667u);
+
+    SymbolTable symbolTable;
+    EXPECT_TRUE(symbolTable.getType("int"));
+    EXPECT_FALSE(symbolTable.getType("never interned"));
+    EXPECT_TRUE(symbolTable.getOperator("div"));
+    EXPECT_EQ(symbolTable.getLookupStatistics().hits, 2u);
+    EXPECT_EQ(symbolTable.getLookupStatistics().misses, 1u);
+}